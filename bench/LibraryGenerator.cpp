@@ -0,0 +1,597 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "LibraryGenerator.hpp"
+
+using namespace MusicList;
+
+namespace
+{
+    const char* const GENRES[] = {"Rock", "Jazz", "Electronic", "Classical", "Hip-Hop", "Folk", "Metal", "Ambient"};
+    const char* const LABELS[] = {"Warp Records", "Blue Note", "Sub Pop", "Deutsche Grammophon", "Ninja Tune"};
+
+    // Lengths of the silence written after the headers.
+    const uint32_t OPUS_PACKETS = 50;
+    const uint32_t OPUS_PACKET_SAMPLES = 960;
+    const uint16_t OPUS_PRE_SKIP = 312;
+    const uint32_t VORBIS_PACKETS = 100;
+    const uint32_t VORBIS_PACKET_SAMPLES = 128;
+
+    void appendUInt16LE(string& out, uint16_t value)
+    {
+        out.push_back(static_cast<char>(value));
+        out.push_back(static_cast<char>(value >> 8));
+    }
+
+    void appendUInt32LE(string& out, uint32_t value)
+    {
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            out.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    void appendUInt64LE(string& out, uint64_t value)
+    {
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            out.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    void appendUIntBE(string& out, uint64_t value, uint32_t byteCount)
+    {
+        for (uint32_t i = byteCount; i > 0; i--)
+        {
+            out.push_back(static_cast<char>(value >> (8 * (i - 1))));
+        }
+    }
+
+    /**
+     * splitmix64, used to derive identifiers and filler bytes from a seed.
+     */
+    uint64_t mix(uint64_t value)
+    {
+        value += 0x9E3779B97F4A7C15ULL;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+        return value ^ (value >> 31);
+    }
+
+    string makeMbid(uint64_t seed)
+    {
+        const uint64_t high = mix(seed);
+        const uint64_t low = mix(high);
+
+        char mbid[37];
+        snprintf(mbid, sizeof(mbid), "%08x-%04x-4%03x-%04x-%012llx",
+                 static_cast<uint32_t>(high >> 32), static_cast<uint32_t>(high >> 16) & 0xFFFF,
+                 static_cast<uint32_t>(high) & 0xFFF, 0x8000 | (static_cast<uint32_t>(low >> 48) & 0x3FFF),
+                 static_cast<unsigned long long>(low & 0xFFFFFFFFFFFFULL));
+        return mbid;
+    }
+
+    string base64Encode(const string& data)
+    {
+        static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        string encoded;
+        encoded.reserve((data.size() + 2) / 3 * 4);
+        for (size_t i = 0; i < data.size(); i += 3)
+        {
+            const size_t remaining = data.size() - i;
+            uint32_t group = static_cast<uint8_t>(data[i]) << 16;
+            if (remaining > 1)
+            {
+                group |= static_cast<uint8_t>(data[i + 1]) << 8;
+            }
+            if (remaining > 2)
+            {
+                group |= static_cast<uint8_t>(data[i + 2]);
+            }
+
+            encoded.push_back(ALPHABET[(group >> 18) & 0x3F]);
+            encoded.push_back(ALPHABET[(group >> 12) & 0x3F]);
+            encoded.push_back(remaining > 1 ? ALPHABET[(group >> 6) & 0x3F] : '=');
+            encoded.push_back(remaining > 2 ? ALPHABET[group & 0x3F] : '=');
+        }
+        return encoded;
+    }
+
+    /**
+     * Vorbis comment block shared by all three formats, without the Vorbis framing bit.
+     */
+    string makeCommentBlock(const char* vendor, const vector<string>& comments, const string& picture)
+    {
+        const string pictureComment = picture.empty() ? string() : "METADATA_BLOCK_PICTURE=" + base64Encode(picture);
+
+        string block;
+        appendUInt32LE(block, static_cast<uint32_t>(strlen(vendor)));
+        block.append(vendor);
+        appendUInt32LE(block, static_cast<uint32_t>(comments.size() + (picture.empty() ? 0 : 1)));
+        for (const auto& comment : comments)
+        {
+            appendUInt32LE(block, static_cast<uint32_t>(comment.size()));
+            block.append(comment);
+        }
+        if (!pictureComment.empty())
+        {
+            appendUInt32LE(block, static_cast<uint32_t>(pictureComment.size()));
+            block.append(pictureComment);
+        }
+        return block;
+    }
+
+    /**
+     * Packs values least significant bit first, as Vorbis headers are.
+     */
+    class BitWriter
+    {
+    private:
+        string bytes;
+        uint32_t bitCount = 0;
+    public:
+        void write(uint32_t value, uint32_t width)
+        {
+            for (uint32_t i = 0; i < width; i++)
+            {
+                if (this->bitCount % 8 == 0)
+                {
+                    this->bytes.push_back(0);
+                }
+                if ((value >> i) & 1U)
+                {
+                    this->bytes.back() = static_cast<char>(this->bytes.back() | (1 << (this->bitCount % 8)));
+                }
+                this->bitCount++;
+            }
+        }
+
+        const string& data() const { return this->bytes; }
+    };
+
+    /**
+     * Lays out the packets of a single logical stream into Ogg pages.
+     */
+    class OggWriter
+    {
+    private:
+        string& out;
+        uint32_t serial;
+        uint32_t sequence = 0;
+
+        void writePage(const vector<uint8_t>& lacing, const string& body, uint8_t flags, uint64_t granule)
+        {
+            const size_t start = this->out.size();
+            this->out.append("OggS");
+            this->out.push_back(0);
+            this->out.push_back(static_cast<char>(flags));
+            appendUInt64LE(this->out, granule);
+            appendUInt32LE(this->out, this->serial);
+            appendUInt32LE(this->out, this->sequence++);
+            appendUInt32LE(this->out, 0);
+            this->out.push_back(static_cast<char>(lacing.size()));
+            this->out.append(lacing.begin(), lacing.end());
+            this->out.append(body);
+
+            const uint32_t checksum = LibraryGenerator::oggChecksum(
+                reinterpret_cast<const uint8_t*>(this->out.data() + start), this->out.size() - start);
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                this->out[start + 22 + i] = static_cast<char>(checksum >> (8 * i));
+            }
+        }
+    public:
+        OggWriter(string& out, uint32_t serial) : out(out), serial(serial) {}
+
+        /**
+         * @brief Writes packets starting on a new page and flushes the last page.
+         *
+         * @param packets packets to write
+         * @param granule granule position of pages on which a packet ends
+         * @param last true to mark the final page as the end of the stream
+         */
+        void writePackets(const vector<string>& packets, uint64_t granule, bool last)
+        {
+            vector<uint8_t> lacing;
+            string body;
+            bool continued = false;
+            bool packetEnded = false;
+
+            const auto flush = [&](bool final)
+            {
+                uint8_t flags = continued ? 0x01 : 0x00;
+                if (this->sequence == 0)
+                {
+                    flags |= 0x02;
+                }
+                if (final && last)
+                {
+                    flags |= 0x04;
+                }
+                this->writePage(lacing, body, flags, packetEnded ? granule : ~0ULL);
+                lacing.clear();
+                body.clear();
+                packetEnded = false;
+            };
+
+            for (const auto& packet : packets)
+            {
+                size_t offset = 0;
+                while (true)
+                {
+                    if (lacing.size() == 255)
+                    {
+                        flush(false);
+                        continued = offset > 0;
+                    }
+
+                    const size_t segment = std::min<size_t>(packet.size() - offset, 255);
+                    lacing.push_back(static_cast<uint8_t>(segment));
+                    body.append(packet, offset, segment);
+                    offset += segment;
+                    if (segment < 255)
+                    {
+                        packetEnded = true;
+                        break;
+                    }
+                }
+            }
+            flush(true);
+        }
+    };
+
+    void writeFile(const fs::path& path, const string& contents)
+    {
+        std::ofstream outFile = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        outFile.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        outFile.close();
+        if (outFile.fail())
+        {
+            throw std::runtime_error("Failed to write " + path.string());
+        }
+    }
+}
+
+uint32_t LibraryShape::trackCount() const
+{
+    return this->artistCount * this->albumsPerArtist * this->discsPerAlbum * this->tracksPerDisc;
+}
+
+uint32_t LibraryGenerator::oggChecksum(const uint8_t* data, size_t length)
+{
+    static const std::array<uint32_t, 256> TABLE = []
+    {
+        std::array<uint32_t, 256> table = {};
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t value = i << 24;
+            for (uint32_t bit = 0; bit < 8; bit++)
+            {
+                value = (value & 0x80000000U) ? (value << 1) ^ 0x04C11DB7U : value << 1;
+            }
+            table[i] = value;
+        }
+        return table;
+    }();
+
+    uint32_t checksum = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        checksum = (checksum << 8) ^ TABLE[((checksum >> 24) & 0xFF) ^ data[i]];
+    }
+    return checksum;
+}
+
+vector<string> LibraryGenerator::makeComments(uint32_t artist, uint32_t album, uint32_t disc, uint32_t track,
+                                              const LibraryShape& shape)
+{
+    const uint64_t albumSeed = (static_cast<uint64_t>(artist) << 32) | album;
+    const uint64_t trackSeed = (albumSeed << 16) ^ (static_cast<uint64_t>(disc) << 8) ^ track;
+    const string artistName = "Artist " + std::to_string(artist + 1);
+
+    char trackGain[16];
+    snprintf(trackGain, sizeof(trackGain), "%+.2f dB", -1.0 * static_cast<double>(mix(trackSeed) % 1200) / 100.0);
+    char albumGain[16];
+    snprintf(albumGain, sizeof(albumGain), "%+.2f dB", -1.0 * static_cast<double>(mix(albumSeed) % 1200) / 100.0);
+    char isrc[16];
+    snprintf(isrc, sizeof(isrc), "USML%02u%05u", 90 + (album % 10), static_cast<uint32_t>(trackSeed % 100000));
+
+    return {
+        "TITLE=Song " + std::to_string(track + 1) + " from Album " + std::to_string(album + 1),
+        "ARTIST=" + artistName,
+        "ALBUMARTIST=" + artistName,
+        "ALBUM=Album " + std::to_string(album + 1) + " by " + artistName,
+        "DATE=" + std::to_string(1970 + (mix(albumSeed) % 50)),
+        "GENRE=" + string(GENRES[mix(albumSeed) % (sizeof(GENRES) / sizeof(GENRES[0]))]),
+        "LABEL=" + string(LABELS[artist % (sizeof(LABELS) / sizeof(LABELS[0]))]),
+        "TRACKNUMBER=" + std::to_string(track + 1),
+        "TOTALTRACKS=" + std::to_string(shape.tracksPerDisc),
+        "DISCNUMBER=" + std::to_string(disc + 1),
+        "TOTALDISCS=" + std::to_string(shape.discsPerAlbum),
+        "ISRC=" + string(isrc),
+        "MUSICBRAINZ_ARTISTID=" + makeMbid(artist),
+        "MUSICBRAINZ_ALBUMARTISTID=" + makeMbid(artist),
+        "MUSICBRAINZ_ALBUMID=" + makeMbid(albumSeed ^ 0xA1B0000000000000ULL),
+        "MUSICBRAINZ_RELEASEGROUPID=" + makeMbid(albumSeed ^ 0x6E00000000000000ULL),
+        "MUSICBRAINZ_TRACKID=" + makeMbid(trackSeed ^ 0x7A00000000000000ULL),
+        "REPLAYGAIN_TRACK_GAIN=" + string(trackGain),
+        "REPLAYGAIN_TRACK_PEAK=0.988525",
+        "REPLAYGAIN_ALBUM_GAIN=" + string(albumGain),
+        "REPLAYGAIN_ALBUM_PEAK=0.999969"
+    };
+}
+
+string LibraryGenerator::makePicture(uint32_t pictureSize)
+{
+    if (pictureSize == 0)
+    {
+        return string();
+    }
+
+    const string mimeType = "image/jpeg";
+    string picture;
+    appendUIntBE(picture, 3, 4); // Front cover
+    appendUIntBE(picture, mimeType.size(), 4);
+    picture.append(mimeType);
+    appendUIntBE(picture, 0, 4); // Description
+    appendUIntBE(picture, 500, 4); // Width
+    appendUIntBE(picture, 500, 4); // Height
+    appendUIntBE(picture, 24, 4); // Colour depth
+    appendUIntBE(picture, 0, 4); // Palette size
+    appendUIntBE(picture, pictureSize, 4);
+
+    // JPEG markers around incompressible filler.
+    const size_t dataStart = picture.size();
+    uint64_t state = pictureSize;
+    for (uint32_t i = 0; i < pictureSize; i += 8)
+    {
+        state = mix(state);
+        picture.append(reinterpret_cast<const char*>(&state), std::min<size_t>(8, pictureSize - i));
+    }
+    const char markers[] = {'\xFF', '\xD8', '\xFF', '\xD9'};
+    for (uint32_t i = 0; i < 2 && i < pictureSize; i++)
+    {
+        picture[dataStart + i] = markers[i];
+        picture[picture.size() - 1 - i] = markers[3 - i];
+    }
+    return picture;
+}
+
+string LibraryGenerator::makeFlac(const vector<string>& comments, const string& picture, uint32_t paddingSize)
+{
+    const auto appendBlockHeader = [](string& out, uint8_t type, bool last, size_t length)
+    {
+        out.push_back(static_cast<char>(type | (last ? 0x80 : 0x00)));
+        appendUIntBE(out, length, 3);
+    };
+
+    string file = "fLaC";
+
+    // STREAMINFO: 4096-sample blocks of 16-bit stereo at 44.1kHz. The sample count is left
+    // unknown since no frames follow.
+    appendBlockHeader(file, 0, false, 34);
+    appendUIntBE(file, 4096, 2);
+    appendUIntBE(file, 4096, 2);
+    appendUIntBE(file, 0, 3);
+    appendUIntBE(file, 0, 3);
+    appendUIntBE(file, (44100ULL << 44) | (1ULL << 41) | (15ULL << 36), 8);
+    file.append(16, '\0');
+
+    const string comment = makeCommentBlock("reference libFLAC 1.3.3 20190804", comments, string());
+    appendBlockHeader(file, 4, false, comment.size());
+    file.append(comment);
+
+    if (!picture.empty())
+    {
+        appendBlockHeader(file, 6, false, picture.size());
+        file.append(picture);
+    }
+
+    appendBlockHeader(file, 1, true, paddingSize);
+    file.append(paddingSize, '\0');
+
+    return file;
+}
+
+string LibraryGenerator::makeOpus(const vector<string>& comments, const string& picture)
+{
+    string head = "OpusHead";
+    head.push_back(1); // Version
+    head.push_back(2); // Channels
+    appendUInt16LE(head, OPUS_PRE_SKIP);
+    appendUInt32LE(head, 44100);
+    appendUInt16LE(head, 0); // Output gain
+    head.push_back(0); // Channel mapping family
+
+    const string tags = "OpusTags" + makeCommentBlock("libopus 1.3.1", comments, picture);
+
+    // 20ms stereo CELT frames of silence.
+    const vector<string> audio = vector<string>(OPUS_PACKETS, string("\xFC\xFF\xFE", 3));
+
+    string file;
+    OggWriter writer = OggWriter(file, static_cast<uint32_t>(mix(comments.size() + tags.size())));
+    writer.writePackets({head}, 0, false);
+    writer.writePackets({tags}, 0, false);
+    writer.writePackets(audio, OPUS_PRE_SKIP + OPUS_PACKETS * OPUS_PACKET_SAMPLES, true);
+    return file;
+}
+
+string LibraryGenerator::makeVorbis(const vector<string>& comments, const string& picture)
+{
+    string identification = string("\x01vorbis", 7);
+    appendUInt32LE(identification, 0); // Version
+    identification.push_back(2); // Channels
+    appendUInt32LE(identification, 44100);
+    appendUInt32LE(identification, 0); // Maximum bitrate
+    appendUInt32LE(identification, 160000); // Nominal bitrate
+    appendUInt32LE(identification, 0); // Minimum bitrate
+    identification.push_back(static_cast<char>(0xB8)); // Block sizes of 256 and 2048
+    identification.push_back(1); // Framing bit
+
+    string comment = string("\x03vorbis", 7);
+    comment.append(makeCommentBlock("Xiph.Org libVorbis I 20200704 (Reducing Environment)", comments, picture));
+    comment.push_back(1); // Framing bit
+
+    // Smallest complete setup: one scalar codebook, a floor 1 without partitions, an empty
+    // residue 0 and a single short-block mode.
+    BitWriter setup;
+    setup.write(0, 8); // Codebook count - 1
+    setup.write(0x564342, 24);
+    setup.write(1, 16); // Dimensions
+    setup.write(2, 24); // Entries
+    setup.write(0, 1); // Ordered
+    setup.write(0, 1); // Sparse
+    setup.write(0, 5); // Entry length - 1
+    setup.write(0, 5);
+    setup.write(0, 4); // Lookup type
+    setup.write(0, 6); // Time domain transform count - 1
+    setup.write(0, 16);
+    setup.write(0, 6); // Floor count - 1
+    setup.write(1, 16); // Floor type
+    setup.write(0, 5); // Partitions
+    setup.write(0, 2); // Multiplier - 1
+    setup.write(8, 4); // Range bits
+    setup.write(0, 6); // Residue count - 1
+    setup.write(0, 16); // Residue type
+    setup.write(0, 24); // Begin
+    setup.write(0, 24); // End
+    setup.write(0, 24); // Partition size - 1
+    setup.write(0, 6); // Classifications - 1
+    setup.write(0, 8); // Classbook
+    setup.write(0, 3); // Cascade low bits
+    setup.write(0, 1); // Cascade high bits flag
+    setup.write(0, 6); // Mapping count - 1
+    setup.write(0, 16); // Mapping type
+    setup.write(0, 1); // Submaps flag
+    setup.write(0, 1); // Coupling flag
+    setup.write(0, 2); // Reserved
+    setup.write(0, 8); // Submap time config
+    setup.write(0, 8); // Submap floor
+    setup.write(0, 8); // Submap residue
+    setup.write(0, 6); // Mode count - 1
+    setup.write(0, 1); // Block flag
+    setup.write(0, 16); // Window type
+    setup.write(0, 16); // Transform type
+    setup.write(0, 8); // Mapping
+    setup.write(1, 1); // Framing bit
+    const string setupPacket = string("\x05vorbis", 7) + setup.data();
+
+    // Audio packets with every channel's floor unused decode to silence.
+    const vector<string> audio = vector<string>(VORBIS_PACKETS, string(1, '\0'));
+
+    string file;
+    OggWriter writer = OggWriter(file, static_cast<uint32_t>(mix(comments.size() + comment.size())));
+    writer.writePackets({identification}, 0, false);
+    writer.writePackets({comment, setupPacket}, 0, false);
+    writer.writePackets(audio, (VORBIS_PACKETS - 1) * VORBIS_PACKET_SAMPLES, true);
+    return file;
+}
+
+uint32_t LibraryGenerator::generate(const fs::path& root, const LibraryShape& shape)
+{
+    if (shape.formats.empty())
+    {
+        throw std::runtime_error("No formats to generate.");
+    }
+
+    const string picture = makePicture(shape.pictureSize);
+    uint32_t written = 0;
+    uint32_t albumIndex = 0;
+
+    for (uint32_t artist = 0; artist < shape.artistCount; artist++)
+    {
+        char artistDir[32];
+        snprintf(artistDir, sizeof(artistDir), "Artist %u", artist + 1);
+
+        for (uint32_t album = 0; album < shape.albumsPerArtist; album++, albumIndex++)
+        {
+            const AudioFormat format = shape.formats[albumIndex % shape.formats.size()];
+            const char* extension;
+            switch (format)
+            {
+                case AudioFormat::flac:
+                    extension = "flac";
+                    break;
+                case AudioFormat::opus:
+                    extension = "opus";
+                    break;
+                case AudioFormat::vorbis:
+                    extension = "ogg";
+                    break;
+                default:
+                    throw std::runtime_error("Only FLAC, Opus and Vorbis libraries can be generated.");
+            }
+
+            char albumDir[32];
+            snprintf(albumDir, sizeof(albumDir), "%u - Album %u", 1970 + album, album + 1);
+            const fs::path albumPath = root / artistDir / albumDir;
+            fs::create_directories(albumPath);
+
+            writeFile(albumPath / "cover.jpg", picture.empty() ? makePicture(1024) : picture);
+            writeFile(albumPath / "rip.log", "Generated by musiclist-bench.\n");
+
+            for (uint32_t disc = 0; disc < shape.discsPerAlbum; disc++)
+            {
+                for (uint32_t track = 0; track < shape.tracksPerDisc; track++)
+                {
+                    const vector<string> comments = makeComments(artist, album, disc, track, shape);
+
+                    char fileName[64];
+                    snprintf(fileName, sizeof(fileName), "%u-%02u Song %u.%s", disc + 1, track + 1, track + 1, extension);
+
+                    switch (format)
+                    {
+                        case AudioFormat::flac:
+                            writeFile(albumPath / fileName, makeFlac(comments, picture, shape.paddingSize));
+                            break;
+                        case AudioFormat::opus:
+                            writeFile(albumPath / fileName, makeOpus(comments, picture));
+                            break;
+                        default:
+                            writeFile(albumPath / fileName, makeVorbis(comments, picture));
+                            break;
+                    }
+                    written++;
+                }
+            }
+        }
+    }
+
+    return written;
+}
@@ -0,0 +1,149 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_LIBRARYGENERATOR_HPP
+#define MUSICLIST_LIBRARYGENERATOR_HPP
+
+#include <cinttypes>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <Track.hpp>
+
+namespace fs = std::filesystem;
+
+using std::string;
+using std::vector;
+
+namespace MusicList
+{
+    /**
+     * @brief Size and layout of a generated library.
+     */
+    struct LibraryShape
+    {
+        uint32_t artistCount = 25;
+        uint32_t albumsPerArtist = 4;
+        uint32_t discsPerAlbum = 1;
+        uint32_t tracksPerDisc = 12;
+
+        // Size of the cover art embedded in each track. 0 leaves the picture out.
+        uint32_t pictureSize = 0;
+
+        // Size of the FLAC PADDING block.
+        uint32_t paddingSize = 8192;
+
+        // Formats are assigned to albums in turn, so every album has a single format.
+        vector<AudioFormat> formats = {AudioFormat::flac, AudioFormat::opus, AudioFormat::vorbis};
+
+        /**
+         * @returns number of audio files in a library of this shape.
+         */
+        uint32_t trackCount() const;
+    };
+
+    /**
+     * @brief Writes synthetic music libraries for benchmarking.
+     *
+     * Files carry valid FLAC, Ogg Opus or Ogg Vorbis headers with a realistic set of Vorbis
+     * comments, followed by a few packets of silence instead of real audio. Ogg pages have
+     * correct checksums so codec libraries accept them. The output only depends on the shape,
+     * so runs on different machines read the same bytes.
+     *
+     * Albums are laid out as `<root>/<artist>/<album>/<disc>-<track> <title>.<ext>` next to a
+     * cover image and a rip log that discovery has to skip.
+     */
+    class LibraryGenerator
+    {
+    private:
+        /**
+         * @returns the Vorbis comments of a track, formatted as "KEY=value".
+         */
+        static vector<string> makeComments(uint32_t artist, uint32_t album, uint32_t disc, uint32_t track,
+                                           const LibraryShape& shape);
+
+        /**
+         * @returns a FLAC METADATA_BLOCK_PICTURE body holding pictureSize bytes of image data.
+         */
+        static string makePicture(uint32_t pictureSize);
+    public:
+        /**
+         * @brief Creates a library of the provided shape below a directory.
+         *
+         * @param root directory to write to. It's created if it doesn't exist.
+         * @param shape size and layout of the library
+         *
+         * @returns number of audio files written.
+         *
+         * @throws std::runtime_error if a file can't be written.
+         */
+        static uint32_t generate(const fs::path& root, const LibraryShape& shape);
+
+        /**
+         * @param comments Vorbis comments, formatted as "KEY=value"
+         * @param picture METADATA_BLOCK_PICTURE body. Empty to leave the picture out.
+         * @param paddingSize size of the trailing PADDING block
+         *
+         * @returns the contents of a FLAC file holding metadata only.
+         */
+        static string makeFlac(const vector<string>& comments, const string& picture, uint32_t paddingSize);
+
+        /**
+         * @param comments Vorbis comments, formatted as "KEY=value"
+         * @param picture METADATA_BLOCK_PICTURE body. Empty to leave the picture out.
+         *
+         * @returns the contents of an Ogg Opus file with one second of silence.
+         */
+        static string makeOpus(const vector<string>& comments, const string& picture);
+
+        /**
+         * @param comments Vorbis comments, formatted as "KEY=value"
+         * @param picture METADATA_BLOCK_PICTURE body. Empty to leave the picture out.
+         *
+         * @returns the contents of an Ogg Vorbis file with a few packets of silence.
+         */
+        static string makeVorbis(const vector<string>& comments, const string& picture);
+
+        /**
+         * @brief Computes the checksum stored in an Ogg page header.
+         *
+         * @param data page with its checksum field set to zero
+         * @param length length of the page
+         *
+         * @returns the page checksum.
+         */
+        static uint32_t oggChecksum(const uint8_t* data, size_t length);
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_LIBRARYGENERATOR_HPP
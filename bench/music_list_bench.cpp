@@ -0,0 +1,436 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <unistd.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <BlockPicture.hpp>
+#include <DirectorySnapshot.hpp>
+#include <FileReader.hpp>
+#include <Importer.hpp>
+#include <Track.hpp>
+
+#include "LibraryGenerator.hpp"
+
+namespace fs = std::filesystem;
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+using namespace MusicList;
+
+namespace
+{
+    // Number of files opened at a time while timing tag parsing.
+    const size_t PARSE_BATCH_SIZE = 256;
+
+    struct BenchLibrary
+    {
+        fs::path root;
+        vector<fs::path> paths;
+    } library;
+
+    /**
+     * Silences the Importer's progress output while it's in scope, so it doesn't get mixed into
+     * the benchmark results.
+     */
+    class QuietOutput
+    {
+    private:
+        struct NullBuffer : public std::streambuf
+        {
+            int overflow(int c) override { return traits_type::not_eof(c); }
+        };
+
+        NullBuffer nullBuffer;
+        std::streambuf* original;
+    public:
+        QuietOutput() : original(std::cout.rdbuf(&this->nullBuffer)) {}
+        ~QuietOutput() { std::cout.rdbuf(this->original); }
+    };
+
+    unique_ptr<Importer> importLibrary(uint32_t threadCount)
+    {
+        QuietOutput quiet;
+        auto importer = std::make_unique<Importer>(threadCount);
+        importer->runTrackSearch(library.root, 0);
+        return importer;
+    }
+
+    bool readOption(string_view arg, string_view name, string_view& value)
+    {
+        if (arg.substr(0, name.size()) != name)
+        {
+            return false;
+        }
+        value = arg.substr(name.size());
+        return true;
+    }
+
+    uint32_t toUInt(string_view value)
+    {
+        return static_cast<uint32_t>(strtoul(string(value).c_str(), nullptr, 10));
+    }
+
+    vector<AudioFormat> toFormats(string_view value)
+    {
+        vector<AudioFormat> formats;
+        while (!value.empty())
+        {
+            const size_t comma = value.find(',');
+            const string_view name = value.substr(0, comma);
+            if (name == "flac")
+            {
+                formats.push_back(AudioFormat::flac);
+            }
+            else if (name == "opus")
+            {
+                formats.push_back(AudioFormat::opus);
+            }
+            else if (name == "vorbis")
+            {
+                formats.push_back(AudioFormat::vorbis);
+            }
+            else
+            {
+                throw std::runtime_error("Unknown format: " + string(name));
+            }
+            value = comma == string_view::npos ? string_view() : value.substr(comma + 1);
+        }
+        return formats;
+    }
+
+    void printUsage()
+    {
+        std::cout << "Library options:\n"
+                  << "\t--library=<dir>\t\tBenchmark an existing library instead of generating one.\n"
+                  << "\t--artists=<n>\t\tNumber of artists to generate.\n"
+                  << "\t--albums=<n>\t\tNumber of albums per artist.\n"
+                  << "\t--discs=<n>\t\tNumber of discs per album.\n"
+                  << "\t--tracks=<n>\t\tNumber of tracks per disc.\n"
+                  << "\t--formats=<list>\tComma-separated formats assigned to albums in turn: flac, opus, vorbis.\n"
+                  << "\t--picture-size=<n>\tBytes of cover art embedded in each track.\n"
+                  << "\t--keep\t\t\tKeep the generated library after the run.\n\n";
+    }
+}
+
+static void BM_Discovery(benchmark::State& state)
+{
+    const auto threadCount = static_cast<uint32_t>(state.range(0));
+    const auto countFile = [](const fs::path&) { return true; };
+
+    for (auto _ : state)
+    {
+        // A fresh snapshot reads every directory.
+        DirectorySnapshot snapshot;
+        benchmark::DoNotOptimize(snapshot.walk(library.root, Track::isSupportedName, countFile, threadCount));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * library.paths.size()));
+}
+BENCHMARK(BM_Discovery)->ArgName("threads")->Arg(1)->Arg(8)->UseRealTime();
+
+static void BM_FormatDetection(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        for (const auto& path : library.paths)
+        {
+            benchmark::DoNotOptimize(Track::determineFormat(path));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * library.paths.size()));
+}
+BENCHMARK(BM_FormatDetection);
+
+static void BM_TagParsing(benchmark::State& state)
+{
+    ReadOptions options;
+    options.tagReader = static_cast<TagReader>(state.range(0));
+    options.lazyTags = state.range(1) != 0;
+
+    vector<shared_ptr<FileReader>> readers;
+    readers.reserve(PARSE_BATCH_SIZE);
+
+    for (auto _ : state)
+    {
+        // Files are opened outside the timed region, so only detection on the loaded prefix
+        // and the comment parsing itself are measured.
+        for (size_t start = 0; start < library.paths.size(); start += PARSE_BATCH_SIZE)
+        {
+            const size_t end = std::min(start + PARSE_BATCH_SIZE, library.paths.size());
+
+            state.PauseTiming();
+            readers.clear();
+            for (size_t i = start; i < end; i++)
+            {
+                readers.push_back(std::make_shared<FileReader>(library.paths[i]));
+            }
+            state.ResumeTiming();
+
+            try
+            {
+                for (size_t i = start; i < end; i++)
+                {
+                    Track track;
+                    track.setReadOptions(options);
+                    track.setPath(library.paths[i], readers[i - start]);
+                    track.readMetadata();
+                    benchmark::DoNotOptimize(track.getTitle());
+                }
+            }
+            catch (const std::exception& e)
+            {
+                state.SkipWithError(e.what());
+                break;
+            }
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * library.paths.size()));
+}
+BENCHMARK(BM_TagParsing)->ArgNames({"reader", "lazy"})
+    ->Args({static_cast<int64_t>(TagReader::native), 0})->Args({static_cast<int64_t>(TagReader::native), 1})
+    ->Args({static_cast<int64_t>(TagReader::library), 0});
+
+static void BM_Import(benchmark::State& state)
+{
+    ReadOptions options;
+    options.readMode = state.range(2) != 0 ? ReadMode::mapped : ReadMode::buffered;
+
+    for (auto _ : state)
+    {
+        QuietOutput quiet;
+        Importer importer = Importer(static_cast<uint32_t>(state.range(0)));
+        importer.setBatchReads(state.range(1) != 0);
+        importer.setReadOptions(options);
+        importer.runTrackSearch(library.root, 0);
+        benchmark::DoNotOptimize(importer.getTracks().size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * library.paths.size()));
+}
+// A thread count of 0 uses one import thread per CPU.
+BENCHMARK(BM_Import)->ArgNames({"threads", "batch", "mapped"})
+    ->Args({1, 0, 0})->Args({0, 0, 0})->Args({0, 1, 0})->Args({0, 0, 1})
+    ->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_AlbumGrouping(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        // Grouping moves the tracks out of the Importer, so every iteration needs a new import.
+        state.PauseTiming();
+        unique_ptr<Importer> importer = importLibrary(0);
+        state.ResumeTiming();
+
+        {
+            QuietOutput quiet;
+            importer->generateAlbumsFromTracks();
+        }
+        benchmark::DoNotOptimize(importer->getAlbums().size());
+
+        state.PauseTiming();
+        importer.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * library.paths.size()));
+}
+BENCHMARK(BM_AlbumGrouping)->Unit(benchmark::kMillisecond);
+
+static void BM_JsonExport(benchmark::State& state)
+{
+    unique_ptr<Importer> importer = importLibrary(0);
+    {
+        QuietOutput quiet;
+        importer->generateAlbumsFromTracks();
+    }
+
+    const fs::path outPath = library.root.parent_path() / (library.root.filename().string() + ".json");
+    for (auto _ : state)
+    {
+        importer->writeJSON(outPath);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * fs::file_size(outPath)));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * library.paths.size()));
+    fs::remove(outPath);
+}
+BENCHMARK(BM_JsonExport)->Unit(benchmark::kMillisecond);
+
+static void BM_PictureDecode(benchmark::State& state)
+{
+    const auto decoder = static_cast<BlockPicture::Decoder>(state.range(0));
+    if (!BlockPicture::isSupported(decoder))
+    {
+        state.SkipWithError("Decoder isn't supported by this CPU.");
+        return;
+    }
+
+    // The encoded size of a typical 1 MiB cover in a METADATA_BLOCK_PICTURE comment.
+    static const char* ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    string encoded(1398104, 'A');
+    for (size_t i = 0; i < encoded.size(); i++)
+    {
+        encoded[i] = ALPHABET[(i * 7919) % 64];
+    }
+    vector<uint8_t> decoded(BlockPicture::maxDecodedSize(encoded.size()));
+
+    for (auto _ : state)
+    {
+        size_t written = 0;
+        if (!BlockPicture::base64Decode(decoder, encoded.data(), encoded.size(), decoded.data(), written))
+        {
+            state.SkipWithError("Invalid base64 data.");
+            break;
+        }
+        benchmark::DoNotOptimize(decoded.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * encoded.size()));
+}
+BENCHMARK(BM_PictureDecode)->ArgName("decoder")
+    ->Arg(static_cast<int64_t>(BlockPicture::Decoder::scalar))
+    ->Arg(static_cast<int64_t>(BlockPicture::Decoder::ssse3))
+    ->Arg(static_cast<int64_t>(BlockPicture::Decoder::avx2));
+
+int main(int argc, char **argv)
+{
+    LibraryShape shape;
+    fs::path libraryPath;
+    bool keepLibrary = false;
+
+    // Take the library options out of argv before Google Benchmark parses the rest.
+    int benchArgc = 1;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const string_view arg = argv[i];
+            string_view value;
+            if (readOption(arg, "--library=", value))
+            {
+                libraryPath = fs::path(value);
+            }
+            else if (readOption(arg, "--artists=", value))
+            {
+                shape.artistCount = toUInt(value);
+            }
+            else if (readOption(arg, "--albums=", value))
+            {
+                shape.albumsPerArtist = toUInt(value);
+            }
+            else if (readOption(arg, "--discs=", value))
+            {
+                shape.discsPerAlbum = toUInt(value);
+            }
+            else if (readOption(arg, "--tracks=", value))
+            {
+                shape.tracksPerDisc = toUInt(value);
+            }
+            else if (readOption(arg, "--formats=", value))
+            {
+                shape.formats = toFormats(value);
+            }
+            else if (readOption(arg, "--picture-size=", value))
+            {
+                shape.pictureSize = toUInt(value);
+            }
+            else if (arg == "--keep")
+            {
+                keepLibrary = true;
+            }
+            else
+            {
+                if (arg == "--help")
+                {
+                    printUsage();
+                }
+                argv[benchArgc++] = argv[i];
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    benchmark::Initialize(&benchArgc, argv);
+    if (benchmark::ReportUnrecognizedArguments(benchArgc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    const bool generated = libraryPath.empty();
+    try
+    {
+        if (generated)
+        {
+            library.root = fs::temp_directory_path() / ("musiclist-bench-" + std::to_string(getpid()));
+            fs::remove_all(library.root);
+            const uint32_t count = LibraryGenerator::generate(library.root, shape);
+            std::cerr << "Generated " << count << " tracks in " << library.root.string() << ".\n";
+        }
+        else
+        {
+            library.root = fs::absolute(libraryPath);
+        }
+
+        DirectorySnapshot snapshot;
+        snapshot.walk(library.root, Track::isSupportedName, [](const fs::path& path)
+        {
+            library.paths.push_back(path);
+            return true;
+        });
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    if (generated && !keepLibrary)
+    {
+        fs::remove_all(library.root);
+    }
+
+    return EXIT_SUCCESS;
+}
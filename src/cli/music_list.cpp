@@ -31,24 +31,50 @@
   
 */
 
+#include <getopt.h>
 #include <unistd.h>
 #include <filesystem>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <memory>
 #include <string>
+#include <cstring>
 
+#include <Completeness.hpp>
+#include <DirectoryWatcher.hpp>
 #include <Importer.hpp>
 
-#include <json/value.h>
-#include <json/writer.h>
-
 namespace fs = std::filesystem;
 
 using std::string;
+using std::unique_ptr;
 
 static const char DEFAULT_OUT_PATH[] = "./musiclist.json";
 
+enum class StatsFormat
+{
+    none,
+    text,
+    json
+};
+
+enum class ProgressFormat
+{
+    none,
+    bar,
+    json
+};
+
+static const option LONG_OPTIONS[] = {
+    {"watch", no_argument, nullptr, 'w'},
+    {"report", required_argument, nullptr, 'r'},
+    {"stats", optional_argument, nullptr, 's'},
+    {"progress", required_argument, nullptr, 'P'},
+    {"lazy-tags", no_argument, nullptr, 'L'},
+    {"quiet", no_argument, nullptr, 'q'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0}
+};
+
 /**
  * @brief Confirms that the supplied path points to a directory.
  * 
@@ -103,7 +129,132 @@ void printHelp()
     std::cout << "Option: -l (Limit)\n  Sets the maximum number of files to process.\n  Usage: 'musiclist -l 100'\n";
     std::cout << std::endl;
 
-    std::cout << "Option -h (Help)\n  Prints this message and exits." << std::endl;
+    std::cout << "Option: -j (Jobs)\n  Sets the number of threads used to read metadata. 0 uses one per CPU.\n  Usage: 'musiclist -j 8'\n";
+    std::cout << std::endl;
+
+    std::cout << "Option: -c (Cache file)\n  Reuses metadata of unchanged files from the cache and updates it afterwards.\n  Usage: 'musiclist -c ~/.cache/musiclist.cache'\n";
+    std::cout << std::endl;
+
+    std::cout << "Option: -p (Tag parser)\n  Selects how FLAC and Opus tags are read: 'native' (default), 'library' or 'validate'.\n  Usage: 'musiclist -p validate'\n";
+    std::cout << std::endl;
+
+    std::cout << "Option: -b (Batch reads)\n  Opens files and reads their headers in batches through io_uring, or on I/O threads where it's unavailable.\n  Usage: 'musiclist -b'\n";
+    std::cout << std::endl;
+
+    std::cout << "Option: -m (Memory-map)\n  Maps file headers into memory instead of copying them, limiting readahead to the headers.\n  Usage: 'musiclist -m'\n";
+    std::cout << std::endl;
+
+    std::cout << "Option: --lazy-tags (Lazy tags)\n  Only reads the tags written to the output. Cache entries written this way are read again without this option.\n  Usage: 'musiclist --lazy-tags'\n";
+    std::cout << std::endl;
+
+    std::cout << "Option: -k (Catalog file)\n  Also writes a binary catalog that can be loaded without parsing.\n  Usage: 'musiclist -k ~/Documents/musiclist.catalog'\n";
+    std::cout << std::endl;
+
+    std::cout << "Option: -r, --report (Completeness report)\n  Checks every album for missing discs, missing tracks and duplicate track numbers, and writes the results as JSON.\n  Usage: 'musiclist -r ~/Documents/completeness.json'\n";
+    std::cout << std::endl;
+
+    std::cout << "Option: -s, --stats[=text|json] (Statistics)\n  Prints the time spent in each import stage, file counts, failures and read times once the output is written.\n  Usage: 'musiclist --stats=json'\n";
+    std::cout << std::endl;
+
+    std::cout << "Option: --progress=bar|json|none (Progress)\n  Selects how import progress is shown: a counter on stdout (default), one JSON object per update on stderr, or nothing.\n  Usage: 'musiclist --progress=json'\n";
+    std::cout << std::endl;
+
+    std::cout << "Option: -q, --quiet (Quiet)\n  Only prints errors and the requested statistics. Hides the progress counter, but not --progress=json.\n  Usage: 'musiclist -q'\n";
+    std::cout << std::endl;
+
+    std::cout << "Option: -w, --watch (Watch)\n  Keeps running after the import and updates the output whenever files in the input directory change.\n  Usage: 'musiclist --watch -i ~/Music'\n";
+    std::cout << std::endl;
+
+    std::cout << "Option -h, --help (Help)\n  Prints this message and exits." << std::endl;
+}
+
+/**
+ * @brief Creates an Importer with the options selected on the command line.
+ */
+unique_ptr<MusicList::Importer> createImporter(uint32_t jobs, const MusicList::ReadOptions& readOptions,
+                                               bool batchReads, const char* cachePath, ProgressFormat progressFormat,
+                                               bool quiet)
+{
+    auto importer = std::make_unique<MusicList::Importer>(jobs);
+    importer->setReadOptions(readOptions);
+    importer->setBatchReads(batchReads);
+    importer->setQuiet(quiet);
+    if (progressFormat == ProgressFormat::none)
+    {
+        importer->setProgressCallback(nullptr);
+    }
+    else if (progressFormat == ProgressFormat::json)
+    {
+        importer->setProgressCallback(MusicList::ProgressReporter::jsonCallback(std::cerr));
+    }
+    if (cachePath != nullptr)
+    {
+        importer->setCachePath(fs::path(cachePath));
+    }
+
+    return importer;
+}
+
+/**
+ * @brief Writes the JSON file and, if requested, the binary catalog and completeness report.
+ * 
+ * @returns false if any of the files couldn't be written.
+ */
+bool exportData(const MusicList::Importer& importer, const fs::path& outFile, const char* catalogPath,
+                const char* reportPath, bool quiet)
+{
+    // Status messages go to a stream without a buffer in quiet mode.
+    std::ostream status = std::ostream(quiet ? nullptr : std::cout.rdbuf());
+
+    status << "Exporting data to '" << outFile.string() << "'.\n";
+
+    try
+    {
+        importer.writeJSON(outFile);
+
+        if (catalogPath != nullptr)
+        {
+            status << "Exporting catalog to '" << catalogPath << "'.\n";
+            importer.writeCatalog(fs::path(catalogPath));
+        }
+
+        if (reportPath != nullptr)
+        {
+            const MusicList::CompletenessReport report = MusicList::CompletenessReport(importer.getAlbums());
+            report.printSummary(status);
+
+            status << "Exporting completeness report to '" << reportPath << "'.\n";
+            report.writeJSON(fs::path(reportPath));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
+        return false;
+    }
+
+    status << "done\n";
+
+    return true;
+}
+
+/**
+ * @brief Prints the Importer's metrics in the requested format.
+ */
+void printStats(const MusicList::Importer& importer, StatsFormat format)
+{
+    if (format == StatsFormat::text)
+    {
+        importer.getMetrics().print(std::cout);
+    }
+    else if (format == StatsFormat::json)
+    {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "  ";
+        const unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+        writer->write(importer.getMetrics().toJSON(), &std::cout);
+        std::cout << std::endl;
+    }
 }
 
 int main(int argc, char* argv[])
@@ -111,13 +262,23 @@ int main(int argc, char* argv[])
     // User input handling.
     char* searchPath = nullptr;
     char* outPath = nullptr;
+    char* cachePath = nullptr;
+    char* catalogPath = nullptr;
+    char* reportPath = nullptr;
+    MusicList::ReadOptions readOptions;
     uint32_t limit = 0;
+    uint32_t jobs = 1;
+    bool batchReads = false;
+    bool watch = false;
+    StatsFormat statsFormat = StatsFormat::none;
+    ProgressFormat progressFormat = ProgressFormat::bar;
+    bool quiet = false;
 
-    char opt;
+    int opt;
 
     opterr = 0;
 
-    while((opt = getopt(argc, argv, "i:o:l:h")) != -1)
+    while((opt = getopt_long(argc, argv, "i:o:l:j:c:p:k:r:s::bmqwh", LONG_OPTIONS, nullptr)) != -1)
     {
         switch (opt)
         {
@@ -130,14 +291,100 @@ int main(int argc, char* argv[])
             case 'l':
                 limit = strtoul(optarg, nullptr, 10);
                 break;
+            case 'j':
+                jobs = strtoul(optarg, nullptr, 10);
+                break;
+            case 'c':
+                cachePath = optarg;
+                break;
+            case 'k':
+                catalogPath = optarg;
+                break;
+            case 'p':
+                if (strcmp(optarg, "native") == 0)
+                {
+                    readOptions.tagReader = MusicList::TagReader::native;
+                }
+                else if (strcmp(optarg, "library") == 0)
+                {
+                    readOptions.tagReader = MusicList::TagReader::library;
+                }
+                else if (strcmp(optarg, "validate") == 0)
+                {
+                    readOptions.tagReader = MusicList::TagReader::validate;
+                }
+                else
+                {
+                    std::cerr << "Unknown tag parser `" << optarg << "`.\n";
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'b':
+                batchReads = true;
+                break;
+            case 'm':
+                readOptions.readMode = MusicList::ReadMode::mapped;
+                break;
+            case 'L':
+                readOptions.lazyTags = true;
+                break;
+            case 'r':
+                reportPath = optarg;
+                break;
+            case 's':
+                if (optarg == nullptr || strcmp(optarg, "text") == 0)
+                {
+                    statsFormat = StatsFormat::text;
+                }
+                else if (strcmp(optarg, "json") == 0)
+                {
+                    statsFormat = StatsFormat::json;
+                }
+                else
+                {
+                    std::cerr << "Unknown statistics format `" << optarg << "`.\n";
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'P':
+                if (strcmp(optarg, "bar") == 0)
+                {
+                    progressFormat = ProgressFormat::bar;
+                }
+                else if (strcmp(optarg, "json") == 0)
+                {
+                    progressFormat = ProgressFormat::json;
+                }
+                else if (strcmp(optarg, "none") == 0)
+                {
+                    progressFormat = ProgressFormat::none;
+                }
+                else
+                {
+                    std::cerr << "Unknown progress format `" << optarg << "`.\n";
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            case 'w':
+                watch = true;
+                break;
             case 'h':
                 printHelp();
                 return EXIT_SUCCESS;
             case '?':
-                if (optopt == 'i' || optopt == 'o')
+                if (optopt == 'i' || optopt == 'o' || optopt == 'l' || optopt == 'j' || optopt == 'c' || optopt == 'p' || optopt == 'k' ||
+                    optopt == 'r')
                 {
                     std::cerr << "Option -" << char(optopt) << " requires an argument\n";
                 }
+                else if (optopt == 0)
+                {
+                    // Unknown long option.
+                    std::cerr << "Unknown option `" << argv[optind - 1] << "`.\n";
+                }
                 else
                 {
                     std::cerr << "Unknown option `-" << char(optopt) << "`.\n";
@@ -156,36 +403,84 @@ int main(int argc, char* argv[])
     verifySearchDir(inDir);
     verifyOutFile(outFile);
 
-    // Run import process
-    MusicList::Importer importer = MusicList::Importer();
-
-    importer.runTrackSearch(inDir, limit);
-    importer.generateAlbumsFromTracks();
-
-    // Export to JSON file
-    std::cout << "Exporting data to '" << outFile.string() << "'.\n";
-
-    const auto& outJson = importer.toJSON();
+    if (quiet && progressFormat == ProgressFormat::bar)
+    {
+        progressFormat = ProgressFormat::none;
+    }
 
-    Json::StreamWriterBuilder builder;
-    builder["commentStyle"] = "None";
-    builder["indentation"] = "  ";
+    // Watching starts before the import so changes made while it runs aren't missed.
+    unique_ptr<MusicList::DirectoryWatcher> watcher;
+    if (watch)
+    {
+        try
+        {
+            watcher = std::make_unique<MusicList::DirectoryWatcher>(inDir);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
 
-    std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+    // Run import process
+    unique_ptr<MusicList::Importer> importer = createImporter(jobs, readOptions, batchReads, cachePath, progressFormat,
+                                                              quiet);
+    importer->runTrackSearch(inDir, limit);
+    importer->generateAlbumsFromTracks();
 
-    std::ostringstream outStr;
+    if (!exportData(*importer, outFile, catalogPath, reportPath, quiet))
+    {
+        return EXIT_FAILURE;
+    }
+    printStats(*importer, statsFormat);
 
-    writer->write(outJson, &outStr);
-    outStr << std::endl;
+    if (watcher == nullptr)
+    {
+        return EXIT_SUCCESS;
+    }
 
-    std::ofstream outStream = std::ofstream(outFile, std::ios::out | std::ios::trunc);
-    if (outStream.is_open())
+    if (!quiet)
     {
-        outStream.write(outStr.str().c_str(), outStr.str().length());
-        outStream.close();
+        std::cout << "Watching " << std::to_string(watcher->size()) << " directories in '" << inDir.string()
+                  << "' for changes.\n";
     }
 
-    std::cout << "done\n";
+    MusicList::DirectoryWatcher::Changes changes;
+    while (true)
+    {
+        try
+        {
+            if (!watcher->wait(changes))
+            {
+                continue;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        if (changes.overflow)
+        {
+            if (!quiet)
+            {
+                std::cout << "Missed some file changes. Rescanning '" << inDir.string() << "'.\n";
+            }
+
+            // A new Importer releases the arena holding every previously read track.
+            importer = createImporter(jobs, readOptions, batchReads, cachePath, progressFormat, quiet);
+            importer->runTrackSearch(inDir, limit);
+            importer->generateAlbumsFromTracks();
+        }
+        else if (!importer->updateTracks(changes.modified, changes.removed))
+        {
+            continue;
+        }
 
-    return EXIT_SUCCESS;
+        // Export failures are reported, but don't stop the watch.
+        exportData(*importer, outFile, catalogPath, reportPath, quiet);
+        printStats(*importer, statsFormat);
+    }
 }
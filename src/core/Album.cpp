@@ -32,6 +32,7 @@
 */
 
 #include "Album.hpp"
+#include "JsonWriter.hpp"
 
 using namespace MusicList;
 
@@ -42,6 +43,14 @@ Album::Album(const shared_ptr<Track>& track)
     this->addTrack(track);
 }
 
+Album::Album(vector<shared_ptr<Track>>::const_iterator first, vector<shared_ptr<Track>>::const_iterator last)
+{
+    for (; first != last; ++first)
+    {
+        this->addTrack(*first);
+    }
+}
+
 Json::Value Album::toJSON() const
 {
     Json::Value root;
@@ -59,6 +68,35 @@ Json::Value Album::toJSON() const
     return root;
 }
 
+void Album::writeJSON(JsonWriter& writer) const
+{
+    // Keys in the sorted order toJSON() output is written in.
+    writer.beginObject();
+    writer.writeKey("artist");
+    writer.writeString(this->artist);
+    writer.writeKey("musicbrainz_id");
+    writer.writeString(this->mbid);
+    writer.writeKey("name");
+    writer.writeString(this->name);
+    writer.writeKey("total_tracks");
+    writer.writeInt(this->totalTracks);
+    writer.writeKey("tracks");
+    if (this->tracks.empty())
+    {
+        writer.writeNull();
+    }
+    else
+    {
+        writer.beginArray();
+        for (const auto& track : this->tracks)
+        {
+            track.second->writeJSON(writer);
+        }
+        writer.endArray();
+    }
+    writer.endObject();
+}
+
 void Album::addTrack(const shared_ptr<Track>& track)
 {
     if (track->getAudioFormat() == AudioFormat::unknown)
@@ -72,14 +110,11 @@ void Album::addTrack(const shared_ptr<Track>& track)
         this->totalTracks = track->getTotalTracks();
         this->name = track->getAlbum();
         this->artist = track->getArtist();
-        map<string,string> trackTags = track->getTags();
-        this->mbid = trackTags["MUSICBRAINZ_ALBUMID"];
+        this->mbid = track->getAlbumMBID();
     }
 
-    if (this->tracks.count(track->getMBID()) == 0)
-    {
-        this->tracks[track->getMBID()] = track;
-    }
+    // Keeps the first track added for each MBID.
+    this->tracks.emplace(track->getMBID(), track);
 }
 
 // =======
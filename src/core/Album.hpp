@@ -36,6 +36,7 @@
 #include <map>
 #include <string>
 #include <memory>
+#include <vector>
 #include <cinttypes>
 #include <json/value.h>
 
@@ -43,10 +44,13 @@
 
 using std::string;
 using std::map;
+using std::vector;
 using std::shared_ptr;
 
 namespace MusicList
 {
+    class JsonWriter;
+
     class Album
     {
     private:
@@ -60,6 +64,17 @@ namespace MusicList
 
         explicit Album(const shared_ptr<Track>& track);
 
+        /**
+         * @brief Creates an Album from a group of tracks in a single pass.
+         * 
+         * The first track provides the album details. Of several tracks with the same MBID,
+         * only the first one is kept, as with addTrack().
+         * 
+         * @param first start of the track range
+         * @param last end of the track range
+         */
+        Album(vector<shared_ptr<Track>>::const_iterator first, vector<shared_ptr<Track>>::const_iterator last);
+
         /**
          * @brief Adds a new track to the Album.
          * 
@@ -72,6 +87,13 @@ namespace MusicList
          */
         Json::Value toJSON() const;
 
+        /**
+         * @brief Streams the same JSON object toJSON() creates.
+         * 
+         * @param writer destination
+         */
+        void writeJSON(JsonWriter& writer) const;
+
         // =======
         // Getters
         // =======
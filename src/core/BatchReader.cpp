@@ -0,0 +1,408 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include <linux/io_uring.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include "BatchReader.hpp"
+#include "WorkerPool.hpp"
+
+using namespace MusicList;
+
+namespace
+{
+    int ioUringSetup(uint32_t entries, io_uring_params* params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int ioUringEnter(int ringFd, uint32_t toSubmit, uint32_t minComplete, uint32_t flags)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+}
+
+/**
+ * Minimal io_uring instance driven through the raw system calls, so liburing isn't required.
+ */
+struct BatchReader::Ring
+{
+    int fd = -1;
+
+    void* sqMap = MAP_FAILED;
+    size_t sqMapSize = 0;
+    void* cqMap = MAP_FAILED;
+    size_t cqMapSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize = 0;
+
+    uint32_t* sqTail = nullptr;
+    uint32_t* sqMask = nullptr;
+    uint32_t* sqArray = nullptr;
+    uint32_t* cqHead = nullptr;
+    uint32_t* cqTail = nullptr;
+    uint32_t* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    uint32_t pending = 0;
+
+    ~Ring()
+    {
+        if (this->sqes != MAP_FAILED)
+        {
+            munmap(this->sqes, this->sqesSize);
+        }
+        if (this->cqMap != MAP_FAILED && this->cqMap != this->sqMap)
+        {
+            munmap(this->cqMap, this->cqMapSize);
+        }
+        if (this->sqMap != MAP_FAILED)
+        {
+            munmap(this->sqMap, this->sqMapSize);
+        }
+        if (this->fd >= 0)
+        {
+            close(this->fd);
+        }
+    }
+
+    bool setup(uint32_t entries)
+    {
+        io_uring_params params = {};
+        this->fd = ioUringSetup(entries, &params);
+        if (this->fd < 0)
+        {
+            return false;
+        }
+
+        this->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        this->cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            this->sqMapSize = std::max(this->sqMapSize, this->cqMapSize);
+            this->cqMapSize = this->sqMapSize;
+        }
+
+        this->sqMap = mmap(nullptr, this->sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           this->fd, IORING_OFF_SQ_RING);
+        if (this->sqMap == MAP_FAILED)
+        {
+            return false;
+        }
+
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            this->cqMap = this->sqMap;
+        }
+        else
+        {
+            this->cqMap = mmap(nullptr, this->cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                               this->fd, IORING_OFF_CQ_RING);
+            if (this->cqMap == MAP_FAILED)
+            {
+                return false;
+            }
+        }
+
+        this->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        this->sqes = static_cast<io_uring_sqe*>(mmap(nullptr, this->sqesSize, PROT_READ | PROT_WRITE,
+                                                     MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQES));
+        if (this->sqes == MAP_FAILED)
+        {
+            return false;
+        }
+
+        auto* sq = static_cast<uint8_t*>(this->sqMap);
+        this->sqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+        this->sqMask = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+        this->sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+
+        auto* cq = static_cast<uint8_t*>(this->cqMap);
+        this->cqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+        this->cqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+        this->cqMask = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+        this->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        return true;
+    }
+
+    /**
+     * Returns a cleared submission entry. The caller must not queue more than BATCH_SIZE entries
+     * before calling submitAndWait().
+     */
+    io_uring_sqe* nextEntry()
+    {
+        const uint32_t tail = *this->sqTail + this->pending;
+        const uint32_t index = tail & *this->sqMask;
+
+        io_uring_sqe* entry = &this->sqes[index];
+        memset(entry, 0, sizeof(io_uring_sqe));
+        this->sqArray[index] = index;
+        this->pending++;
+
+        return entry;
+    }
+
+    /**
+     * Submits the queued entries and hands every completion to the handler.
+     *
+     * @returns false if the submission failed.
+     */
+    template<typename Handler>
+    bool submitAndWait(Handler&& handler)
+    {
+        const uint32_t count = this->pending;
+        __atomic_store_n(this->sqTail, *this->sqTail + count, __ATOMIC_RELEASE);
+        this->pending = 0;
+
+        uint32_t submitted = 0;
+        uint32_t completed = 0;
+        while (completed < count)
+        {
+            const int result = ioUringEnter(this->fd, count - submitted, count - completed, IORING_ENTER_GETEVENTS);
+            if (result < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (submitted == 0)
+                {
+                    // Nothing reached the kernel. Rewind so the ring stays consistent.
+                    __atomic_store_n(this->sqTail, *this->sqTail - count, __ATOMIC_RELEASE);
+                    return false;
+                }
+            }
+            else
+            {
+                submitted += static_cast<uint32_t>(result);
+            }
+
+            uint32_t head = *this->cqHead;
+            const uint32_t tail = __atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; head++)
+            {
+                const io_uring_cqe& completion = this->cqes[head & *this->cqMask];
+                handler(completion.user_data, completion.res);
+                completed++;
+            }
+            __atomic_store_n(this->cqHead, head, __ATOMIC_RELEASE);
+        }
+
+        return true;
+    }
+};
+
+BatchReader::BatchReader(bool allowRing)
+{
+    // Leave most descriptors to the directory walk and the readers that are being parsed.
+    rlimit limit = {};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+    {
+        this->batchSize = static_cast<uint32_t>(std::clamp<rlim_t>(limit.rlim_cur / 4, 1, BATCH_SIZE));
+    }
+
+    if (allowRing)
+    {
+        this->ring = std::make_unique<Ring>();
+        if (!this->ring->setup(BATCH_SIZE))
+        {
+            this->ring.reset();
+        }
+    }
+
+    if (this->ring == nullptr)
+    {
+        this->fallbackPool = std::make_unique<WorkerPool>(FALLBACK_THREADS);
+    }
+}
+
+BatchReader::~BatchReader() = default;
+
+bool BatchReader::usesRing() const
+{
+    return this->ring != nullptr;
+}
+
+vector<shared_ptr<FileReader>> BatchReader::read(const vector<fs::path>& paths)
+{
+    vector<shared_ptr<FileReader>> readers(paths.size());
+
+    if (this->ring != nullptr && !this->readWithRing(paths, readers))
+    {
+        // The kernel has io_uring but not the operations used here. Don't try it again.
+        this->ring.reset();
+        this->fallbackPool = std::make_unique<WorkerPool>(FALLBACK_THREADS);
+    }
+
+    if (this->ring == nullptr)
+    {
+        this->readWithPool(paths, readers);
+    }
+
+    return readers;
+}
+
+bool BatchReader::readWithRing(const vector<fs::path>& paths, vector<shared_ptr<FileReader>>& readers)
+{
+    vector<int> fds(this->batchSize);
+    vector<vector<uint8_t>> buffers(this->batchSize);
+
+    for (size_t start = 0; start < paths.size(); start += this->batchSize)
+    {
+        const size_t count = std::min<size_t>(this->batchSize, paths.size() - start);
+
+        // Open every file in the batch.
+        for (size_t i = 0; i < count; i++)
+        {
+            io_uring_sqe* entry = this->ring->nextEntry();
+            entry->opcode = IORING_OP_OPENAT;
+            entry->fd = AT_FDCWD;
+            entry->addr = reinterpret_cast<uint64_t>(paths[start + i].c_str());
+            entry->open_flags = O_RDONLY | O_CLOEXEC;
+            entry->user_data = i;
+        }
+
+        bool unsupported = false;
+        const bool opened = this->ring->submitAndWait([&fds, &unsupported](uint64_t index, int32_t result)
+        {
+            fds[index] = result;
+            unsupported = unsupported || result == -EINVAL || result == -EOPNOTSUPP;
+        });
+
+        if (!opened || unsupported)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                if (opened && fds[i] >= 0)
+                {
+                    close(fds[i]);
+                }
+            }
+            return false;
+        }
+
+        // Read the prefix of every file that opened.
+        uint32_t reads = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (fds[i] < 0)
+            {
+                continue;
+            }
+
+            buffers[i] = vector<uint8_t>(FileReader::PREFIX_SIZE);
+
+            io_uring_sqe* entry = this->ring->nextEntry();
+            entry->opcode = IORING_OP_READ;
+            entry->fd = fds[i];
+            entry->addr = reinterpret_cast<uint64_t>(buffers[i].data());
+            entry->len = FileReader::PREFIX_SIZE;
+            entry->off = 0;
+            entry->user_data = i;
+            reads++;
+        }
+
+        if (reads == 0)
+        {
+            continue;
+        }
+
+        const bool loaded = this->ring->submitAndWait([&](uint64_t index, int32_t result)
+        {
+            if (result < 0)
+            {
+                close(fds[index]);
+                fds[index] = -1;
+                return;
+            }
+
+            buffers[index].resize(static_cast<size_t>(result));
+            auto reader = std::make_shared<FileReader>(paths[start + index], fds[index], std::move(buffers[index]));
+            reader->closeFile();
+            readers[start + index] = std::move(reader);
+            // The descriptor is closed now. Don't close it again if the submission fails.
+            fds[index] = -1;
+        });
+
+        if (!loaded)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                if (fds[i] >= 0)
+                {
+                    close(fds[i]);
+                }
+            }
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void BatchReader::readWithPool(const vector<fs::path>& paths, vector<shared_ptr<FileReader>>& readers)
+{
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        if (readers[i] != nullptr)
+        {
+            continue;
+        }
+
+        this->fallbackPool->submit([&paths, &readers, i]
+        {
+            try
+            {
+                auto reader = std::make_shared<FileReader>(paths[i]);
+                reader->closeFile();
+                readers[i] = std::move(reader);
+            }
+            catch (const std::exception&)
+            {
+                // Left as nullptr. The caller reports the error when it retries the open.
+            }
+        });
+    }
+    this->fallbackPool->wait();
+}
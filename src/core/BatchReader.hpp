@@ -0,0 +1,126 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_BATCHREADER_HPP
+#define MUSICLIST_BATCHREADER_HPP
+
+#include <filesystem>
+#include <cinttypes>
+#include <memory>
+#include <vector>
+
+#include "FileReader.hpp"
+
+namespace fs = std::filesystem;
+
+using std::vector;
+using std::shared_ptr;
+using std::unique_ptr;
+
+namespace MusicList
+{
+    class WorkerPool;
+
+    /**
+     * @brief Opens groups of files and reads their prefixes with as few blocking calls as possible.
+     *
+     * On Linux the opens and reads for a whole batch are submitted through io_uring, which keeps
+     * many requests in flight at the storage device instead of issuing them one at a time.
+     * Kernels without io_uring (or sandboxes that block it) fall back to a small pool of I/O
+     * threads performing the same opens and reads.
+     *
+     * Each file is closed again once its prefix has been read, so readers waiting to be parsed
+     * don't hold a descriptor.
+     */
+    class BatchReader
+    {
+    private:
+        struct Ring;
+
+        unique_ptr<Ring> ring;
+        unique_ptr<WorkerPool> fallbackPool;
+        uint32_t batchSize = BATCH_SIZE;
+
+        /**
+         * @brief Reads the paths through io_uring.
+         *
+         * @returns false if the kernel rejected the operations. Readers created before that
+         * point are kept.
+         */
+        bool readWithRing(const vector<fs::path>& paths, vector<shared_ptr<FileReader>>& readers);
+
+        /**
+         * @brief Reads the paths that don't have a reader yet on the fallback I/O threads.
+         */
+        void readWithPool(const vector<fs::path>& paths, vector<shared_ptr<FileReader>>& readers);
+    public:
+        /**
+         * Maximum number of files with requests in flight at once. Lowered to a quarter of
+         * RLIMIT_NOFILE if that's smaller.
+         */
+        static constexpr uint32_t BATCH_SIZE = 256;
+
+        /**
+         * Number of I/O threads used when io_uring isn't available.
+         */
+        static constexpr uint32_t FALLBACK_THREADS = 8;
+
+        /**
+         * @brief Sets up the io_uring instance, or the fallback threads if that fails.
+         *
+         * @param allowRing false to always use the fallback threads
+         */
+        explicit BatchReader(bool allowRing = true);
+
+        BatchReader(const BatchReader&) = delete;
+        BatchReader& operator=(const BatchReader&) = delete;
+
+        ~BatchReader();
+
+        /**
+         * @returns true if batches are read through io_uring.
+         */
+        bool usesRing() const;
+
+        /**
+         * @brief Opens each file and reads its first FileReader::PREFIX_SIZE bytes.
+         *
+         * @param paths files to read. They're submitted up to BATCH_SIZE at a time.
+         *
+         * @returns one reader per path, in the same order. Files that couldn't be opened or read
+         * are left as nullptr so the caller can report the error when it opens them itself.
+         */
+        vector<shared_ptr<FileReader>> read(const vector<fs::path>& paths);
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_BATCHREADER_HPP
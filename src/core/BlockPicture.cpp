@@ -0,0 +1,461 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <cstring>
+#include <stdexcept>
+
+#include "BlockPicture.hpp"
+#include "OggPacketStream.hpp"
+#include "MemorySource.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MUSICLIST_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+using namespace MusicList;
+
+namespace
+{
+    const uint8_t INVALID = 0xFF;
+
+    struct DecodeTable
+    {
+        uint8_t values[256];
+    };
+
+    constexpr DecodeTable makeDecodeTable()
+    {
+        DecodeTable table = {};
+        for (int i = 0; i < 256; i++)
+        {
+            table.values[i] = INVALID;
+        }
+
+        const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (uint8_t i = 0; i < 64; i++)
+        {
+            table.values[static_cast<uint8_t>(alphabet[i])] = i;
+        }
+        return table;
+    }
+
+    constexpr DecodeTable DECODE_TABLE = makeDecodeTable();
+
+    /**
+     * Decodes a byte at a time. Handles the padding at the end of the input.
+     */
+    bool decodeScalar(const char* in, size_t length, uint8_t* out, size_t& written)
+    {
+        size_t end = length;
+        while (end > 0 && length - end < 2 && in[end - 1] == '=')
+        {
+            end--;
+        }
+        if (end % 4 == 1 || (end != length && length % 4 != 0))
+        {
+            return false;
+        }
+
+        const auto* input = reinterpret_cast<const uint8_t*>(in);
+        size_t pos = 0;
+        written = 0;
+        for (; pos + 4 <= end; pos += 4)
+        {
+            const uint8_t a = DECODE_TABLE.values[input[pos]];
+            const uint8_t b = DECODE_TABLE.values[input[pos + 1]];
+            const uint8_t c = DECODE_TABLE.values[input[pos + 2]];
+            const uint8_t d = DECODE_TABLE.values[input[pos + 3]];
+            if ((a | b | c | d) >= 64)
+            {
+                return false;
+            }
+
+            out[written++] = static_cast<uint8_t>((a << 2) | (b >> 4));
+            out[written++] = static_cast<uint8_t>((b << 4) | (c >> 2));
+            out[written++] = static_cast<uint8_t>((c << 6) | d);
+        }
+
+        // A final group of 2 or 3 characters holds 1 or 2 bytes.
+        if (pos < end)
+        {
+            const uint8_t a = DECODE_TABLE.values[input[pos]];
+            const uint8_t b = DECODE_TABLE.values[input[pos + 1]];
+            const uint8_t c = end - pos == 3 ? DECODE_TABLE.values[input[pos + 2]] : 0;
+            if ((a | b | c) >= 64)
+            {
+                return false;
+            }
+
+            out[written++] = static_cast<uint8_t>((a << 2) | (b >> 4));
+            if (end - pos == 3)
+            {
+                out[written++] = static_cast<uint8_t>((b << 4) | (c >> 2));
+            }
+        }
+
+        return true;
+    }
+
+#ifdef MUSICLIST_X86_SIMD
+    // Both vector decoders translate characters to their 6-bit values by adding an offset chosen
+    // by range: A-Z -65, a-z -71, 0-9 +4, '+' +19 and '/' +16. Characters outside every range
+    // stop the vector loop, and the scalar decoder reports them. The values are then packed
+    // from 4 bytes of 6 bits into 3 bytes per 32-bit lane.
+
+    /**
+     * Decodes 16 characters at a time, leaving at least 8 for the scalar decoder so padding
+     * never reaches the vector loop and 16-byte stores stay inside the output.
+     *
+     * @returns number of characters decoded, a multiple of 16.
+     */
+    __attribute__((target("ssse3")))
+    size_t decodeSsse3(const char* in, size_t length, uint8_t* out)
+    {
+        const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+        size_t pos = 0;
+        for (; length - pos >= 24; pos += 16)
+        {
+            const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + pos));
+
+            const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8('A' - 1)),
+                                                _mm_cmplt_epi8(input, _mm_set1_epi8('Z' + 1)));
+            const __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8('a' - 1)),
+                                                _mm_cmplt_epi8(input, _mm_set1_epi8('z' + 1)));
+            const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8('0' - 1)),
+                                                _mm_cmplt_epi8(input, _mm_set1_epi8('9' + 1)));
+            const __m128i plus = _mm_cmpeq_epi8(input, _mm_set1_epi8('+'));
+            const __m128i slash = _mm_cmpeq_epi8(input, _mm_set1_epi8('/'));
+
+            const __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, plus), slash));
+            if (_mm_movemask_epi8(valid) != 0xFFFF)
+            {
+                break;
+            }
+
+            __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-65));
+            shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(-71)));
+            shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(4)));
+            shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(19)));
+            shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(16)));
+            const __m128i values = _mm_add_epi8(input, shift);
+
+            // aaaaaa bbbbbb cccccc dddddd -> aaaaaabbbbbb ccccccdddddd -> aaaaaabbbbbbccccccdddddd
+            const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+            const __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + pos / 4 * 3), _mm_shuffle_epi8(groups, pack));
+        }
+
+        return pos;
+    }
+
+    /**
+     * Decodes 32 characters at a time, leaving at least 16 for the narrower decoders.
+     *
+     * @returns number of characters decoded, a multiple of 32.
+     */
+    __attribute__((target("avx2")))
+    size_t decodeAvx2(const char* in, size_t length, uint8_t* out)
+    {
+        const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                              2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+        // Joins the 12 bytes decoded in each 128-bit lane.
+        const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+
+        size_t pos = 0;
+        for (; length - pos >= 48; pos += 32)
+        {
+            const __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + pos));
+
+            const __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(input, _mm256_set1_epi8('A' - 1)),
+                                                   _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), input));
+            const __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(input, _mm256_set1_epi8('a' - 1)),
+                                                   _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), input));
+            const __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(input, _mm256_set1_epi8('0' - 1)),
+                                                   _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), input));
+            const __m256i plus = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('+'));
+            const __m256i slash = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('/'));
+
+            const __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                                  _mm256_or_si256(_mm256_or_si256(digit, plus), slash));
+            if (_mm256_movemask_epi8(valid) != -1)
+            {
+                break;
+            }
+
+            __m256i shift = _mm256_and_si256(upper, _mm256_set1_epi8(-65));
+            shift = _mm256_or_si256(shift, _mm256_and_si256(lower, _mm256_set1_epi8(-71)));
+            shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(4)));
+            shift = _mm256_or_si256(shift, _mm256_and_si256(plus, _mm256_set1_epi8(19)));
+            shift = _mm256_or_si256(shift, _mm256_and_si256(slash, _mm256_set1_epi8(16)));
+            const __m256i values = _mm256_add_epi8(input, shift);
+
+            const __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+            const __m256i groups = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+            const __m256i packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(groups, pack), join);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + pos / 4 * 3), packed);
+        }
+
+        return pos;
+    }
+#endif
+
+    BlockPicture::Decoder detectDecoder()
+    {
+#ifdef MUSICLIST_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return BlockPicture::Decoder::avx2;
+        }
+        if (__builtin_cpu_supports("ssse3"))
+        {
+            return BlockPicture::Decoder::ssse3;
+        }
+#endif
+        return BlockPicture::Decoder::scalar;
+    }
+
+    const BlockPicture::Decoder BEST_DECODER = detectDecoder();
+}
+
+BlockPicture::BlockPicture() = default;
+
+size_t BlockPicture::maxDecodedSize(size_t encodedLength)
+{
+    return (encodedLength + 3) / 4 * 3;
+}
+
+bool BlockPicture::isSupported(Decoder decoder)
+{
+    return decoder <= BEST_DECODER;
+}
+
+bool BlockPicture::base64Decode(const char* encoded, size_t length, uint8_t* out, size_t& written)
+{
+    return BlockPicture::base64Decode(BEST_DECODER, encoded, length, out, written);
+}
+
+bool BlockPicture::base64Decode(Decoder decoder, const char* encoded, size_t length, uint8_t* out, size_t& written)
+{
+    if (!BlockPicture::isSupported(decoder))
+    {
+        decoder = Decoder::scalar;
+    }
+
+    size_t decoded = 0;
+#ifdef MUSICLIST_X86_SIMD
+    if (decoder == Decoder::avx2)
+    {
+        decoded = decodeAvx2(encoded, length, out);
+    }
+    if (decoder != Decoder::scalar)
+    {
+        decoded += decodeSsse3(encoded + decoded, length - decoded, out + decoded / 4 * 3);
+    }
+#endif
+
+    size_t tail = 0;
+    if (!decodeScalar(encoded + decoded, length - decoded, out + decoded / 4 * 3, tail))
+    {
+        return false;
+    }
+
+    written = decoded / 4 * 3 + tail;
+    return true;
+}
+
+string BlockPicture::base64Decode(const string& encoded)
+{
+    string decoded = string(BlockPicture::maxDecodedSize(encoded.size()), '\0');
+    size_t written = 0;
+    if (!BlockPicture::base64Decode(encoded.data(), encoded.size(), reinterpret_cast<uint8_t*>(decoded.data()), written))
+    {
+        throw std::runtime_error("Invalid base64 data.");
+    }
+
+    decoded.resize(written);
+    return decoded;
+}
+
+bool BlockPicture::parseFields(const uint8_t* block, size_t length)
+{
+    size_t pos = 0;
+    auto readValue = [block, length, &pos](uint32_t& value)
+    {
+        if (length - pos < 4)
+        {
+            return false;
+        }
+        value = readUInt32BE(block + pos);
+        pos += 4;
+        return true;
+    };
+    auto readString = [block, length, &pos, &readValue](string& value)
+    {
+        uint32_t size;
+        if (!readValue(size) || length - pos < size)
+        {
+            return false;
+        }
+        value.assign(reinterpret_cast<const char*>(block + pos), size);
+        pos += size;
+        return true;
+    };
+
+    if (!readValue(this->type) || !readString(this->mimeType) || !readString(this->description) ||
+        !readValue(this->width) || !readValue(this->height) || !readValue(this->colorDepth) ||
+        !readValue(this->colorCount) || !readValue(this->dataLength) || length - pos < this->dataLength)
+    {
+        this->dataLength = 0;
+        return false;
+    }
+
+    this->dataOffset = pos;
+    return true;
+}
+
+bool BlockPicture::parse(const uint8_t* block, size_t length)
+{
+    this->buffer.clear();
+    this->external = block;
+    return this->parseFields(block, length);
+}
+
+bool BlockPicture::readPictureBlock(const string& encoded)
+{
+    this->external = nullptr;
+    this->buffer.resize(BlockPicture::maxDecodedSize(encoded.size()));
+
+    size_t written = 0;
+    if (!BlockPicture::base64Decode(encoded.data(), encoded.size(), this->buffer.data(), written))
+    {
+        this->buffer.clear();
+        this->dataLength = 0;
+        return false;
+    }
+
+    this->buffer.resize(written);
+    return this->parseFields(this->buffer.data(), this->buffer.size());
+}
+
+bool BlockPicture::read(FileReader& reader, const VorbisComment::Picture& picture)
+{
+    if (!picture.base64)
+    {
+        this->external = nullptr;
+        this->buffer.resize(picture.length);
+        if (reader.readAt(picture.offset, this->buffer.data(), picture.length) != picture.length)
+        {
+            this->buffer.clear();
+            this->dataLength = 0;
+            return false;
+        }
+        return this->parseFields(this->buffer.data(), this->buffer.size());
+    }
+
+    string encoded = string(picture.length, '\0');
+    size_t count = 0;
+    if (picture.packetOffset != 0)
+    {
+        // Ogg comment values are split over pages, so they're read through the packet.
+        OggPacketStream stream = OggPacketStream(reader, picture.offset);
+        if (stream.nextPacket() && stream.skip(picture.packetOffset) == picture.packetOffset)
+        {
+            count = stream.read(encoded.data(), encoded.size());
+        }
+    }
+    else
+    {
+        count = reader.readAt(picture.offset, encoded.data(), encoded.size());
+    }
+
+    if (count != encoded.size())
+    {
+        this->dataLength = 0;
+        return false;
+    }
+    return this->readPictureBlock(encoded);
+}
+
+uint32_t BlockPicture::getType() const
+{
+    return this->type;
+}
+
+const string& BlockPicture::getMimeType() const
+{
+    return this->mimeType;
+}
+
+const string& BlockPicture::getDescription() const
+{
+    return this->description;
+}
+
+uint32_t BlockPicture::getWidth() const
+{
+    return this->width;
+}
+
+uint32_t BlockPicture::getHeight() const
+{
+    return this->height;
+}
+
+uint32_t BlockPicture::getColorDepth() const
+{
+    return this->colorDepth;
+}
+
+uint32_t BlockPicture::getColorCount() const
+{
+    return this->colorCount;
+}
+
+const uint8_t* BlockPicture::getData() const
+{
+    if (this->dataLength == 0)
+    {
+        return nullptr;
+    }
+    return (this->external != nullptr ? this->external : this->buffer.data()) + this->dataOffset;
+}
+
+uint32_t BlockPicture::getDataLength() const
+{
+    return this->dataLength;
+}
@@ -0,0 +1,228 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_BLOCKPICTURE_HPP
+#define MUSICLIST_BLOCKPICTURE_HPP
+
+#include <string>
+#include <vector>
+#include <cinttypes>
+#include <cstddef>
+
+#include "FileReader.hpp"
+#include "VorbisComment.hpp"
+
+using std::string;
+using std::vector;
+
+namespace MusicList
+{
+    /**
+     * @brief Decoder for FLAC picture blocks, as stored in PICTURE metadata blocks and, base64
+     * encoded, in METADATA_BLOCK_PICTURE comments.
+     *
+     * Base64 is decoded 32 or 16 characters at a time with AVX2 or SSSE3 when the CPU supports
+     * them, and a byte at a time otherwise.
+     */
+    class BlockPicture
+    {
+    public:
+        /**
+         * Base64 decoder implementations. base64Decode() picks the fastest one the CPU supports.
+         */
+        enum class Decoder : uint_fast8_t
+        {
+            scalar = 0,
+            ssse3,
+            avx2
+        };
+
+    private:
+        // Decoded block, if it was read by this BlockPicture rather than handed in by the caller.
+        vector<uint8_t> buffer;
+        // Block handed in through parse(). nullptr if the block is in `buffer`.
+        const uint8_t* external = nullptr;
+
+        uint32_t type = 0;
+        string mimeType;
+        string description;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t colorDepth = 0;
+        uint32_t colorCount = 0;
+        size_t dataOffset = 0;
+        uint32_t dataLength = 0;
+
+        /**
+         * @brief Reads the fields of a block without keeping a pointer to it.
+         *
+         * @returns false if the block is malformed.
+         */
+        bool parseFields(const uint8_t* block, size_t length);
+    public:
+        BlockPicture();
+
+        /**
+         * @param encodedLength number of base64 characters
+         *
+         * @returns size of the buffer needed to decode them.
+         */
+        static size_t maxDecodedSize(size_t encodedLength);
+
+        /**
+         * @param decoder decoder to check
+         *
+         * @returns true if the CPU can run the decoder.
+         */
+        static bool isSupported(Decoder decoder);
+
+        /**
+         * @brief Decodes base64 into a caller-provided buffer.
+         *
+         * Padding is optional, and only allowed at the end. Whitespace isn't skipped.
+         *
+         * @param encoded base64 characters
+         * @param length number of characters
+         * @param out destination holding at least maxDecodedSize(length) bytes
+         * @param written set to the number of bytes decoded
+         *
+         * @returns false if the input isn't valid base64.
+         */
+        static bool base64Decode(const char* encoded, size_t length, uint8_t* out, size_t& written);
+
+        /**
+         * @brief Decodes base64 with a specific decoder, like base64Decode(const char*, size_t, uint8_t*, size_t&).
+         *
+         * Decoders the CPU doesn't support fall back to the scalar one.
+         *
+         * @param decoder decoder to use
+         * @param encoded base64 characters
+         * @param length number of characters
+         * @param out destination holding at least maxDecodedSize(length) bytes
+         * @param written set to the number of bytes decoded
+         *
+         * @returns false if the input isn't valid base64.
+         */
+        static bool base64Decode(Decoder decoder, const char* encoded, size_t length, uint8_t* out, size_t& written);
+
+        /**
+         * @brief Decodes base64 into a new string.
+         *
+         * @param encoded base64 text
+         *
+         * @returns the decoded bytes.
+         *
+         * @throws std::runtime_error if the input isn't valid base64.
+         */
+        static string base64Decode(const string& encoded);
+
+        /**
+         * @brief Reads a decoded picture block in place.
+         *
+         * The image data isn't copied, so the block must outlive this BlockPicture's use of getData().
+         *
+         * @param block start of the picture block
+         * @param length size of the block in bytes
+         *
+         * @returns false if the block is malformed.
+         */
+        bool parse(const uint8_t* block, size_t length);
+
+        /**
+         * @brief Decodes and reads the value of a METADATA_BLOCK_PICTURE comment.
+         *
+         * @param encoded base64-encoded picture block
+         *
+         * @returns false if the value isn't valid base64 or the block is malformed.
+         */
+        bool readPictureBlock(const string& encoded);
+
+        /**
+         * @brief Reads a picture recorded with ReadOptions::recordPictures.
+         *
+         * Only the picture's bytes are read from the file.
+         *
+         * @param reader open reader for the file the picture was recorded from
+         * @param picture position of the picture
+         *
+         * @returns false if the picture can't be read or is malformed.
+         */
+        bool read(FileReader& reader, const VorbisComment::Picture& picture);
+
+        /**
+         * @returns picture type, e.g. 3 for the front cover.
+         */
+        uint32_t getType() const;
+
+        /**
+         * @returns MIME type of the image, or "-->" if the image data is a URL.
+         */
+        const string& getMimeType() const;
+
+        /**
+         * @returns UTF-8 description of the picture.
+         */
+        const string& getDescription() const;
+
+        /**
+         * @returns width of the image in pixels.
+         */
+        uint32_t getWidth() const;
+
+        /**
+         * @returns height of the image in pixels.
+         */
+        uint32_t getHeight() const;
+
+        /**
+         * @returns colour depth of the image in bits per pixel.
+         */
+        uint32_t getColorDepth() const;
+
+        /**
+         * @returns number of colours in an indexed image, or 0 for other images.
+         */
+        uint32_t getColorCount() const;
+
+        /**
+         * @returns start of the image data, or nullptr if there is none.
+         */
+        const uint8_t* getData() const;
+
+        /**
+         * @returns size of the image data in bytes.
+         */
+        uint32_t getDataLength() const;
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_BLOCKPICTURE_HPP
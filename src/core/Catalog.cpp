@@ -0,0 +1,434 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "Catalog.hpp"
+
+using namespace MusicList;
+
+static const char CATALOG_MAGIC[8] = {'M', 'L', 'C', 'A', 'T', 'L', 'G', 0};
+// Bump whenever the header or a section's layout changes.
+static const uint32_t CATALOG_VERSION = 1;
+// Written in the writer's byte order. Reads back differently on a machine with the other order.
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+static const size_t SECTION_ALIGNMENT = 16;
+
+static_assert(sizeof(Mbid) == 16, "Mbid must pack into 16 bytes.");
+static_assert(sizeof(CatalogAlbum) == 40, "CatalogAlbum must not contain padding.");
+
+namespace
+{
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t trackCount;
+        uint32_t albumCount;
+        uint32_t stringCount;
+        uint32_t stringBytes;
+        uint64_t offsets[Catalog::SECTION_COUNT];
+    };
+
+    /**
+     * @returns size in bytes of a section of a catalog with the provided header.
+     */
+    uint64_t sectionSize(Catalog::Section section, const Header& header)
+    {
+        switch (section)
+        {
+            case Catalog::stringOffsets:
+                return (static_cast<uint64_t>(header.stringCount) + 1) * sizeof(uint32_t);
+            case Catalog::stringData:
+                return header.stringBytes;
+            case Catalog::trackNums:
+            case Catalog::totalTracks:
+            case Catalog::discNums:
+            case Catalog::totalDiscs:
+            case Catalog::formats:
+            case Catalog::lossless:
+                return header.trackCount;
+            case Catalog::trackAlbums:
+            case Catalog::titles:
+            case Catalog::artists:
+            case Catalog::paths:
+                return static_cast<uint64_t>(header.trackCount) * sizeof(uint32_t);
+            case Catalog::trackMbids:
+                return static_cast<uint64_t>(header.trackCount) * sizeof(Mbid);
+            case Catalog::albums:
+                return static_cast<uint64_t>(header.albumCount) * sizeof(CatalogAlbum);
+            default:
+                return 0;
+        }
+    }
+
+    template<typename T>
+    void appendValue(string& out, const T& value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /**
+     * Builds the deduplicated string table. Views must stay valid until the table is written.
+     */
+    class StringTable
+    {
+    private:
+        std::unordered_map<string_view,uint32_t> ids;
+    public:
+        string offsets;
+        string data;
+
+        StringTable()
+        {
+            this->add("");
+        }
+
+        uint32_t add(string_view value)
+        {
+            const auto found = this->ids.find(value);
+            if (found != this->ids.end())
+            {
+                return found->second;
+            }
+
+            const auto id = static_cast<uint32_t>(this->ids.size());
+            this->ids.emplace(value, id);
+
+            appendValue(this->offsets, static_cast<uint32_t>(this->data.size()));
+            this->data.append(value);
+            this->data.push_back('\0');
+            return id;
+        }
+
+        uint32_t size() const
+        {
+            return static_cast<uint32_t>(this->ids.size());
+        }
+    };
+
+    Mbid parseMbid(string_view text)
+    {
+        Mbid mbid;
+        if (!Mbid::parse(text, mbid))
+        {
+            mbid = Mbid();
+        }
+        return mbid;
+    }
+}
+
+Catalog::Catalog(const fs::path& path)
+{
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open catalog: " + path.string() + ".");
+    }
+
+    struct stat info = {};
+    if (fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) < sizeof(Header))
+    {
+        close(fd);
+        throw std::runtime_error("Catalog is truncated: " + path.string() + ".");
+    }
+
+    this->length = static_cast<size_t>(info.st_size);
+    void* mapping = mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file referenced.
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("Failed to map catalog: " + path.string() + ".");
+    }
+    this->data = static_cast<const uint8_t*>(mapping);
+
+    try
+    {
+        Header header;
+        memcpy(&header, this->data, sizeof(Header));
+        if (memcmp(header.magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) != 0)
+        {
+            throw std::runtime_error("Catalog has an unknown format: ");
+        }
+        if (header.version != CATALOG_VERSION)
+        {
+            throw std::runtime_error("Catalog was written by an incompatible version: ");
+        }
+        if (header.byteOrder != BYTE_ORDER_MARK)
+        {
+            throw std::runtime_error("Catalog was written with a different byte order: ");
+        }
+        if (header.stringCount == 0)
+        {
+            throw std::runtime_error("Catalog has no string table: ");
+        }
+
+        for (uint_fast8_t i = 0; i < SECTION_COUNT; i++)
+        {
+            const uint64_t offset = header.offsets[i];
+            const uint64_t size = sectionSize(static_cast<Section>(i), header);
+            if (offset % SECTION_ALIGNMENT != 0 || offset > this->length || size > this->length - offset)
+            {
+                throw std::runtime_error("Catalog is truncated: ");
+            }
+            this->sections[i] = this->data + offset;
+        }
+
+        this->trackCount = header.trackCount;
+        this->albumCount = header.albumCount;
+        this->stringCount = header.stringCount;
+
+        // Check the string and album tables once so lookups don't have to.
+        const auto offsets = this->column<uint32_t>(stringOffsets, this->stringCount + 1);
+        const auto* strings = this->sections[stringData];
+        if (offsets[0] != 0 || offsets[this->stringCount] != header.stringBytes)
+        {
+            throw std::runtime_error("Catalog has a corrupt string table: ");
+        }
+        for (uint32_t i = 0; i < this->stringCount; i++)
+        {
+            if (offsets[i + 1] <= offsets[i] || strings[offsets[i + 1] - 1] != '\0')
+            {
+                throw std::runtime_error("Catalog has a corrupt string table: ");
+            }
+        }
+
+        for (const auto& album : this->getAlbums())
+        {
+            if (static_cast<uint64_t>(album.firstTrack) + album.trackCount > this->trackCount)
+            {
+                throw std::runtime_error("Catalog has a corrupt album table: ");
+            }
+        }
+    }
+    catch (const std::runtime_error& e)
+    {
+        munmap(const_cast<uint8_t*>(this->data), this->length);
+        throw std::runtime_error(e.what() + path.string() + ".");
+    }
+}
+
+Catalog::~Catalog()
+{
+    munmap(const_cast<uint8_t*>(this->data), this->length);
+}
+
+void Catalog::write(const fs::path& path, const map<string,shared_ptr<Album>>& albums)
+{
+    StringTable strings;
+    string blobs[SECTION_COUNT];
+    uint32_t trackIndex = 0;
+
+    for (const auto& albumPair : albums)
+    {
+        const Album& album = *albumPair.second;
+        const auto albumIndex = static_cast<uint32_t>(blobs[Section::albums].size() / sizeof(CatalogAlbum));
+
+        CatalogAlbum record;
+        record.mbid = parseMbid(album.getMBID());
+        record.name = strings.add(album.getName());
+        record.artist = strings.add(album.getArtist());
+        record.firstTrack = trackIndex;
+        record.trackCount = static_cast<uint32_t>(album.getTrackSet().size());
+        record.totalTracks = album.getTotalTracks();
+        appendValue(blobs[Section::albums], record);
+
+        for (const auto& trackPair : album.getTrackSet())
+        {
+            const Track& track = *trackPair.second;
+            blobs[Section::trackNums].push_back(static_cast<char>(track.getTrackNum()));
+            blobs[Section::totalTracks].push_back(static_cast<char>(track.getTotalTracks()));
+            blobs[Section::discNums].push_back(static_cast<char>(track.getDiscNum()));
+            blobs[Section::totalDiscs].push_back(static_cast<char>(track.getTotalDiscs()));
+            blobs[Section::formats].push_back(static_cast<char>(track.getAudioFormat()));
+            blobs[Section::lossless].push_back(static_cast<char>(track.getIsLossless()));
+            appendValue(blobs[Section::trackAlbums], albumIndex);
+            appendValue(blobs[Section::titles], strings.add(track.getTitle()));
+            appendValue(blobs[Section::artists], strings.add(track.getArtist()));
+            appendValue(blobs[Section::paths], strings.add(track.getPath().native()));
+            appendValue(blobs[Section::trackMbids], parseMbid(track.getMBID()));
+            trackIndex++;
+        }
+    }
+
+    if (strings.data.size() > UINT32_MAX)
+    {
+        throw std::runtime_error("Catalog string table exceeds 4 GiB: " + path.string() + ".");
+    }
+
+    // Closing offset, so every string's length is the distance to the next offset.
+    appendValue(strings.offsets, static_cast<uint32_t>(strings.data.size()));
+    blobs[stringOffsets] = std::move(strings.offsets);
+    blobs[stringData] = std::move(strings.data);
+
+    Header header = {};
+    memcpy(header.magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+    header.version = CATALOG_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.trackCount = trackIndex;
+    header.albumCount = static_cast<uint32_t>(albums.size());
+    header.stringCount = strings.size();
+    header.stringBytes = static_cast<uint32_t>(blobs[stringData].size());
+
+    uint64_t offset = sizeof(Header);
+    for (uint_fast8_t i = 0; i < SECTION_COUNT; i++)
+    {
+        offset = (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+        header.offsets[i] = offset;
+        offset += blobs[i].size();
+    }
+
+    fs::path tmpPath = path;
+    tmpPath += ".tmp";
+
+    std::ofstream catalogFile = std::ofstream(tmpPath, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!catalogFile.is_open())
+    {
+        throw std::runtime_error("Failed to open catalog for writing: " + tmpPath.string() + ".");
+    }
+
+    const char padding[SECTION_ALIGNMENT] = {};
+    uint64_t written = sizeof(Header);
+    catalogFile.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    for (uint_fast8_t i = 0; i < SECTION_COUNT; i++)
+    {
+        catalogFile.write(padding, static_cast<std::streamsize>(header.offsets[i] - written));
+        catalogFile.write(blobs[i].data(), static_cast<std::streamsize>(blobs[i].size()));
+        written = header.offsets[i] + blobs[i].size();
+    }
+
+    catalogFile.close();
+    if (catalogFile.fail())
+    {
+        throw std::runtime_error("Failed to write catalog: " + tmpPath.string() + ".");
+    }
+
+    fs::rename(tmpPath, path);
+}
+
+uint32_t Catalog::getTrackCount() const
+{
+    return this->trackCount;
+}
+
+uint32_t Catalog::getAlbumCount() const
+{
+    return this->albumCount;
+}
+
+uint32_t Catalog::getStringCount() const
+{
+    return this->stringCount;
+}
+
+string_view Catalog::getString(uint32_t id) const
+{
+    if (id >= this->stringCount)
+    {
+        throw std::out_of_range("Catalog string id is out of range.");
+    }
+
+    const auto offsets = this->column<uint32_t>(stringOffsets, this->stringCount + 1);
+    const char* strings = reinterpret_cast<const char*>(this->sections[stringData]);
+    return string_view(strings + offsets[id], offsets[id + 1] - offsets[id] - 1);
+}
+
+Catalog::Column<uint8_t> Catalog::getTrackNums() const
+{
+    return this->column<uint8_t>(trackNums, this->trackCount);
+}
+
+Catalog::Column<uint8_t> Catalog::getTotalTracks() const
+{
+    return this->column<uint8_t>(totalTracks, this->trackCount);
+}
+
+Catalog::Column<uint8_t> Catalog::getDiscNums() const
+{
+    return this->column<uint8_t>(discNums, this->trackCount);
+}
+
+Catalog::Column<uint8_t> Catalog::getTotalDiscs() const
+{
+    return this->column<uint8_t>(totalDiscs, this->trackCount);
+}
+
+Catalog::Column<uint8_t> Catalog::getFormats() const
+{
+    return this->column<uint8_t>(formats, this->trackCount);
+}
+
+Catalog::Column<uint8_t> Catalog::getLossless() const
+{
+    return this->column<uint8_t>(lossless, this->trackCount);
+}
+
+Catalog::Column<uint32_t> Catalog::getTrackAlbums() const
+{
+    return this->column<uint32_t>(trackAlbums, this->trackCount);
+}
+
+Catalog::Column<uint32_t> Catalog::getTitles() const
+{
+    return this->column<uint32_t>(titles, this->trackCount);
+}
+
+Catalog::Column<uint32_t> Catalog::getArtists() const
+{
+    return this->column<uint32_t>(artists, this->trackCount);
+}
+
+Catalog::Column<uint32_t> Catalog::getPaths() const
+{
+    return this->column<uint32_t>(paths, this->trackCount);
+}
+
+Catalog::Column<Mbid> Catalog::getTrackMBIDs() const
+{
+    return this->column<Mbid>(trackMbids, this->trackCount);
+}
+
+Catalog::Column<CatalogAlbum> Catalog::getAlbums() const
+{
+    return this->column<CatalogAlbum>(albums, this->albumCount);
+}
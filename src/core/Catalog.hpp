@@ -0,0 +1,243 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_CATALOG_HPP
+#define MUSICLIST_CATALOG_HPP
+
+#include <filesystem>
+#include <cinttypes>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "Album.hpp"
+#include "Mbid.hpp"
+
+namespace fs = std::filesystem;
+
+using std::map;
+using std::string;
+using std::string_view;
+using std::shared_ptr;
+
+namespace MusicList
+{
+    /**
+     * @brief Fixed-width album record stored in a catalog's album table.
+     *
+     * The album's tracks are stored contiguously, starting at firstTrack.
+     */
+    struct CatalogAlbum
+    {
+        Mbid mbid;              // All zero if the album has no valid MBID.
+        uint32_t name = 0;      // Catalog string id.
+        uint32_t artist = 0;    // Catalog string id.
+        uint32_t firstTrack = 0;
+        uint32_t trackCount = 0;
+        uint8_t totalTracks = 0;
+        uint8_t reserved[7] = {};
+    };
+
+    /**
+     * @brief Read-only view of a binary catalog written by Catalog::write().
+     *
+     * A catalog holds the same albums and tracks as the JSON export in a form that can be used
+     * straight from a memory mapping: a deduplicated string table, one fixed-width column per
+     * track field and an album table. Opening a catalog only validates its header and section
+     * bounds, so the load time doesn't depend on the size of the library.
+     *
+     * Values are stored in the byte order of the machine that wrote the catalog.
+     */
+    class Catalog
+    {
+    public:
+        /**
+         * @brief Array of values inside the mapped catalog.
+         */
+        template<typename T>
+        struct Column
+        {
+            const T* values = nullptr;
+            uint32_t count = 0;
+
+            inline const T& operator[](uint32_t index) const { return this->values[index]; }
+            inline const T* begin() const { return this->values; }
+            inline const T* end() const { return this->values + this->count; }
+            inline uint32_t size() const { return this->count; }
+        };
+
+        enum Section : uint_fast8_t
+        {
+            stringOffsets = 0,
+            stringData,
+            trackNums,
+            totalTracks,
+            discNums,
+            totalDiscs,
+            formats,
+            lossless,
+            trackAlbums,
+            titles,
+            artists,
+            paths,
+            trackMbids,
+            albums,
+            SECTION_COUNT
+        };
+
+        // String id of the empty string in every catalog.
+        static constexpr uint32_t EMPTY = 0;
+    private:
+        const uint8_t* data = nullptr;
+        size_t length = 0;
+
+        uint32_t trackCount = 0;
+        uint32_t albumCount = 0;
+        uint32_t stringCount = 0;
+        const uint8_t* sections[SECTION_COUNT] = {};
+
+        template<typename T>
+        inline Column<T> column(Section section, uint32_t count) const
+        {
+            return {reinterpret_cast<const T*>(this->sections[section]), count};
+        }
+    public:
+        /**
+         * @brief Maps the catalog at the provided path.
+         *
+         * @param path catalog file written by Catalog::write()
+         *
+         * @throws std::runtime_error if the file can't be opened or isn't a valid catalog.
+         */
+        explicit Catalog(const fs::path& path);
+
+        Catalog(const Catalog&) = delete;
+        Catalog& operator=(const Catalog&) = delete;
+
+        ~Catalog();
+
+        /**
+         * @brief Writes the provided albums and their tracks as a catalog.
+         *
+         * Albums are stored in map order and each album's tracks in the order of its track set,
+         * matching the JSON export. The file is written next to the destination and renamed
+         * into place.
+         *
+         * @param path destination file
+         * @param albums albums to store
+         *
+         * @throws std::runtime_error if the file can't be written.
+         */
+        static void write(const fs::path& path, const map<string,shared_ptr<Album>>& albums);
+
+        /**
+         * @returns number of tracks in the catalog.
+         */
+        uint32_t getTrackCount() const;
+
+        /**
+         * @returns number of albums in the catalog.
+         */
+        uint32_t getAlbumCount() const;
+
+        /**
+         * @returns number of strings in the string table.
+         */
+        uint32_t getStringCount() const;
+
+        /**
+         * @param id catalog string id
+         *
+         * @returns view of the string inside the mapping. It's followed by a NUL byte.
+         *
+         * @throws std::out_of_range if the id isn't in the string table.
+         */
+        string_view getString(uint32_t id) const;
+
+        // ============
+        // Track Columns
+        // ============
+
+        Column<uint8_t> getTrackNums() const;
+
+        Column<uint8_t> getTotalTracks() const;
+
+        Column<uint8_t> getDiscNums() const;
+
+        Column<uint8_t> getTotalDiscs() const;
+
+        /**
+         * @returns the AudioFormat of each track, as its underlying value.
+         */
+        Column<uint8_t> getFormats() const;
+
+        /**
+         * @returns 1 for each lossless track, 0 otherwise.
+         */
+        Column<uint8_t> getLossless() const;
+
+        /**
+         * @returns index of each track's album in the album table.
+         */
+        Column<uint32_t> getTrackAlbums() const;
+
+        /**
+         * @returns string id of each track's title.
+         */
+        Column<uint32_t> getTitles() const;
+
+        /**
+         * @returns string id of each track's album artist.
+         */
+        Column<uint32_t> getArtists() const;
+
+        /**
+         * @returns string id of each track's file path.
+         */
+        Column<uint32_t> getPaths() const;
+
+        /**
+         * @returns MusicBrainz track ID of each track. All zero if the track has no valid MBID.
+         */
+        Column<Mbid> getTrackMBIDs() const;
+
+        // ===========
+        // Album Table
+        // ===========
+
+        Column<CatalogAlbum> getAlbums() const;
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_CATALOG_HPP
@@ -0,0 +1,279 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <algorithm>
+#include <bitset>
+
+#include "Completeness.hpp"
+#include "JsonWriter.hpp"
+
+using namespace MusicList;
+
+namespace
+{
+    // Track and disc numbers are stored in 8 bits, so every position fits.
+    using PositionSet = std::bitset<256>;
+
+    struct DiscState
+    {
+        PositionSet present;
+        PositionSet duplicates;
+        uint_fast8_t totalTracks = 0;
+        uint_fast8_t highest = 0;
+        bool found = false;
+    };
+
+    /**
+     * @returns a set with positions 1 through count.
+     */
+    PositionSet firstPositions(uint_fast8_t count)
+    {
+        PositionSet positions = ~PositionSet() >> (255 - count);
+        return positions.reset(0);
+    }
+
+    void appendPositions(const PositionSet& positions, vector<uint_fast8_t>& out)
+    {
+        const size_t count = positions.count();
+        out.reserve(out.size() + count);
+        for (uint32_t i = 1; i < positions.size() && out.size() < count; i++)
+        {
+            if (positions.test(i))
+            {
+                out.push_back(static_cast<uint_fast8_t>(i));
+            }
+        }
+    }
+
+    void writePositions(JsonWriter& writer, const vector<uint_fast8_t>& positions)
+    {
+        writer.beginArray();
+        for (const auto position : positions)
+        {
+            writer.writeInt(position);
+        }
+        writer.endArray();
+    }
+}
+
+bool AlbumCompleteness::isComplete() const
+{
+    return this->missingDiscs.empty() && this->discs.empty();
+}
+
+void AlbumCompleteness::writeJSON(JsonWriter& writer) const
+{
+    writer.beginObject();
+    writer.writeKey("artist");
+    writer.writeString(this->album->getArtist());
+    writer.writeKey("discs");
+    writer.beginArray();
+    for (const auto& disc : this->discs)
+    {
+        writer.beginObject();
+        writer.writeKey("disc_num");
+        writer.writeInt(disc.discNum);
+        writer.writeKey("duplicates");
+        writePositions(writer, disc.duplicates);
+        writer.writeKey("missing");
+        writePositions(writer, disc.missing);
+        writer.writeKey("total_tracks");
+        writer.writeInt(disc.totalTracks);
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.writeKey("missing_discs");
+    writePositions(writer, this->missingDiscs);
+    writer.writeKey("musicbrainz_id");
+    writer.writeString(this->album->getMBID());
+    writer.writeKey("name");
+    writer.writeString(this->album->getName());
+    writer.writeKey("total_discs");
+    writer.writeInt(this->totalDiscs);
+    writer.writeKey("unnumbered_tracks");
+    writer.writeInt(this->unnumberedTracks);
+    writer.endObject();
+}
+
+CompletenessReport::CompletenessReport() = default;
+
+CompletenessReport::CompletenessReport(const map<string,shared_ptr<Album>>& albums)
+{
+    for (const auto& albumPair : albums)
+    {
+        AlbumCompleteness result = CompletenessReport::analyze(albumPair.second);
+        this->albumCount++;
+        if (result.isComplete())
+        {
+            continue;
+        }
+
+        this->missingDiscs += static_cast<uint32_t>(result.missingDiscs.size());
+        for (const auto& disc : result.discs)
+        {
+            this->missingTracks += static_cast<uint32_t>(disc.missing.size());
+            this->duplicateTracks += static_cast<uint32_t>(disc.duplicates.size());
+        }
+        this->incomplete.push_back(std::move(result));
+    }
+}
+
+AlbumCompleteness CompletenessReport::analyze(const shared_ptr<Album>& album)
+{
+    AlbumCompleteness result;
+    result.album = album;
+
+    // Indexed by disc number. Albums rarely have more than a couple of discs.
+    vector<DiscState> discs(2);
+    for (const auto& trackPair : album->getTrackSet())
+    {
+        const Track& track = *trackPair.second;
+        const uint_fast8_t discNum = std::max<uint_fast8_t>(track.getDiscNum(), 1);
+        if (discNum >= discs.size())
+        {
+            discs.resize(discNum + 1);
+        }
+
+        DiscState& disc = discs[discNum];
+        disc.found = true;
+        disc.totalTracks = std::max(disc.totalTracks, track.getTotalTracks());
+        result.totalDiscs = std::max(result.totalDiscs, track.getTotalDiscs());
+
+        const uint_fast8_t trackNum = track.getTrackNum();
+        if (trackNum == 0)
+        {
+            result.unnumberedTracks++;
+            continue;
+        }
+
+        // Setting a position that's already present marks it as duplicated.
+        PositionSet position;
+        position.set(trackNum);
+        disc.duplicates |= disc.present & position;
+        disc.present |= position;
+        disc.highest = std::max(disc.highest, trackNum);
+    }
+
+    const size_t discCount = std::max<size_t>(discs.size() - 1, result.totalDiscs);
+    for (size_t discNum = 1; discNum <= discCount; discNum++)
+    {
+        if (discNum >= discs.size() || !discs[discNum].found)
+        {
+            result.missingDiscs.push_back(static_cast<uint_fast8_t>(discNum));
+            continue;
+        }
+
+        const DiscState& disc = discs[discNum];
+        const uint_fast8_t expected = disc.totalTracks != 0 ? disc.totalTracks : disc.highest;
+        const PositionSet missing = firstPositions(expected) & ~disc.present;
+        if (missing.none() && disc.duplicates.none())
+        {
+            continue;
+        }
+
+        DiscCompleteness discResult;
+        discResult.discNum = static_cast<uint_fast8_t>(discNum);
+        discResult.totalTracks = disc.totalTracks;
+        appendPositions(missing, discResult.missing);
+        appendPositions(disc.duplicates, discResult.duplicates);
+        result.discs.push_back(std::move(discResult));
+    }
+
+    return result;
+}
+
+const vector<AlbumCompleteness>& CompletenessReport::getIncompleteAlbums() const
+{
+    return this->incomplete;
+}
+
+uint32_t CompletenessReport::getAlbumCount() const
+{
+    return this->albumCount;
+}
+
+uint32_t CompletenessReport::getMissingTrackCount() const
+{
+    return this->missingTracks;
+}
+
+uint32_t CompletenessReport::getDuplicateTrackCount() const
+{
+    return this->duplicateTracks;
+}
+
+uint32_t CompletenessReport::getMissingDiscCount() const
+{
+    return this->missingDiscs;
+}
+
+void CompletenessReport::printSummary(std::ostream& out) const
+{
+    out << std::to_string(this->albumCount - this->incomplete.size()) << " of " << std::to_string(this->albumCount)
+        << " albums are complete. " << std::to_string(this->missingTracks) << " missing tracks, "
+        << std::to_string(this->duplicateTracks) << " duplicate tracks and " << std::to_string(this->missingDiscs)
+        << " missing discs.\n";
+}
+
+void CompletenessReport::writeJSON(const fs::path& path) const
+{
+    JsonWriter writer = JsonWriter(path);
+
+    writer.beginObject();
+    writer.writeKey("albums");
+    writer.beginArray();
+    for (const auto& album : this->incomplete)
+    {
+        album.writeJSON(writer);
+    }
+    writer.endArray();
+
+    writer.writeKey("summary");
+    writer.beginObject();
+    writer.writeKey("albums");
+    writer.writeInt(this->albumCount);
+    writer.writeKey("complete_albums");
+    writer.writeInt(this->albumCount - this->incomplete.size());
+    writer.writeKey("duplicate_tracks");
+    writer.writeInt(this->duplicateTracks);
+    writer.writeKey("incomplete_albums");
+    writer.writeInt(this->incomplete.size());
+    writer.writeKey("missing_discs");
+    writer.writeInt(this->missingDiscs);
+    writer.writeKey("missing_tracks");
+    writer.writeInt(this->missingTracks);
+    writer.endObject();
+    writer.endObject();
+
+    writer.close();
+}
@@ -0,0 +1,164 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_COMPLETENESS_HPP
+#define MUSICLIST_COMPLETENESS_HPP
+
+#include <filesystem>
+#include <cinttypes>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Album.hpp"
+
+namespace fs = std::filesystem;
+
+using std::map;
+using std::string;
+using std::shared_ptr;
+using std::vector;
+
+namespace MusicList
+{
+    class JsonWriter;
+
+    /**
+     * @brief Missing and duplicated track positions on one disc of an album.
+     */
+    struct DiscCompleteness
+    {
+        uint_fast8_t discNum = 0;
+        // Largest TOTALTRACKS value on the disc. 0 if no track has one.
+        uint_fast8_t totalTracks = 0;
+        vector<uint_fast8_t> missing;
+        vector<uint_fast8_t> duplicates;
+    };
+
+    /**
+     * @brief Result of checking one album for missing and duplicated tracks.
+     */
+    struct AlbumCompleteness
+    {
+        shared_ptr<Album> album;
+        uint_fast8_t totalDiscs = 0;
+        vector<uint_fast8_t> missingDiscs;
+        // Only discs with missing or duplicated tracks.
+        vector<DiscCompleteness> discs;
+        // Tracks without a track number. They can't be placed, so they're only counted.
+        uint32_t unnumberedTracks = 0;
+
+        /**
+         * @returns true if no discs or tracks are missing and no position is duplicated.
+         */
+        bool isComplete() const;
+
+        /**
+         * @brief Streams the album's report as a JSON object.
+         *
+         * @param writer destination
+         */
+        void writeJSON(JsonWriter& writer) const;
+    };
+
+    /**
+     * @brief Checks every album for missing discs, missing tracks and duplicated track positions.
+     *
+     * Each album is checked in a single pass over its tracks that sets the track numbers found
+     * on each disc in a bitset. Missing and duplicated positions then fall out of a couple of
+     * bitset operations per disc. Tracks without a disc number count as disc 1.
+     *
+     * A disc's expected length is the largest TOTALTRACKS value among its tracks. Without one,
+     * only gaps below the highest track number found can be reported.
+     */
+    class CompletenessReport
+    {
+    private:
+        vector<AlbumCompleteness> incomplete;
+        uint32_t albumCount = 0;
+        uint32_t missingTracks = 0;
+        uint32_t duplicateTracks = 0;
+        uint32_t missingDiscs = 0;
+    public:
+        CompletenessReport();
+
+        /**
+         * @brief Checks the provided albums.
+         *
+         * @param albums albums to check, as returned by Importer::getAlbums()
+         */
+        explicit CompletenessReport(const map<string,shared_ptr<Album>>& albums);
+
+        /**
+         * @brief Checks a single album.
+         *
+         * @param album album to check
+         *
+         * @returns the album's missing discs and incomplete discs.
+         */
+        static AlbumCompleteness analyze(const shared_ptr<Album>& album);
+
+        /**
+         * @returns the albums that aren't complete, in album map order.
+         */
+        const vector<AlbumCompleteness>& getIncompleteAlbums() const;
+
+        uint32_t getAlbumCount() const;
+
+        uint32_t getMissingTrackCount() const;
+
+        uint32_t getDuplicateTrackCount() const;
+
+        uint32_t getMissingDiscCount() const;
+
+        /**
+         * @brief Prints a one-line summary of the report.
+         *
+         * @param out destination stream
+         */
+        void printSummary(std::ostream& out) const;
+
+        /**
+         * @brief Writes the report as a JSON document with a summary section and the
+         * incomplete albums.
+         *
+         * @param path file to write
+         *
+         * @throws std::runtime_error if the file can't be written.
+         */
+        void writeJSON(const fs::path& path) const;
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_COMPLETENESS_HPP
@@ -0,0 +1,479 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+
+#include "DirectorySnapshot.hpp"
+#include "WorkerPool.hpp"
+
+using namespace MusicList;
+
+static const char SNAPSHOT_MAGIC[8] = {'M', 'L', 'D', 'I', 'R', 'S', 'N', 0};
+// Bump whenever the listing layout changes.
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+namespace
+{
+    /**
+     * Appends fixed-width values in host byte order. The snapshot is never shared between machines.
+     */
+    template<typename T>
+    void writeValue(string& out, const T& value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void writeString(string& out, const string& value)
+    {
+        writeValue(out, static_cast<uint32_t>(value.size()));
+        out.append(value);
+    }
+
+    /**
+     * Bounds-checked cursor over a loaded snapshot file.
+     */
+    struct SnapshotReader
+    {
+        const string& data;
+        size_t pos = 0;
+
+        void require(size_t count) const
+        {
+            if (count > this->data.size() - this->pos)
+            {
+                throw std::runtime_error("Directory snapshot is truncated.");
+            }
+        }
+
+        template<typename T>
+        T readValue()
+        {
+            this->require(sizeof(T));
+            T value;
+            memcpy(&value, this->data.data() + this->pos, sizeof(T));
+            this->pos += sizeof(T);
+            return value;
+        }
+
+        string readString()
+        {
+            const auto length = this->readValue<uint32_t>();
+            this->require(length);
+            string value = this->data.substr(this->pos, length);
+            this->pos += length;
+            return value;
+        }
+    };
+}
+
+DirectorySnapshot::DirectorySnapshot() = default;
+
+DirectorySnapshot::DirectorySnapshot(const fs::path& snapshotPath)
+{
+    this->load(snapshotPath);
+}
+
+void DirectorySnapshot::load(const fs::path& snapshotPath)
+{
+    this->directories.clear();
+
+    std::ifstream snapshotFile = std::ifstream(snapshotPath, std::ios::binary);
+    if (!snapshotFile.is_open())
+    {
+        return;
+    }
+
+    const string data = string(std::istreambuf_iterator<char>(snapshotFile), std::istreambuf_iterator<char>());
+    snapshotFile.close();
+
+    SnapshotReader reader = {data};
+    try
+    {
+        reader.require(sizeof(SNAPSHOT_MAGIC));
+        if (memcmp(data.data(), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+        {
+            throw std::runtime_error("Directory snapshot has an unknown format.");
+        }
+        reader.pos += sizeof(SNAPSHOT_MAGIC);
+
+        if (reader.readValue<uint32_t>() != SNAPSHOT_VERSION)
+        {
+            // Outdated snapshots are simply rebuilt.
+            return;
+        }
+
+        const auto directoryCount = reader.readValue<uint32_t>();
+        this->directories.reserve(directoryCount);
+        for (uint32_t i = 0; i < directoryCount; i++)
+        {
+            string path = reader.readString();
+
+            Listing listing;
+            listing.inode = reader.readValue<uint64_t>();
+            listing.mtime = reader.readValue<int64_t>();
+
+            const auto childCount = reader.readValue<uint32_t>();
+            listing.children.reserve(childCount);
+            for (uint32_t j = 0; j < childCount; j++)
+            {
+                Child child;
+                child.name = reader.readString();
+                child.isDirectory = reader.readValue<uint8_t>() != 0;
+                listing.children.push_back(std::move(child));
+            }
+
+            this->directories[std::move(path)] = std::move(listing);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << " Ignoring " << snapshotPath.string() << ".\n";
+        this->directories.clear();
+    }
+}
+
+void DirectorySnapshot::save(const fs::path& snapshotPath) const
+{
+    string data;
+    data.append(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    writeValue(data, SNAPSHOT_VERSION);
+
+    writeValue(data, static_cast<uint32_t>(this->directories.size()));
+    for (const auto& pair : this->directories)
+    {
+        const Listing& listing = pair.second;
+
+        writeString(data, pair.first);
+        writeValue(data, listing.inode);
+        writeValue(data, listing.mtime);
+
+        writeValue(data, static_cast<uint32_t>(listing.children.size()));
+        for (const auto& child : listing.children)
+        {
+            writeString(data, child.name);
+            writeValue(data, static_cast<uint8_t>(child.isDirectory));
+        }
+    }
+
+    fs::path tmpPath = snapshotPath;
+    tmpPath += ".tmp";
+
+    std::ofstream snapshotFile = std::ofstream(tmpPath, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!snapshotFile.is_open())
+    {
+        throw std::runtime_error("Failed to open directory snapshot for writing: " + tmpPath.string());
+    }
+
+    snapshotFile.write(data.data(), static_cast<std::streamsize>(data.size()));
+    snapshotFile.close();
+    if (snapshotFile.fail())
+    {
+        throw std::runtime_error("Failed to write directory snapshot: " + tmpPath.string());
+    }
+
+    fs::rename(tmpPath, snapshotPath);
+}
+
+struct DirectorySnapshot::Node
+{
+    fs::path path;
+    Listing listing;
+    bool loaded = false;
+    bool reused = false;
+    // Set once the listing and subdirs are filled in. Guarded by WalkState::lock while walking
+    // on several threads.
+    bool ready = false;
+    vector<unique_ptr<Node>> subdirs;
+};
+
+struct DirectorySnapshot::WalkState
+{
+    const FileFilter& filter;
+    const FileVisitor& visit;
+    unique_ptr<WorkerPool> pool;
+    std::mutex lock;
+    std::condition_variable nodeReady;
+    std::atomic<bool> stopping = false;
+
+    WalkState(const FileFilter& filter, const FileVisitor& visit) : filter(filter), visit(visit) {}
+};
+
+bool DirectorySnapshot::readListing(int fd, const fs::path& dir, Listing& listing)
+{
+    thread_local vector<char> buffer(DIRENT_BUFFER_SIZE);
+
+    while (true)
+    {
+        const long length = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+        if (length < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "Failed to read directory " << dir.string() << ": " << strerror(errno) << '\n';
+            return false;
+        }
+        if (length == 0)
+        {
+            return true;
+        }
+
+        for (long pos = 0; pos < length;)
+        {
+            const auto* entry = reinterpret_cast<const struct dirent64*>(buffer.data() + pos);
+            pos += entry->d_reclen;
+
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            {
+                continue;
+            }
+
+            // Matches recursive_directory_iterator: symlinked files are listed, but symlinked
+            // directories aren't descended into.
+            unsigned char type = entry->d_type;
+            if (type == DT_UNKNOWN || type == DT_LNK)
+            {
+                struct stat info = {};
+                if (type == DT_UNKNOWN && fstatat(fd, name, &info, AT_SYMLINK_NOFOLLOW) == 0 && !S_ISLNK(info.st_mode))
+                {
+                    type = S_ISDIR(info.st_mode) ? DT_DIR : S_ISREG(info.st_mode) ? DT_REG : DT_UNKNOWN;
+                }
+                else
+                {
+                    type = fstatat(fd, name, &info, 0) == 0 && S_ISREG(info.st_mode) ? DT_REG : DT_UNKNOWN;
+                }
+            }
+
+            if (type == DT_DIR || type == DT_REG)
+            {
+                listing.children.push_back({name, type == DT_DIR});
+            }
+        }
+    }
+}
+
+void DirectorySnapshot::loadNode(Node& node, WalkState& state)
+{
+    if (!state.stopping)
+    {
+        const int fd = openat(AT_FDCWD, node.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        struct stat info = {};
+        if (fd < 0 || fstat(fd, &info) != 0)
+        {
+            std::cerr << "Failed to read directory " << node.path.string() << ": " << strerror(errno) << '\n';
+        }
+        else
+        {
+            node.listing.inode = static_cast<uint64_t>(info.st_ino);
+            node.listing.mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+
+            // Each directory is loaded by exactly one thread, so its stored entry is never
+            // touched concurrently.
+            auto found = this->directories.find(node.path.native());
+            if (found != this->directories.end() && found->second.inode == node.listing.inode &&
+                found->second.mtime == node.listing.mtime)
+            {
+                node.listing.children = std::move(found->second.children);
+                node.reused = true;
+                node.loaded = true;
+            }
+            else
+            {
+                // A partial listing is still walked, but isn't recorded, so the directory is
+                // read again next time.
+                node.loaded = DirectorySnapshot::readListing(fd, node.path, node.listing);
+            }
+        }
+
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    for (const auto& child : node.listing.children)
+    {
+        if (child.isDirectory)
+        {
+            node.subdirs.push_back(std::make_unique<Node>());
+            node.subdirs.back()->path = node.path / child.name;
+        }
+    }
+
+    if (state.pool == nullptr)
+    {
+        node.ready = true;
+        return;
+    }
+
+    // Subdirectories are read ahead of the visitor, which waits for each one in turn.
+    for (auto& subdir : node.subdirs)
+    {
+        state.pool->submit([this, &state, subdirPtr = subdir.get()] { this->loadNode(*subdirPtr, state); });
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(state.lock);
+        node.ready = true;
+    }
+    state.nodeReady.notify_all();
+}
+
+bool DirectorySnapshot::visitNode(Node& node, WalkState& state)
+{
+    if (node.loaded)
+    {
+        node.reused ? this->reusedCount++ : this->readCount++;
+    }
+
+    size_t subdirIndex = 0;
+    for (const auto& child : node.listing.children)
+    {
+        if (child.isDirectory)
+        {
+            Node& subdir = *node.subdirs[subdirIndex++];
+            if (state.pool == nullptr)
+            {
+                this->loadNode(subdir, state);
+            }
+            else
+            {
+                std::unique_lock<std::mutex> guard(state.lock);
+                state.nodeReady.wait(guard, [&subdir] { return subdir.ready; });
+            }
+
+            if (!this->visitNode(subdir, state))
+            {
+                return false;
+            }
+        }
+        else if (state.filter(child.name) && !state.visit(node.path / child.name))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void DirectorySnapshot::collectNode(Node& node, std::unordered_map<string,Listing>& walked, int64_t racyLimit)
+{
+    if (node.loaded && node.listing.mtime < racyLimit)
+    {
+        walked[node.path.native()] = std::move(node.listing);
+    }
+
+    for (auto& subdir : node.subdirs)
+    {
+        DirectorySnapshot::collectNode(*subdir, walked, racyLimit);
+    }
+}
+
+bool DirectorySnapshot::walk(const fs::path& root, const FileFilter& filter, const FileVisitor& visit,
+                             uint32_t threadCount)
+{
+    this->reusedCount = 0;
+    this->readCount = 0;
+
+    const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    WalkState state = WalkState(filter, visit);
+    if (threadCount > 1)
+    {
+        state.pool = std::make_unique<WorkerPool>(threadCount);
+    }
+
+    Node rootNode;
+    rootNode.path = root;
+    this->loadNode(rootNode, state);
+
+    const bool completed = this->visitNode(rootNode, state);
+    if (state.pool != nullptr)
+    {
+        // A stopped walk may still have directories queued.
+        state.stopping = true;
+        state.pool->wait();
+    }
+
+    std::unordered_map<string,Listing> walked;
+    walked.reserve(this->directories.size());
+    DirectorySnapshot::collectNode(rootNode, walked, now - RACY_WINDOW_NS);
+
+    if (completed)
+    {
+        // Directories that weren't visited no longer exist.
+        this->directories = std::move(walked);
+    }
+    else
+    {
+        for (auto& pair : walked)
+        {
+            this->directories[pair.first] = std::move(pair.second);
+        }
+    }
+
+    return completed;
+}
+
+uint32_t DirectorySnapshot::getReusedCount() const
+{
+    return this->reusedCount;
+}
+
+uint32_t DirectorySnapshot::getReadCount() const
+{
+    return this->readCount;
+}
+
+size_t DirectorySnapshot::size() const
+{
+    return this->directories.size();
+}
@@ -0,0 +1,201 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_DIRECTORYSNAPSHOT_HPP
+#define MUSICLIST_DIRECTORYSNAPSHOT_HPP
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <cinttypes>
+
+namespace fs = std::filesystem;
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace MusicList
+{
+    /**
+     * @brief Persisted listing of every directory in a tree.
+     *
+     * Each directory's inode, modification time and children are recorded while the tree is
+     * walked. A directory's modification time changes whenever an entry is added, removed or
+     * renamed inside it, so on the next walk the stored children of an unchanged directory
+     * are used without reading it. Unchanged directories cost one stat instead of a readdir
+     * plus a stat for every entry.
+     */
+    class DirectorySnapshot
+    {
+    public:
+        /**
+         * @returns true if the file with the provided name should be visited.
+         */
+        using FileFilter = std::function<bool(string_view)>;
+
+        /**
+         * @returns false to stop the walk.
+         */
+        using FileVisitor = std::function<bool(const fs::path&)>;
+
+        // Directories modified this close to the start of a walk aren't recorded, since
+        // another change within the same timestamp tick wouldn't be noticed.
+        static constexpr int64_t RACY_WINDOW_NS = 2000000000;
+
+        // Size of the buffer each thread reads directory entries into.
+        static constexpr size_t DIRENT_BUFFER_SIZE = 256 * 1024;
+    private:
+        struct Child
+        {
+            string name;
+            bool isDirectory = false;
+        };
+
+        struct Listing
+        {
+            uint64_t inode = 0;
+            int64_t mtime = 0;
+            vector<Child> children;
+        };
+
+        struct Node;
+        struct WalkState;
+
+        std::unordered_map<string,Listing> directories;
+        uint32_t reusedCount = 0;
+        uint32_t readCount = 0;
+
+        /**
+         * @brief Reads a directory's regular files and subdirectories with getdents64.
+         *
+         * Entry types come from d_type. Only symlinks and entries on file systems that don't
+         * report a type are stat'ed. Errors are reported to stderr.
+         *
+         * @param fd open descriptor of the directory
+         * @param dir path of the directory, for error messages
+         * @param listing destination for the directory's children
+         *
+         * @returns false if the directory couldn't be read in full. The children read before
+         * the error are kept in the listing.
+         */
+        static bool readListing(int fd, const fs::path& dir, Listing& listing);
+
+        /**
+         * @brief Fills a node with its directory's listing, from the snapshot if it's unchanged,
+         * and creates nodes for its subdirectories.
+         *
+         * When walking on several threads, loading the subdirectories is queued right away.
+         */
+        void loadNode(Node& node, WalkState& state);
+
+        /**
+         * @brief Visits the files of a loaded node and of every node below it in order.
+         *
+         * @returns false if the visitor stopped the walk.
+         */
+        bool visitNode(Node& node, WalkState& state);
+
+        /**
+         * @brief Moves the listings of every loaded node into the walked set.
+         */
+        static void collectNode(Node& node, std::unordered_map<string,Listing>& walked, int64_t racyLimit);
+    public:
+        DirectorySnapshot();
+
+        /**
+         * @brief Creates a snapshot populated from the file at the provided path.
+         *
+         * @param snapshotPath path to a file written by DirectorySnapshot::save()
+         */
+        explicit DirectorySnapshot(const fs::path& snapshotPath);
+
+        /**
+         * @brief Replaces the snapshot contents with the listings in the provided file.
+         *
+         * A missing file leaves the snapshot empty. A corrupt or outdated file is ignored.
+         *
+         * @param snapshotPath path to a file written by DirectorySnapshot::save()
+         */
+        void load(const fs::path& snapshotPath);
+
+        /**
+         * @brief Writes the snapshot to disk.
+         *
+         * The file is written next to the destination and renamed into place.
+         *
+         * @param snapshotPath destination file
+         */
+        void save(const fs::path& snapshotPath) const;
+
+        /**
+         * @brief Walks the tree below the provided directory.
+         *
+         * Files are visited on the calling thread, in the same order fs::recursive_directory_iterator
+         * would produce, even when directories are read on several threads. Symlinks to files
+         * are followed, symlinks to directories aren't. Directories that can't be read are
+         * reported to stderr and skipped.
+         *
+         * If the walk completes, the snapshot is replaced by the listings of the directories
+         * that were visited.
+         *
+         * @param root directory to walk
+         * @param filter decides which files are visited, by name
+         * @param visit called for each file that passes the filter
+         * @param threadCount number of threads reading directories. 1 reads them on the
+         * calling thread as they're visited.
+         *
+         * @returns false if the visitor stopped the walk.
+         */
+        bool walk(const fs::path& root, const FileFilter& filter, const FileVisitor& visit, uint32_t threadCount = 1);
+
+        /**
+         * @returns number of directories whose stored listing was used during the last walk.
+         */
+        uint32_t getReusedCount() const;
+
+        /**
+         * @returns number of directories that had to be read during the last walk.
+         */
+        uint32_t getReadCount() const;
+
+        /**
+         * @returns number of directories in the snapshot.
+         */
+        size_t size() const;
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_DIRECTORYSNAPSHOT_HPP
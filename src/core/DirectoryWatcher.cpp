@@ -0,0 +1,267 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "DirectoryWatcher.hpp"
+
+using namespace MusicList;
+
+static const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                   IN_ONLYDIR | IN_EXCL_UNLINK;
+
+// Enough for several hundred events with long names per read().
+static const size_t EVENT_BUFFER_SIZE = 64 * 1024;
+
+DirectoryWatcher::DirectoryWatcher(const fs::path& root)
+{
+    this->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (this->fd < 0)
+    {
+        throw std::runtime_error(string("Failed to initialize inotify: ") + strerror(errno) + ".");
+    }
+
+    this->addTree(root, false);
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+    if (this->fd >= 0)
+    {
+        close(this->fd);
+    }
+}
+
+void DirectoryWatcher::addTree(const fs::path& dir, bool reportFiles)
+{
+    this->addWatch(dir);
+
+    std::error_code error;
+    auto it = fs::recursive_directory_iterator(dir, fs::directory_options::skip_permission_denied, error);
+    for (; !error && it != fs::recursive_directory_iterator(); it.increment(error))
+    {
+        if (it->is_directory(error))
+        {
+            this->addWatch(it->path());
+        }
+        else if (reportFiles && it->is_regular_file(error))
+        {
+            this->markModified(it->path());
+        }
+    }
+}
+
+void DirectoryWatcher::addWatch(const fs::path& dir)
+{
+    const int wd = inotify_add_watch(this->fd, dir.c_str(), WATCH_MASK);
+    if (wd >= 0)
+    {
+        this->watches[wd] = dir;
+        return;
+    }
+
+    if (errno == ENOSPC && !this->limitReported)
+    {
+        std::cerr << "Reached the inotify watch limit. Changes below " << dir.string()
+                  << " won't be noticed until fs.inotify.max_user_watches is raised.\n";
+        this->limitReported = true;
+    }
+}
+
+void DirectoryWatcher::removeWatches(const fs::path& dir)
+{
+    for (auto it = this->watches.begin(); it != this->watches.end();)
+    {
+        if (DirectoryWatcher::isWithin(it->second, dir))
+        {
+            // Deleted directories already lost their watch. Moved ones would keep reporting
+            // events under their old path.
+            inotify_rm_watch(this->fd, it->first);
+            it = this->watches.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void DirectoryWatcher::markModified(const fs::path& path)
+{
+    this->removed.erase(path);
+    this->modified.insert(path);
+}
+
+void DirectoryWatcher::markRemoved(const fs::path& path)
+{
+    for (auto it = this->modified.lower_bound(path); it != this->modified.end() && DirectoryWatcher::isWithin(*it, path);)
+    {
+        it = this->modified.erase(it);
+    }
+    this->removed.insert(path);
+}
+
+void DirectoryWatcher::readEvents()
+{
+    alignas(inotify_event) char buffer[EVENT_BUFFER_SIZE];
+
+    while (true)
+    {
+        const ssize_t length = read(this->fd, buffer, sizeof(buffer));
+        if (length < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return;
+            }
+            throw std::runtime_error(string("Failed to read inotify events: ") + strerror(errno) + ".");
+        }
+
+        for (const char* pos = buffer; pos < buffer + length;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(pos);
+            pos += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                this->overflow = true;
+                continue;
+            }
+
+            const auto watch = this->watches.find(event->wd);
+            if (watch == this->watches.end())
+            {
+                continue;
+            }
+            if (event->mask & IN_IGNORED)
+            {
+                this->watches.erase(watch);
+                continue;
+            }
+            if (event->len == 0)
+            {
+                continue;
+            }
+
+            const fs::path path = watch->second / event->name;
+            if (event->mask & IN_ISDIR)
+            {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                {
+                    // Files may have been added before the watch was in place, so report
+                    // everything that's already there.
+                    this->addTree(path, true);
+                }
+                else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+                {
+                    this->removeWatches(path);
+                    this->markRemoved(path);
+                }
+            }
+            else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+            {
+                this->markModified(path);
+            }
+            else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+            {
+                this->markRemoved(path);
+            }
+        }
+    }
+}
+
+bool DirectoryWatcher::wait(Changes& changes, const std::chrono::milliseconds& timeout)
+{
+    pollfd pollFd = {this->fd, POLLIN, 0};
+    int pollTimeout = timeout.count() < 0 ? -1 : static_cast<int>(timeout.count());
+
+    while (true)
+    {
+        const int ready = poll(&pollFd, 1, pollTimeout);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::runtime_error(string("Failed to wait for inotify events: ") + strerror(errno) + ".");
+        }
+
+        if (ready == 0)
+        {
+            break;
+        }
+
+        this->readEvents();
+        pollTimeout = static_cast<int>(SETTLE_TIME.count());
+    }
+
+    changes.modified.assign(this->modified.begin(), this->modified.end());
+    changes.removed.assign(this->removed.begin(), this->removed.end());
+    changes.overflow = this->overflow;
+
+    this->modified.clear();
+    this->removed.clear();
+    this->overflow = false;
+
+    return changes.overflow || !changes.modified.empty() || !changes.removed.empty();
+}
+
+size_t DirectoryWatcher::size() const
+{
+    return this->watches.size();
+}
+
+bool DirectoryWatcher::isWithin(const fs::path& path, const fs::path& dir)
+{
+    auto dirEnd = dir.end();
+    if (dir.has_relative_path() && !dir.has_filename())
+    {
+        // Ignore the empty element left by a trailing separator.
+        --dirEnd;
+    }
+
+    return std::mismatch(dir.begin(), dirEnd, path.begin(), path.end()).first == dirEnd;
+}
@@ -0,0 +1,164 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_DIRECTORYWATCHER_HPP
+#define MUSICLIST_DIRECTORYWATCHER_HPP
+
+#include <chrono>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using std::string;
+using std::vector;
+
+namespace MusicList
+{
+    /**
+     * @brief Watches a directory tree for files being written, moved or deleted using inotify.
+     *
+     * Every directory in the tree gets its own watch. Directories created or moved into the
+     * tree are watched as soon as they're noticed, and the files already inside them are
+     * reported as changed.
+     */
+    class DirectoryWatcher
+    {
+    public:
+        /**
+         * @brief Files affected by one burst of events.
+         */
+        struct Changes
+        {
+            // Files that were written or moved into the tree.
+            vector<fs::path> modified;
+            // Files and directories that were deleted or moved out of the tree.
+            vector<fs::path> removed;
+            // Set if the kernel dropped events. The whole tree has to be rescanned.
+            bool overflow = false;
+        };
+
+        // How long the tree has to stay quiet before a burst of events is reported.
+        static constexpr std::chrono::milliseconds SETTLE_TIME = std::chrono::milliseconds(250);
+    private:
+        int fd = -1;
+        std::unordered_map<int,fs::path> watches;
+        bool limitReported = false;
+
+        std::set<fs::path> modified;
+        std::set<fs::path> removed;
+        bool overflow = false;
+
+        /**
+         * @brief Watches a directory and every directory below it.
+         *
+         * @param dir root of the tree to watch
+         * @param reportFiles true to mark the files found in the tree as modified
+         */
+        void addTree(const fs::path& dir, bool reportFiles);
+
+        /**
+         * @brief Adds a watch for a single directory.
+         *
+         * @param dir directory to watch
+         */
+        void addWatch(const fs::path& dir);
+
+        /**
+         * @brief Drops the watches of a directory that left the tree, and of its subdirectories.
+         *
+         * @param dir directory that was moved or deleted
+         */
+        void removeWatches(const fs::path& dir);
+
+        /**
+         * @brief Reads and handles every queued event.
+         *
+         * @throws std::runtime_error if the inotify descriptor can't be read.
+         */
+        void readEvents();
+
+        void markModified(const fs::path& path);
+
+        void markRemoved(const fs::path& path);
+    public:
+        /**
+         * @brief Starts watching the tree below the provided directory.
+         *
+         * @param root directory to watch
+         *
+         * @throws std::runtime_error if inotify isn't available.
+         */
+        explicit DirectoryWatcher(const fs::path& root);
+
+        DirectoryWatcher(const DirectoryWatcher&) = delete;
+        DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+        ~DirectoryWatcher();
+
+        /**
+         * @brief Blocks until something in the tree changes, then collects events until the tree
+         * has been quiet for SETTLE_TIME.
+         *
+         * Repeated events for the same file are merged, so a file that's written and then
+         * deleted is only reported as removed.
+         *
+         * @param changes destination for the affected files
+         * @param timeout maximum amount of time to wait for the first event. A negative value
+         * waits indefinitely.
+         *
+         * @returns false if nothing changed before the timeout passed, or if the events that
+         * arrived cancelled each other out.
+         *
+         * @throws std::runtime_error if the inotify descriptor can't be read.
+         */
+        bool wait(Changes& changes, const std::chrono::milliseconds& timeout = std::chrono::milliseconds(-1));
+
+        /**
+         * @returns number of directories being watched.
+         */
+        size_t size() const;
+
+        /**
+         * @param path path to check
+         * @param dir possible parent directory
+         *
+         * @returns true if the path is the directory itself or anywhere below it.
+         */
+        static bool isWithin(const fs::path& path, const fs::path& dir);
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_DIRECTORYWATCHER_HPP
@@ -0,0 +1,292 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "FileReader.hpp"
+
+using namespace MusicList;
+
+FileReader::FileReader(const fs::path& path, ReadMode mode) : path(path)
+{
+    this->fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (this->fd < 0)
+    {
+        std::ostringstream errStr;
+        errStr << "Failed to open file to determine audio format: " << path.string() << ".";
+        throw std::runtime_error(errStr.str());
+    }
+
+    struct stat info = {};
+    if (fstat(this->fd, &info) == 0)
+    {
+        this->fileSize = static_cast<uint64_t>(info.st_size);
+    }
+
+    if (mode == ReadMode::mapped && this->map(MAP_SIZE))
+    {
+        return;
+    }
+
+    this->ensure(PREFIX_SIZE);
+}
+
+FileReader::FileReader(const fs::path& path, int fd, vector<uint8_t>&& prefix) :
+    path(path), fd(fd), buffer(std::move(prefix))
+{
+    struct stat info = {};
+    if (fstat(this->fd, &info) == 0)
+    {
+        this->fileSize = static_cast<uint64_t>(info.st_size);
+    }
+}
+
+FileReader::~FileReader()
+{
+    if (this->mapping != nullptr)
+    {
+        // Drop the header pages from the page cache so a scan doesn't evict other hot data.
+        if (this->fd >= 0)
+        {
+            posix_fadvise(this->fd, 0, static_cast<off_t>(this->mappingSize), POSIX_FADV_DONTNEED);
+        }
+        this->unmap();
+    }
+
+    if (this->fd >= 0)
+    {
+        close(this->fd);
+    }
+}
+
+bool FileReader::map(size_t length)
+{
+    length = static_cast<size_t>(std::min<uint64_t>(length, this->fileSize));
+    if (length == 0 || !this->reopen())
+    {
+        return false;
+    }
+
+    void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, this->fd, 0);
+    if (address == MAP_FAILED)
+    {
+        return false;
+    }
+
+    this->unmap();
+    this->mapping = static_cast<uint8_t*>(address);
+    this->mappingSize = length;
+
+    // Only fault in what's touched, but fetch the headers at the front in one go.
+    madvise(this->mapping, this->mappingSize, MADV_RANDOM);
+    madvise(this->mapping, std::min(this->mappingSize, PREFIX_SIZE), MADV_WILLNEED);
+
+    return true;
+}
+
+void FileReader::unmap()
+{
+    if (this->mapping != nullptr)
+    {
+        munmap(this->mapping, this->mappingSize);
+        this->mapping = nullptr;
+        this->mappingSize = 0;
+    }
+}
+
+void FileReader::closeFile()
+{
+    if (this->fd >= 0)
+    {
+        close(this->fd);
+        this->fd = -1;
+    }
+}
+
+bool FileReader::reopen() const
+{
+    if (this->fd < 0)
+    {
+        this->fd = open(this->path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    return this->fd >= 0;
+}
+
+size_t FileReader::readFromFile(uint64_t offset, void* dest, size_t length) const
+{
+    // Don't open a closed file again just to find the end of it.
+    if ((this->fd < 0 && offset >= this->fileSize) || !this->reopen())
+    {
+        return 0;
+    }
+
+    auto* out = static_cast<uint8_t*>(dest);
+    size_t total = 0;
+    while (total < length)
+    {
+        const ssize_t count = pread(this->fd, out + total, length - total, static_cast<off_t>(offset + total));
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            break;
+        }
+        total += static_cast<size_t>(count);
+    }
+
+    return total;
+}
+
+const uint8_t* FileReader::data() const
+{
+    return this->mapping != nullptr ? this->mapping : this->buffer.data();
+}
+
+size_t FileReader::size() const
+{
+    return this->mapping != nullptr ? this->mappingSize : this->buffer.size();
+}
+
+bool FileReader::isMapped() const
+{
+    return this->mapping != nullptr;
+}
+
+uint64_t FileReader::getFileSize() const
+{
+    return this->fileSize;
+}
+
+const fs::path& FileReader::getPath() const
+{
+    return this->path;
+}
+
+bool FileReader::ensure(size_t length)
+{
+    if (this->mapping != nullptr)
+    {
+        if (length > this->mappingSize && this->mappingSize < this->fileSize)
+        {
+            this->map(std::max(length, this->mappingSize * 2));
+        }
+        return this->mappingSize >= length;
+    }
+
+    const size_t loaded = this->buffer.size();
+    if (length <= loaded)
+    {
+        return true;
+    }
+
+    const size_t wanted = static_cast<size_t>(std::min<uint64_t>(length, this->fileSize)) - loaded;
+    this->buffer.resize(loaded + wanted);
+    const size_t count = this->readFromFile(loaded, this->buffer.data() + loaded, wanted);
+    this->buffer.resize(loaded + count);
+
+    return this->buffer.size() >= length;
+}
+
+size_t FileReader::readAt(uint64_t offset, void* dest, size_t length) const
+{
+    auto* out = static_cast<uint8_t*>(dest);
+    size_t copied = 0;
+
+    if (offset < this->size())
+    {
+        copied = std::min<size_t>(length, this->size() - offset);
+        memcpy(out, this->data() + offset, copied);
+    }
+
+    if (copied < length)
+    {
+        copied += this->readFromFile(offset + copied, out + copied, length - copied);
+    }
+
+    return copied;
+}
+
+// ===================
+// Sequential Access
+// ===================
+
+size_t FileReader::read(void* dest, size_t length)
+{
+    const size_t count = this->readAt(this->position, dest, length);
+    this->position += count;
+    return count;
+}
+
+bool FileReader::seek(int64_t offset, int whence)
+{
+    int64_t base;
+    switch (whence)
+    {
+        case SEEK_SET:
+            base = 0;
+            break;
+        case SEEK_CUR:
+            base = static_cast<int64_t>(this->position);
+            break;
+        case SEEK_END:
+            base = static_cast<int64_t>(this->fileSize);
+            break;
+        default:
+            return false;
+    }
+
+    if (base + offset < 0)
+    {
+        return false;
+    }
+
+    this->position = static_cast<uint64_t>(base + offset);
+    return true;
+}
+
+uint64_t FileReader::tell() const
+{
+    return this->position;
+}
@@ -0,0 +1,212 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_FILEREADER_HPP
+#define MUSICLIST_FILEREADER_HPP
+
+#include <filesystem>
+#include <vector>
+#include <cinttypes>
+#include <cstddef>
+
+namespace fs = std::filesystem;
+
+using std::vector;
+
+namespace MusicList
+{
+    /**
+     * Ways a FileReader can access the start of a file.
+     */
+    enum class ReadMode : uint_fast8_t
+    {
+        buffered = 0, // Copy the prefix into a heap buffer with pread().
+        mapped        // Map the prefix into memory and read it in place.
+    };
+
+    /**
+     * @brief Read-only view of an audio file that is opened once and read through a prefix buffer.
+     *
+     * In buffered mode the first PREFIX_SIZE bytes are read with a single call when the file is
+     * opened. In mapped mode the first MAP_SIZE bytes are mapped instead, with readahead limited
+     * to the prefix so the audio frames behind the headers aren't pulled into the page cache.
+     * Format detection and tag parsing are served from the prefix, and the file is only read
+     * again when a caller needs bytes past the end of it.
+     */
+    class FileReader
+    {
+    private:
+        fs::path path;
+        // Mutable so a closed file can be opened again from const reads.
+        mutable int fd = -1;
+        uint64_t fileSize = 0;
+        uint64_t position = 0;
+        vector<uint8_t> buffer;
+
+        uint8_t* mapping = nullptr;
+        size_t mappingSize = 0;
+
+        /**
+         * @brief Maps the first `length` bytes of the file, replacing any existing mapping.
+         *
+         * @returns false if the file couldn't be mapped.
+         */
+        bool map(size_t length);
+
+        /**
+         * @brief Removes the current mapping, if any.
+         */
+        void unmap();
+
+        /**
+         * @brief Opens the file again if closeFile() was called.
+         *
+         * @returns false if the file couldn't be opened.
+         */
+        bool reopen() const;
+
+        /**
+         * @brief Reads from the file at the provided offset, retrying short reads.
+         *
+         * @returns number of bytes read.
+         */
+        size_t readFromFile(uint64_t offset, void* dest, size_t length) const;
+    public:
+        static constexpr size_t PREFIX_SIZE = 64 * 1024;
+        static constexpr size_t MAP_SIZE = 256 * 1024;
+
+        /**
+         * @brief Opens the file and reads or maps its prefix.
+         *
+         * Mapped mode falls back to buffered reads if the file can't be mapped.
+         *
+         * @param path file to open
+         * @param mode how to access the start of the file
+         *
+         * @throws std::runtime_error if the file can't be opened.
+         */
+        explicit FileReader(const fs::path& path, ReadMode mode = ReadMode::buffered);
+
+        /**
+         * @brief Wraps a file that has already been opened and had its prefix read.
+         *
+         * @param path path of the open file
+         * @param fd open file descriptor. The reader takes ownership of it.
+         * @param prefix bytes read from the start of the file
+         */
+        FileReader(const fs::path& path, int fd, vector<uint8_t>&& prefix);
+
+        FileReader(const FileReader&) = delete;
+        FileReader& operator=(const FileReader&) = delete;
+
+        ~FileReader();
+
+        /**
+         * @brief Closes the file descriptor but keeps the prefix.
+         *
+         * The file is opened again the first time bytes past the prefix are needed. Readers that
+         * are queued for a while should be closed so they don't hold a descriptor each.
+         */
+        void closeFile();
+
+        /**
+         * @returns pointer to the buffered bytes at the start of the file.
+         */
+        const uint8_t* data() const;
+
+        /**
+         * @returns number of bytes available through data().
+         */
+        size_t size() const;
+
+        /**
+         * @returns size of the file on disk.
+         */
+        uint64_t getFileSize() const;
+
+        /**
+         * @returns path of the open file.
+         */
+        const fs::path& getPath() const;
+
+        /**
+         * @returns true if the prefix is memory-mapped rather than buffered.
+         */
+        bool isMapped() const;
+
+        /**
+         * @brief Grows the prefix so that it holds at least the first `length` bytes of the file.
+         *
+         * Only the missing range is read. Pointers previously returned by data() are invalidated
+         * if the prefix grows.
+         *
+         * @param length number of bytes needed from the start of the file
+         *
+         * @returns false if the file is shorter than `length`.
+         */
+        bool ensure(size_t length);
+
+        /**
+         * @brief Copies bytes from an arbitrary offset, using the buffer where possible.
+         *
+         * @returns number of bytes copied. Less than `length` at the end of the file.
+         */
+        size_t readAt(uint64_t offset, void* dest, size_t length) const;
+
+        // ===================
+        // Sequential Access
+        // ===================
+
+        /**
+         * @brief Reads from the current stream position and advances it.
+         *
+         * Used to feed the FLAC and Opus libraries through their I/O callback APIs.
+         *
+         * @returns number of bytes read.
+         */
+        size_t read(void* dest, size_t length);
+
+        /**
+         * @brief Moves the stream position like fseek().
+         *
+         * @returns true on success.
+         */
+        bool seek(int64_t offset, int whence);
+
+        /**
+         * @returns current stream position.
+         */
+        uint64_t tell() const;
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_FILEREADER_HPP
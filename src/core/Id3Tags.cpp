@@ -0,0 +1,531 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "Id3Tags.hpp"
+#include "MemorySource.hpp"
+
+using namespace MusicList;
+
+using std::vector;
+
+namespace
+{
+    /**
+     * Vorbis comment keys for the ID3v2 frames that have one.
+     */
+    struct FrameKey
+    {
+        const char* frame;
+        const char* key;
+    };
+
+    const FrameKey TEXT_FRAMES[] = {
+        {"TIT2", "TITLE"},
+        {"TALB", "ALBUM"},
+        {"TPE1", "ARTIST"},
+        {"TPE2", "ALBUMARTIST"},
+        {"TYER", "DATE"},
+        {"TDRC", "DATE"},
+        {"TCON", "GENRE"},
+        {"TCOM", "COMPOSER"}
+    };
+
+    // TXXX descriptions written by MusicBrainz Picard.
+    const FrameKey USER_FRAMES[] = {
+        {"MusicBrainz Album Id", "MUSICBRAINZ_ALBUMID"},
+        {"MusicBrainz Artist Id", "MUSICBRAINZ_ARTISTID"},
+        {"MusicBrainz Album Artist Id", "MUSICBRAINZ_ALBUMARTISTID"},
+        {"MusicBrainz Release Group Id", "MUSICBRAINZ_RELEASEGROUPID"},
+        {"MusicBrainz Release Track Id", "MUSICBRAINZ_RELEASETRACKID"}
+    };
+
+    // Owner of the UFID frame holding the recording MBID.
+    const char* MUSICBRAINZ_UFID_OWNER = "http://musicbrainz.org";
+
+    const size_t HEADER_SIZE = 10;
+    // Tags above this size are treated as corruption.
+    const uint32_t MAX_TAG_SIZE = 16 * 1024 * 1024;
+
+    // Tag header flags
+    const uint8_t TAG_UNSYNCHRONISATION = 0x80;
+    const uint8_t TAG_EXTENDED_HEADER = 0x40;
+
+    // Frame format flags
+    const uint8_t V3_COMPRESSION = 0x80;
+    const uint8_t V3_ENCRYPTION = 0x40;
+    const uint8_t V3_GROUPING = 0x20;
+    const uint8_t V4_GROUPING = 0x40;
+    const uint8_t V4_COMPRESSION = 0x08;
+    const uint8_t V4_ENCRYPTION = 0x04;
+    const uint8_t V4_UNSYNCHRONISATION = 0x02;
+    const uint8_t V4_DATA_LENGTH = 0x01;
+
+    // Text encodings
+    const uint8_t ENCODING_LATIN1 = 0;
+    const uint8_t ENCODING_UTF16 = 1;
+    const uint8_t ENCODING_UTF16BE = 2;
+
+    /**
+     * Reads a 28-bit integer stored in the low 7 bits of 4 bytes.
+     */
+    uint32_t readSyncsafe(const uint8_t* bytes)
+    {
+        return ((bytes[0] & 0x7F) << 21) | ((bytes[1] & 0x7F) << 14) | ((bytes[2] & 0x7F) << 7) | (bytes[3] & 0x7F);
+    }
+
+    /**
+     * Drops the 0x00 inserted after every 0xFF by the unsynchronisation scheme.
+     */
+    void removeUnsynchronisation(vector<uint8_t>& data)
+    {
+        size_t out = 0;
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            data[out++] = data[i];
+            if (data[i] == 0xFF && i + 1 < data.size() && data[i + 1] == 0x00)
+            {
+                i++;
+            }
+        }
+        data.resize(out);
+    }
+
+    void appendUtf8(string& out, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            out.push_back(static_cast<char>(codePoint));
+        }
+        else if (codePoint < 0x800)
+        {
+            out.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else if (codePoint < 0x10000)
+        {
+            out.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+    }
+
+    string latin1ToUtf8(const uint8_t* data, size_t length)
+    {
+        string out;
+        out.reserve(length);
+        for (size_t i = 0; i < length; i++)
+        {
+            appendUtf8(out, data[i]);
+        }
+        return out;
+    }
+
+    /**
+     * Converts UTF-16 to UTF-8. A leading byte order mark overrides the default byte order.
+     */
+    string utf16ToUtf8(const uint8_t* data, size_t length, bool bigEndian)
+    {
+        size_t pos = 0;
+        if (length >= 2 && ((data[0] == 0xFF && data[1] == 0xFE) || (data[0] == 0xFE && data[1] == 0xFF)))
+        {
+            bigEndian = data[0] == 0xFE;
+            pos = 2;
+        }
+
+        auto unit = [data, bigEndian](size_t at) -> uint32_t
+        {
+            return bigEndian ? (data[at] << 8) | data[at + 1] : (data[at + 1] << 8) | data[at];
+        };
+
+        string out;
+        out.reserve(length / 2);
+        for (; pos + 1 < length; pos += 2)
+        {
+            uint32_t codePoint = unit(pos);
+            if (codePoint >= 0xD800 && codePoint < 0xDC00 && pos + 3 < length)
+            {
+                const uint32_t low = unit(pos + 2);
+                if (low >= 0xDC00 && low < 0xE000)
+                {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 2;
+                }
+            }
+            appendUtf8(out, codePoint);
+        }
+        return out;
+    }
+
+    /**
+     * Decodes the NUL-separated strings of a text frame body to UTF-8.
+     */
+    vector<string> decodeText(uint8_t encoding, const uint8_t* data, size_t length)
+    {
+        const bool wide = encoding == ENCODING_UTF16 || encoding == ENCODING_UTF16BE;
+        const size_t unitSize = wide ? 2 : 1;
+
+        vector<string> values;
+        size_t start = 0;
+        while (start < length)
+        {
+            size_t end = start;
+            while (end + unitSize <= length && !(data[end] == 0 && (!wide || data[end + 1] == 0)))
+            {
+                end += unitSize;
+            }
+            end = std::min(end, length);
+
+            if (encoding == ENCODING_LATIN1)
+            {
+                values.push_back(latin1ToUtf8(data + start, end - start));
+            }
+            else if (wide)
+            {
+                values.push_back(utf16ToUtf8(data + start, end - start, encoding == ENCODING_UTF16BE));
+            }
+            else
+            {
+                // UTF-8, or an unknown encoding passed through as is.
+                values.emplace_back(reinterpret_cast<const char*>(data + start), end - start);
+            }
+
+            start = end + unitSize;
+        }
+
+        // Writers often terminate the last string, which leaves nothing behind it.
+        if (values.empty())
+        {
+            values.emplace_back();
+        }
+        return values;
+    }
+
+    /**
+     * Splits a "3/12" position into its index and total.
+     */
+    void readIndex(const string& value, const char* indexKey, const char* totalKey, const Id3Tags::TagHandler& handler)
+    {
+        const size_t slash = value.find('/');
+        handler(indexKey, value.substr(0, slash));
+        if (slash != string::npos)
+        {
+            handler(totalKey, value.substr(slash + 1));
+        }
+    }
+
+    const char* textFrameKey(const char* id)
+    {
+        for (const auto& frame : TEXT_FRAMES)
+        {
+            if (memcmp(id, frame.frame, 4) == 0)
+            {
+                return frame.key;
+            }
+        }
+        return nullptr;
+    }
+
+    bool isWanted(const char* id)
+    {
+        return textFrameKey(id) != nullptr || memcmp(id, "TRCK", 4) == 0 || memcmp(id, "TPOS", 4) == 0 ||
+            memcmp(id, "TXXX", 4) == 0 || memcmp(id, "UFID", 4) == 0;
+    }
+
+    /**
+     * Hands the contents of a frame returned by isWanted() to the handler.
+     */
+    void handleFrame(const char* id, const uint8_t* data, size_t length, const Id3Tags::TagHandler& handler)
+    {
+        if (memcmp(id, "UFID", 4) == 0)
+        {
+            const char* text = reinterpret_cast<const char*>(data);
+            const auto* ownerEnd = static_cast<const char*>(memchr(text, 0, length));
+            if (ownerEnd != nullptr && string(text, ownerEnd) == MUSICBRAINZ_UFID_OWNER)
+            {
+                handler("MUSICBRAINZ_TRACKID", string(ownerEnd + 1, text + length));
+            }
+            return;
+        }
+
+        if (length < 1)
+        {
+            return;
+        }
+        const vector<string> values = decodeText(data[0], data + 1, length - 1);
+
+        if (memcmp(id, "TXXX", 4) == 0)
+        {
+            for (const auto& frame : USER_FRAMES)
+            {
+                if (values[0] == frame.frame)
+                {
+                    for (size_t i = 1; i < values.size(); i++)
+                    {
+                        handler(frame.key, values[i]);
+                    }
+                    return;
+                }
+            }
+        }
+        else if (memcmp(id, "TRCK", 4) == 0)
+        {
+            readIndex(values[0], "TRACKNUMBER", "TOTALTRACKS", handler);
+        }
+        else if (memcmp(id, "TPOS", 4) == 0)
+        {
+            readIndex(values[0], "DISCNUMBER", "TOTALDISCS", handler);
+        }
+        else if (const char* key = textFrameKey(id))
+        {
+            for (const auto& value : values)
+            {
+                handler(key, value);
+            }
+        }
+    }
+
+    /**
+     * Walks the frames between `start` and `end`. Only the frames returned by isWanted() are read.
+     */
+    template<typename Source>
+    void readFrames(const Source& source, uint64_t start, uint64_t end, uint8_t version,
+                    const Id3Tags::TagHandler& handler)
+    {
+        vector<uint8_t> frame;
+        uint64_t offset = start;
+        while (end - offset >= HEADER_SIZE)
+        {
+            uint8_t header[HEADER_SIZE];
+            if (source.readAt(offset, header, HEADER_SIZE) != HEADER_SIZE || header[0] == 0)
+            {
+                // Padding, or a truncated tag.
+                return;
+            }
+
+            const uint32_t size = version == 4 ? readSyncsafe(header + 4) : readUInt32BE(header + 4);
+            const uint64_t dataOffset = offset + HEADER_SIZE;
+            if (size > end - dataOffset)
+            {
+                return;
+            }
+            offset = dataOffset + size;
+
+            const char* id = reinterpret_cast<const char*>(header);
+            const uint8_t flags = header[9];
+            if (!isWanted(id) || size > Id3Tags::MAX_FRAME_SIZE ||
+                (version == 3 && (flags & (V3_COMPRESSION | V3_ENCRYPTION)) != 0) ||
+                (version == 4 && (flags & (V4_COMPRESSION | V4_ENCRYPTION)) != 0))
+            {
+                continue;
+            }
+
+            frame.resize(size);
+            if (source.readAt(dataOffset, frame.data(), size) != size)
+            {
+                return;
+            }
+
+            size_t skip = 0;
+            if (version == 3)
+            {
+                skip += (flags & V3_GROUPING) != 0 ? 1 : 0;
+            }
+            else
+            {
+                skip += (flags & V4_GROUPING) != 0 ? 1 : 0;
+                skip += (flags & V4_DATA_LENGTH) != 0 ? 4 : 0;
+                if ((flags & V4_UNSYNCHRONISATION) != 0)
+                {
+                    removeUnsynchronisation(frame);
+                }
+            }
+
+            if (skip <= frame.size())
+            {
+                handleFrame(id, frame.data() + skip, frame.size() - skip, handler);
+            }
+        }
+    }
+
+    /**
+     * Copies the ID3v1 field, dropping the NUL or space padding.
+     */
+    string readV1Field(const uint8_t* data, size_t length)
+    {
+        while (length > 0 && (data[length - 1] == 0 || data[length - 1] == ' '))
+        {
+            length--;
+        }
+        const auto* nul = static_cast<const uint8_t*>(memchr(data, 0, length));
+        return latin1ToUtf8(data, nul != nullptr ? static_cast<size_t>(nul - data) : length);
+    }
+}
+
+bool Id3Tags::isMp3(const FileReader& reader)
+{
+    const uint8_t* data = reader.data();
+    if (reader.size() >= 3 && memcmp(data, "ID3", 3) == 0)
+    {
+        return true;
+    }
+
+    // MPEG audio frame sync.
+    return reader.size() >= 2 && data[0] == 0xFF && (data[1] & 0xE0) == 0xE0;
+}
+
+bool Id3Tags::read(FileReader& reader, const TagHandler& handler)
+{
+    uint8_t header[HEADER_SIZE];
+    const bool hasV2 = reader.readAt(0, header, HEADER_SIZE) == HEADER_SIZE && memcmp(header, "ID3", 3) == 0 &&
+        (header[3] == 3 || header[3] == 4);
+    if ((hasV2 && Id3Tags::readV2(reader, handler)) || Id3Tags::readV1(reader, handler))
+    {
+        return true;
+    }
+
+    // An untagged file is fine, only a broken tag is an error.
+    return !hasV2;
+}
+
+bool Id3Tags::readV2(FileReader& reader, const TagHandler& handler)
+{
+    uint8_t header[HEADER_SIZE];
+    if (reader.readAt(0, header, HEADER_SIZE) != HEADER_SIZE || memcmp(header, "ID3", 3) != 0)
+    {
+        return false;
+    }
+
+    const uint8_t version = header[3];
+    const uint8_t flags = header[5];
+    const uint32_t tagSize = readSyncsafe(header + 6);
+    const uint64_t end = HEADER_SIZE + tagSize;
+    if ((version != 3 && version != 4) || tagSize > MAX_TAG_SIZE || end > reader.getFileSize())
+    {
+        return false;
+    }
+
+    // Tag-wide unsynchronisation in v2.3 also covers the frame headers, so that tag has to be
+    // decoded as a whole. v2.4 marks it per frame instead.
+    const bool unsynchronised = version == 3 && (flags & TAG_UNSYNCHRONISATION) != 0;
+    if (tagSize <= MAX_BUFFERED_TAG || unsynchronised)
+    {
+        // A single read of exactly the tag, if it isn't already in the prefix.
+        reader.ensure(static_cast<size_t>(end));
+    }
+
+    vector<uint8_t> decoded;
+    uint64_t start = HEADER_SIZE;
+    uint64_t frameEnd = end;
+    if (unsynchronised)
+    {
+        decoded.resize(tagSize);
+        if (reader.readAt(HEADER_SIZE, decoded.data(), decoded.size()) != decoded.size())
+        {
+            return false;
+        }
+        removeUnsynchronisation(decoded);
+        frameEnd = HEADER_SIZE + decoded.size();
+    }
+    const MemorySource memory = {decoded.data(), HEADER_SIZE, decoded.size()};
+
+    if ((flags & TAG_EXTENDED_HEADER) != 0)
+    {
+        uint8_t sizeBytes[4];
+        const size_t count = unsynchronised ? memory.readAt(start, sizeBytes, 4) : reader.readAt(start, sizeBytes, 4);
+        if (count != 4)
+        {
+            return false;
+        }
+        // The v2.3 size excludes its own 4 bytes, the syncsafe v2.4 size includes them.
+        start += version == 3 ? 4 + readUInt32BE(sizeBytes) : readSyncsafe(sizeBytes);
+        if (start > frameEnd)
+        {
+            return false;
+        }
+    }
+
+    if (unsynchronised)
+    {
+        readFrames(memory, start, frameEnd, version, handler);
+    }
+    else
+    {
+        readFrames(reader, start, frameEnd, version, handler);
+    }
+
+    return true;
+}
+
+bool Id3Tags::readV1(const FileReader& reader, const TagHandler& handler)
+{
+    const uint64_t fileSize = reader.getFileSize();
+    uint8_t tag[ID3V1_SIZE];
+    if (fileSize < ID3V1_SIZE || reader.readAt(fileSize - ID3V1_SIZE, tag, ID3V1_SIZE) != ID3V1_SIZE ||
+        memcmp(tag, "TAG", 3) != 0)
+    {
+        return false;
+    }
+
+    const std::pair<const char*, string> fields[] = {
+        {"TITLE", readV1Field(tag + 3, 30)},
+        {"ARTIST", readV1Field(tag + 33, 30)},
+        {"ALBUM", readV1Field(tag + 63, 30)},
+        {"DATE", readV1Field(tag + 93, 4)}
+    };
+    for (const auto& field : fields)
+    {
+        if (!field.second.empty())
+        {
+            handler(field.first, field.second);
+        }
+    }
+
+    // ID3v1.1 keeps the track number in the last byte of the comment, behind a NUL.
+    if (tag[125] == 0 && tag[126] != 0)
+    {
+        handler("TRACKNUMBER", std::to_string(tag[126]));
+    }
+
+    return true;
+}
@@ -0,0 +1,122 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_ID3TAGS_HPP
+#define MUSICLIST_ID3TAGS_HPP
+
+#include <functional>
+#include <cinttypes>
+#include <string>
+
+#include "FileReader.hpp"
+
+using std::string;
+
+namespace MusicList
+{
+    /**
+     * @brief Dependency-free reader for the ID3v2.3, ID3v2.4 and ID3v1 tags of MP3 files.
+     *
+     * An ID3v2 tag at the start of the file is fetched with a single read of the size given in
+     * its header, which usually falls within the prefix the FileReader has already read. Files
+     * without one cost a single 128-byte read of the ID3v1 tag at the end instead.
+     *
+     * Known frames are handed out under the Vorbis comment key of the same tag, so they can be
+     * stored exactly like comments from the other formats.
+     */
+    class Id3Tags
+    {
+    public:
+        /**
+         * Receives each tag as a Vorbis comment key and value. Values are UTF-8.
+         */
+        using TagHandler = std::function<void(const string& key, const string& value)>;
+
+        /**
+         * ID3v2 tags up to this size are read at once. Larger ones, usually due to embedded
+         * pictures, are read frame by frame so APIC payloads can be skipped without reading them.
+         */
+        static constexpr uint32_t MAX_BUFFERED_TAG = 256 * 1024;
+
+        /**
+         * Frames larger than this are skipped.
+         */
+        static constexpr uint32_t MAX_FRAME_SIZE = 1024 * 1024;
+
+        static constexpr size_t ID3V1_SIZE = 128;
+
+        /**
+         * @brief Checks whether a file starts with an ID3v2 tag or an MPEG audio frame.
+         *
+         * @param reader open reader for the file
+         *
+         * @returns true if the file looks like an MP3 file.
+         */
+        static bool isMp3(const FileReader& reader);
+
+        /**
+         * @brief Reads the ID3v2 tag at the start of the file, or the ID3v1 tag at its end.
+         *
+         * The ID3v1 tag is only read if there's no usable ID3v2 tag. Files with neither tag,
+         * including ones that only have an unsupported ID3v2.2 tag, are read without any tags.
+         *
+         * @param reader open reader for the file
+         * @param handler called for every tag
+         *
+         * @returns false if the ID3v2 tag is malformed and there's no ID3v1 tag to fall back on.
+         */
+        static bool read(FileReader& reader, const TagHandler& handler);
+
+        /**
+         * @brief Reads an ID3v2.3 or ID3v2.4 tag.
+         *
+         * @param reader open reader for the file
+         * @param handler called for every tag
+         *
+         * @returns false if the file doesn't start with a supported ID3v2 tag, or the tag is
+         * malformed.
+         */
+        static bool readV2(FileReader& reader, const TagHandler& handler);
+
+        /**
+         * @brief Reads the ID3v1 or ID3v1.1 tag in the last 128 bytes of the file.
+         *
+         * @param reader open reader for the file
+         * @param handler called for every tag
+         *
+         * @returns false if the file has no ID3v1 tag.
+         */
+        static bool readV1(const FileReader& reader, const TagHandler& handler);
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_ID3TAGS_HPP
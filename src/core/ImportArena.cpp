@@ -0,0 +1,95 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <atomic>
+
+#include "ImportArena.hpp"
+
+using namespace MusicList;
+
+namespace
+{
+    std::atomic<uint64_t> nextArenaId = 1;
+
+    // Last arena used by this thread. Arenas are identified by id rather than address so a new
+    // arena allocated where an old one lived is never mistaken for it.
+    thread_local uint64_t cachedArenaId = 0;
+    thread_local std::pmr::monotonic_buffer_resource* cachedArena = nullptr;
+}
+
+ImportArena::ImportArena() : id(nextArenaId++) {}
+
+ImportArena::~ImportArena()
+{
+    if (cachedArenaId == this->id)
+    {
+        cachedArenaId = 0;
+        cachedArena = nullptr;
+    }
+}
+
+std::pmr::monotonic_buffer_resource& ImportArena::local()
+{
+    if (cachedArenaId == this->id)
+    {
+        return *cachedArena;
+    }
+
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    auto& arena = this->threadArenas[std::this_thread::get_id()];
+    if (arena == nullptr)
+    {
+        arena = std::make_unique<std::pmr::monotonic_buffer_resource>(INITIAL_BLOCK_SIZE);
+    }
+
+    cachedArenaId = this->id;
+    cachedArena = arena.get();
+
+    return *arena;
+}
+
+void* ImportArena::do_allocate(size_t bytes, size_t alignment)
+{
+    return this->local().allocate(bytes, alignment);
+}
+
+void ImportArena::do_deallocate(void*, size_t, size_t)
+{
+    // Memory is only released when the arena is destroyed.
+}
+
+bool ImportArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
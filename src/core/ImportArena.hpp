@@ -0,0 +1,129 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_IMPORTARENA_HPP
+#define MUSICLIST_IMPORTARENA_HPP
+
+#include <cinttypes>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+using std::shared_ptr;
+using std::unique_ptr;
+
+namespace MusicList
+{
+    /**
+     * @brief Thread-safe monotonic memory resource owning everything created by an import session.
+     *
+     * Each thread allocates from its own std::pmr::monotonic_buffer_resource, so allocation only
+     * takes a lock the first time a thread uses the arena. Deallocation is a no-op. All memory is
+     * returned in a few large blocks when the arena is destroyed.
+     */
+    class ImportArena : public std::pmr::memory_resource
+    {
+    private:
+        const uint64_t id;
+
+        std::mutex lock;
+        std::unordered_map<std::thread::id,unique_ptr<std::pmr::monotonic_buffer_resource>> threadArenas;
+
+        /**
+         * @returns the calling thread's buffer, creating it on first use.
+         */
+        std::pmr::monotonic_buffer_resource& local();
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    public:
+        /**
+         * Size of the first block requested by each thread. Later blocks grow geometrically.
+         */
+        static constexpr size_t INITIAL_BLOCK_SIZE = 64 * 1024;
+
+        ImportArena();
+
+        ImportArena(const ImportArena&) = delete;
+        ImportArena& operator=(const ImportArena&) = delete;
+
+        ~ImportArena() override;
+    };
+
+    /**
+     * @brief Allocator that keeps an ImportArena alive for as long as any copy of it exists.
+     *
+     * Objects created with std::allocate_shared and this allocator store a copy in their control
+     * block, so the arena can't be destroyed while any shared_ptr to them is left. The control
+     * block frees itself through a temporary copy, so the arena is released last.
+     */
+    template<typename T>
+    class ArenaAllocator
+    {
+    private:
+        template<typename U>
+        friend class ArenaAllocator;
+
+        shared_ptr<ImportArena> arena;
+    public:
+        using value_type = T;
+
+        explicit ArenaAllocator(shared_ptr<ImportArena> arena) : arena(std::move(arena)) {}
+
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+        T* allocate(size_t count)
+        {
+            return static_cast<T*>(this->arena->allocate(count * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T* ptr, size_t count)
+        {
+            this->arena->deallocate(ptr, count * sizeof(T), alignof(T));
+        }
+
+        friend inline bool operator== (const ArenaAllocator& lhs, const ArenaAllocator& rhs)
+        {
+            return lhs.arena == rhs.arena;
+        }
+
+        friend inline bool operator!= (const ArenaAllocator& lhs, const ArenaAllocator& rhs) { return !(lhs == rhs); }
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_IMPORTARENA_HPP
@@ -0,0 +1,405 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "ImportMetrics.hpp"
+
+using namespace MusicList;
+
+namespace
+{
+    const char* const STAGE_NAMES[ImportMetrics::STAGE_COUNT] = {
+        "search", "discovery", "cache_lookup", "detection", "parsing", "grouping", "json_export", "catalog_export"
+    };
+
+    /**
+     * @returns true for stages that run once rather than once per file, and so have the
+     * resources used by the process recorded.
+     */
+    bool isSequential(ImportMetrics::Stage stage)
+    {
+        return stage == ImportMetrics::Stage::search || stage == ImportMetrics::Stage::grouping ||
+            stage == ImportMetrics::Stage::jsonExport || stage == ImportMetrics::Stage::catalogExport;
+    }
+
+    /**
+     * Finds "<key>: <value>" in the contents of /proc/self/io.
+     */
+    uint64_t readIoField(const char* data, const char* key)
+    {
+        const char* found = strstr(data, key);
+        return found == nullptr ? 0 : strtoull(found + strlen(key), nullptr, 10);
+    }
+
+    void atomicMax(std::atomic<uint64_t>& target, uint64_t value)
+    {
+        uint64_t current = target.load(std::memory_order_relaxed);
+        while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+    string formatDuration(uint64_t ns)
+    {
+        char text[32];
+        if (ns >= 1000000000ULL)
+        {
+            snprintf(text, sizeof(text), "%.3f s", static_cast<double>(ns) / 1e9);
+        }
+        else if (ns >= 1000000ULL)
+        {
+            snprintf(text, sizeof(text), "%.2f ms", static_cast<double>(ns) / 1e6);
+        }
+        else
+        {
+            snprintf(text, sizeof(text), "%.1f us", static_cast<double>(ns) / 1e3);
+        }
+        return text;
+    }
+
+    string formatBytes(uint64_t bytes)
+    {
+        char text[32];
+        if (bytes >= 1024ULL * 1024ULL)
+        {
+            snprintf(text, sizeof(text), "%.1f MiB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+        }
+        else
+        {
+            snprintf(text, sizeof(text), "%.1f KiB", static_cast<double>(bytes) / 1024.0);
+        }
+        return text;
+    }
+
+    double perSecond(uint64_t items, uint64_t ns)
+    {
+        return ns == 0 ? 0.0 : static_cast<double>(items) * 1e9 / static_cast<double>(ns);
+    }
+}
+
+ImportMetrics::StageTimer::StageTimer(ImportMetrics& metrics, Stage stage) : metrics(metrics), stage(stage)
+{
+    // The I/O counters don't include the read that fetched them yet. Count it here, so the
+    // difference to the final sample only covers the work in between.
+    const uint64_t sampleBytes = ImportMetrics::sampleUsage(this->startUsage);
+    if (sampleBytes > 0)
+    {
+        this->startUsage.bytesRead += sampleBytes;
+        this->startUsage.readSyscalls++;
+    }
+    this->start = Clock::now();
+}
+
+ImportMetrics::StageTimer::~StageTimer()
+{
+    StageTotals endUsage;
+    ImportMetrics::sampleUsage(endUsage);
+    const auto wall = Clock::now() - this->start;
+
+    StageCounters& counters = this->metrics.stages[static_cast<size_t>(this->stage)];
+    counters.wallNs += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(wall).count());
+    counters.items += this->items;
+    counters.cpuNs += endUsage.cpuNs - this->startUsage.cpuNs;
+    counters.bytesRead += endUsage.bytesRead - this->startUsage.bytesRead;
+    counters.readSyscalls += endUsage.readSyscalls - this->startUsage.readSyscalls;
+    counters.storageBytesRead += endUsage.storageBytesRead - this->startUsage.storageBytesRead;
+    counters.majorFaults += endUsage.majorFaults - this->startUsage.majorFaults;
+}
+
+void ImportMetrics::StageTimer::setItems(uint64_t count)
+{
+    this->items = count;
+}
+
+ImportMetrics::ImportMetrics() = default;
+
+uint64_t ImportMetrics::sampleUsage(StageTotals& usage)
+{
+
+    struct rusage resources = {};
+    if (getrusage(RUSAGE_SELF, &resources) == 0)
+    {
+        const auto toNs = [](const timeval& time)
+        {
+            return static_cast<uint64_t>(time.tv_sec) * 1000000000ULL + static_cast<uint64_t>(time.tv_usec) * 1000ULL;
+        };
+        usage.cpuNs = toNs(resources.ru_utime) + toNs(resources.ru_stime);
+        usage.majorFaults = static_cast<uint64_t>(resources.ru_majflt);
+    }
+
+    const int fd = open("/proc/self/io", O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    char data[512];
+    const ssize_t length = read(fd, data, sizeof(data) - 1);
+    close(fd);
+    if (length <= 0)
+    {
+        return 0;
+    }
+
+    data[length] = '\0';
+    usage.bytesRead = readIoField(data, "rchar:");
+    usage.readSyscalls = readIoField(data, "syscr:");
+    usage.storageBytesRead = readIoField(data, "read_bytes:");
+
+    return static_cast<uint64_t>(length);
+}
+
+void ImportMetrics::addTime(Stage stage, Clock::duration wall, uint64_t items)
+{
+    StageCounters& counters = this->stages[static_cast<size_t>(stage)];
+    counters.wallNs.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(wall).count()),
+                              std::memory_order_relaxed);
+    counters.items.fetch_add(items, std::memory_order_relaxed);
+}
+
+void ImportMetrics::addParseTime(Clock::duration time)
+{
+    const auto ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+    const uint64_t us = ns / 1000;
+
+    size_t bucket = 0;
+    if (us >= 2)
+    {
+        bucket = std::min(static_cast<size_t>(63 - __builtin_clzll(us)), HISTOGRAM_BUCKETS - 1);
+    }
+
+    this->parseHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    this->parseTotalNs.fetch_add(ns, std::memory_order_relaxed);
+    atomicMax(this->parseMaxNs, ns);
+}
+
+void ImportMetrics::add(Counter counter, uint64_t count)
+{
+    this->counters[static_cast<size_t>(counter)].fetch_add(count, std::memory_order_relaxed);
+}
+
+void ImportMetrics::reset()
+{
+    for (auto& stage : this->stages)
+    {
+        stage.wallNs = 0;
+        stage.cpuNs = 0;
+        stage.items = 0;
+        stage.bytesRead = 0;
+        stage.readSyscalls = 0;
+        stage.storageBytesRead = 0;
+        stage.majorFaults = 0;
+    }
+    for (auto& counter : this->counters)
+    {
+        counter = 0;
+    }
+    for (auto& bucket : this->parseHistogram)
+    {
+        bucket = 0;
+    }
+    this->parseTotalNs = 0;
+    this->parseMaxNs = 0;
+}
+
+ImportMetrics::StageTotals ImportMetrics::getStage(Stage stage) const
+{
+    const StageCounters& counters = this->stages[static_cast<size_t>(stage)];
+
+    StageTotals totals;
+    totals.wallNs = counters.wallNs;
+    totals.cpuNs = counters.cpuNs;
+    totals.items = counters.items;
+    totals.bytesRead = counters.bytesRead;
+    totals.readSyscalls = counters.readSyscalls;
+    totals.storageBytesRead = counters.storageBytesRead;
+    totals.majorFaults = counters.majorFaults;
+    return totals;
+}
+
+uint64_t ImportMetrics::get(Counter counter) const
+{
+    return this->counters[static_cast<size_t>(counter)];
+}
+
+vector<uint64_t> ImportMetrics::getParseHistogram() const
+{
+    vector<uint64_t> histogram;
+    histogram.reserve(HISTOGRAM_BUCKETS);
+    for (const auto& bucket : this->parseHistogram)
+    {
+        histogram.push_back(bucket);
+    }
+    return histogram;
+}
+
+uint64_t ImportMetrics::getParsePercentile(double percentile) const
+{
+    const vector<uint64_t> histogram = this->getParseHistogram();
+    uint64_t total = 0;
+    for (const auto count : histogram)
+    {
+        total += count;
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    const auto target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(static_cast<double>(total) * percentile / 100.0)));
+    const uint64_t max = this->getParseMax();
+    uint64_t seen = 0;
+    for (size_t i = 0; i + 1 < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += histogram[i];
+        if (seen >= target)
+        {
+            return std::min<uint64_t>(max, (2ULL << i) * 1000ULL);
+        }
+    }
+    return max;
+}
+
+uint64_t ImportMetrics::getParseMax() const
+{
+    return this->parseMaxNs;
+}
+
+string ImportMetrics::getStageName(Stage stage)
+{
+    return STAGE_NAMES[static_cast<size_t>(stage)];
+}
+
+void ImportMetrics::print(std::ostream& out) const
+{
+    char line[160];
+    snprintf(line, sizeof(line), "%-18s %12s %12s %10s %12s %12s %10s\n",
+             "Stage", "Wall", "CPU", "Items", "Items/s", "Read", "Syscalls");
+    out << line;
+
+    for (size_t i = 0; i < STAGE_COUNT; i++)
+    {
+        const auto stage = static_cast<Stage>(i);
+        const StageTotals totals = this->getStage(stage);
+        if (totals.wallNs == 0 && totals.items == 0)
+        {
+            continue;
+        }
+
+        // Per-file stages are part of the search, so they're indented below it.
+        const bool sequential = isSequential(stage);
+        const string name = sequential ? getStageName(stage) : "  " + getStageName(stage);
+        snprintf(line, sizeof(line), "%-18s %12s %12s %10llu %12.1f %12s %10s\n",
+                 name.c_str(), formatDuration(totals.wallNs).c_str(),
+                 sequential ? formatDuration(totals.cpuNs).c_str() : "-",
+                 static_cast<unsigned long long>(totals.items), perSecond(totals.items, totals.wallNs),
+                 sequential ? formatBytes(totals.bytesRead).c_str() : "-",
+                 sequential ? std::to_string(totals.readSyscalls).c_str() : "-");
+        out << line;
+    }
+    out << "Times of the indented stages are summed across import threads.\n";
+
+    out << "Files: " << this->get(Counter::discovered) << " discovered, " << this->get(Counter::imported)
+        << " imported, " << this->get(Counter::cacheHits) << " from the cache.\n";
+    out << "Failures: " << this->get(Counter::openFailures) << " could not be opened, "
+        << this->get(Counter::unsupportedFiles) << " unsupported, " << this->get(Counter::parseFailures)
+        << " failed to parse.\n";
+
+    if (this->getParseMax() > 0)
+    {
+        out << "Read time per file: p50 " << formatDuration(this->getParsePercentile(50))
+            << ", p90 " << formatDuration(this->getParsePercentile(90))
+            << ", p99 " << formatDuration(this->getParsePercentile(99))
+            << ", max " << formatDuration(this->getParseMax()) << ".\n";
+    }
+}
+
+Json::Value ImportMetrics::toJSON() const
+{
+    Json::Value root;
+
+    Json::Value& stagesValue = root["stages"];
+    stagesValue = Json::Value(Json::objectValue);
+    for (size_t i = 0; i < STAGE_COUNT; i++)
+    {
+        const auto stage = static_cast<Stage>(i);
+        const StageTotals totals = this->getStage(stage);
+        if (totals.wallNs == 0 && totals.items == 0)
+        {
+            continue;
+        }
+
+        Json::Value& stageValue = stagesValue[getStageName(stage)];
+        stageValue["wall_ns"] = Json::UInt64(totals.wallNs);
+        stageValue["items"] = Json::UInt64(totals.items);
+        stageValue["items_per_second"] = perSecond(totals.items, totals.wallNs);
+        if (isSequential(stage))
+        {
+            stageValue["cpu_ns"] = Json::UInt64(totals.cpuNs);
+            stageValue["bytes_read"] = Json::UInt64(totals.bytesRead);
+            stageValue["read_syscalls"] = Json::UInt64(totals.readSyscalls);
+            stageValue["storage_bytes_read"] = Json::UInt64(totals.storageBytesRead);
+            stageValue["major_faults"] = Json::UInt64(totals.majorFaults);
+        }
+    }
+
+    Json::Value& countersValue = root["counters"];
+    countersValue["discovered"] = Json::UInt64(this->get(Counter::discovered));
+    countersValue["imported"] = Json::UInt64(this->get(Counter::imported));
+    countersValue["cache_hits"] = Json::UInt64(this->get(Counter::cacheHits));
+    countersValue["open_failures"] = Json::UInt64(this->get(Counter::openFailures));
+    countersValue["unsupported_files"] = Json::UInt64(this->get(Counter::unsupportedFiles));
+    countersValue["parse_failures"] = Json::UInt64(this->get(Counter::parseFailures));
+
+    Json::Value& readTime = root["read_time"];
+    uint64_t files = 0;
+    Json::Value& buckets = readTime["buckets"];
+    buckets = Json::Value(Json::arrayValue);
+    for (const auto count : this->getParseHistogram())
+    {
+        buckets.append(Json::UInt64(count));
+        files += count;
+    }
+    readTime["mean_ns"] = Json::UInt64(files == 0 ? 0 : this->parseTotalNs.load() / files);
+    readTime["max_ns"] = Json::UInt64(this->getParseMax());
+    readTime["p50_ns"] = Json::UInt64(this->getParsePercentile(50));
+    readTime["p90_ns"] = Json::UInt64(this->getParsePercentile(90));
+    readTime["p99_ns"] = Json::UInt64(this->getParsePercentile(99));
+
+    return root;
+}
@@ -0,0 +1,242 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_IMPORTMETRICS_HPP
+#define MUSICLIST_IMPORTMETRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <json/value.h>
+
+using std::string;
+using std::vector;
+
+namespace MusicList
+{
+    /**
+     * @brief Timing and counters collected while importing and exporting a library.
+     *
+     * Sequential stages, like a whole search or an export, record their wall time along with
+     * the CPU time, bytes read and read syscalls of the whole process while they ran. Stages
+     * that run once per file record only their wall time, summed across import threads, since
+     * reading a thread's CPU clock costs a syscall per file. Reads submitted through io_uring
+     * don't show up in the kernel's read counters, so batch reads report almost no I/O.
+     *
+     * Recording is a few relaxed atomic adds per file, so it's always enabled. All methods are
+     * safe to call from multiple threads.
+     */
+    class ImportMetrics
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        enum class Stage : uint_fast8_t
+        {
+            search = 0,    // Whole Importer::runTrackSearch() call.
+            discovery,     // Walking the directory tree.
+            cacheLookup,   // Checking files against the metadata cache.
+            detection,     // Opening files, reading their first bytes and identifying the format.
+            parsing,       // Reading tags.
+            grouping,      // Importer::generateAlbumsFromTracks().
+            jsonExport,    // Importer::writeJSON().
+            catalogExport  // Importer::writeCatalog().
+        };
+        static constexpr size_t STAGE_COUNT = 8;
+
+        enum class Counter : uint_fast8_t
+        {
+            discovered = 0,
+            imported,
+            cacheHits,
+            openFailures,
+            unsupportedFiles,
+            parseFailures
+        };
+        static constexpr size_t COUNTER_COUNT = 6;
+
+        // Bucket 0 counts files read in under 2us, bucket i those read in [2^i, 2^(i+1)) us,
+        // and the last bucket everything slower.
+        static constexpr size_t HISTOGRAM_BUCKETS = 24;
+
+        struct StageTotals
+        {
+            uint64_t wallNs = 0;
+            uint64_t cpuNs = 0;
+            uint64_t items = 0;
+            uint64_t bytesRead = 0;
+            uint64_t readSyscalls = 0;
+            uint64_t storageBytesRead = 0;
+            uint64_t majorFaults = 0;
+        };
+
+        /**
+         * @brief Records a sequential stage, including the resources the process used, from
+         * construction until destruction.
+         */
+        class StageTimer
+        {
+        private:
+            ImportMetrics& metrics;
+            Stage stage;
+            Clock::time_point start;
+            StageTotals startUsage;
+            uint64_t items = 0;
+        public:
+            StageTimer(ImportMetrics& metrics, Stage stage);
+
+            StageTimer(const StageTimer&) = delete;
+            StageTimer& operator=(const StageTimer&) = delete;
+
+            ~StageTimer();
+
+            /**
+             * @param count number of items handled by the stage
+             */
+            void setItems(uint64_t count);
+        };
+    private:
+        struct StageCounters
+        {
+            std::atomic<uint64_t> wallNs = 0;
+            std::atomic<uint64_t> cpuNs = 0;
+            std::atomic<uint64_t> items = 0;
+            std::atomic<uint64_t> bytesRead = 0;
+            std::atomic<uint64_t> readSyscalls = 0;
+            std::atomic<uint64_t> storageBytesRead = 0;
+            std::atomic<uint64_t> majorFaults = 0;
+        };
+
+        std::array<StageCounters, STAGE_COUNT> stages;
+        std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters = {};
+        std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> parseHistogram = {};
+        std::atomic<uint64_t> parseTotalNs = 0;
+        std::atomic<uint64_t> parseMaxNs = 0;
+
+        /**
+         * @brief Reads the CPU time, I/O and page faults of the process so far.
+         *
+         * Bytes read and read syscalls come from /proc/self/io and stay 0 where it's missing.
+         *
+         * @param usage destination for the totals. The wall time and item count are left alone.
+         *
+         * @returns number of bytes read from /proc/self/io, or 0 if it couldn't be read.
+         */
+        static uint64_t sampleUsage(StageTotals& usage);
+    public:
+        ImportMetrics();
+
+        ImportMetrics(const ImportMetrics&) = delete;
+        ImportMetrics& operator=(const ImportMetrics&) = delete;
+
+        /**
+         * @brief Adds time spent in a stage without sampling process resources.
+         *
+         * @param stage stage the time was spent in
+         * @param wall time spent
+         * @param items number of items handled
+         */
+        void addTime(Stage stage, Clock::duration wall, uint64_t items);
+
+        /**
+         * @brief Records how long it took to read a single file, from opening it to having its tags.
+         *
+         * @param time time taken to read the file
+         */
+        void addParseTime(Clock::duration time);
+
+        /**
+         * @param counter counter to increase
+         * @param count amount to add
+         */
+        void add(Counter counter, uint64_t count = 1);
+
+        /**
+         * @brief Clears every stage, counter and histogram.
+         */
+        void reset();
+
+        /**
+         * @returns totals recorded for a stage.
+         */
+        StageTotals getStage(Stage stage) const;
+
+        /**
+         * @returns current value of a counter.
+         */
+        uint64_t get(Counter counter) const;
+
+        /**
+         * @returns number of files in each per-file read time bucket.
+         */
+        vector<uint64_t> getParseHistogram() const;
+
+        /**
+         * @brief Estimates a percentile of the per-file read time from the histogram.
+         *
+         * @param percentile value between 0 and 100
+         *
+         * @returns upper bound of the bucket holding the percentile in nanoseconds, or 0 if no
+         * files were read.
+         */
+        uint64_t getParsePercentile(double percentile) const;
+
+        /**
+         * @returns slowest per-file read time in nanoseconds.
+         */
+        uint64_t getParseMax() const;
+
+        /**
+         * @returns name of a stage as used in reports.
+         */
+        static string getStageName(Stage stage);
+
+        /**
+         * @brief Writes a human-readable table of the stages and counters.
+         *
+         * @param out destination stream
+         */
+        void print(std::ostream& out) const;
+
+        /**
+         * @returns Json::Value holding every stage that ran, the counters and the read time histogram.
+         */
+        Json::Value toJSON() const;
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_IMPORTMETRICS_HPP
@@ -31,104 +31,658 @@
   
 */
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
 #include "Importer.hpp"
+#include "BatchReader.hpp"
+#include "Catalog.hpp"
+#include "JsonWriter.hpp"
+#include "Mbid.hpp"
+#include "WorkerPool.hpp"
 
 using namespace MusicList;
 
+// Serializes console output from import threads.
+static std::mutex outputLock;
+
+// Number of discovered files allowed to wait for each import thread.
+static const uint32_t QUEUE_DEPTH_PER_THREAD = 64;
+
+// Threads reading directories during a multi-threaded search. Reading is I/O bound, so this
+// doesn't follow the number of import threads.
+static const uint32_t WALK_THREADS = 8;
+
 Importer::Importer() = default;
 
+Importer::Importer(const uint32_t& threadCount)
+{
+    this->setThreadCount(threadCount);
+}
+
+void Importer::setThreadCount(const uint32_t& count)
+{
+    this->threadCount = count;
+}
+
+void Importer::setCachePath(const fs::path& path)
+{
+    this->cachePath = path;
+    this->cache = std::make_unique<MetadataCache>(path);
+
+    this->snapshotPath = path;
+    this->snapshotPath += ".dirs";
+    this->snapshot->load(this->snapshotPath);
+}
+
+void Importer::setReadOptions(const ReadOptions& options)
+{
+    this->readOptions = options;
+}
+
+void Importer::setBatchReads(bool enabled)
+{
+    this->batchReads = enabled;
+}
+
+void Importer::setProgressCallback(ProgressCallback callback)
+{
+    this->progressCallback = std::move(callback);
+}
+
+void Importer::setQuiet(bool enabled)
+{
+    this->quiet = enabled;
+}
+
+void Importer::printStatus(const string& message) const
+{
+    if (!this->quiet)
+    {
+        std::cout << message << std::endl;
+    }
+}
+
+shared_ptr<Track> Importer::createTrack(const shared_ptr<ImportArena>& arena)
+{
+    if (arena == nullptr)
+    {
+        return std::make_shared<Track>();
+    }
+    return std::allocate_shared<Track>(ArenaAllocator<Track>(arena), arena.get());
+}
+
+shared_ptr<Track> Importer::importTrack(const fs::path& trackPath, MetadataCache* cache,
+                                        const ReadOptions& options, const shared_ptr<ImportArena>& arena,
+                                        ImportMetrics& metrics)
+{
+    std::optional<FileStamp> stamp;
+    shared_ptr<Track> trackPtr = Importer::restoreTrack(trackPath, cache, options, arena, metrics, stamp);
+    if (trackPtr != nullptr)
+    {
+        return trackPtr;
+    }
+
+    return Importer::readTrack(trackPath, nullptr, cache, stamp, options, arena, metrics);
+}
+
+shared_ptr<Track> Importer::restoreTrack(const fs::path& trackPath, MetadataCache* cache,
+                                         const ReadOptions& options, const shared_ptr<ImportArena>& arena,
+                                         ImportMetrics& metrics, std::optional<FileStamp>& stamp)
+{
+    if (cache == nullptr)
+    {
+        return nullptr;
+    }
+
+    const auto start = ImportMetrics::Clock::now();
+    FileStamp fileStamp;
+    if (!MetadataCache::readStamp(trackPath, fileStamp))
+    {
+        return nullptr;
+    }
+    stamp = fileStamp;
+
+    // Misses are checked for first, so no Track is left behind in the arena for them.
+    shared_ptr<Track> trackPtr;
+    if (cache->contains(trackPath, fileStamp, options))
+    {
+        trackPtr = Importer::createTrack(arena);
+        trackPtr->setReadOptions(options);
+        if (!cache->restore(*trackPtr, trackPath, fileStamp))
+        {
+            trackPtr = nullptr;
+        }
+    }
+
+    metrics.addTime(ImportMetrics::Stage::cacheLookup, ImportMetrics::Clock::now() - start, 1);
+    if (trackPtr != nullptr)
+    {
+        metrics.add(ImportMetrics::Counter::cacheHits);
+    }
+
+    return trackPtr;
+}
+
+shared_ptr<Track> Importer::readTrack(const fs::path& trackPath, shared_ptr<FileReader> reader,
+                                      MetadataCache* cache, const std::optional<FileStamp>& stamp,
+                                      const ReadOptions& options, const shared_ptr<ImportArena>& arena,
+                                      ImportMetrics& metrics)
+{
+    shared_ptr<Track> trackPtr = Importer::createTrack(arena);
+    trackPtr->setReadOptions(options);
+
+    auto reportFailure = [&metrics](const std::exception& e, ImportMetrics::Counter counter)
+    {
+        metrics.add(counter);
+        std::lock_guard<std::mutex> guard(outputLock);
+        std::cerr << e.what() << '\n';
+    };
+
+    const auto start = ImportMetrics::Clock::now();
+    try
+    {
+        trackPtr->setPath(trackPath, std::move(reader));
+    }
+    catch(const std::exception& e)
+    {
+        reportFailure(e, ImportMetrics::Counter::openFailures);
+        return nullptr;
+    }
+
+    const auto detected = ImportMetrics::Clock::now();
+    try
+    {
+        trackPtr->readMetadata();
+    }
+    catch(const unsupported_format_error& e)
+    {
+        reportFailure(e, ImportMetrics::Counter::unsupportedFiles);
+        return nullptr;
+    }
+    catch(const std::exception& e)
+    {
+        reportFailure(e, ImportMetrics::Counter::parseFailures);
+        return nullptr;
+    }
+
+    const auto parsed = ImportMetrics::Clock::now();
+    metrics.addTime(ImportMetrics::Stage::detection, detected - start, 1);
+    metrics.addTime(ImportMetrics::Stage::parsing, parsed - detected, 1);
+    metrics.addParseTime(parsed - start);
+
+    if (cache != nullptr && stamp.has_value())
+    {
+        cache->store(*trackPtr, *stamp);
+    }
+
+    return trackPtr;
+}
+
+bool Importer::isSupportedFile(const fs::directory_entry& entry)
+{
+    return entry.is_regular_file() && Track::isSupportedName(entry.path().filename().native());
+}
+
 void Importer::runTrackSearch(const fs::path& path, const uint32_t& limit)
 {
-    vector<fs::path> trackPaths;
-    for (const auto& item : fs::recursive_directory_iterator(path))
+    ImportMetrics& metrics = *this->metrics;
+    ImportMetrics::StageTimer searchTimer = ImportMetrics::StageTimer(metrics, ImportMetrics::Stage::search);
+
+    this->printStatus("Processing files in " + path.string() + "...");
+
+    if (limit > 0)
     {
-        if (fs::is_regular_file(item))
+        this->printStatus("Limiting import to " + std::to_string(limit) + " files.");
+    }
+
+    // Tracks are tagged with their discovery index so the final order doesn't depend on which
+    // thread finishes first.
+    vector<std::pair<uint32_t, shared_ptr<Track>>> results;
+    std::mutex resultsLock;
+    uint32_t discovered = 0;
+
+    // Import threads only bump its counters. Output happens on the reporter's own thread.
+    auto progress = std::make_unique<ProgressReporter>(this->progressCallback);
+
+    MetadataCache* trackCache = this->cache.get();
+    const ReadOptions& options = this->readOptions;
+    const shared_ptr<ImportArena>& arena = this->arena;
+    ProgressReporter* reporter = progress.get();
+    auto addResult = [&results, &resultsLock, reporter](uint32_t index, shared_ptr<Track> trackPtr)
+    {
+        if (trackPtr == nullptr)
+        {
+            reporter->addFailed();
+            return;
+        }
+
         {
-            const string fileExt = item.path().extension().string();
-            for (const auto & i : SUPPORTED_EXTS)
+            std::lock_guard<std::mutex> guard(resultsLock);
+            results.emplace_back(index, std::move(trackPtr));
+        }
+        reporter->addImported();
+    };
+
+    // Files are parsed while the walk is still running. The pool's backlog is bounded so the
+    // walker can't race ahead and hold the whole tree's paths in memory.
+    unique_ptr<WorkerPool> pool;
+    if (this->threadCount != 1)
+    {
+        const uint32_t workerCount = this->threadCount == 0 ?
+            std::max(1U, std::thread::hardware_concurrency()) : this->threadCount;
+        pool = std::make_unique<WorkerPool>(workerCount, workerCount * QUEUE_DEPTH_PER_THREAD);
+    }
+
+    auto dispatch = [&pool](std::function<void()> task)
+    {
+        if (pool == nullptr)
+        {
+            task();
+        }
+        else
+        {
+            pool->submit(std::move(task));
+        }
+    };
+
+    // In batch mode discovered files are held back until a full batch can be opened and read
+    // at once. Cache hits are resolved first so unchanged files are never opened.
+    struct PendingTrack
+    {
+        uint32_t index;
+        fs::path path;
+        std::optional<FileStamp> stamp;
+    };
+
+    unique_ptr<BatchReader> batchReader;
+    if (this->batchReads && options.readMode != ReadMode::mapped)
+    {
+        batchReader = std::make_unique<BatchReader>();
+    }
+
+    vector<PendingTrack> pending;
+    auto flushBatch = [&pending, &batchReader, &addResult, &dispatch, trackCache, &options, &arena, &metrics]()
+    {
+        vector<PendingTrack> toRead;
+        vector<fs::path> paths;
+        for (auto& item : pending)
+        {
+            shared_ptr<Track> restored = Importer::restoreTrack(item.path, trackCache, options, arena, metrics, item.stamp);
+            if (restored != nullptr)
+            {
+                addResult(item.index, std::move(restored));
+            }
+            else if (Track::isInspectable(item.path))
             {
-                if (fileExt == i)
+                paths.push_back(item.path);
+                toRead.push_back(std::move(item));
+            }
+            else
+            {
+                dispatch([&addResult, trackCache, &options, &arena, &metrics, item = std::move(item)]
                 {
-                    trackPaths.push_back(item.path());
-                }
+                    addResult(item.index, Importer::readTrack(item.path, nullptr, trackCache, item.stamp, options,
+                                                              arena, metrics));
+                });
+            }
+        }
+        pending.clear();
+
+        // Opening and reading the batch counts towards detection. The per-file time that
+        // follows only covers identifying the already loaded files.
+        const auto readStart = ImportMetrics::Clock::now();
+        vector<shared_ptr<FileReader>> readers = batchReader->read(paths);
+        metrics.addTime(ImportMetrics::Stage::detection, ImportMetrics::Clock::now() - readStart, 0);
+
+        for (size_t i = 0; i < toRead.size(); i++)
+        {
+            dispatch([&addResult, trackCache, &options, &arena, &metrics, item = std::move(toRead[i]),
+                      reader = std::move(readers[i])]
+            {
+                addResult(item.index, Importer::readTrack(item.path, reader, trackCache, item.stamp, options,
+                                                          arena, metrics));
+            });
+        }
+    };
+
+    // Time spent handing files over to be read, which is taken out of the discovery time.
+    ImportMetrics::Clock::duration visitTime = ImportMetrics::Clock::duration::zero();
+    auto visitFile = [&](const fs::path& trackPath)
+    {
+        if (limit > 0 && discovered >= limit)
+        {
+            return false;
+        }
+
+        const auto visitStart = ImportMetrics::Clock::now();
+        const uint32_t index = discovered++;
+        reporter->addDiscovered();
+        if (batchReader != nullptr)
+        {
+            pending.push_back({index, trackPath, std::nullopt});
+            if (pending.size() >= BatchReader::BATCH_SIZE)
+            {
+                flushBatch();
             }
         }
+        else
+        {
+            dispatch([&addResult, trackCache, &options, &arena, &metrics, index, trackPath]
+            {
+                addResult(index, Importer::importTrack(trackPath, trackCache, options, arena, metrics));
+            });
+        }
+
+        visitTime += ImportMetrics::Clock::now() - visitStart;
+        return true;
+    };
+
+    // Unchanged directories are listed from the snapshot instead of being read again. The
+    // others are read ahead of the walk on the I/O threads.
+    const uint32_t walkThreads = this->threadCount == 1 ? 1 : WALK_THREADS;
+    const auto walkStart = ImportMetrics::Clock::now();
+    this->snapshot->walk(path, Track::isSupportedName, visitFile, walkThreads);
+    metrics.addTime(ImportMetrics::Stage::discovery, ImportMetrics::Clock::now() - walkStart - visitTime, discovered);
+
+    if (!pending.empty())
+    {
+        flushBatch();
     }
 
-    uint32_t totalTracks = trackPaths.size();
-    this->tracks.reserve(totalTracks);
+    if (pool != nullptr)
+    {
+        pool->wait();
+    }
+    // Delivers the final count before any other output.
+    progress.reset();
 
-    std::cout << "Discovered " << std::to_string(totalTracks) << " audio files in " << path.string() << ".\n";
-    std::cout << "Processing files...\n";
+    std::sort(results.begin(), results.end(), [](const auto& lhs, const auto& rhs)
+    {
+        return lhs.first < rhs.first;
+    });
 
-    bool useLimit = false;
+    metrics.add(ImportMetrics::Counter::discovered, discovered);
+    metrics.add(ImportMetrics::Counter::imported, results.size());
+    searchTimer.setItems(results.size());
 
-    if (limit > 0)
+    this->tracks.reserve(this->tracks.size() + results.size());
+    for (auto& result : results)
     {
-        std::cout << "Limiting import to " << std::to_string(limit) << " files.";
-        useLimit = true;
+        this->tracks.push_back(std::move(result.second));
     }
 
-    uint32_t processed = 0;
-    for (; processed < totalTracks; processed++)
+    this->printStatus("Discovered " + std::to_string(discovered) + " audio files in " + path.string() + ".");
+    if (!this->snapshotPath.empty())
     {
-        if (useLimit && processed >= limit)
+        const uint32_t reused = this->snapshot->getReusedCount();
+        this->printStatus("Reused " + std::to_string(reused) + " of " +
+                          std::to_string(reused + this->snapshot->getReadCount()) + " directory listings.");
+    }
+
+    if (this->cache != nullptr && limit == 0)
+    {
+        // Entries that weren't seen during a full search belong to deleted or moved files.
+        this->cache->prune();
+    }
+    this->saveCache();
+}
+
+bool Importer::updateTracks(const vector<fs::path>& modified, const vector<fs::path>& removed)
+{
+    StringPool& pool = StringPool::global();
+
+    if (this->trackAlbums.empty())
+    {
+        // Built here rather than while grouping, so imports that are never updated don't pay for it.
+        for (const auto& albumPair : this->albums)
         {
-            break;
+            for (const auto& trackPair : albumPair.second->getTrackSet())
+            {
+                this->trackAlbums.emplace(trackPair.second->getPath().string(), trackPair.second->getAlbumMBIDId());
+            }
         }
+    }
 
-        const fs::path& trackPath = trackPaths[processed];
+    // Modified files are dropped along with the removed ones and read again below.
+    std::set<StringPool::Id> affected;
+    std::set<string> stale;
+    auto dropStale = [this, &affected, &stale](map<string,StringPool::Id>::iterator it)
+    {
+        affected.insert(it->second);
+        stale.insert(it->first);
+        return this->trackAlbums.erase(it);
+    };
 
-        shared_ptr<Track> trackPtr = std::make_shared<Track>(Track());
+    for (const auto* paths : {&removed, &modified})
+    {
+        for (const auto& path : *paths)
+        {
+            const string key = path.string();
+            auto found = this->trackAlbums.find(key);
+            if (found != this->trackAlbums.end())
+            {
+                dropStale(found);
+            }
+
+            // Removed paths may be whole directories, whose tracks sort right after their prefix.
+            const string prefix = key + static_cast<char>(fs::path::preferred_separator);
+            for (auto it = this->trackAlbums.lower_bound(prefix);
+                 it != this->trackAlbums.end() && it->first.compare(0, prefix.size(), prefix) == 0;)
+            {
+                it = dropStale(it);
+            }
+        }
+    }
 
-        try
+    if (this->cache != nullptr)
+    {
+        for (const auto& path : removed)
+        {
+            this->cache->remove(path);
+        }
+        for (const auto& path : stale)
         {
-            trackPtr->setPath(trackPath);
+            this->cache->remove(path);
         }
-        catch(const std::exception& e)
+    }
+
+    size_t read = 0;
+    for (const auto& path : modified)
+    {
+        std::error_code error;
+        const fs::directory_entry entry = fs::directory_entry(path, error);
+        if (error || !Importer::isSupportedFile(entry))
         {
-            std::cerr << e.what() << '\n';
             continue;
         }
 
-        try
+        // Read on the heap. The arena never gets memory back, and a watch can replace tracks forever.
+        shared_ptr<Track> trackPtr = Importer::importTrack(path, this->cache.get(), this->readOptions, nullptr,
+                                                           *this->metrics);
+        if (trackPtr != nullptr)
         {
-            trackPtr->readMetadata();
+            affected.insert(trackPtr->getAlbumMBIDId());
+            this->trackAlbums[trackPtr->getPath().string()] = trackPtr->getAlbumMBIDId();
+            this->tracks.push_back(std::move(trackPtr));
+            read++;
         }
-        catch(const std::exception& e)
+    }
+
+    this->metrics->add(ImportMetrics::Counter::imported, read);
+
+    // Affected albums are rebuilt so their details are taken from the tracks they hold now.
+    size_t dropped = 0;
+    for (const auto& albumId : affected)
+    {
+        auto found = this->albums.find(pool.get(albumId));
+        if (found == this->albums.end())
         {
-            std::cerr << e.what() << '\n';
             continue;
         }
-        
-        this->tracks.push_back(trackPtr);
-        std::cout << "\33[2K\rImported " << std::to_string(this->tracks.size()) << " of " << std::to_string(totalTracks) << std::flush;
+
+        for (const auto& trackPair : found->second->getTrackSet())
+        {
+            if (stale.count(trackPair.second->getPath().string()) > 0)
+            {
+                dropped++;
+            }
+            else
+            {
+                this->tracks.push_back(trackPair.second);
+            }
+        }
+        this->albums.erase(found);
+    }
+
+    if (read == 0 && dropped == 0)
+    {
+        // Nothing that belongs to the library, like the export being rewritten.
+        return false;
+    }
+
+    this->printStatus("Read " + std::to_string(read) + " changed files and dropped " + std::to_string(dropped) +
+                      " tracks.");
+
+    if (!this->tracks.empty())
+    {
+        // Grouping takes each album's details from the last of its tracks, so the same track
+        // supplies them however the changes arrived.
+        std::sort(this->tracks.begin(), this->tracks.end(), [](const auto& lhs, const auto& rhs)
+        {
+            return lhs->getPath() < rhs->getPath();
+        });
+        this->groupTracks(nullptr);
+    }
+    this->saveCache();
+
+    return true;
+}
+
+void Importer::saveCache() const
+{
+    if (this->cache == nullptr)
+    {
+        return;
+    }
+
+    try
+    {
+        this->cache->save(this->cachePath);
+        this->snapshot->save(this->snapshotPath);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
     }
-    std::cout << std::endl;
 }
 
 void Importer::generateAlbumsFromTracks()
 {
-    while (!this->tracks.empty())
+    this->groupTracks(this->arena);
+    // Rebuilt by the next update to cover the new albums.
+    this->trackAlbums.clear();
+}
+
+void Importer::groupTracks(const shared_ptr<ImportArena>& arena)
+{
+    ImportMetrics::StageTimer timer = ImportMetrics::StageTimer(*this->metrics, ImportMetrics::Stage::grouping);
+    timer.setItems(this->tracks.size());
+
+    StringPool& pool = StringPool::global();
+
+    // Group tracks by the binary form of their album MBID. IDs that aren't UUIDs, including
+    // missing ones, are hashed by their pooled text instead. Keys still compare by the exact
+    // text, so IDs that only differ in letter case stay separate albums.
+    struct AlbumKey
     {
-        const auto& track = this->tracks.back();
+        Mbid mbid;
+        StringPool::Id text = StringPool::EMPTY;
+        bool binary = false;
 
-        auto trackTags = track->getTags();
-        const auto& albumID = trackTags["MUSICBRAINZ_ALBUMID"];
-        shared_ptr<Album> albumPtr = this->albums[albumID];
+        bool operator== (const AlbumKey& other) const
+        {
+            return this->text == other.text;
+        }
+    };
 
-        if (albumPtr == nullptr)
+    struct AlbumKeyHash
+    {
+        size_t operator()(const AlbumKey& key) const
+        {
+            return key.binary ? MbidHash()(key.mbid) : static_cast<size_t>(key.text);
+        }
+    };
+
+    const size_t trackCount = this->tracks.size();
+    std::unordered_map<AlbumKey, uint32_t, AlbumKeyHash> groupIndices;
+    vector<StringPool::Id> groupIds;
+    vector<uint32_t> trackGroups(trackCount);
+    vector<uint32_t> groupOffsets;
+
+    for (size_t i = 0; i < trackCount; i++)
+    {
+        AlbumKey key;
+        key.text = this->tracks[i]->getAlbumMBIDId();
+        key.binary = Mbid::parse(pool.get(key.text), key.mbid);
+
+        auto inserted = groupIndices.try_emplace(key, static_cast<uint32_t>(groupIds.size()));
+        if (inserted.second)
         {
-            albumPtr = std::make_shared<Album>(Album());
+            groupIds.push_back(key.text);
+            groupOffsets.push_back(0);
         }
-        
-        albumPtr->addTrack(track);
-        this->albums[albumID] = albumPtr;
 
-        this->tracks.pop_back();
-        std::cout << "\33[2K\rGenerated " << std::to_string(this->albums.size()) << " albums." << std::flush;
+        trackGroups[i] = inserted.first->second;
+        groupOffsets[trackGroups[i]]++;
+    }
+
+    // Counting sort into contiguous per-album ranges. Tracks are placed back to front, which is
+    // the order albums have always been built in, so the same track supplies each album's details.
+    uint32_t offset = 0;
+    for (auto& groupOffset : groupOffsets)
+    {
+        const uint32_t size = groupOffset;
+        groupOffset = offset;
+        offset += size;
+    }
+    groupOffsets.push_back(offset);
+
+    vector<shared_ptr<Track>> grouped(trackCount);
+    vector<uint32_t> cursors(groupOffsets.begin(), groupOffsets.end() - 1);
+    for (size_t i = trackCount; i-- > 0;)
+    {
+        grouped[cursors[trackGroups[i]]++] = std::move(this->tracks[i]);
     }
-    std::cout << std::endl;
+    this->tracks.clear();
+
+    for (size_t group = 0; group < groupIds.size(); group++)
+    {
+        const auto first = grouped.cbegin() + groupOffsets[group];
+        const auto last = grouped.cbegin() + groupOffsets[group + 1];
+
+        shared_ptr<Album>& albumPtr = this->albums[pool.get(groupIds[group])];
+        if (albumPtr == nullptr)
+        {
+            albumPtr = arena != nullptr ? std::allocate_shared<Album>(ArenaAllocator<Album>(arena), first, last) :
+                std::make_shared<Album>(first, last);
+        }
+        else
+        {
+            // Albums left over from an earlier search are extended instead.
+            for (auto it = first; it != last; ++it)
+            {
+                albumPtr->addTrack(*it);
+            }
+        }
+    }
+
+    this->printStatus("Generated " + std::to_string(this->albums.size()) + " albums.");
 }
 
 Json::Value Importer::toJSON() const
@@ -145,6 +699,38 @@ Json::Value Importer::toJSON() const
     return root;
 }
 
+void Importer::writeJSON(const fs::path& path) const
+{
+    ImportMetrics::StageTimer timer = ImportMetrics::StageTimer(*this->metrics, ImportMetrics::Stage::jsonExport);
+    timer.setItems(this->albums.size());
+
+    JsonWriter writer = JsonWriter(path);
+
+    if (this->albums.empty())
+    {
+        writer.writeNull();
+    }
+    else
+    {
+        writer.beginArray();
+        for (const auto& albumPair : this->albums)
+        {
+            albumPair.second->writeJSON(writer);
+        }
+        writer.endArray();
+    }
+
+    writer.close();
+}
+
+void Importer::writeCatalog(const fs::path& path) const
+{
+    ImportMetrics::StageTimer timer = ImportMetrics::StageTimer(*this->metrics, ImportMetrics::Stage::catalogExport);
+    timer.setItems(this->albums.size());
+
+    Catalog::write(path, this->albums);
+}
+
 const vector<shared_ptr<Track>>& Importer::getTracks() const
 {
     return this->tracks;
@@ -154,3 +740,8 @@ const map<string,shared_ptr<Album>>& Importer::getAlbums() const
 {
     return this->albums;
 }
+
+const ImportMetrics& Importer::getMetrics() const
+{
+    return *this->metrics;
+}
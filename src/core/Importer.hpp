@@ -37,6 +37,7 @@
 #include <iostream>
 #include <cinttypes>
 #include <memory>
+#include <optional>
 #include <vector>
 #include <map>
 
@@ -45,6 +46,11 @@
 
 #include "Track.hpp"
 #include "Album.hpp"
+#include "MetadataCache.hpp"
+#include "DirectorySnapshot.hpp"
+#include "ImportArena.hpp"
+#include "ImportMetrics.hpp"
+#include "ProgressReporter.hpp"
 
 using std::map;
 using std::vector;
@@ -58,18 +64,218 @@ namespace MusicList
     class Importer
     {
     private:
+        // Holds every Track and Album created by this Importer. Each of them keeps a reference to
+        // it, so the arena lives on for as long as any of them is still held.
+        shared_ptr<ImportArena> arena = std::make_shared<ImportArena>();
+
         map<string,shared_ptr<Album>> albums;
+        // Album MBID of each grouped track, by path, so updates only touch the albums holding
+        // changed files. Built by the first update after the albums are generated.
+        map<string,StringPool::Id> trackAlbums;
         vector<shared_ptr<Track>> tracks;
+        uint32_t threadCount = 1;
+        bool batchReads = false;
+        ReadOptions readOptions;
+        unique_ptr<MetadataCache> cache;
+        fs::path cachePath;
+        unique_ptr<DirectorySnapshot> snapshot = std::make_unique<DirectorySnapshot>();
+        fs::path snapshotPath;
+        // Held by pointer so the Importer stays movable and const exports can still record their timing.
+        unique_ptr<ImportMetrics> metrics = std::make_unique<ImportMetrics>();
+        ProgressCallback progressCallback = ProgressReporter::consoleCallback(std::cout);
+        bool quiet = false;
+
+        /**
+         * @brief Creates an empty Track in the provided arena.
+         *
+         * @param arena arena the Track and its tags are allocated from. If nullptr, they're
+         * allocated on the heap.
+         *
+         * @returns the new Track. It keeps the arena alive.
+         */
+        static shared_ptr<Track> createTrack(const shared_ptr<ImportArena>& arena);
+
+        /**
+         * @brief Creates a Track for the provided path and reads its metadata.
+         *
+         * Errors are reported to stderr.
+         *
+         * @param trackPath path to the audio file to import
+         * @param cache metadata cache to consult and update. May be nullptr.
+         * @param options options used to read the file
+         * @param arena arena the Track is allocated from
+         * @param metrics metrics to record the time spent in each stage in
+         *
+         * @returns the imported Track, or nullptr if the file could not be imported.
+         */
+        static shared_ptr<Track> importTrack(const fs::path& trackPath, MetadataCache* cache,
+                                             const ReadOptions& options, const shared_ptr<ImportArena>& arena,
+                                             ImportMetrics& metrics);
+
+        /**
+         * @brief Looks up a file in the metadata cache.
+         *
+         * @param trackPath path to the audio file to import
+         * @param cache metadata cache to consult. May be nullptr.
+         * @param options options used to read the file
+         * @param arena arena the Track is allocated from
+         * @param metrics metrics to record the lookup in
+         * @param stamp set to the file's current stamp if the cache is enabled
+         *
+         * @returns the cached Track, or nullptr if the file has to be read.
+         */
+        static shared_ptr<Track> restoreTrack(const fs::path& trackPath, MetadataCache* cache,
+                                              const ReadOptions& options, const shared_ptr<ImportArena>& arena,
+                                              ImportMetrics& metrics, std::optional<FileStamp>& stamp);
+
+        /**
+         * @brief Reads the metadata of a file and adds it to the metadata cache.
+         *
+         * Errors are reported to stderr.
+         *
+         * @param trackPath path to the audio file to import
+         * @param reader reader with the file already open. If nullptr, the file is opened here.
+         * @param cache metadata cache to update. May be nullptr.
+         * @param stamp stamp of the file, as returned by restoreTrack()
+         * @param options options used to read the file
+         * @param arena arena the Track is allocated from
+         * @param metrics metrics to record the read time and any failure in
+         *
+         * @returns the imported Track, or nullptr if the file could not be imported.
+         */
+        static shared_ptr<Track> readTrack(const fs::path& trackPath, shared_ptr<FileReader> reader,
+                                           MetadataCache* cache, const std::optional<FileStamp>& stamp,
+                                           const ReadOptions& options, const shared_ptr<ImportArena>& arena,
+                                           ImportMetrics& metrics);
+
+        /**
+         * @brief Organizes the imported tracks into their albums.
+         *
+         * @param arena arena new albums are allocated from. If nullptr, they're allocated on the heap.
+         */
+        void groupTracks(const shared_ptr<ImportArena>& arena);
+
+        /**
+         * @brief Checks whether a directory entry is a regular file with a supported extension.
+         *
+         * @param entry directory entry to check
+         *
+         * @returns true if the entry should be imported.
+         */
+        static bool isSupportedFile(const fs::directory_entry& entry);
+
+        /**
+         * @brief Writes the metadata cache back to disk, if it's enabled.
+         *
+         * Errors are reported to stderr.
+         */
+        void saveCache() const;
+
+        /**
+         * @brief Prints a status line to stdout unless the Importer is quiet.
+         *
+         * @param message line to print
+         */
+        void printStatus(const string& message) const;
     public:
         Importer();
 
+        /**
+         * @brief Creates an Importer that spreads metadata parsing across multiple threads.
+         *
+         * @param threadCount number of import threads. 0 uses one thread per CPU.
+         */
+        explicit Importer(const uint32_t& threadCount);
+
+        /**
+         * @brief Sets the number of threads used to read track metadata.
+         *
+         * The resulting track list is ordered the same way regardless of the thread count.
+         *
+         * @param count number of import threads. 0 uses one thread per CPU.
+         */
+        void setThreadCount(const uint32_t& count);
+
+        /**
+         * @brief Enables the persistent metadata cache stored at the provided path.
+         *
+         * Files whose inode, modification time and size match their cache entry aren't opened
+         * during the next search. The cache is written back after every completed search.
+         * 
+         * A snapshot of the directory listings is kept next to it, at the same path with a
+         * ".dirs" suffix. Directories whose modification time hasn't changed aren't read again.
+         *
+         * @param path location of the cache file. It's created if it doesn't exist.
+         */
+        void setCachePath(const fs::path& path);
+
+        /**
+         * @brief Sets the options used to read each imported track.
+         *
+         * @param options read options applied to every Track
+         */
+        void setReadOptions(const ReadOptions& options);
+
+        /**
+         * @brief Enables opening files and reading their headers in batches.
+         *
+         * Batches are submitted through io_uring when the kernel supports it, so the storage
+         * device sees many requests at once rather than one per import thread. Otherwise a
+         * small pool of I/O threads reads them. Batching is skipped for ReadMode::mapped.
+         *
+         * @param enabled true to read headers in batches
+         */
+        void setBatchReads(bool enabled);
+
+        /**
+         * @brief Sets the function that receives progress snapshots during a search.
+         *
+         * The callback runs on a separate reporting thread, at most once per
+         * ProgressReporter::DEFAULT_INTERVAL, plus once more with the final counts. Import threads
+         * never wait for it. Defaults to a single-line counter on stdout.
+         *
+         * @param callback progress callback. An empty function disables progress reporting.
+         */
+        void setProgressCallback(ProgressCallback callback);
+
+        /**
+         * @brief Suppresses the status messages printed during a search.
+         *
+         * Errors are still reported to stderr. Progress reporting is controlled separately
+         * through setProgressCallback().
+         *
+         * @param enabled true to stop printing status messages
+         */
+        void setQuiet(bool enabled);
+
         /**
          * @brief Performs a search and import for supported files in the specified directory.
          * 
+         * Metadata is read as files are discovered rather than after the whole tree has been walked.
+         * 
          * @param path directory to import from
+         * @param limit maximum number of files to import. 0 imports everything.
          */
         void runTrackSearch(const fs::path& path, const uint32_t& limit);
 
+        /**
+         * @brief Brings the albums up to date with files that changed since they were generated.
+         * 
+         * Modified files are read again. Only the albums that held a changed file or receive a
+         * re-read track are touched: they're grouped again from their remaining tracks and the
+         * new ones, sorted by path, so their name, artist, MBID and track count come from their
+         * current tracks. Albums left without tracks are dropped. Re-read tracks and rebuilt
+         * albums are allocated on the heap rather than in the Importer's arena, so they're freed
+         * once they're replaced and a long watch doesn't keep growing. Cache entries of removed
+         * files are dropped, and the metadata cache is saved whenever an album changed.
+         * 
+         * @param modified files that were created or written
+         * @param removed files or whole directories that were deleted or moved away
+         * 
+         * @returns true if any album changed.
+         */
+        bool updateTracks(const vector<fs::path>& modified, const vector<fs::path>& removed);
+
         /**
          * @brief Organizes tracks into their respective albums.
          * 
@@ -86,14 +292,50 @@ namespace MusicList
         Json::Value toJSON() const;
 
         /**
+         * @brief Streams the albums array straight to a file without building a Json::Value.
+         * 
+         * The output is identical to writing toJSON() with two-space indentation, followed by
+         * a newline.
+         * 
+         * @param path file to write
+         * 
+         * @throws std::runtime_error if the file can't be written.
+         */
+        void writeJSON(const fs::path& path) const;
+
+        /**
+         * @brief Writes the albums and their tracks as a binary catalog.
+         * 
+         * The catalog can be opened with MusicList::Catalog without parsing it.
+         * 
+         * @param path file to write
+         * 
+         * @throws std::runtime_error if the file can't be written.
+         */
+        void writeCatalog(const fs::path& path) const;
+
+        /**
+         * Tracks are allocated from the Importer's arena and keep it alive, so they can be held on
+         * to after the Importer is destroyed.
+         *
          * @returns a reference to the tracks vector.
          */
         const vector<shared_ptr<Track>>& getTracks() const;
 
         /**
+         * Like tracks, albums keep the Importer's arena alive. Their track maps and strings are
+         * allocated on the heap.
+         *
          * @returns a reference to the albums map.
          */
         const map<string,shared_ptr<Album>>& getAlbums() const;
+
+        /**
+         * Metrics accumulate over every search, update and export run by this Importer.
+         *
+         * @returns timing and counters for the work done so far.
+         */
+        const ImportMetrics& getMetrics() const;
     };
 } // namespace MusicList
 
@@ -0,0 +1,410 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <sstream>
+#include <stdexcept>
+
+#include "JsonWriter.hpp"
+
+using namespace MusicList;
+
+namespace
+{
+    const char INDENTATION[] = "  ";
+    const char HEX_DIGITS[] = "0123456789abcdef";
+
+    void appendHex(string& out, uint32_t codepoint)
+    {
+        out += "\\u";
+        out += HEX_DIGITS[(codepoint >> 12) & 0xF];
+        out += HEX_DIGITS[(codepoint >> 8) & 0xF];
+        out += HEX_DIGITS[(codepoint >> 4) & 0xF];
+        out += HEX_DIGITS[codepoint & 0xF];
+    }
+
+    /**
+     * Decodes one UTF-8 sequence and advances `pos` to its last byte. Mirrors jsoncpp, which
+     * doesn't check continuation bytes but rejects truncated, overlong and surrogate sequences.
+     */
+    uint32_t decodeUtf8(string_view text, size_t& pos)
+    {
+        static const uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+        const auto byte = [&text, &pos](size_t offset)
+        {
+            return static_cast<uint32_t>(static_cast<unsigned char>(text[pos + offset]));
+        };
+
+        const uint32_t first = byte(0);
+        const size_t remaining = text.size() - pos;
+
+        if (first < 0x80)
+        {
+            return first;
+        }
+        if (first < 0xE0)
+        {
+            if (remaining < 2)
+            {
+                return REPLACEMENT_CHARACTER;
+            }
+            const uint32_t codepoint = ((first & 0x1F) << 6) | (byte(1) & 0x3F);
+            pos += 1;
+            return codepoint < 0x80 ? REPLACEMENT_CHARACTER : codepoint;
+        }
+        if (first < 0xF0)
+        {
+            if (remaining < 3)
+            {
+                return REPLACEMENT_CHARACTER;
+            }
+            const uint32_t codepoint = ((first & 0x0F) << 12) | ((byte(1) & 0x3F) << 6) | (byte(2) & 0x3F);
+            pos += 2;
+            if (codepoint >= 0xD800 && codepoint <= 0xDFFF)
+            {
+                return REPLACEMENT_CHARACTER;
+            }
+            return codepoint < 0x800 ? REPLACEMENT_CHARACTER : codepoint;
+        }
+        if (first < 0xF8)
+        {
+            if (remaining < 4)
+            {
+                return REPLACEMENT_CHARACTER;
+            }
+            const uint32_t codepoint = ((first & 0x07) << 18) | ((byte(1) & 0x3F) << 12) |
+                                       ((byte(2) & 0x3F) << 6) | (byte(3) & 0x3F);
+            pos += 3;
+            return codepoint < 0x10000 ? REPLACEMENT_CHARACTER : codepoint;
+        }
+
+        return REPLACEMENT_CHARACTER;
+    }
+}
+
+JsonWriter::JsonWriter(const fs::path& path) : path(path)
+{
+    this->fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (this->fd < 0)
+    {
+        std::ostringstream errStr;
+        errStr << "Failed to open output file: " << path.string() << ".";
+        throw std::runtime_error(errStr.str());
+    }
+
+    this->buffer.reserve(BUFFER_SIZE);
+}
+
+JsonWriter::~JsonWriter()
+{
+    if (this->fd >= 0)
+    {
+        try
+        {
+            this->flush();
+        }
+        catch (const std::exception&)
+        {
+            // Destructors can't report errors. Call close() to find out about them.
+        }
+        ::close(this->fd);
+    }
+}
+
+void JsonWriter::flush()
+{
+    size_t written = 0;
+    while (written < this->buffer.size())
+    {
+        const ssize_t result = write(this->fd, this->buffer.data() + written, this->buffer.size() - written);
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            std::ostringstream errStr;
+            errStr << "Failed to write output file: " << this->path.string() << ".";
+            throw std::runtime_error(errStr.str());
+        }
+        written += static_cast<size_t>(result);
+    }
+
+    this->buffer.clear();
+}
+
+void JsonWriter::append(string_view text)
+{
+    this->buffer.append(text.data(), text.size());
+    if (this->buffer.size() >= BUFFER_SIZE)
+    {
+        this->flush();
+    }
+}
+
+void JsonWriter::writeIndent()
+{
+    this->buffer += '\n';
+    this->append(this->indentString);
+}
+
+void JsonWriter::writeWithIndent(string_view text)
+{
+    if (!this->indented)
+    {
+        this->writeIndent();
+    }
+    this->append(text);
+    this->indented = false;
+}
+
+void JsonWriter::beginValue()
+{
+    if (this->frames.empty() || !this->frames.back().isArray)
+    {
+        return;
+    }
+
+    this->openContainer();
+
+    Frame& frame = this->frames.back();
+    if (!frame.empty)
+    {
+        this->append(",");
+    }
+    frame.empty = false;
+
+    if (!this->indented)
+    {
+        this->writeIndent();
+    }
+    this->indented = true;
+}
+
+void JsonWriter::endValue()
+{
+    // Like jsoncpp, only array elements reset the indentation state.
+    if (!this->frames.empty() && this->frames.back().isArray)
+    {
+        this->indented = false;
+    }
+}
+
+void JsonWriter::openContainer()
+{
+    Frame& frame = this->frames.back();
+    if (frame.empty)
+    {
+        this->writeWithIndent(frame.isArray ? "[" : "{");
+        this->indentString += INDENTATION;
+    }
+}
+
+void JsonWriter::beginObject()
+{
+    this->beginValue();
+    this->frames.push_back({false, true});
+}
+
+void JsonWriter::endObject()
+{
+    const Frame frame = this->frames.back();
+    this->frames.pop_back();
+
+    if (frame.empty)
+    {
+        this->append("{}");
+    }
+    else
+    {
+        this->indentString.resize(this->indentString.size() - (sizeof(INDENTATION) - 1));
+        this->writeWithIndent("}");
+    }
+
+    this->endValue();
+}
+
+void JsonWriter::beginArray()
+{
+    this->beginValue();
+    this->frames.push_back({true, true});
+}
+
+void JsonWriter::endArray()
+{
+    const Frame frame = this->frames.back();
+    this->frames.pop_back();
+
+    if (frame.empty)
+    {
+        this->append("[]");
+    }
+    else
+    {
+        this->indentString.resize(this->indentString.size() - (sizeof(INDENTATION) - 1));
+        this->writeWithIndent("]");
+    }
+
+    this->endValue();
+}
+
+void JsonWriter::writeKey(string_view name)
+{
+    this->openContainer();
+
+    Frame& frame = this->frames.back();
+    if (!frame.empty)
+    {
+        this->append(",");
+    }
+    frame.empty = false;
+
+    string quoted;
+    JsonWriter::appendQuoted(quoted, name);
+    this->writeWithIndent(quoted);
+    this->append(" : ");
+}
+
+void JsonWriter::writeString(string_view value)
+{
+    this->beginValue();
+
+    JsonWriter::appendQuoted(this->buffer, value);
+    if (this->buffer.size() >= BUFFER_SIZE)
+    {
+        this->flush();
+    }
+
+    this->endValue();
+}
+
+void JsonWriter::writeInt(int64_t value)
+{
+    this->beginValue();
+    this->append(std::to_string(value));
+
+    this->endValue();
+}
+
+void JsonWriter::writeBool(bool value)
+{
+    this->beginValue();
+    this->append(value ? "true" : "false");
+
+    this->endValue();
+}
+
+void JsonWriter::writeNull()
+{
+    this->beginValue();
+    this->append("null");
+
+    this->endValue();
+}
+
+void JsonWriter::close()
+{
+    this->append("\n");
+    this->flush();
+
+    const int fileDescriptor = this->fd;
+    this->fd = -1;
+    if (::close(fileDescriptor) != 0)
+    {
+        std::ostringstream errStr;
+        errStr << "Failed to write output file: " << this->path.string() << ".";
+        throw std::runtime_error(errStr.str());
+    }
+}
+
+void JsonWriter::appendQuoted(string& out, string_view value)
+{
+    out += '"';
+    for (size_t pos = 0; pos < value.size(); pos++)
+    {
+        const char c = value[pos];
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\b':
+            out += "\\b";
+            break;
+        case '\f':
+            out += "\\f";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+        {
+            const uint32_t codepoint = decodeUtf8(value, pos);
+            if (codepoint < 0x20)
+            {
+                appendHex(out, codepoint);
+            }
+            else if (codepoint < 0x80)
+            {
+                out += static_cast<char>(codepoint);
+            }
+            else if (codepoint < 0x10000)
+            {
+                appendHex(out, codepoint);
+            }
+            else
+            {
+                const uint32_t offset = codepoint - 0x10000;
+                appendHex(out, 0xD800 + ((offset >> 10) & 0x3FF));
+                appendHex(out, 0xDC00 + (offset & 0x3FF));
+            }
+        }
+        break;
+        }
+    }
+    out += '"';
+}
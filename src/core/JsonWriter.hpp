@@ -0,0 +1,157 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_JSONWRITER_HPP
+#define MUSICLIST_JSONWRITER_HPP
+
+#include <filesystem>
+#include <cinttypes>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace MusicList
+{
+    /**
+     * @brief Streams JSON to a file through a fixed-size buffer.
+     *
+     * The output is byte-for-byte what Json::StreamWriterBuilder produces with two-space
+     * indentation and comments disabled. Object keys are written in the order they are given,
+     * so callers must supply them sorted the way Json::Value sorts them. Arrays are always laid
+     * out one element per line, which is how jsoncpp writes arrays of non-empty objects.
+     */
+    class JsonWriter
+    {
+    private:
+        struct Frame
+        {
+            bool isArray;
+            bool empty;
+        };
+
+        int fd = -1;
+        fs::path path;
+        string buffer;
+        string indentString;
+        vector<Frame> frames;
+        bool indented = true;
+
+        void flush();
+
+        void append(string_view text);
+
+        void writeIndent();
+
+        void writeWithIndent(string_view text);
+
+        /**
+         * @brief Handles separators and line breaks before a value in an array.
+         */
+        void beginValue();
+
+        /**
+         * @brief Updates the line break state after a value.
+         */
+        void endValue();
+
+        /**
+         * @brief Writes the opening bracket of the innermost container once it's known to be non-empty.
+         */
+        void openContainer();
+    public:
+        static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+        /**
+         * @brief Creates or truncates the output file.
+         *
+         * @param path file to write
+         *
+         * @throws std::runtime_error if the file can't be opened.
+         */
+        explicit JsonWriter(const fs::path& path);
+
+        JsonWriter(const JsonWriter&) = delete;
+        JsonWriter& operator=(const JsonWriter&) = delete;
+
+        /**
+         * @brief Flushes any buffered output and closes the file, ignoring errors.
+         */
+        ~JsonWriter();
+
+        void beginObject();
+
+        void endObject();
+
+        void beginArray();
+
+        void endArray();
+
+        /**
+         * @brief Writes the key of the next object member.
+         */
+        void writeKey(string_view name);
+
+        void writeString(string_view value);
+
+        void writeInt(int64_t value);
+
+        void writeBool(bool value);
+
+        void writeNull();
+
+        /**
+         * @brief Ends the document with a newline, then flushes and closes the file.
+         *
+         * @throws std::runtime_error if the output couldn't be written.
+         */
+        void close();
+
+        /**
+         * @brief Appends a string quoted and escaped the way jsoncpp does without emitUTF8.
+         *
+         * Non-ASCII characters are written as \u escapes, using surrogate pairs outside the
+         * Basic Multilingual Plane, and malformed UTF-8 becomes U+FFFD.
+         *
+         * @param out destination
+         * @param value UTF-8 text to quote
+         */
+        static void appendQuoted(string& out, string_view value);
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_JSONWRITER_HPP
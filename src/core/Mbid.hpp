@@ -0,0 +1,88 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_MBID_HPP
+#define MUSICLIST_MBID_HPP
+
+#include <cinttypes>
+#include <cstddef>
+#include <string_view>
+#include <tuple>
+
+using std::string_view;
+
+namespace MusicList
+{
+    /**
+     * @brief 128-bit binary form of a MusicBrainz identifier.
+     *
+     * MBIDs are UUIDs, so the 36 character text form packs into two 64-bit words that hash and
+     * compare without touching the original string.
+     */
+    struct Mbid
+    {
+        uint64_t high = 0;
+        uint64_t low = 0;
+
+        /**
+         * @brief Parses the canonical "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx" form. Hex digits may
+         * be upper or lower case.
+         *
+         * @param text text to parse
+         * @param mbid destination for the parsed value
+         *
+         * @returns false if the text isn't a well-formed UUID.
+         */
+        static bool parse(string_view text, Mbid& mbid);
+
+        friend inline bool operator== (const Mbid& lhs, const Mbid& rhs)
+        {
+            return std::tie(lhs.high, lhs.low) == std::tie(rhs.high, rhs.low);
+        }
+
+        friend inline bool operator!= (const Mbid& lhs, const Mbid& rhs) { return !(lhs == rhs); }
+    };
+
+    /**
+     * Hash for using Mbid as an unordered container key. UUIDs are already well distributed, so
+     * folding the two halves together is enough.
+     */
+    struct MbidHash
+    {
+        inline size_t operator()(const Mbid& mbid) const
+        {
+            return static_cast<size_t>(mbid.high ^ (mbid.low * 0x9E3779B97F4A7C15ULL));
+        }
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_MBID_HPP
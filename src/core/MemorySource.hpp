@@ -0,0 +1,90 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_MEMORYSOURCE_HPP
+#define MUSICLIST_MEMORYSOURCE_HPP
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+
+namespace MusicList
+{
+    /**
+     * @brief Range of a file that has already been read into memory.
+     *
+     * Offsets are relative to the start of the file, so tag parsers templated on their source
+     * read it the same way as a FileReader.
+     */
+    struct MemorySource
+    {
+        const uint8_t* data;
+        uint64_t start;
+        uint64_t length;
+
+        /**
+         * @brief Copies bytes from the buffered range.
+         *
+         * @param offset position in the file to read from
+         * @param dest destination for the bytes
+         * @param count maximum number of bytes to copy
+         *
+         * @returns number of bytes copied, which is 0 if `offset` is outside the range.
+         */
+        size_t readAt(uint64_t offset, void* dest, size_t count) const
+        {
+            if (offset < this->start || offset - this->start >= this->length)
+            {
+                return 0;
+            }
+
+            count = static_cast<size_t>(std::min<uint64_t>(count, this->length - (offset - this->start)));
+            memcpy(dest, this->data + (offset - this->start), count);
+            return count;
+        }
+    };
+
+    /**
+     * @brief Reads a big-endian 32-bit integer.
+     *
+     * @param bytes start of the 4 bytes to read
+     *
+     * @returns the value in host byte order.
+     */
+    inline uint32_t readUInt32BE(const uint8_t* bytes)
+    {
+        return (static_cast<uint32_t>(bytes[0]) << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+    }
+} // namespace MusicList
+
+#endif // MUSICLIST_MEMORYSOURCE_HPP
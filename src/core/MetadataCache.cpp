@@ -0,0 +1,392 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <sys/stat.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#include "MetadataCache.hpp"
+
+using namespace MusicList;
+
+static const char CACHE_MAGIC[8] = {'M', 'L', 'C', 'A', 'C', 'H', 'E', 0};
+// Bump whenever the entry layout or the meaning of a cached field changes.
+static const uint32_t CACHE_VERSION = 3;
+
+namespace
+{
+    /**
+     * Appends fixed-width values in host byte order. The cache is never shared between machines.
+     */
+    template<typename T>
+    void writeValue(string& out, const T& value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void writeString(string& out, const string& value)
+    {
+        writeValue(out, static_cast<uint32_t>(value.size()));
+        out.append(value);
+    }
+
+    /**
+     * Bounds-checked cursor over a loaded cache file.
+     */
+    struct CacheReader
+    {
+        const string& data;
+        size_t pos = 0;
+
+        void require(size_t count) const
+        {
+            if (count > this->data.size() - this->pos)
+            {
+                throw std::runtime_error("Metadata cache is truncated.");
+            }
+        }
+
+        template<typename T>
+        T readValue()
+        {
+            this->require(sizeof(T));
+            T value;
+            memcpy(&value, this->data.data() + this->pos, sizeof(T));
+            this->pos += sizeof(T);
+            return value;
+        }
+
+        string readString()
+        {
+            const auto length = this->readValue<uint32_t>();
+            this->require(length);
+            string value = this->data.substr(this->pos, length);
+            this->pos += length;
+            return value;
+        }
+    };
+}
+
+MetadataCache::MetadataCache() = default;
+
+MetadataCache::MetadataCache(const fs::path& cachePath)
+{
+    this->load(cachePath);
+}
+
+void MetadataCache::load(const fs::path& cachePath)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->entries.clear();
+
+    std::ifstream cacheFile = std::ifstream(cachePath, std::ios::binary);
+    if (!cacheFile.is_open())
+    {
+        return;
+    }
+
+    const string data = string(std::istreambuf_iterator<char>(cacheFile), std::istreambuf_iterator<char>());
+    cacheFile.close();
+
+    StringPool& pool = StringPool::global();
+    CacheReader reader = {data};
+    try
+    {
+        reader.require(sizeof(CACHE_MAGIC));
+        if (memcmp(data.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0)
+        {
+            throw std::runtime_error("Metadata cache has an unknown format.");
+        }
+        reader.pos += sizeof(CACHE_MAGIC);
+
+        if (reader.readValue<uint32_t>() != CACHE_VERSION)
+        {
+            // Outdated caches are simply rebuilt.
+            return;
+        }
+
+        const auto entryCount = reader.readValue<uint32_t>();
+        this->entries.reserve(entryCount);
+        for (uint32_t i = 0; i < entryCount; i++)
+        {
+            const string path = reader.readString();
+
+            Entry entry;
+            entry.stamp.inode = reader.readValue<uint64_t>();
+            entry.stamp.mtime = reader.readValue<int64_t>();
+            entry.stamp.size = reader.readValue<uint64_t>();
+            const auto format = reader.readValue<uint8_t>();
+            if (format > static_cast<uint8_t>(AudioFormat::alac))
+            {
+                throw std::runtime_error("Metadata cache has an unknown audio format.");
+            }
+            entry.format = static_cast<AudioFormat>(format);
+            entry.isLossless = reader.readValue<uint8_t>() != 0;
+            entry.trackNum = reader.readValue<uint8_t>();
+            entry.totalTracks = reader.readValue<uint8_t>();
+            entry.discNum = reader.readValue<uint8_t>();
+            entry.totalDiscs = reader.readValue<uint8_t>();
+            entry.mbid = pool.intern(reader.readString());
+            entry.completeTags = reader.readValue<uint8_t>() != 0;
+            entry.picturesRecorded = reader.readValue<uint8_t>() != 0;
+
+            const auto pictureCount = reader.readValue<uint32_t>();
+            for (uint32_t j = 0; j < pictureCount; j++)
+            {
+                VorbisComment::Picture picture;
+                picture.offset = reader.readValue<uint64_t>();
+                picture.packetOffset = reader.readValue<uint32_t>();
+                picture.length = reader.readValue<uint32_t>();
+                picture.base64 = reader.readValue<uint8_t>() != 0;
+                picture.type = reader.readValue<uint32_t>();
+                picture.mimeType = reader.readString();
+                entry.pictures.push_back(std::move(picture));
+            }
+
+            const auto tagCount = reader.readValue<uint32_t>();
+            // Every tag takes at least its two length fields, which bounds a corrupt count.
+            reader.require(static_cast<size_t>(tagCount) * 2 * sizeof(uint32_t));
+            entry.tags.reserve(tagCount);
+            for (uint32_t j = 0; j < tagCount; j++)
+            {
+                const string key = reader.readString();
+                const string value = reader.readString();
+                entry.tags.set(key, value);
+            }
+
+            this->entries[path] = std::move(entry);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << " Ignoring " << cachePath.string() << ".\n";
+        this->entries.clear();
+    }
+}
+
+void MetadataCache::save(const fs::path& cachePath) const
+{
+    const StringPool& pool = StringPool::global();
+    string data;
+    data.append(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    writeValue(data, CACHE_VERSION);
+
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        writeValue(data, static_cast<uint32_t>(this->entries.size()));
+        for (const auto& pair : this->entries)
+        {
+            const Entry& entry = pair.second;
+
+            writeString(data, pair.first);
+            writeValue(data, entry.stamp.inode);
+            writeValue(data, entry.stamp.mtime);
+            writeValue(data, entry.stamp.size);
+            writeValue(data, static_cast<uint8_t>(entry.format));
+            writeValue(data, static_cast<uint8_t>(entry.isLossless));
+            writeValue(data, static_cast<uint8_t>(entry.trackNum));
+            writeValue(data, static_cast<uint8_t>(entry.totalTracks));
+            writeValue(data, static_cast<uint8_t>(entry.discNum));
+            writeValue(data, static_cast<uint8_t>(entry.totalDiscs));
+            writeString(data, pool.get(entry.mbid));
+            writeValue(data, static_cast<uint8_t>(entry.completeTags));
+            writeValue(data, static_cast<uint8_t>(entry.picturesRecorded));
+
+            writeValue(data, static_cast<uint32_t>(entry.pictures.size()));
+            for (const auto& picture : entry.pictures)
+            {
+                writeValue(data, picture.offset);
+                writeValue(data, picture.packetOffset);
+                writeValue(data, picture.length);
+                writeValue(data, static_cast<uint8_t>(picture.base64));
+                writeValue(data, picture.type);
+                writeString(data, picture.mimeType);
+            }
+
+            writeValue(data, static_cast<uint32_t>(entry.tags.size()));
+            for (const auto tag : entry.tags)
+            {
+                writeString(data, tag.first);
+                writeString(data, tag.second);
+            }
+        }
+    }
+
+    fs::path tmpPath = cachePath;
+    tmpPath += ".tmp";
+
+    std::ofstream cacheFile = std::ofstream(tmpPath, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!cacheFile.is_open())
+    {
+        throw std::runtime_error("Failed to open metadata cache for writing: " + tmpPath.string());
+    }
+
+    cacheFile.write(data.data(), static_cast<std::streamsize>(data.size()));
+    cacheFile.close();
+    if (cacheFile.fail())
+    {
+        throw std::runtime_error("Failed to write metadata cache: " + tmpPath.string());
+    }
+
+    fs::rename(tmpPath, cachePath);
+}
+
+bool MetadataCache::readStamp(const fs::path& path, FileStamp& stamp)
+{
+    struct stat info = {};
+    if (stat(path.c_str(), &info) != 0)
+    {
+        return false;
+    }
+
+    stamp.inode = static_cast<uint64_t>(info.st_ino);
+    stamp.mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    stamp.size = static_cast<uint64_t>(info.st_size);
+
+    return true;
+}
+
+MetadataCache::Entry* MetadataCache::find(const fs::path& path, const FileStamp& stamp, const ReadOptions& options)
+{
+    auto found = this->entries.find(path.string());
+    if (found == this->entries.end() || found->second.stamp != stamp)
+    {
+        return nullptr;
+    }
+    if (!found->second.completeTags && !options.lazyTags)
+    {
+        // Read the file again to get the rest of the tags.
+        return nullptr;
+    }
+    if (!found->second.picturesRecorded && options.recordPictures)
+    {
+        return nullptr;
+    }
+
+    return &found->second;
+}
+
+bool MetadataCache::contains(const fs::path& path, const FileStamp& stamp, const ReadOptions& options)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->find(path, stamp, options) != nullptr;
+}
+
+bool MetadataCache::restore(Track& track, const fs::path& path, const FileStamp& stamp)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    Entry* found = this->find(path, stamp, track.options);
+    if (found == nullptr)
+    {
+        return false;
+    }
+
+    Entry& entry = *found;
+    entry.used = true;
+
+    track.path = path;
+    track.format = entry.format;
+    track.isLossless = entry.isLossless;
+    track.trackNum = entry.trackNum;
+    track.totalTracks = entry.totalTracks;
+    track.discNum = entry.discNum;
+    track.totalDiscs = entry.totalDiscs;
+    track.mbid = entry.mbid;
+
+    track.tags = entry.tags;
+    track.pictures = entry.pictures;
+
+    track.artist = track.tags.valueId("ALBUMARTIST");
+    track.album = track.tags.valueId("ALBUM");
+    track.title = track.tags.valueId("TITLE");
+    track.albumMbid = track.tags.valueId("MUSICBRAINZ_ALBUMID");
+    track.tagsLoaded = entry.completeTags;
+
+    return true;
+}
+
+void MetadataCache::store(const Track& track, const FileStamp& stamp)
+{
+    Entry entry;
+    entry.stamp = stamp;
+    entry.format = track.format;
+    entry.isLossless = track.isLossless;
+    entry.trackNum = track.trackNum;
+    entry.totalTracks = track.totalTracks;
+    entry.discNum = track.discNum;
+    entry.totalDiscs = track.totalDiscs;
+    entry.mbid = track.mbid;
+    entry.tags = track.tags;
+    entry.completeTags = track.tagsLoaded;
+    entry.picturesRecorded = track.options.recordPictures;
+    entry.pictures = track.pictures;
+    entry.used = true;
+
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->entries[track.path.string()] = std::move(entry);
+}
+
+void MetadataCache::remove(const fs::path& path)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->entries.erase(path.string());
+}
+
+void MetadataCache::prune()
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    for (auto it = this->entries.begin(); it != this->entries.end();)
+    {
+        if (it->second.used)
+        {
+            ++it;
+        }
+        else
+        {
+            it = this->entries.erase(it);
+        }
+    }
+}
+
+size_t MetadataCache::size() const
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->entries.size();
+}
@@ -0,0 +1,204 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_METADATACACHE_HPP
+#define MUSICLIST_METADATACACHE_HPP
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <cinttypes>
+
+#include "Track.hpp"
+
+namespace fs = std::filesystem;
+
+using std::string;
+using std::vector;
+
+namespace MusicList
+{
+    /**
+     * @brief Identifies a specific version of a file on disk.
+     */
+    struct FileStamp
+    {
+        uint64_t inode = 0;
+        int64_t mtime = 0;
+        uint64_t size = 0;
+
+        friend inline bool operator== (const FileStamp& lhs, const FileStamp& rhs)
+        {
+            return std::tie(lhs.inode, lhs.mtime, lhs.size) == std::tie(rhs.inode, rhs.mtime, rhs.size);
+        }
+
+        friend inline bool operator!= (const FileStamp& lhs, const FileStamp& rhs) { return !(lhs == rhs); }
+    };
+
+    /**
+     * @brief On-disk cache of parsed track metadata.
+     *
+     * Entries are keyed on the file path and only reused while the file's inode, modification
+     * time and size are unchanged. All methods are safe to call from multiple import threads.
+     */
+    class MetadataCache
+    {
+    private:
+        struct Entry
+        {
+            FileStamp stamp;
+            AudioFormat format = AudioFormat::unknown;
+            bool isLossless = false;
+            uint_fast8_t trackNum = 0;
+            uint_fast8_t totalTracks = 0;
+            uint_fast8_t discNum = 0;
+            uint_fast8_t totalDiscs = 0;
+            StringPool::Id mbid = StringPool::EMPTY;
+            TagList tags;
+            // False if only the summary tags of a lazily loaded Track were stored.
+            bool completeTags = true;
+            // False if the Track was read without ReadOptions::recordPictures.
+            bool picturesRecorded = false;
+            vector<VorbisComment::Picture> pictures;
+            bool used = false;
+        };
+
+        std::unordered_map<string,Entry> entries;
+        mutable std::mutex lock;
+
+        /**
+         * @brief Looks up the entry that can serve a Track read with the provided options.
+         *
+         * The lock must be held by the caller.
+         *
+         * @returns the entry, or nullptr if there's no usable entry for the unchanged file.
+         */
+        Entry* find(const fs::path& path, const FileStamp& stamp, const ReadOptions& options);
+    public:
+        MetadataCache();
+
+        /**
+         * @brief Creates a cache populated from the file at the provided path.
+         *
+         * @param cachePath path to a cache file written by MetadataCache::save()
+         */
+        explicit MetadataCache(const fs::path& cachePath);
+
+        /**
+         * @brief Replaces the cache contents with the entries in the provided file.
+         *
+         * A missing file leaves the cache empty. A corrupt or outdated file is ignored.
+         *
+         * @param cachePath path to a cache file written by MetadataCache::save()
+         */
+        void load(const fs::path& cachePath);
+
+        /**
+         * @brief Writes the cache to disk.
+         *
+         * The file is written next to the destination and renamed into place so a failed
+         * write never leaves a truncated cache behind.
+         *
+         * @param cachePath destination file
+         */
+        void save(const fs::path& cachePath) const;
+
+        /**
+         * @brief Reads the identifying stamp of a file.
+         *
+         * @param path file to stat
+         * @param stamp destination for the file's inode, modification time and size
+         *
+         * @returns false if the file could not be stat'ed.
+         */
+        static bool readStamp(const fs::path& path, FileStamp& stamp);
+
+        /**
+         * @brief Fills a Track from the cache if an entry for the unchanged file exists.
+         *
+         * Entries holding only summary tags are only used for Tracks that load their tags lazily,
+         * and entries without pictures only for Tracks that don't record them.
+         *
+         * @param track Track to populate
+         * @param path path of the audio file
+         * @param stamp current stamp of the audio file
+         *
+         * @returns true if the Track was populated from the cache.
+         */
+        bool restore(Track& track, const fs::path& path, const FileStamp& stamp);
+
+        /**
+         * @brief Checks whether restore() would succeed, without needing a Track.
+         *
+         * Lets callers skip creating a Track for files that have to be read anyway.
+         *
+         * @param path path of the audio file
+         * @param stamp current stamp of the audio file
+         * @param options options the Track would be read with
+         *
+         * @returns true if a usable entry for the unchanged file exists.
+         */
+        bool contains(const fs::path& path, const FileStamp& stamp, const ReadOptions& options);
+
+        /**
+         * @brief Adds or replaces the cache entry for a freshly parsed Track.
+         *
+         * @param track Track whose metadata has been read
+         * @param stamp stamp of the audio file at the time it was read
+         */
+        void store(const Track& track, const FileStamp& stamp);
+
+        /**
+         * @brief Drops the entry for a file that no longer exists.
+         *
+         * @param path path of the audio file
+         */
+        void remove(const fs::path& path);
+
+        /**
+         * @brief Drops every entry that wasn't restored or stored since the cache was loaded.
+         *
+         * This should only be run after a complete scan, otherwise entries for files outside
+         * the scanned set are lost.
+         */
+        void prune();
+
+        /**
+         * @returns number of entries in the cache.
+         */
+        size_t size() const;
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_METADATACACHE_HPP
@@ -0,0 +1,399 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "Mp4Tags.hpp"
+#include "MemorySource.hpp"
+
+using namespace MusicList;
+
+namespace
+{
+    /**
+     * Location of a box, with offsets relative to the start of the file.
+     */
+    struct Box
+    {
+        char type[4] = {};
+        uint64_t dataOffset = 0;
+        uint64_t end = 0;
+
+        bool is(const char* name) const
+        {
+            return memcmp(this->type, name, 4) == 0;
+        }
+    };
+
+    /**
+     * Vorbis comment keys for the iTunes atoms that have one.
+     */
+    struct AtomKey
+    {
+        const char* atom;
+        const char* key;
+    };
+
+    const AtomKey TEXT_ATOMS[] = {
+        {"\xA9nam", "TITLE"},
+        {"\xA9" "alb", "ALBUM"},
+        {"\xA9" "ART", "ARTIST"},
+        {"aART", "ALBUMARTIST"},
+        {"\xA9" "day", "DATE"},
+        {"\xA9gen", "GENRE"},
+        {"\xA9wrt", "COMPOSER"}
+    };
+
+    // Freeform "----" atoms in the com.apple.iTunes namespace, as written by MusicBrainz Picard.
+    const AtomKey FREEFORM_ATOMS[] = {
+        {"MusicBrainz Track Id", "MUSICBRAINZ_TRACKID"},
+        {"MusicBrainz Album Id", "MUSICBRAINZ_ALBUMID"},
+        {"MusicBrainz Artist Id", "MUSICBRAINZ_ARTISTID"},
+        {"MusicBrainz Album Artist Id", "MUSICBRAINZ_ALBUMARTISTID"},
+        {"MusicBrainz Release Group Id", "MUSICBRAINZ_RELEASEGROUPID"}
+    };
+
+    const char* ITUNES_NAMESPACE = "com.apple.iTunes";
+
+    // A data box holds a 4-byte type indicator and a 4-byte locale ahead of its value.
+    const uint64_t DATA_HEADER_SIZE = 8;
+    // Version and flags of a full box.
+    const uint64_t FULL_BOX_HEADER_SIZE = 4;
+
+    /**
+     * Reads the header of the box starting at `offset`, which must end before `limit`.
+     */
+    template<typename Source>
+    bool readBox(const Source& source, uint64_t offset, uint64_t limit, Box& box)
+    {
+        if (offset >= limit || limit - offset < 8)
+        {
+            return false;
+        }
+
+        uint8_t header[16];
+        if (source.readAt(offset, header, 8) != 8)
+        {
+            return false;
+        }
+
+        uint64_t size = readUInt32BE(header);
+        uint64_t headerSize = 8;
+        if (size == 1)
+        {
+            // 64-bit size, used by large mdat boxes.
+            if (limit - offset < 16 || source.readAt(offset + 8, header + 8, 8) != 8)
+            {
+                return false;
+            }
+            size = (static_cast<uint64_t>(readUInt32BE(header + 8)) << 32) | readUInt32BE(header + 12);
+            headerSize = 16;
+        }
+        else if (size == 0)
+        {
+            // Extends to the end of the enclosing box.
+            size = limit - offset;
+        }
+
+        if (size < headerSize || size > limit - offset)
+        {
+            return false;
+        }
+
+        memcpy(box.type, header + 4, 4);
+        box.dataOffset = offset + headerSize;
+        box.end = offset + size;
+        return true;
+    }
+
+    /**
+     * Finds the first child of the given type between `start` and `end`, skipping the others by size.
+     */
+    template<typename Source>
+    bool findBox(const Source& source, uint64_t start, uint64_t end, const char* type, Box& box)
+    {
+        uint64_t offset = start;
+        while (readBox(source, offset, end, box))
+        {
+            if (box.is(type))
+            {
+                return true;
+            }
+            offset = box.end;
+        }
+        return false;
+    }
+
+    /**
+     * Reads a range of the source into a string, unless it's larger than MAX_VALUE_SIZE.
+     */
+    template<typename Source>
+    bool readString(const Source& source, uint64_t offset, uint64_t end, string& value)
+    {
+        if (offset > end || end - offset > Mp4Tags::MAX_VALUE_SIZE)
+        {
+            return false;
+        }
+
+        value.resize(static_cast<size_t>(end - offset));
+        return source.readAt(offset, value.data(), value.size()) == value.size();
+    }
+
+    /**
+     * Hands the value of every data box in an item to the handler.
+     */
+    template<typename Source>
+    void readTextItem(const Source& source, const Box& item, const char* key, const Mp4Tags::TagHandler& handler)
+    {
+        Box data;
+        uint64_t offset = item.dataOffset;
+        while (readBox(source, offset, item.end, data))
+        {
+            string value;
+            if (data.is("data") && readString(source, data.dataOffset + DATA_HEADER_SIZE, data.end, value))
+            {
+                handler(key, value);
+            }
+            offset = data.end;
+        }
+    }
+
+    /**
+     * Reads a trkn or disk item, which holds a big-endian index and total after 2 reserved bytes.
+     */
+    template<typename Source>
+    void readIndexItem(const Source& source, const Box& item, const char* indexKey, const char* totalKey,
+                       const Mp4Tags::TagHandler& handler)
+    {
+        Box data;
+        uint8_t value[6];
+        if (!findBox(source, item.dataOffset, item.end, "data", data) ||
+            data.end - data.dataOffset < DATA_HEADER_SIZE + sizeof(value) ||
+            source.readAt(data.dataOffset + DATA_HEADER_SIZE, value, sizeof(value)) != sizeof(value))
+        {
+            return;
+        }
+
+        const uint32_t index = (value[2] << 8) | value[3];
+        const uint32_t total = (value[4] << 8) | value[5];
+        if (index > 0)
+        {
+            handler(indexKey, std::to_string(index));
+        }
+        if (total > 0)
+        {
+            handler(totalKey, std::to_string(total));
+        }
+    }
+
+    /**
+     * Reads a "----" item, which names its tag with mean and name boxes ahead of the data.
+     */
+    template<typename Source>
+    void readFreeformItem(const Source& source, const Box& item, const Mp4Tags::TagHandler& handler)
+    {
+        string mean;
+        string name;
+        Box child;
+        uint64_t offset = item.dataOffset;
+        while (readBox(source, offset, item.end, child))
+        {
+            if (child.is("mean"))
+            {
+                readString(source, child.dataOffset + FULL_BOX_HEADER_SIZE, child.end, mean);
+            }
+            else if (child.is("name"))
+            {
+                readString(source, child.dataOffset + FULL_BOX_HEADER_SIZE, child.end, name);
+            }
+            else if (child.is("data"))
+            {
+                break;
+            }
+            offset = child.end;
+        }
+
+        if (mean != ITUNES_NAMESPACE)
+        {
+            return;
+        }
+
+        for (const auto& atom : FREEFORM_ATOMS)
+        {
+            if (name == atom.atom)
+            {
+                readTextItem(source, item, atom.key, handler);
+                return;
+            }
+        }
+    }
+
+    /**
+     * Hands every known item in an ilst to the handler.
+     */
+    template<typename Source>
+    void readItems(const Source& source, const Box& ilst, const Mp4Tags::TagHandler& handler)
+    {
+        Box item;
+        uint64_t offset = ilst.dataOffset;
+        while (readBox(source, offset, ilst.end, item))
+        {
+            offset = item.end;
+
+            if (item.is("trkn"))
+            {
+                readIndexItem(source, item, "TRACKNUMBER", "TOTALTRACKS", handler);
+                continue;
+            }
+            if (item.is("disk"))
+            {
+                readIndexItem(source, item, "DISCNUMBER", "TOTALDISCS", handler);
+                continue;
+            }
+            if (item.is("----"))
+            {
+                readFreeformItem(source, item, handler);
+                continue;
+            }
+
+            // Anything else, including cover art, is skipped without reading its data.
+            for (const auto& atom : TEXT_ATOMS)
+            {
+                if (item.is(atom.atom))
+                {
+                    readTextItem(source, item, atom.key, handler);
+                    break;
+                }
+            }
+        }
+    }
+
+    /**
+     * Determines the codec of the first track whose sample description is AAC or ALAC.
+     */
+    Mp4Tags::Codec readCodec(const FileReader& reader, const Box& moov)
+    {
+        Box trak;
+        uint64_t offset = moov.dataOffset;
+        while (readBox(reader, offset, moov.end, trak))
+        {
+            offset = trak.end;
+
+            Box mdia, minf, stbl, stsd, entry;
+            if (!trak.is("trak") ||
+                !findBox(reader, trak.dataOffset, trak.end, "mdia", mdia) ||
+                !findBox(reader, mdia.dataOffset, mdia.end, "minf", minf) ||
+                !findBox(reader, minf.dataOffset, minf.end, "stbl", stbl) ||
+                !findBox(reader, stbl.dataOffset, stbl.end, "stsd", stsd) ||
+                // Skip the version, flags and entry count to get to the first sample entry.
+                !readBox(reader, stsd.dataOffset + FULL_BOX_HEADER_SIZE + 4, stsd.end, entry))
+            {
+                continue;
+            }
+
+            if (entry.is("mp4a"))
+            {
+                return Mp4Tags::Codec::aac;
+            }
+            if (entry.is("alac"))
+            {
+                return Mp4Tags::Codec::alac;
+            }
+        }
+
+        return Mp4Tags::Codec::unknown;
+    }
+}
+
+bool Mp4Tags::isMp4(const FileReader& reader)
+{
+    return reader.size() >= 8 && memcmp(reader.data() + 4, "ftyp", 4) == 0;
+}
+
+bool Mp4Tags::read(FileReader& reader, const TagHandler& handler, Codec& codec)
+{
+    codec = Codec::unknown;
+    if (!Mp4Tags::isMp4(reader))
+    {
+        return false;
+    }
+
+    Box moov;
+    if (!findBox(reader, 0, reader.getFileSize(), "moov", moov))
+    {
+        return false;
+    }
+
+    codec = readCodec(reader, moov);
+
+    Box udta, meta, ilst;
+    if (!findBox(reader, moov.dataOffset, moov.end, "udta", udta) ||
+        !findBox(reader, udta.dataOffset, udta.end, "meta", meta))
+    {
+        return true;
+    }
+
+    // iTunes writes meta as a full box, QuickTime without the version and flags. Tell them
+    // apart by whether the first child shows up where it would without them.
+    uint64_t metaStart = meta.dataOffset;
+    Box first;
+    if (!readBox(reader, metaStart, meta.end, first) || !first.is("hdlr"))
+    {
+        metaStart += FULL_BOX_HEADER_SIZE;
+    }
+
+    if (!findBox(reader, metaStart, meta.end, "ilst", ilst))
+    {
+        return true;
+    }
+
+    if (ilst.end - ilst.dataOffset <= MAX_BUFFERED_ILST)
+    {
+        std::vector<uint8_t> buffer(static_cast<size_t>(ilst.end - ilst.dataOffset));
+        if (reader.readAt(ilst.dataOffset, buffer.data(), buffer.size()) != buffer.size())
+        {
+            return false;
+        }
+
+        const MemorySource source = {buffer.data(), ilst.dataOffset, buffer.size()};
+        readItems(source, ilst, handler);
+    }
+    else
+    {
+        readItems(reader, ilst, handler);
+    }
+
+    return true;
+}
@@ -0,0 +1,109 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_MP4TAGS_HPP
+#define MUSICLIST_MP4TAGS_HPP
+
+#include <functional>
+#include <cinttypes>
+#include <string>
+
+#include "FileReader.hpp"
+
+using std::string;
+
+namespace MusicList
+{
+    /**
+     * @brief Dependency-free reader for the iTunes metadata of MP4/M4A files.
+     *
+     * Boxes are walked by their headers alone. Boxes off the moov/udta/meta/ilst path, including
+     * an mdat that comes before moov, are skipped by size. Skipping one costs a single small
+     * read past the prefix, so a file costs a few KB of I/O no matter where its moov sits.
+     *
+     * Known iTunes atoms are handed out under the Vorbis comment key of the same tag, so they
+     * can be stored exactly like comments from the other formats.
+     */
+    class Mp4Tags
+    {
+    public:
+        /**
+         * Receives each tag as a Vorbis comment key and value.
+         */
+        using TagHandler = std::function<void(const string& key, const string& value)>;
+
+        /**
+         * Codec of the first audio track.
+         */
+        enum class Codec : uint_fast8_t
+        {
+            unknown = 0,
+            aac,
+            alac
+        };
+
+        /**
+         * An ilst up to this size is read with a single call. Larger ones, usually due to cover
+         * art, are walked item by item.
+         */
+        static constexpr uint32_t MAX_BUFFERED_ILST = 64 * 1024;
+
+        /**
+         * Tag values larger than this are skipped.
+         */
+        static constexpr uint32_t MAX_VALUE_SIZE = 1024 * 1024;
+
+        /**
+         * @brief Checks whether a file starts with an MP4 ftyp box.
+         *
+         * @param reader open reader for the file
+         *
+         * @returns true if the file is an MP4 file.
+         */
+        static bool isMp4(const FileReader& reader);
+
+        /**
+         * @brief Reads the iTunes tags and the audio codec of an MP4 file.
+         *
+         * A file without an ilst is read successfully, but has no tags.
+         *
+         * @param reader open reader for the file
+         * @param handler called for every tag
+         * @param codec set to the codec of the first AAC or ALAC track
+         *
+         * @returns false if the file isn't MP4 or has no moov box.
+         */
+        static bool read(FileReader& reader, const TagHandler& handler, Codec& codec);
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_MP4TAGS_HPP
@@ -0,0 +1,219 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "OggPacketStream.hpp"
+
+using namespace MusicList;
+
+OggPacketStream::OggPacketStream(FileReader& reader) : reader(reader) {}
+
+OggPacketStream::OggPacketStream(FileReader& reader, uint64_t offset) : reader(reader), nextPageOffset(offset) {}
+
+bool OggPacketStream::loadPage()
+{
+    while (true)
+    {
+        const uint64_t pageOffset = this->nextPageOffset;
+
+        if (pageOffset <= this->reader.size())
+        {
+            // Extend the reader's buffer over the header and lacing table. Pages past skipped
+            // data are read on their own instead, so the skipped bytes are never fetched.
+            this->reader.ensure(pageOffset + PAGE_HEADER_SIZE + 255);
+        }
+
+        uint8_t header[PAGE_HEADER_SIZE + 255];
+        const size_t headerSize = this->reader.readAt(pageOffset, header, sizeof(header));
+        if (headerSize < PAGE_HEADER_SIZE || memcmp(header, "OggS", 4) != 0)
+        {
+            return false;
+        }
+
+        const uint8_t count = header[26];
+        if (headerSize < PAGE_HEADER_SIZE + count)
+        {
+            return false;
+        }
+        memcpy(this->lacing, header + PAGE_HEADER_SIZE, count);
+
+        uint32_t payloadSize = 0;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            payloadSize += this->lacing[i];
+        }
+
+        const uint32_t pageSerial = header[14] | (header[15] << 8) | (header[16] << 16) |
+            (static_cast<uint32_t>(header[17]) << 24);
+        const uint64_t payloadOffset = pageOffset + PAGE_HEADER_SIZE + count;
+        this->nextPageOffset = payloadOffset + payloadSize;
+
+        if (!this->started)
+        {
+            this->serial = pageSerial;
+            this->started = true;
+        }
+        else if (pageSerial != this->serial)
+        {
+            // Page from another multiplexed stream.
+            continue;
+        }
+
+        this->pageOffset = pageOffset;
+        this->segmentCount = count;
+        this->segmentIndex = 0;
+        this->dataOffset = payloadOffset;
+        return true;
+    }
+}
+
+bool OggPacketStream::nextSegment()
+{
+    while (this->segmentIndex >= this->segmentCount)
+    {
+        if (!this->loadPage())
+        {
+            return false;
+        }
+    }
+
+    const uint8_t length = this->lacing[this->segmentIndex++];
+    this->segmentRemaining = length;
+    // A lacing value below 255 terminates the packet.
+    this->packetEnded = length < 255;
+
+    return true;
+}
+
+bool OggPacketStream::nextPacket()
+{
+    this->skip(std::numeric_limits<size_t>::max());
+
+    this->packetEnded = false;
+    this->segmentRemaining = 0;
+    this->packetPosition = 0;
+    if (!this->nextSegment())
+    {
+        this->packetEnded = true;
+        return false;
+    }
+
+    return true;
+}
+
+size_t OggPacketStream::read(void* dest, size_t length)
+{
+    auto* out = static_cast<uint8_t*>(dest);
+    size_t total = 0;
+
+    while (total < length)
+    {
+        if (this->segmentRemaining == 0)
+        {
+            if (this->packetEnded || !this->nextSegment())
+            {
+                this->packetEnded = true;
+                break;
+            }
+            continue;
+        }
+
+        const size_t wanted = std::min<size_t>(this->segmentRemaining, length - total);
+        if (this->dataOffset + wanted > this->reader.size() && this->dataOffset <= this->reader.size())
+        {
+            // Fetch the rest of the page with one read rather than a read per segment. Payloads
+            // are only fetched when read, so skipped ones stay on disk.
+            this->reader.ensure(this->nextPageOffset);
+        }
+        const size_t count = this->reader.readAt(this->dataOffset, out + total, wanted);
+
+        this->dataOffset += count;
+        this->segmentRemaining -= count;
+        this->packetPosition += count;
+        total += count;
+
+        if (count < wanted)
+        {
+            // Truncated file.
+            this->segmentRemaining = 0;
+            this->packetEnded = true;
+            break;
+        }
+    }
+
+    return total;
+}
+
+size_t OggPacketStream::skip(size_t length)
+{
+    size_t total = 0;
+
+    while (total < length)
+    {
+        if (this->segmentRemaining == 0)
+        {
+            if (this->packetEnded || !this->nextSegment())
+            {
+                this->packetEnded = true;
+                break;
+            }
+            continue;
+        }
+
+        const size_t count = std::min<size_t>(this->segmentRemaining, length - total);
+        this->dataOffset += count;
+        this->segmentRemaining -= count;
+        this->packetPosition += count;
+        total += count;
+    }
+
+    return total;
+}
+
+uint64_t OggPacketStream::tell() const
+{
+    return this->packetPosition;
+}
+
+uint64_t OggPacketStream::getPageOffset() const
+{
+    return this->pageOffset;
+}
+
+bool OggPacketStream::isPageStart() const
+{
+    return this->segmentIndex == 1;
+}
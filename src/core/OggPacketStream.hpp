@@ -0,0 +1,137 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_OGGPACKETSTREAM_HPP
+#define MUSICLIST_OGGPACKETSTREAM_HPP
+
+#include <cinttypes>
+#include <cstddef>
+
+#include "FileReader.hpp"
+
+namespace MusicList
+{
+    /**
+     * @brief Sequential reader for the packets of the first logical stream in an Ogg file.
+     *
+     * Pages are located through their headers and lacing tables, so packets that span
+     * several pages can be read without assembling them in memory first. Page checksums
+     * aren't verified.
+     */
+    class OggPacketStream
+    {
+    private:
+        static constexpr size_t PAGE_HEADER_SIZE = 27;
+
+        FileReader& reader;
+        uint32_t serial = 0;
+        bool started = false;
+
+        // Current page
+        uint64_t pageOffset = 0;
+        uint64_t nextPageOffset = 0;
+        uint8_t lacing[255] = {};
+        uint8_t segmentCount = 0;
+        uint8_t segmentIndex = 0;
+
+        // Current segment
+        uint64_t dataOffset = 0;
+        uint32_t segmentRemaining = 0;
+        bool packetEnded = true;
+        uint64_t packetPosition = 0;
+
+        /**
+         * @brief Loads the next page belonging to the stream.
+         *
+         * @returns false at the end of the file or on a malformed page.
+         */
+        bool loadPage();
+
+        /**
+         * @brief Advances to the next segment of the current packet, loading pages as needed.
+         *
+         * @returns false if the packet has no more data.
+         */
+        bool nextSegment();
+    public:
+        /**
+         * @param reader open reader for an Ogg file
+         */
+        explicit OggPacketStream(FileReader& reader);
+
+        /**
+         * @param reader open reader for an Ogg file
+         * @param offset offset of the page to start reading from. It must begin with a new packet.
+         */
+        OggPacketStream(FileReader& reader, uint64_t offset);
+
+        /**
+         * @brief Skips the rest of the current packet and moves to the start of the next one.
+         *
+         * The first call moves to the first packet in the stream.
+         *
+         * @returns false if there are no more packets.
+         */
+        bool nextPacket();
+
+        /**
+         * @brief Reads from the current packet.
+         *
+         * @returns number of bytes read. Less than `length` at the end of the packet.
+         */
+        size_t read(void* dest, size_t length);
+
+        /**
+         * @brief Skips bytes in the current packet without reading them.
+         *
+         * @returns number of bytes skipped. Less than `length` at the end of the packet.
+         */
+        size_t skip(size_t length);
+
+        /**
+         * @returns number of bytes read or skipped in the current packet.
+         */
+        uint64_t tell() const;
+
+        /**
+         * @returns offset of the page holding the current segment.
+         */
+        uint64_t getPageOffset() const;
+
+        /**
+         * @returns true if the current packet started at the beginning of the current page.
+         */
+        bool isPageStart() const;
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_OGGPACKETSTREAM_HPP
@@ -0,0 +1,117 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <cstdio>
+
+#include "ProgressReporter.hpp"
+
+using namespace MusicList;
+
+ProgressReporter::ProgressReporter(ProgressCallback callback, std::chrono::milliseconds interval) :
+    callback(std::move(callback)), interval(interval)
+{
+    if (this->callback)
+    {
+        this->reporter = std::thread(&ProgressReporter::reportLoop, this);
+    }
+}
+
+ProgressReporter::~ProgressReporter()
+{
+    if (!this->callback)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(this->stateLock);
+        this->stopping = true;
+    }
+    this->stopRequested.notify_one();
+    this->reporter.join();
+
+    this->callback(this->snapshot(true));
+}
+
+void ProgressReporter::reportLoop()
+{
+    std::unique_lock<std::mutex> lock(this->stateLock);
+    while (!this->stopRequested.wait_for(lock, this->interval, [this] { return this->stopping; }))
+    {
+        // The callback may be slow, like a write to a remote terminal, so the lock isn't held.
+        lock.unlock();
+        this->callback(this->snapshot(false));
+        lock.lock();
+    }
+}
+
+ImportProgress ProgressReporter::snapshot(bool finished) const
+{
+    ImportProgress progress;
+    progress.discovered = this->discovered.load(std::memory_order_relaxed);
+    progress.imported = this->imported.load(std::memory_order_relaxed);
+    progress.failed = this->failed.load(std::memory_order_relaxed);
+    progress.elapsed = std::chrono::steady_clock::now() - this->start;
+    progress.finished = finished;
+    return progress;
+}
+
+ProgressCallback ProgressReporter::consoleCallback(std::ostream& out)
+{
+    return [&out](const ImportProgress& progress)
+    {
+        out << "\33[2K\rImported " << progress.imported << " of " << progress.discovered;
+        if (progress.finished)
+        {
+            out << std::endl;
+        }
+        else
+        {
+            out << std::flush;
+        }
+    };
+}
+
+ProgressCallback ProgressReporter::jsonCallback(std::ostream& out)
+{
+    return [&out](const ImportProgress& progress)
+    {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(progress.elapsed);
+
+        char line[160];
+        snprintf(line, sizeof(line),
+                 "{\"discovered\":%u,\"elapsed_ms\":%lld,\"failed\":%u,\"finished\":%s,\"imported\":%u}\n",
+                 progress.discovered, static_cast<long long>(elapsed.count()), progress.failed,
+                 progress.finished ? "true" : "false", progress.imported);
+        out << line << std::flush;
+    };
+}
@@ -0,0 +1,144 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_PROGRESSREPORTER_HPP
+#define MUSICLIST_PROGRESSREPORTER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+namespace MusicList
+{
+    /**
+     * @brief Snapshot of a running search.
+     */
+    struct ImportProgress
+    {
+        uint32_t discovered = 0;
+        // Files read or restored from the cache.
+        uint32_t imported = 0;
+        uint32_t failed = 0;
+        std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::duration::zero();
+        // Set on the last snapshot of a search, once every file has been handled.
+        bool finished = false;
+    };
+
+    /**
+     * Receives progress snapshots. It's called from the reporter's thread, but never from two
+     * threads at once.
+     */
+    using ProgressCallback = std::function<void(const ImportProgress&)>;
+
+    /**
+     * @brief Collects progress in atomic counters and hands snapshots to a callback at a fixed rate.
+     *
+     * Import threads only bump the counters, so they never wait on the callback or on the
+     * terminal it writes to. A background thread passes a snapshot to the callback every
+     * interval while the reporter is alive, and the final snapshot is delivered on the thread
+     * that destroys it.
+     */
+    class ProgressReporter
+    {
+    private:
+        ProgressCallback callback;
+        std::chrono::milliseconds interval;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::atomic<uint32_t> discovered = 0;
+        std::atomic<uint32_t> imported = 0;
+        std::atomic<uint32_t> failed = 0;
+
+        std::mutex stateLock;
+        std::condition_variable stopRequested;
+        bool stopping = false;
+        std::thread reporter;
+
+        /**
+         * @brief Main loop of the reporter thread.
+         */
+        void reportLoop();
+
+        /**
+         * @returns the current value of the counters.
+         */
+        ImportProgress snapshot(bool finished) const;
+    public:
+        static constexpr std::chrono::milliseconds DEFAULT_INTERVAL = std::chrono::milliseconds(100);
+
+        /**
+         * @brief Starts reporting to the provided callback.
+         *
+         * @param callback destination for snapshots. If empty, no thread is started and the
+         * counters are only kept.
+         * @param interval time between snapshots
+         */
+        explicit ProgressReporter(ProgressCallback callback, std::chrono::milliseconds interval = DEFAULT_INTERVAL);
+
+        ProgressReporter(const ProgressReporter&) = delete;
+        ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+        /**
+         * @brief Stops the reporter thread and delivers a final snapshot marked as finished.
+         */
+        ~ProgressReporter();
+
+        void addDiscovered() { this->discovered.fetch_add(1, std::memory_order_relaxed); }
+        void addImported() { this->imported.fetch_add(1, std::memory_order_relaxed); }
+        void addFailed() { this->failed.fetch_add(1, std::memory_order_relaxed); }
+
+        /**
+         * @brief Creates a callback that keeps a single "Imported N of M" line updated on a terminal.
+         *
+         * @param out stream to write to
+         *
+         * @returns the callback.
+         */
+        static ProgressCallback consoleCallback(std::ostream& out);
+
+        /**
+         * @brief Creates a callback that writes every snapshot as a single-line JSON object.
+         *
+         * @param out stream to write to
+         *
+         * @returns the callback.
+         */
+        static ProgressCallback jsonCallback(std::ostream& out);
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_PROGRESSREPORTER_HPP
@@ -0,0 +1,124 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <mutex>
+#include <stdexcept>
+
+#include "StringPool.hpp"
+
+using namespace MusicList;
+
+StringPool::StringPool() : chunks(new std::atomic<string*>[MAX_CHUNKS])
+{
+    for (uint32_t i = 0; i < MAX_CHUNKS; i++)
+    {
+        this->chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    this->intern("");
+}
+
+StringPool::~StringPool()
+{
+    for (uint32_t i = 0; i < MAX_CHUNKS; i++)
+    {
+        delete[] this->chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+StringPool& StringPool::global()
+{
+    static StringPool pool;
+    return pool;
+}
+
+StringPool::Id StringPool::intern(string_view value)
+{
+    {
+        std::shared_lock<std::shared_mutex> guard(this->lock);
+        auto found = this->ids.find(value);
+        if (found != this->ids.end())
+        {
+            return found->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> guard(this->lock);
+
+    // Another thread may have added it while the lock was released.
+    auto found = this->ids.find(value);
+    if (found != this->ids.end())
+    {
+        return found->second;
+    }
+
+    if (this->count == MAX_CHUNKS * CHUNK_SIZE)
+    {
+        throw std::length_error("String pool is full.");
+    }
+
+    const Id id = this->count;
+    string* chunk = this->chunks[id >> CHUNK_BITS].load(std::memory_order_relaxed);
+    if (chunk == nullptr)
+    {
+        chunk = new string[CHUNK_SIZE];
+        this->chunks[id >> CHUNK_BITS].store(chunk, std::memory_order_release);
+    }
+
+    string& stored = chunk[id & (CHUNK_SIZE - 1)];
+    stored.assign(value.data(), value.size());
+    this->ids.emplace(string_view(stored), id);
+    this->count++;
+
+    return id;
+}
+
+bool StringPool::find(string_view value, Id& id) const
+{
+    std::shared_lock<std::shared_mutex> guard(this->lock);
+
+    auto found = this->ids.find(value);
+    if (found == this->ids.end())
+    {
+        return false;
+    }
+
+    id = found->second;
+    return true;
+}
+
+size_t StringPool::size() const
+{
+    std::shared_lock<std::shared_mutex> guard(this->lock);
+    return this->count;
+}
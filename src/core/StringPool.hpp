@@ -0,0 +1,127 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_STRINGPOOL_HPP
+#define MUSICLIST_STRINGPOOL_HPP
+
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using std::string;
+using std::string_view;
+using std::unique_ptr;
+
+namespace MusicList
+{
+    /**
+     * @brief Thread-safe pool of unique strings, each identified by a 32-bit id.
+     *
+     * Strings are stored once and never move or get freed, so references returned by get()
+     * stay valid for the lifetime of the pool. Looking up an id doesn't take a lock.
+     */
+    class StringPool
+    {
+    public:
+        using Id = uint32_t;
+
+        /**
+         * Id of the empty string, which every pool contains.
+         */
+        static constexpr Id EMPTY = 0;
+    private:
+        static constexpr uint32_t CHUNK_BITS = 12;
+        static constexpr uint32_t CHUNK_SIZE = 1U << CHUNK_BITS;
+        static constexpr uint32_t MAX_CHUNKS = 1U << 14;
+
+        // Fixed directory of fixed-size chunks, so growing the pool never moves existing strings.
+        unique_ptr<std::atomic<string*>[]> chunks;
+        uint32_t count = 0;
+
+        std::unordered_map<string_view,Id> ids;
+        mutable std::shared_mutex lock;
+    public:
+        StringPool();
+
+        StringPool(const StringPool&) = delete;
+        StringPool& operator=(const StringPool&) = delete;
+
+        ~StringPool();
+
+        /**
+         * @returns the pool shared by every Track.
+         */
+        static StringPool& global();
+
+        /**
+         * @brief Adds a string to the pool if it isn't already in it.
+         *
+         * @param value string to add
+         *
+         * @returns id of the pooled string.
+         *
+         * @throws std::length_error if the pool is full.
+         */
+        Id intern(string_view value);
+
+        /**
+         * @brief Looks up a string without adding it.
+         *
+         * @param value string to look up
+         * @param id set to the string's id if it's in the pool
+         *
+         * @returns true if the string is in the pool.
+         */
+        bool find(string_view value, Id& id) const;
+
+        /**
+         * @param id id returned by intern()
+         *
+         * @returns the pooled string.
+         */
+        inline const string& get(Id id) const
+        {
+            return this->chunks[id >> CHUNK_BITS].load(std::memory_order_acquire)[id & (CHUNK_SIZE - 1)];
+        }
+
+        /**
+         * @returns number of strings in the pool.
+         */
+        size_t size() const;
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_STRINGPOOL_HPP
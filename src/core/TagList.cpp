@@ -0,0 +1,136 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <algorithm>
+
+#include "TagList.hpp"
+
+using namespace MusicList;
+
+TagList::TagList() = default;
+
+TagList::TagList(std::pmr::memory_resource* resource) : entries(resource) {}
+
+std::pmr::vector<TagList::Entry>::const_iterator TagList::lowerBound(StringPool::Id key) const
+{
+    return std::lower_bound(this->entries.begin(), this->entries.end(), key,
+                            [](const Entry& entry, StringPool::Id id) { return entry.first < id; });
+}
+
+void TagList::set(string_view key, string_view value)
+{
+    StringPool& pool = StringPool::global();
+    this->set(pool.intern(key), pool.intern(value));
+}
+
+void TagList::set(StringPool::Id key, StringPool::Id value)
+{
+    auto position = this->entries.begin() + (this->lowerBound(key) - this->entries.cbegin());
+    if (position != this->entries.end() && position->first == key)
+    {
+        position->second = value;
+    }
+    else
+    {
+        this->entries.emplace(position, key, value);
+    }
+}
+
+StringPool::Id TagList::valueId(string_view key) const
+{
+    StringPool::Id keyId;
+    if (!StringPool::global().find(key, keyId))
+    {
+        return StringPool::EMPTY;
+    }
+
+    return this->valueId(keyId);
+}
+
+StringPool::Id TagList::valueId(StringPool::Id key) const
+{
+    auto position = this->lowerBound(key);
+    if (position == this->entries.end() || position->first != key)
+    {
+        return StringPool::EMPTY;
+    }
+
+    return position->second;
+}
+
+const string& TagList::operator[](string_view key) const
+{
+    return StringPool::global().get(this->valueId(key));
+}
+
+size_t TagList::count(string_view key) const
+{
+    StringPool::Id keyId;
+    if (!StringPool::global().find(key, keyId))
+    {
+        return 0;
+    }
+
+    auto position = this->lowerBound(keyId);
+    return position != this->entries.end() && position->first == keyId ? 1 : 0;
+}
+
+size_t TagList::size() const
+{
+    return this->entries.size();
+}
+
+bool TagList::empty() const
+{
+    return this->entries.empty();
+}
+
+void TagList::clear()
+{
+    this->entries.clear();
+}
+
+void TagList::reserve(size_t count)
+{
+    this->entries.reserve(count);
+}
+
+TagList::const_iterator TagList::begin() const
+{
+    return const_iterator(this->entries.begin());
+}
+
+TagList::const_iterator TagList::end() const
+{
+    return const_iterator(this->entries.end());
+}
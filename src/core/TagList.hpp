@@ -0,0 +1,183 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_TAGLIST_HPP
+#define MUSICLIST_TAGLIST_HPP
+
+#include <cinttypes>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "StringPool.hpp"
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace MusicList
+{
+    /**
+     * @brief Compact set of key/value tags whose strings live in the global StringPool.
+     *
+     * Each tag only costs a pair of 32-bit ids, kept sorted by key id. Iteration order follows
+     * the order in which keys were first pooled rather than the alphabetical order of the keys.
+     *
+     * The ids are stored through a polymorphic allocator so lists can live in an ImportArena.
+     * Copies use the default memory resource; assignment keeps the destination's resource.
+     * A monotonic resource never gets outgrown buffers back, so lists stored in one should be
+     * filled elsewhere and assigned once, or reserved before they're filled.
+     */
+    class TagList
+    {
+    public:
+        using Entry = std::pair<StringPool::Id,StringPool::Id>;
+
+        /**
+         * Iterates over the tags as (key, value) string reference pairs.
+         */
+        class const_iterator
+        {
+        private:
+            std::pmr::vector<Entry>::const_iterator position;
+        public:
+            using value_type = std::pair<const string&,const string&>;
+
+            explicit const_iterator(std::pmr::vector<Entry>::const_iterator position) : position(position) {}
+
+            inline value_type operator*() const
+            {
+                const StringPool& pool = StringPool::global();
+                return value_type(pool.get(this->position->first), pool.get(this->position->second));
+            }
+
+            inline const_iterator& operator++()
+            {
+                ++this->position;
+                return *this;
+            }
+
+            friend inline bool operator== (const const_iterator& lhs, const const_iterator& rhs)
+            {
+                return lhs.position == rhs.position;
+            }
+
+            friend inline bool operator!= (const const_iterator& lhs, const const_iterator& rhs) { return !(lhs == rhs); }
+        };
+    private:
+        std::pmr::vector<Entry> entries;
+
+        /**
+         * @returns the position of the first entry whose key id isn't less than the provided one.
+         */
+        std::pmr::vector<Entry>::const_iterator lowerBound(StringPool::Id key) const;
+    public:
+        TagList();
+
+        /**
+         * @param resource memory resource used to store the tags
+         */
+        explicit TagList(std::pmr::memory_resource* resource);
+
+        /**
+         * @brief Adds a tag, replacing the value of an existing tag with the same key.
+         *
+         * @param key tag key
+         * @param value tag value
+         */
+        void set(string_view key, string_view value);
+
+        /**
+         * @brief Adds a tag using ids from the global StringPool.
+         *
+         * @param key pooled tag key
+         * @param value pooled tag value
+         */
+        void set(StringPool::Id key, StringPool::Id value);
+
+        /**
+         * @param key tag key to look up
+         *
+         * @returns pooled id of the tag's value, or StringPool::EMPTY if there's no such tag.
+         */
+        StringPool::Id valueId(string_view key) const;
+
+        /**
+         * @param key pooled tag key to look up
+         *
+         * @returns pooled id of the tag's value, or StringPool::EMPTY if there's no such tag.
+         */
+        StringPool::Id valueId(StringPool::Id key) const;
+
+        /**
+         * @param key tag key to look up
+         *
+         * @returns the tag's value, or an empty string if there's no such tag.
+         */
+        const string& operator[](string_view key) const;
+
+        /**
+         * @param key tag key to look up
+         *
+         * @returns 1 if the tag exists, otherwise 0.
+         */
+        size_t count(string_view key) const;
+
+        /**
+         * @returns number of tags.
+         */
+        size_t size() const;
+
+        bool empty() const;
+
+        void clear();
+
+        /**
+         * @brief Allocates room for the provided number of tags up front.
+         *
+         * @param count number of tags the list will hold
+         */
+        void reserve(size_t count);
+
+        const_iterator begin() const;
+
+        const_iterator end() const;
+
+        friend inline bool operator== (const TagList& lhs, const TagList& rhs) { return lhs.entries == rhs.entries; }
+
+        friend inline bool operator!= (const TagList& lhs, const TagList& rhs) { return !(lhs == rhs); }
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_TAGLIST_HPP
@@ -31,9 +31,11 @@
   
 */
 
-#include <fstream>
 #include <memory>
+#include <mutex>
 #include <vector>
+#include <cstdio>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
 
@@ -43,11 +45,75 @@
 #include <opus/opusfile.h>
 
 #include "Track.hpp"
+#include "FileReader.hpp"
+#include "JsonWriter.hpp"
+#include "VorbisComment.hpp"
+#include "Mp4Tags.hpp"
+#include "Id3Tags.hpp"
 
 using namespace MusicList;
 
 using std::unique_ptr;
 
+// Lazy loads only lock to publish their result. Tracks share a few striped locks so
+// the Track stays copyable without holding a mutex of its own.
+static constexpr size_t LAZY_TAG_STRIPES = 16;
+static std::mutex lazyTagLocks[LAZY_TAG_STRIPES];
+
+/**
+ * @brief Gets the lock that guards publishing a Track's lazily loaded tags.
+ * @param track The Track to load tags for.
+ * @returns The stripe for the Track's address.
+ */
+static std::mutex &lazyTagLock(const Track *track)
+{
+    // Drop the low bits, which are the same for every aligned Track.
+    const auto address = reinterpret_cast<uintptr_t>(track) / alignof(Track);
+    return lazyTagLocks[address % LAZY_TAG_STRIPES];
+}
+
+namespace
+{
+    /**
+     * Reads the Vorbis comments of a FLAC, Opus or Vorbis file with the in-house parser.
+     */
+    bool readNativeComments(AudioFormat format, FileReader &reader, const VorbisComment::EntryHandler &handler,
+                            VorbisComment::Location &location,
+                            const VorbisComment::PictureHandler &pictureHandler = VorbisComment::PictureHandler())
+    {
+        switch (format)
+        {
+        case AudioFormat::flac:
+            return VorbisComment::readFlac(reader, handler, location, pictureHandler);
+        case AudioFormat::opus:
+            return VorbisComment::readOpus(reader, handler, location, pictureHandler);
+        case AudioFormat::vorbis:
+            return VorbisComment::readVorbis(reader, handler, location, pictureHandler);
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * Reads the Vorbis comments from a location found by readNativeComments().
+     */
+    bool readNativeCommentsAt(AudioFormat format, FileReader &reader, const VorbisComment::Location &location,
+                              const VorbisComment::EntryHandler &handler)
+    {
+        switch (format)
+        {
+        case AudioFormat::flac:
+            return VorbisComment::readFlacAt(reader, location, handler);
+        case AudioFormat::opus:
+            return VorbisComment::readOpusAt(reader, location, handler);
+        case AudioFormat::vorbis:
+            return VorbisComment::readVorbisAt(reader, location, handler);
+        default:
+            return false;
+        }
+    }
+}
+
 // ===============
 // Instance Set Up
 // ===============
@@ -57,6 +123,11 @@ Track::Track()
     this->path = "./";
 }
 
+Track::Track(std::pmr::memory_resource *resource) : tags(resource)
+{
+    this->path = "./";
+}
+
 Track::Track(const fs::path &path)
 {
     try
@@ -71,16 +142,15 @@ Track::Track(const fs::path &path)
 }
 
 void Track::setPath(const fs::path &newPath)
+{
+    this->setPath(newPath, nullptr);
+}
+
+void Track::setPath(const fs::path &newPath, shared_ptr<FileReader> fileReader)
 {
     this->path = newPath;
-    try
-    {
-        this->format = Track::determineFormat(this->path);
-    }
-    catch (const unsupported_format_error &err)
-    {
-        throw err;
-    }
+    this->reader = std::move(fileReader);
+    this->format = Track::determineFormat(this->path, this->reader, this->options.readMode);
 
     switch (this->format)
     {
@@ -90,33 +160,38 @@ void Track::setPath(const fs::path &newPath)
         case AudioFormat::ogg_flac:
             this->isLossless = true;
             break;
+        case AudioFormat::alac:
+            this->isLossless = true;
+            break;
         default:
             this->isLossless = false;
     }
 }
 
-AudioFormat Track::determineOggAudioFormat(const fs::path &path)
+void Track::setReadOptions(const ReadOptions &newOptions)
+{
+    this->options = newOptions;
+}
+
+AudioFormat Track::determineOggAudioFormat(const FileReader &reader)
 {
     // Don't check the extension since this is a private method, and we should already know that it's .ogg
 
-    std::ifstream trackFile = std::ifstream(path, std::ios::binary);
-    if (!trackFile.is_open())
+    // The first page's segment table follows the 27-byte page header. The first packet starts
+    // right after it.
+    const uint8_t* data = reader.data();
+    if (reader.size() < 27)
     {
-        throw std::runtime_error("Failed to open Ogg file to determine audio format.");
+        return AudioFormat::unknown;
     }
 
-    trackFile.seekg(std::ios::beg + 26);
-    char segTableSize = 0;
-    trackFile.read(&segTableSize, 1);
-    std::streampos readPos = trackFile.tellg() + static_cast<int64_t>(segTableSize);
-    trackFile.seekg(std::ios::beg + readPos);
-
-    char buff[9];
-    buff[8] = 0;
-
-    trackFile.read(buff, 8);
+    const size_t packetStart = 27 + data[26];
+    if (reader.size() < packetStart + 8)
+    {
+        return AudioFormat::unknown;
+    }
 
-    trackFile.close();
+    const char* buff = reinterpret_cast<const char*>(data + packetStart);
 
     if (strncmp("OpusHead", buff, 8) == 0)
     {
@@ -136,39 +211,78 @@ AudioFormat Track::determineOggAudioFormat(const fs::path &path)
 
 AudioFormat Track::determineFormat(const fs::path &path)
 {
-    std::ostringstream errStr;
+    shared_ptr<FileReader> reader;
+    return Track::determineFormat(path, reader, ReadMode::buffered);
+}
+
+bool Track::isInspectable(const fs::path &path)
+{
+    const string fileExt = path.extension();
+    return fileExt == ".flac" || fileExt == ".ogg" || fileExt == ".oga" || fileExt == ".opus" || fileExt == ".m4a" ||
+        fileExt == ".mp3";
+}
+
+bool Track::isSupportedName(string_view fileName)
+{
+    // Same rule as fs::path::extension(): a leading dot doesn't start an extension.
+    const size_t dot = fileName.rfind('.');
+    if (dot == string_view::npos || dot == 0)
+    {
+        return false;
+    }
 
+    // Switch on the length first so most names are rejected after a single comparison.
+    // Keep in sync with SUPPORTED_EXTS.
+    const string_view fileExt = fileName.substr(dot);
+    switch (fileExt.size())
+    {
+        case 4:
+            return fileExt == ".ogg" || fileExt == ".oga" || fileExt == ".mp3" || fileExt == ".m4a";
+        case 5:
+            return fileExt == ".flac" || fileExt == ".opus";
+        default:
+            return false;
+    }
+}
+
+AudioFormat Track::determineFormat(const fs::path &path, shared_ptr<FileReader> &reader, ReadMode mode)
+{
     string fileExt = path.extension();
 
     AudioFormat format = AudioFormat::unknown;
 
-    unique_ptr<char> buff = std::make_unique<char>();
+    if (Track::isInspectable(path) && reader == nullptr)
+    {
+        reader = std::make_shared<FileReader>(path, mode);
+    }
 
     if (fileExt == ".flac")
     {
-        std::ifstream trackFile = std::ifstream(path, std::ios::binary);
-
-        if (!trackFile.is_open())
-        {
-            errStr << "Failed to open file to determine audio format: " << path.string() << ".";
-            throw std::runtime_error(errStr.str());
-        }
-
         // Check for flac audio data.
-        buff.reset(new char[5]);
-        buff.get()[4] = 0;
-
-        trackFile.readsome(buff.get(), 4);
-        if (strncmp(buff.get(), "fLaC", 4) == 0)
+        if (reader->size() >= 4 && strncmp(reinterpret_cast<const char*>(reader->data()), "fLaC", 4) == 0)
         {
             format = AudioFormat::flac;
         }
-
-        trackFile.close();
     }
     else if (fileExt == ".ogg" || fileExt == ".oga" || fileExt == ".opus")
     {
-        format = Track::determineOggAudioFormat(path);
+        format = Track::determineOggAudioFormat(*reader);
+    }
+    else if (fileExt == ".m4a")
+    {
+        // AAC until the sample description shows otherwise. Telling ALAC apart means walking
+        // moov, which is left to readMetadata().
+        if (Mp4Tags::isMp4(*reader))
+        {
+            format = AudioFormat::aac;
+        }
+    }
+    else if (fileExt == ".mp3")
+    {
+        if (Id3Tags::isMp3(*reader))
+        {
+            format = AudioFormat::mp3;
+        }
     }
 
     return format;
@@ -180,15 +294,38 @@ AudioFormat Track::determineFormat(const fs::path &path)
 
 void Track::readMetadata()
 {
+    // Take over the reader opened during format detection so the file is closed afterwards.
+    shared_ptr<FileReader> fileReader = std::move(this->reader);
+
+    // Tags are collected on the heap and copied into the Track's memory resource once they're
+    // all known. A monotonic resource would keep every buffer the list outgrew.
+    struct ParseTarget
+    {
+        TagList list;
+        Track& track;
+
+        explicit ParseTarget(Track& track) : track(track) { this->track.parsedTags = &this->list; }
+        ~ParseTarget() { this->track.parsedTags = nullptr; }
+    };
+    ParseTarget target = ParseTarget(*this);
+
     switch (this->format)
     {
     case AudioFormat::flac:
-        this->readFlacMetadata();
+        if (fileReader == nullptr)
+        {
+            fileReader = std::make_shared<FileReader>(this->path, this->options.readMode);
+        }
+        this->readComments(*fileReader);
         break;
     case AudioFormat::opus:
         try
         {
-            this->readOpusMetadata();
+            if (fileReader == nullptr)
+            {
+                fileReader = std::make_shared<FileReader>(this->path, this->options.readMode);
+            }
+            this->readComments(*fileReader);
         }
         catch(const std::exception& e)
         {
@@ -196,6 +333,28 @@ void Track::readMetadata()
             std::cerr << "File: " << this->path.string() << "\n";
         }
         break;
+    case AudioFormat::vorbis:
+        if (fileReader == nullptr)
+        {
+            fileReader = std::make_shared<FileReader>(this->path, this->options.readMode);
+        }
+        this->readComments(*fileReader);
+        break;
+    case AudioFormat::aac:
+    case AudioFormat::alac:
+        if (fileReader == nullptr)
+        {
+            fileReader = std::make_shared<FileReader>(this->path, this->options.readMode);
+        }
+        this->readMp4Metadata(*fileReader);
+        break;
+    case AudioFormat::mp3:
+        if (fileReader == nullptr)
+        {
+            fileReader = std::make_shared<FileReader>(this->path, this->options.readMode);
+        }
+        this->readMp3Metadata(*fileReader);
+        break;
     default:
         throw unsupported_format_error(this->path);
     }
@@ -203,76 +362,375 @@ void Track::readMetadata()
 
 void Track::addMetadataPair(const string &key, const string &value)
 {
-    string tmpKey = key;
-    if (tmpKey == "ARTIST")
-    {
-        tmpKey = tmpKey.append(std::to_string(this->artistCount));
-        this->artistCount++;
-    }
-    else if (tmpKey == "TRACKNUMBER")
+    if (key == "TRACKNUMBER")
     {
         this->trackNum = strtoul(value.c_str(), nullptr, 10);
     }
-    else if (tmpKey == "TOTALTRACKS")
+    else if (key == "TOTALTRACKS")
     {
         this->totalTracks = strtoul(value.c_str(), nullptr, 10);
     }
-    else if (tmpKey == "DISCNUMBER")
+    else if (key == "DISCNUMBER")
     {
         this->discNum = strtoul(value.c_str(), nullptr, 10);
     }
-    else if (tmpKey == "TOTALDISCS")
+    else if (key == "TOTALDISCS")
     {
         this->totalDiscs = strtoul(value.c_str(), nullptr, 10);
     }
-    else if (tmpKey == "MUSICBRAINZ_TRACKID")
+    else if (key == "MUSICBRAINZ_TRACKID")
+    {
+        this->mbid = StringPool::global().intern(value);
+    }
+    else
+    {
+        Track::addTag(this->tagTarget(), this->artistCount, key, value);
+    }
+}
+
+void Track::addTag(TagList &tagList, uint_fast8_t &artistCount, const string &key, const string &value)
+{
+    if (key == "ARTIST")
     {
-        this->mbid = value;
+        tagList.set(key + std::to_string(artistCount), value);
+        artistCount++;
     }
-    else if (tmpKey != "METADATA_BLOCK_PICTURE")
+    else if (key != "METADATA_BLOCK_PICTURE")
     {
         // Skip the picture. There's no need to store it in memory
-        this->tags[tmpKey] = value;
+        tagList.set(key, value);
     }
 }
 
-void Track::readFlacMetadata()
+bool Track::isFieldKey(string_view key)
 {
-    FLAC__StreamMetadata *streamMetadata = FLAC__metadata_object_new(FLAC__METADATA_TYPE_VORBIS_COMMENT);
+    return key == "TRACKNUMBER" || key == "TOTALTRACKS" || key == "DISCNUMBER" || key == "TOTALDISCS" ||
+        key == "MUSICBRAINZ_TRACKID";
+}
 
-    bool success = static_cast<bool>(FLAC__metadata_get_tags(this->path.c_str(), &streamMetadata));
+void Track::addSummaryEntry(const char *entry, size_t length)
+{
+    const char* splitLoc = static_cast<const char*>(memchr(entry, '=', length));
+    if (splitLoc == nullptr)
+    {
+        return;
+    }
 
-    if (!success)
+    // Keep in sync with the tags read by readComments(), MetadataCache::restore() and writeJSON().
+    const string_view key = string_view(entry, static_cast<size_t>(splitLoc - entry));
+    if (Track::isFieldKey(key) || key == "ALBUMARTIST" || key == "ALBUM" || key == "TITLE" ||
+        key == "MUSICBRAINZ_ALBUMID")
+    {
+        this->addMetadataPair(string(key), string(splitLoc + 1, entry + length));
+    }
+}
+
+void Track::clearMetadata()
+{
+    this->tags.clear();
+    if (this->parsedTags != nullptr)
+    {
+        this->parsedTags->clear();
+    }
+    this->artistCount = 0;
+    this->trackNum = 0;
+    this->totalTracks = 0;
+    this->discNum = 0;
+    this->totalDiscs = 0;
+    this->mbid = StringPool::EMPTY;
+    this->commentLocation = VorbisComment::Location();
+    this->pictures.clear();
+}
+
+void Track::readComments(FileReader &reader)
+{
+    // There's no codec library for Vorbis, so it's always read natively.
+    const bool hasLibrary = this->format != AudioFormat::vorbis;
+    const bool lazy = this->options.lazyTags && (this->options.tagReader == TagReader::native || !hasLibrary);
+
+    bool parsed = false;
+    if (this->options.tagReader != TagReader::library || !hasLibrary)
+    {
+        VorbisComment::EntryHandler handler;
+        if (lazy)
+        {
+            handler = [this](const char *entry, size_t length) { this->addSummaryEntry(entry, length); };
+        }
+        else
+        {
+            handler = [this](const char *entry, size_t length) { this->addCommentEntry(entry, length); };
+        }
+
+        VorbisComment::PictureHandler pictureHandler;
+        if (this->options.recordPictures)
+        {
+            pictureHandler = [this](const VorbisComment::Picture &picture) { this->pictures.push_back(picture); };
+        }
+
+        parsed = readNativeComments(this->format, reader, handler, this->commentLocation, pictureHandler);
+
+        if (!parsed)
+        {
+            // Drop anything read before the parser gave up and let the library have a go.
+            this->clearMetadata();
+        }
+    }
+
+    // The library always reads every tag.
+    this->tagsLoaded = !(lazy && parsed);
+
+    if (!parsed && !hasLibrary)
+    {
+        throw std::runtime_error("Failed to read metadata from Vorbis file.");
+    }
+    else if (!parsed)
+    {
+        this->readLibraryComments(reader);
+    }
+    else if (this->options.tagReader == TagReader::validate && hasLibrary)
+    {
+        this->validateComments(reader);
+    }
+
+    this->indexTags();
+}
+
+TagList& Track::tagTarget()
+{
+    return this->parsedTags != nullptr ? *this->parsedTags : this->tags;
+}
+
+const TagList& Track::tagTarget() const
+{
+    return this->parsedTags != nullptr ? *this->parsedTags : this->tags;
+}
+
+void Track::indexTags()
+{
+    if (this->parsedTags != nullptr)
+    {
+        // The Track's list is empty here, so this allocates exactly what's needed.
+        this->tags = *this->parsedTags;
+        this->parsedTags->clear();
+    }
+
+    this->artist = this->tags.valueId("ALBUMARTIST");
+    this->album = this->tags.valueId("ALBUM");
+    this->title = this->tags.valueId("TITLE");
+    this->albumMbid = this->tags.valueId("MUSICBRAINZ_ALBUMID");
+}
+
+void Track::loadTags() const
+{
+    // The file is read without a lock. Threads racing on the same Track may both read it,
+    // but only the first one publishes.
+    // Read into a separate list so a failure leaves the summary tags untouched.
+    TagList loaded;
+    uint_fast8_t loadedArtists = 0;
+    const auto handler = [&loaded, &loadedArtists](const char *entry, size_t length)
+    {
+        const char* splitLoc = static_cast<const char*>(memchr(entry, '=', length));
+        const string key = splitLoc != nullptr ? string(entry, splitLoc) : string(entry, length);
+        if (!Track::isFieldKey(key))
+        {
+            const string value = splitLoc != nullptr ? string(splitLoc + 1, entry + length) : string();
+            Track::addTag(loaded, loadedArtists, key, value);
+        }
+    };
+
+    bool parsed = false;
+    try
+    {
+        FileReader fileReader = FileReader(this->path, this->options.readMode);
+        if (this->commentLocation.offset != 0)
+        {
+            parsed = readNativeCommentsAt(this->format, fileReader, this->commentLocation, handler);
+        }
+        else
+        {
+            // Restored from the cache, which doesn't keep the location.
+            VorbisComment::Location location;
+            parsed = readNativeComments(this->format, fileReader, handler, location);
+        }
+
+        if (!parsed)
+        {
+            std::cerr << "Failed to load tags. File: " << this->path.string() << '\n';
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << '\n';
+    }
+
+    std::lock_guard<std::mutex> guard(lazyTagLock(this));
+    if (this->tagsLoaded)
+    {
+        return;
+    }
+    if (parsed)
+    {
+        // Assigned once so only the complete list is allocated in the Track's memory resource.
+        this->tags = loaded;
+        this->artistCount = loadedArtists;
+    }
+    // Failures aren't retried. Callers get the summary tags instead.
+    this->tagsLoaded = true;
+}
+
+void Track::readLibraryComments(FileReader &reader)
+{
+    if (this->format == AudioFormat::flac)
+    {
+        this->readFlacMetadata(reader);
+    }
+    else
+    {
+        this->readOpusMetadata(reader);
+    }
+}
+
+void Track::validateComments(FileReader &reader) const
+{
+    Track reference;
+    reference.path = this->path;
+    reference.format = this->format;
+
+    try
+    {
+        reference.readLibraryComments(reader);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Tag validation skipped: " << e.what() << " File: " << this->path.string() << '\n';
+        return;
+    }
+
+    if (reference.tags != this->tagTarget() || reference.mbid != this->mbid ||
+        reference.trackNum != this->trackNum || reference.totalTracks != this->totalTracks ||
+        reference.discNum != this->discNum || reference.totalDiscs != this->totalDiscs)
+    {
+        std::cerr << "Native tag reader disagrees with the codec library. File: " << this->path.string() << '\n';
+    }
+}
+
+void Track::addCommentEntry(const char *entry, size_t length)
+{
+    // The libraries hand pictures over along with everything else. Drop them before they're copied.
+    if (VorbisComment::isPictureEntry(entry, length))
+    {
+        return;
+    }
+
+    const char* splitLoc = static_cast<const char*>(memchr(entry, '=', length));
+    if (splitLoc == nullptr)
+    {
+        this->addMetadataPair(string(entry, length), "");
+        return;
+    }
+
+    const string key = string(entry, splitLoc);
+    const string value = string(splitLoc + 1, entry + length);
+
+    this->addMetadataPair(key, value);
+}
+
+// Adapters that let libFLAC and libopusfile read through the shared FileReader.
+namespace
+{
+    size_t flacRead(void *ptr, size_t size, size_t nmemb, FLAC__IOHandle handle)
+    {
+        if (size == 0)
+        {
+            return 0;
+        }
+        return static_cast<FileReader*>(handle)->read(ptr, size * nmemb) / size;
+    }
+
+    int flacSeek(FLAC__IOHandle handle, FLAC__int64 offset, int whence)
+    {
+        return static_cast<FileReader*>(handle)->seek(offset, whence) ? 0 : -1;
+    }
+
+    FLAC__int64 flacTell(FLAC__IOHandle handle)
+    {
+        return static_cast<FLAC__int64>(static_cast<FileReader*>(handle)->tell());
+    }
+
+    int flacEof(FLAC__IOHandle handle)
+    {
+        const auto* reader = static_cast<FileReader*>(handle);
+        return reader->tell() >= reader->getFileSize();
+    }
+
+    int opusRead(void *stream, unsigned char *ptr, int nbytes)
+    {
+        return static_cast<int>(static_cast<FileReader*>(stream)->read(ptr, static_cast<size_t>(nbytes)));
+    }
+}
+
+void Track::readFlacMetadata(FileReader &reader)
+{
+    FLAC__IOCallbacks callbacks = {flacRead, nullptr, flacSeek, flacTell, flacEof, nullptr};
+
+    FLAC__Metadata_Chain *chain = FLAC__metadata_chain_new();
+    if (chain == nullptr)
     {
-        FLAC__metadata_object_delete(streamMetadata);
         throw std::runtime_error("Failed to read metadata from FLAC file.");
     }
 
-    FLAC__StreamMetadata_VorbisComment vorbisComment = streamMetadata->data.vorbis_comment;
-    for (uint32_t i = 0; i < vorbisComment.num_comments; i++)
+    reader.seek(0, SEEK_SET);
+    if (!FLAC__metadata_chain_read_with_callbacks(chain, &reader, callbacks))
     {
-        string fullEntry = reinterpret_cast<char *>(vorbisComment.comments[i].entry);
-        auto splitLoc = fullEntry.find('=');
+        FLAC__metadata_chain_delete(chain);
+        throw std::runtime_error("Failed to read metadata from FLAC file.");
+    }
 
-        string key = fullEntry.substr(0, splitLoc);
-        string value = fullEntry.substr(splitLoc + 1);
+    FLAC__Metadata_Iterator *iterator = FLAC__metadata_iterator_new();
+    bool foundComments = false;
+    if (iterator != nullptr)
+    {
+        FLAC__metadata_iterator_init(iterator, chain);
+        do
+        {
+            if (FLAC__metadata_iterator_get_block_type(iterator) != FLAC__METADATA_TYPE_VORBIS_COMMENT)
+            {
+                continue;
+            }
+
+            const FLAC__StreamMetadata *block = FLAC__metadata_iterator_get_block(iterator);
+            const FLAC__StreamMetadata_VorbisComment &vorbisComment = block->data.vorbis_comment;
+            for (uint32_t i = 0; i < vorbisComment.num_comments; i++)
+            {
+                const FLAC__StreamMetadata_VorbisComment_Entry &entry = vorbisComment.comments[i];
+                this->addCommentEntry(reinterpret_cast<const char *>(entry.entry), entry.length);
+            }
+            foundComments = true;
+            break;
+        } while (FLAC__metadata_iterator_next(iterator));
 
-        this->addMetadataPair(key, value);
+        FLAC__metadata_iterator_delete(iterator);
     }
 
-    FLAC__metadata_object_delete(streamMetadata);
+    FLAC__metadata_chain_delete(chain);
 
-    this->artist = this->tags["ALBUMARTIST"];
-    this->album = this->tags["ALBUM"];
-    this->title = this->tags["TITLE"];
+    if (!foundComments)
+    {
+        throw std::runtime_error("Failed to read metadata from FLAC file.");
+    }
 }
 
-void Track::readOpusMetadata()
+void Track::readOpusMetadata(FileReader &reader)
 {
+    // Without a seek callback libopusfile treats the stream as unseekable, so it only reads
+    // the headers instead of scanning the whole file for links.
+    OpusFileCallbacks callbacks = {opusRead, nullptr, nullptr, nullptr};
+
     int errCode;
-    OggOpusFile* opusFile = op_open_file(this->path.c_str(), &errCode);
+    reader.seek(0, SEEK_SET);
+    OggOpusFile* opusFile = op_open_callbacks(&reader, &callbacks, nullptr, 0, &errCode);
 
-    if (errCode == OP_EFAULT)
+    if (opusFile == nullptr)
     {
         throw std::runtime_error("Failed to open Opus File.");
     }
@@ -281,71 +739,124 @@ void Track::readOpusMetadata()
 
     for (uint32_t i = 0; i < static_cast<uint32_t>(opTags->comments); i++)
     {
-        string fullEntry = opTags->user_comments[i];
-        auto splitLoc = fullEntry.find('=');
+        this->addCommentEntry(opTags->user_comments[i], static_cast<size_t>(opTags->comment_lengths[i]));
+    }
 
-        string key = fullEntry.substr(0, splitLoc);
-        string value = fullEntry.substr(splitLoc + 1);
+    op_free(opusFile);
+}
 
+void Track::readMp4Metadata(FileReader &reader)
+{
+    // The ilst is small and read in one go, so MP4 tags are never loaded lazily.
+    Mp4Tags::Codec codec;
+    const bool parsed = Mp4Tags::read(reader, [this](const string &key, const string &value)
+    {
         this->addMetadataPair(key, value);
+    }, codec);
+
+    if (!parsed)
+    {
+        this->clearMetadata();
+        throw std::runtime_error("Failed to read metadata from MP4 file.");
     }
 
-    //opus_tags_clear(opTags);
-    op_free(opusFile);
+    this->format = codec == Mp4Tags::Codec::alac ? AudioFormat::alac : AudioFormat::aac;
+    this->isLossless = this->format == AudioFormat::alac;
+    this->tagsLoaded = true;
+    this->indexTags();
+}
 
-    this->artist = this->tags["ALBUMARTIST"];
-    this->album = this->tags["ALBUM"];
-    this->title = this->tags["TITLE"];
+void Track::readMp3Metadata(FileReader &reader)
+{
+    // Like MP4 tags, ID3 tags are small enough to always be read in full.
+    const bool parsed = Id3Tags::read(reader, [this](const string &key, const string &value)
+    {
+        this->addMetadataPair(key, value);
+    });
+
+    if (!parsed)
+    {
+        this->clearMetadata();
+        throw std::runtime_error("Failed to read metadata from MP3 file.");
+    }
+
+    this->tagsLoaded = true;
+    this->indexTags();
 }
 
 // ==========
 // Operations
 // ==========
 
-Json::Value Track::toJSON() const
+const char* Track::formatName(AudioFormat format)
 {
-    Json::Value root;
-
-    root["track_num"] = this->trackNum;
-    root["total_tracks"] = this->totalTracks;
-    root["disc_num"] = this->discNum;
-    root["total_discs"] = this->totalDiscs;
-    root["title"] = this->title;
-    root["artist"] = this->artist;
-    root["album"] = this->album;
-    root["is_lossless"] = this->isLossless;
-    root["musicbrainz_id"] = this->mbid;
-
-    string formatStr;
-    switch (this->format)
+    switch (format)
     {
     case AudioFormat::aac:
-        formatStr = "AAC";
-        break;
+        return "AAC";
+    case AudioFormat::alac:
+        return "ALAC";
     case AudioFormat::flac:
-        formatStr = "FLAC";
-        break;
+        return "FLAC";
     case AudioFormat::mp3:
-        formatStr = "MP3";
-        break;
+        return "MP3";
     case AudioFormat::ogg_flac:
-        formatStr = "FLAC";
-        break;
+        return "FLAC";
     case AudioFormat::opus:
-        formatStr = "Opus";
-        break;
+        return "Opus";
     case AudioFormat::vorbis:
-        formatStr = "Vorbis";
-        break;
+        return "Vorbis";
     default:
-        formatStr = "unkown";
+        return "unkown";
     }
+}
 
-    root["format"] = formatStr;
+Json::Value Track::toJSON() const
+{
+    Json::Value root;
+
+    root["track_num"] = this->trackNum;
+    root["total_tracks"] = this->totalTracks;
+    root["disc_num"] = this->discNum;
+    root["total_discs"] = this->totalDiscs;
+    root["title"] = this->getTitle();
+    root["artist"] = this->getArtist();
+    root["album"] = this->getAlbum();
+    root["is_lossless"] = this->isLossless;
+    root["musicbrainz_id"] = this->getMBID();
+
+    root["format"] = Track::formatName(this->format);
 
     return root;
 }
 
+void Track::writeJSON(JsonWriter &writer) const
+{
+    // Keys in the sorted order toJSON() output is written in.
+    writer.beginObject();
+    writer.writeKey("album");
+    writer.writeString(this->getAlbum());
+    writer.writeKey("artist");
+    writer.writeString(this->getArtist());
+    writer.writeKey("disc_num");
+    writer.writeInt(this->discNum);
+    writer.writeKey("format");
+    writer.writeString(Track::formatName(this->format));
+    writer.writeKey("is_lossless");
+    writer.writeBool(this->isLossless);
+    writer.writeKey("musicbrainz_id");
+    writer.writeString(this->getMBID());
+    writer.writeKey("title");
+    writer.writeString(this->getTitle());
+    writer.writeKey("total_discs");
+    writer.writeInt(this->totalDiscs);
+    writer.writeKey("total_tracks");
+    writer.writeInt(this->totalTracks);
+    writer.writeKey("track_num");
+    writer.writeInt(this->trackNum);
+    writer.endObject();
+}
+
 inline uint32_t Track::toUInt32(const char *bytes)
 {
     return (bytes[3] << 24) | (bytes[2] << 16) | (bytes[1] << 8) | bytes[0];
@@ -355,24 +866,43 @@ inline uint32_t Track::toUInt32(const char *bytes)
 // Getters
 // =======
 
-const map<string, string> &Track::getTags() const
+const TagList &Track::getTags() const
 {
+    if (!this->tagsLoaded)
+    {
+        this->loadTags();
+    }
     return this->tags;
 }
 
+const string &Track::getTag(string_view key) const
+{
+    return this->getTags()[key];
+}
+
+bool Track::hasAllTags() const
+{
+    return this->tagsLoaded;
+}
+
+const vector<VorbisComment::Picture> &Track::getPictures() const
+{
+    return this->pictures;
+}
+
 const string &Track::getTitle() const
 {
-    return this->title;
+    return StringPool::global().get(this->title);
 }
 
 const string &Track::getArtist() const
 {
-    return this->artist;
+    return StringPool::global().get(this->artist);
 }
 
 const string &Track::getAlbum() const
 {
-    return this->album;
+    return StringPool::global().get(this->album);
 }
 
 const uint_fast8_t &Track::getTrackNum() const
@@ -400,6 +930,11 @@ const AudioFormat &Track::getAudioFormat() const
     return this->format;
 }
 
+const bool &Track::getIsLossless() const
+{
+    return this->isLossless;
+}
+
 const fs::path &Track::getPath() const
 {
     return this->path;
@@ -407,5 +942,15 @@ const fs::path &Track::getPath() const
 
 const string &Track::getMBID() const
 {
-    return this->mbid;
+    return StringPool::global().get(this->mbid);
+}
+
+const string &Track::getAlbumMBID() const
+{
+    return StringPool::global().get(this->albumMbid);
+}
+
+StringPool::Id Track::getAlbumMBIDId() const
+{
+    return this->albumMbid;
 }
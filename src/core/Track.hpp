@@ -34,17 +34,26 @@
 #ifndef MUSICLIST_TRACK_HPP
 #define MUSICLIST_TRACK_HPP
 
+#include <atomic>
 #include <filesystem>
 #include <string>
 #include <map>
+#include <memory>
+#include <vector>
 #include <cinttypes>
 
 #include <json/value.h>
 
+#include "FileReader.hpp"
+#include "TagList.hpp"
+#include "VorbisComment.hpp"
+
 namespace fs = std::filesystem;
 
 using std::string;
 using std::map;
+using std::shared_ptr;
+using std::vector;
 
 namespace MusicList
 {
@@ -56,16 +65,16 @@ namespace MusicList
     struct unsupported_format_error : public std::exception
     {
         fs::path errPath;
+        string message;
         unsupported_format_error(const fs::path& filePath)
         {
             this->errPath = filePath;
+            this->message = "Unsupported audio format. File: ";
+            this->message.append(errPath.string());
         }
         const char* what() const throw()
         {
-            string outStr = "Unsupported audio format. File: ";
-            outStr.append(errPath.string());
-            const char* cStr = outStr.c_str();
-            return cStr;
+            return this->message.c_str();
         }
     };
 
@@ -80,16 +89,76 @@ namespace MusicList
         opus,
         aac,
         vorbis,
-        mp3
+        mp3,
+        alac
+    };
+
+    /**
+     * Ways of reading Vorbis comments from FLAC and Opus files. Vorbis files are always read by
+     * the in-house parser.
+     */
+    enum class TagReader : uint_fast8_t
+    {
+        native = 0, // In-house parser, falling back to libFLAC/libopusfile if it fails.
+        library,    // libFLAC/libopusfile only.
+        validate    // In-house parser, checked against libFLAC/libopusfile.
+    };
+
+    /**
+     * Options controlling how a Track reads its file.
+     */
+    struct ReadOptions
+    {
+        TagReader tagReader = TagReader::native;
+        ReadMode readMode = ReadMode::buffered;
+        // Only read the tags needed to group and export the track up front. The rest are read
+        // from the file on the first call to Track::getTags(). Requires TagReader::native, except
+        // for Vorbis, which is always read natively.
+        bool lazyTags = false;
+        // Record where embedded pictures are, see Track::getPictures(). Pictures are skipped either
+        // way. Only FLAC, Opus and Vorbis files read by the in-house parser have their pictures recorded.
+        bool recordPictures = false;
     };
 
+    class MetadataCache;
+    class JsonWriter;
+
     class Track 
     {
+        friend class MetadataCache;
     private:
         // Data info
         fs::path path;
         AudioFormat format = AudioFormat();
 
+        /**
+         * File opened by setPath() for format detection. It's reused by readMetadata() so each
+         * file is only opened once, and released once the metadata has been read.
+         */
+        shared_ptr<FileReader> reader;
+        ReadOptions options;
+
+        // Where the native reader found the comments, so lazily loaded tags don't have to be searched for again.
+        VorbisComment::Location commentLocation;
+        // Only filled with ReadOptions::recordPictures.
+        vector<VorbisComment::Picture> pictures;
+        /**
+         * Flag that's safe to read while another thread sets it, without making Track non-copyable.
+         */
+        struct LoadedFlag
+        {
+            std::atomic<bool> value;
+
+            LoadedFlag(bool loaded) : value(loaded) {}
+            LoadedFlag(const LoadedFlag& other) : value(other.value.load()) {}
+            LoadedFlag& operator=(const LoadedFlag& other) { this->value = other.value.load(); return *this; }
+            LoadedFlag& operator=(bool loaded) { this->value = loaded; return *this; }
+            operator bool() const { return this->value; }
+        };
+
+        // False while only the summary tags have been read.
+        mutable LoadedFlag tagsLoaded = true;
+
         // ==================
         // Metadata Retrieval
         // ==================
@@ -97,11 +166,34 @@ namespace MusicList
         /**
          * Determines which audio format is held within an Ogg container.
          * 
+         * @param reader open reader positioned anywhere in the track to check
+         * 
+         * @returns AudioFormat corresponding to the detected file type.
+         */
+        static AudioFormat determineOggAudioFormat(const FileReader& reader);
+
+        /**
+         * @brief Determines the AudioFormat of the file at the provided path.
+         * 
+         * The file is only opened if its extension is one that can be identified. The reader
+         * used to identify it is handed back so the caller can keep reading from it.
+         * 
          * @param path fs path to the track to check
+         * @param reader reader used to inspect the file. If nullptr, it's set to a newly opened
+         * reader when one is needed.
+         * @param mode how the reader accesses the file
          * 
          * @returns AudioFormat corresponding to the detected file type.
          */
-        static AudioFormat determineOggAudioFormat(const fs::path& path);
+        static AudioFormat determineFormat(const fs::path& path, shared_ptr<FileReader>& reader, ReadMode mode);
+
+        /**
+         * @brief Splits a raw "KEY=value" comment entry and adds it to the object.
+         * 
+         * @param entry comment entry bytes
+         * @param length length of the entry in bytes
+         */
+        void addCommentEntry(const char* entry, size_t length);
 
         /**
          * @brief Adds the metadata pair to the object.
@@ -113,15 +205,116 @@ namespace MusicList
          */
         void addMetadataPair(const string& key, const string& value);
 
+        /**
+         * @brief Adds an entry to the summary tags read in lazy mode.
+         * 
+         * Only the fields and tags needed to group and export the track are kept. The key is
+         * checked before anything is copied, so other entries cost next to nothing.
+         * 
+         * @param entry comment entry bytes
+         * @param length length of the entry in bytes
+         */
+        void addSummaryEntry(const char* entry, size_t length);
+
+        /**
+         * @brief Adds a tag that isn't held in one of the dedicated fields to a tag list.
+         * 
+         * @param tagList destination list
+         * @param artistCount number of ARTIST tags added so far. Used to number them.
+         * @param key metadata entry key
+         * @param value metadata entry value
+         */
+        static void addTag(TagList& tagList, uint_fast8_t& artistCount, const string& key, const string& value);
+
+        /**
+         * @param key metadata entry key
+         * 
+         * @returns true if the entry is stored in a dedicated field instead of the tag list.
+         */
+        static bool isFieldKey(string_view key);
+
+        /**
+         * @brief Reads the complete tag list of a Track whose tags were loaded lazily.
+         * 
+         * Errors are reported to stderr, leaving the summary tags in place.
+         */
+        void loadTags() const;
+
+        /**
+         * @brief Resets all metadata read from the file.
+         */
+        void clearMetadata();
+
+        /**
+         * @brief Reads the Vorbis comments of a FLAC, Opus or Vorbis track using the configured TagReader.
+         * 
+         * Vorbis has no codec library fallback, so it's always read natively and never validated.
+         * 
+         * @param reader open reader for the track
+         */
+        void readComments(FileReader& reader);
+
+        /**
+         * @brief Reads the Vorbis comments through libFLAC or libopusfile.
+         * 
+         * @param reader open reader for the track
+         */
+        void readLibraryComments(FileReader& reader);
+
+        /**
+         * @brief Compares the natively parsed comments against the ones read by the codec library.
+         * 
+         * Differences are reported to stderr.
+         * 
+         * @param reader open reader for the track
+         */
+        void validateComments(FileReader& reader) const;
+
         /**
          * @brief Handles parsing FLAC metadata into memory.
+         * 
+         * @param reader open reader for the track
          */
-        void readFlacMetadata();
+        void readFlacMetadata(FileReader& reader);
 
         /**
          * @brief Handles parsing Opus metadata into memory.
+         * 
+         * @param reader open reader for the track
+         */
+        void readOpusMetadata(FileReader& reader);
+
+        /**
+         * @brief Handles parsing the iTunes tags of an MP4 file into memory.
+         * 
+         * The format is switched to AudioFormat::alac if the file holds Apple Lossless audio.
+         * 
+         * @param reader open reader for the track
+         */
+        void readMp4Metadata(FileReader& reader);
+
+        /**
+         * @brief Handles parsing the ID3 tags of an MP3 file into memory.
+         * 
+         * @param reader open reader for the track
+         */
+        void readMp3Metadata(FileReader& reader);
+
+        /**
+         * @returns the list parsed tags are added to. The heap-backed list set up by readMetadata()
+         * while a file is read, otherwise the Track's own tags.
+         */
+        TagList& tagTarget();
+
+        const TagList& tagTarget() const;
+
+        /**
+         * @brief Stores the parsed tags and looks up the ones held as dedicated fields.
+         *
+         * Tags collected while reading a file are copied into the Track's memory resource here,
+         * in a single allocation.
          */
-        void readOpusMetadata();
+        void indexTags();
     protected:
         // Data info
         bool isLossless = false;
@@ -131,12 +324,19 @@ namespace MusicList
         uint_fast8_t totalTracks = 0;
         uint_fast8_t discNum = 0;
         uint_fast8_t totalDiscs = 0;
-        uint_fast8_t artistCount = 0;
-        string title = "";
-        string artist = "";
-        string album = "";
-        string mbid = "";
-        map<string,string> tags;
+        mutable uint_fast8_t artistCount = 0;
+
+        // Strings are held as ids into the global StringPool, so repeated values are only
+        // stored once across the whole library.
+        StringPool::Id title = StringPool::EMPTY;
+        StringPool::Id artist = StringPool::EMPTY;
+        StringPool::Id album = StringPool::EMPTY;
+        StringPool::Id mbid = StringPool::EMPTY;
+        StringPool::Id albumMbid = StringPool::EMPTY;
+        // Completed on first access when the tags are loaded lazily.
+        mutable TagList tags;
+        // Collects tags while readMetadata() runs, so the list doesn't regrow inside an ImportArena.
+        TagList* parsedTags = nullptr;
         
     public:
         /**
@@ -146,6 +346,13 @@ namespace MusicList
          */
         Track();
 
+        /**
+         * @brief Creates a new Track instance that stores its tags in the provided memory resource.
+         * 
+         * @param resource memory resource for the tag list. It must outlive the Track.
+         */
+        explicit Track(std::pmr::memory_resource* resource);
+
         /**
          * @brief Creates a new Track instance using the provided path.
          * 
@@ -162,6 +369,22 @@ namespace MusicList
          */
         void setPath(const fs::path& newPath);
 
+        /**
+         * @brief Sets the path of this Track using a reader that already has the file open.
+         * 
+         * @param newPath filesystem path to the track to use.
+         * @param fileReader reader with the start of the file loaded. If nullptr, the file is
+         * opened as it would be by setPath(const fs::path&).
+         */
+        void setPath(const fs::path& newPath, shared_ptr<FileReader> fileReader);
+
+        /**
+         * @brief Sets the options used by readMetadata().
+         * 
+         * @param newOptions options to use
+         */
+        void setReadOptions(const ReadOptions& newOptions);
+
         // ==================
         // Metadata Retrieval
         // ==================
@@ -182,6 +405,24 @@ namespace MusicList
          */
         static AudioFormat determineFormat(const fs::path& path);
 
+        /**
+         * @brief Checks whether determineFormat() needs to open a file to identify it.
+         * 
+         * @param path fs path to the track to check
+         * 
+         * @returns true if the file's contents are inspected.
+         */
+        static bool isInspectable(const fs::path& path);
+
+        /**
+         * @brief Checks whether a file name has one of the SUPPORTED_EXTS, without allocating.
+         * 
+         * @param fileName name of the file to check
+         * 
+         * @returns true if the file should be imported.
+         */
+        static bool isSupportedName(string_view fileName);
+
         // ==========
         // Operations
         // ==========
@@ -191,6 +432,20 @@ namespace MusicList
          */
         Json::Value toJSON() const;
 
+        /**
+         * @brief Streams the same JSON object toJSON() creates.
+         * 
+         * @param writer destination
+         */
+        void writeJSON(JsonWriter& writer) const;
+
+        /**
+         * @param format format to describe
+         * 
+         * @returns display name of the format as used in JSON output.
+         */
+        static const char* formatName(AudioFormat format);
+
         /**
          * @brief Converts the first 4 bytes in the input array into an unsigned 32-bit int.
          * 
@@ -205,9 +460,30 @@ namespace MusicList
         // =======
 
         /**
-         * @returns a const reference to the complete tag map for this Track instance.
+         * @brief Returns the complete tag list, reading it from the file first if it was loaded lazily.
+         * 
+         * @returns a const reference to the complete tag list for this Track instance.
+         */
+        const TagList& getTags() const;
+
+        /**
+         * @param key tag key to look up. Like getTags(), this loads lazy tags.
+         *
+         * @returns the tag's value, or an empty string if the Track doesn't have the tag.
          */
-        const map<string,string>& getTags() const;
+        const string& getTag(string_view key) const;
+
+        /**
+         * @returns false if only the summary tags have been read so far.
+         */
+        bool hasAllTags() const;
+
+        /**
+         * Pictures are only recorded with ReadOptions::recordPictures.
+         *
+         * @returns the position of each picture embedded in the file.
+         */
+        const vector<VorbisComment::Picture>& getPictures() const;
 
         /**
          * @returns Track title.
@@ -249,6 +525,11 @@ namespace MusicList
          */
         const AudioFormat& getAudioFormat() const;
 
+        /**
+         * @returns true if the Track uses a lossless format.
+         */
+        const bool& getIsLossless() const;
+
         /**
          * @returns Filesystem path associated with the Track
          */
@@ -256,6 +537,16 @@ namespace MusicList
 
         const string& getMBID() const;
 
+        /**
+         * @returns MusicBrainz ID of the release the Track belongs to.
+         */
+        const string& getAlbumMBID() const;
+
+        /**
+         * @returns pooled id of the MusicBrainz ID of the release the Track belongs to.
+         */
+        StringPool::Id getAlbumMBIDId() const;
+
         // ==================
         // Operator Overloads
         // ==================
@@ -263,6 +554,9 @@ namespace MusicList
         /**
          * @brief Returns true if the left hand side is less than the right hand side.
          * 
+         * Tracks are ordered by the text of their MusicBrainz track ID, not by its pooled id,
+         * which depends on the order in which import threads interned the values.
+         * 
          * @param lhs left-hand Track
          * @param rhs right-hand Track
          * 
@@ -270,7 +564,8 @@ namespace MusicList
          */
         friend inline bool operator< (const Track& lhs, const Track& rhs)
         {
-            return std::tie(lhs.mbid) < std::tie(rhs.mbid);
+            const StringPool& pool = StringPool::global();
+            return pool.get(lhs.mbid) < pool.get(rhs.mbid);
         }
 
         friend inline bool operator> (const Track& lhs, const Track& rhs) { return rhs < lhs;}
@@ -0,0 +1,535 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <strings.h>
+
+#include "VorbisComment.hpp"
+#include "OggPacketStream.hpp"
+#include "MemorySource.hpp"
+
+using namespace MusicList;
+
+static const uint8_t FLAC_BLOCK_VORBIS_COMMENT = 4;
+static const uint8_t FLAC_BLOCK_PICTURE = 6;
+
+namespace
+{
+    /**
+     * Magic bytes at the start of the identification and comment header packets of an Ogg codec.
+     */
+    struct OggHeaders
+    {
+        const char* identification;
+        const char* comment;
+        size_t length;
+    };
+
+    const OggHeaders OPUS_HEADERS = {"OpusHead", "OpusTags", 8};
+    const OggHeaders VORBIS_HEADERS = {"\x01vorbis", "\x03vorbis", 7};
+
+    // Bytes of an entry needed to recognize a picture: the key and the '='.
+    const size_t PICTURE_PREFIX_SIZE = strlen(VorbisComment::PICTURE_KEY) + 1;
+    // Start of a picture block read to get its type and MIME type. Longer MIME types are left out.
+    const size_t PICTURE_HEADER_SIZE = 8 + 64;
+    const size_t PICTURE_HEADER_BASE64_SIZE = PICTURE_HEADER_SIZE / 3 * 4;
+
+    /**
+     * Byte range of a file, used to read FLAC metadata blocks.
+     */
+    struct FileRange
+    {
+        const FileReader& reader;
+        uint64_t offset;
+        uint64_t end;
+
+        uint64_t tell() const
+        {
+            return this->offset;
+        }
+
+        size_t read(void* dest, size_t length)
+        {
+            length = static_cast<size_t>(std::min<uint64_t>(length, this->end - this->offset));
+            const size_t count = this->reader.readAt(this->offset, dest, length);
+            this->offset += count;
+            return count;
+        }
+
+        size_t skip(size_t length)
+        {
+            length = static_cast<size_t>(std::min<uint64_t>(length, this->end - this->offset));
+            this->offset += length;
+            return length;
+        }
+    };
+
+    /**
+     * Byte range in memory. `position` is the offset of `data` in the file, if it was read from one.
+     */
+    struct MemoryRange
+    {
+        const uint8_t* data;
+        size_t length;
+        uint64_t position = 0;
+
+        uint64_t tell() const
+        {
+            return this->position;
+        }
+
+        size_t read(void* dest, size_t count)
+        {
+            count = std::min(count, this->length);
+            memcpy(dest, this->data, count);
+            this->data += count;
+            this->length -= count;
+            this->position += count;
+            return count;
+        }
+
+        size_t skip(size_t count)
+        {
+            count = std::min(count, this->length);
+            this->data += count;
+            this->length -= count;
+            this->position += count;
+            return count;
+        }
+    };
+
+    template<typename Source>
+    bool readUInt32LE(Source& source, uint32_t& value)
+    {
+        uint8_t bytes[4];
+        if (source.read(bytes, 4) != 4)
+        {
+            return false;
+        }
+
+        value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+        return true;
+    }
+
+    /**
+     * @returns the 6-bit value of a base64 character, or -1 if it's outside the alphabet.
+     */
+    int base64Value(char c)
+    {
+        if (c >= 'A' && c <= 'Z')
+        {
+            return c - 'A';
+        }
+        if (c >= 'a' && c <= 'z')
+        {
+            return c - 'a' + 26;
+        }
+        if (c >= '0' && c <= '9')
+        {
+            return c - '0' + 52;
+        }
+        if (c == '+')
+        {
+            return 62;
+        }
+        return c == '/' ? 63 : -1;
+    }
+
+    /**
+     * Decodes base64 until the end of the input or the first character outside the alphabet.
+     *
+     * @returns number of bytes written to `out`, which must hold length / 4 * 3 bytes.
+     */
+    size_t decodeBase64Prefix(const char* in, size_t length, uint8_t* out)
+    {
+        size_t written = 0;
+        for (size_t i = 0; i + 4 <= length; i += 4)
+        {
+            const int a = base64Value(in[i]);
+            const int b = base64Value(in[i + 1]);
+            const int c = base64Value(in[i + 2]);
+            const int d = base64Value(in[i + 3]);
+            if (a < 0 || b < 0 || c < 0 || d < 0)
+            {
+                break;
+            }
+            out[written++] = static_cast<uint8_t>((a << 2) | (b >> 4));
+            out[written++] = static_cast<uint8_t>((b << 4) | (c >> 2));
+            out[written++] = static_cast<uint8_t>((c << 6) | d);
+        }
+        return written;
+    }
+
+    /**
+     * Fills in the picture type and MIME type from the start of a FLAC picture block.
+     */
+    void readPictureHeader(const uint8_t* data, size_t length, VorbisComment::Picture& picture)
+    {
+        if (length < 8)
+        {
+            return;
+        }
+
+        picture.type = readUInt32BE(data);
+        const uint32_t mimeLength = readUInt32BE(data + 4);
+        if (mimeLength <= length - 8)
+        {
+            picture.mimeType.assign(reinterpret_cast<const char*>(data + 8), mimeLength);
+        }
+    }
+
+    /**
+     * Skips the value of a picture entry, after reporting its position if there's a handler.
+     */
+    template<typename Source>
+    bool skipPicture(Source& source, uint32_t length, const VorbisComment::PictureHandler& pictureHandler)
+    {
+        if (pictureHandler)
+        {
+            VorbisComment::Picture picture;
+            picture.offset = source.tell();
+            picture.length = length;
+            picture.base64 = true;
+
+            // Only the few bytes holding the MIME type are read.
+            char encoded[PICTURE_HEADER_BASE64_SIZE];
+            const size_t count = std::min<size_t>(length, sizeof(encoded));
+            if (source.read(encoded, count) != count)
+            {
+                return false;
+            }
+            length -= static_cast<uint32_t>(count);
+
+            uint8_t header[PICTURE_HEADER_SIZE];
+            readPictureHeader(header, decodeBase64Prefix(encoded, count, header), picture);
+            pictureHandler(picture);
+        }
+
+        return source.skip(length) == length;
+    }
+
+    /**
+     * Parses the vendor string, comment count and comment entries from a source.
+     */
+    template<typename Source>
+    bool parseComments(Source& source, const VorbisComment::EntryHandler& handler,
+                       const VorbisComment::PictureHandler& pictureHandler)
+    {
+        uint32_t vendorLength;
+        if (!readUInt32LE(source, vendorLength) || source.skip(vendorLength) != vendorLength)
+        {
+            return false;
+        }
+
+        uint32_t count;
+        if (!readUInt32LE(source, count))
+        {
+            return false;
+        }
+
+        std::string entry;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t length;
+            if (!readUInt32LE(source, length) || length > VorbisComment::MAX_ENTRY_SIZE)
+            {
+                return false;
+            }
+
+            // Read just enough to recognize a picture before committing to the whole entry.
+            const size_t prefixLength = std::min<size_t>(length, PICTURE_PREFIX_SIZE);
+            entry.resize(prefixLength);
+            if (source.read(entry.data(), prefixLength) != prefixLength)
+            {
+                return false;
+            }
+
+            if (VorbisComment::isPictureEntry(entry.data(), prefixLength))
+            {
+                if (!skipPicture(source, static_cast<uint32_t>(length - prefixLength), pictureHandler))
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            entry.resize(length);
+            if (source.read(entry.data() + prefixLength, length - prefixLength) != length - prefixLength)
+            {
+                return false;
+            }
+
+            handler(entry.data(), entry.size());
+        }
+
+        return true;
+    }
+
+    /**
+     * Checks that the current packet of a stream starts with the provided magic bytes.
+     */
+    bool readMagic(OggPacketStream& stream, const char* magic, size_t length)
+    {
+        char buff[8];
+        return stream.read(buff, length) == length && memcmp(buff, magic, length) == 0;
+    }
+
+    /**
+     * Reads the comment header that follows the identification header of an Ogg stream.
+     */
+    bool readOggComments(FileReader& reader, const OggHeaders& headers, const VorbisComment::EntryHandler& handler,
+                         VorbisComment::Location& location, const VorbisComment::PictureHandler& pictureHandler)
+    {
+        OggPacketStream stream = OggPacketStream(reader);
+
+        if (!stream.nextPacket() || !readMagic(stream, headers.identification, headers.length))
+        {
+            return false;
+        }
+
+        if (!stream.nextPacket())
+        {
+            return false;
+        }
+
+        // Both Opus and Vorbis start the comment header on the page after the identification
+        // header, so the page is all that's needed to find it again.
+        if (stream.isPageStart())
+        {
+            location.offset = stream.getPageOffset();
+            location.length = 0;
+        }
+
+        if (!readMagic(stream, headers.comment, headers.length))
+        {
+            return false;
+        }
+
+        // Pictures are found again through the comment header's page and their position in the packet.
+        VorbisComment::PictureHandler oggPictureHandler;
+        if (pictureHandler)
+        {
+            oggPictureHandler = [&location, &pictureHandler](const VorbisComment::Picture& picture)
+            {
+                VorbisComment::Picture located = picture;
+                located.offset = location.offset;
+                located.packetOffset = static_cast<uint32_t>(picture.offset);
+                pictureHandler(located);
+            };
+        }
+
+        // Vorbis packets end with a framing bit, which is left unread.
+        return parseComments(stream, handler, oggPictureHandler);
+    }
+
+    /**
+     * Reads a comment header located by readOggComments().
+     */
+    bool readOggCommentsAt(FileReader& reader, const OggHeaders& headers, const VorbisComment::Location& location,
+                           const VorbisComment::EntryHandler& handler)
+    {
+        OggPacketStream stream = OggPacketStream(reader, location.offset);
+
+        if (!stream.nextPacket() || !readMagic(stream, headers.comment, headers.length))
+        {
+            return false;
+        }
+
+        return parseComments(stream, handler, VorbisComment::PictureHandler());
+    }
+
+    /**
+     * Reports a FLAC PICTURE block, reading only the start of it.
+     */
+    void readFlacPicture(const FileReader& reader, uint64_t offset, uint32_t length,
+                         const VorbisComment::PictureHandler& pictureHandler)
+    {
+        VorbisComment::Picture picture;
+        picture.offset = offset;
+        picture.length = length;
+
+        uint8_t header[PICTURE_HEADER_SIZE];
+        const size_t count = reader.readAt(offset, header, std::min<size_t>(length, sizeof(header)));
+        readPictureHeader(header, count, picture);
+        pictureHandler(picture);
+    }
+
+    /**
+     * Reads a FLAC comment block located by VorbisComment::readFlac().
+     */
+    bool readFlacComments(FileReader& reader, const VorbisComment::Location& location,
+                          const VorbisComment::EntryHandler& handler,
+                          const VorbisComment::PictureHandler& pictureHandler)
+    {
+        if (location.length > VorbisComment::MAX_BUFFERED_BLOCK)
+        {
+            // The block holds a picture, which is skipped rather than read.
+            FileRange range = {reader, location.offset, location.offset + location.length};
+            return parseComments(range, handler, pictureHandler);
+        }
+
+        if (location.offset <= reader.size())
+        {
+            // Fetch the whole block at once if it extends past what's been read so far.
+            reader.ensure(location.offset + location.length);
+
+            FileRange range = {reader, location.offset, location.offset + location.length};
+            return parseComments(range, handler, pictureHandler);
+        }
+
+        // Something large, usually a PICTURE block, comes first. Read the comment block on its
+        // own rather than extending the prefix over it.
+        std::vector<uint8_t> block(location.length);
+        if (reader.readAt(location.offset, block.data(), block.size()) != block.size())
+        {
+            return false;
+        }
+
+        MemoryRange range = {block.data(), block.size(), location.offset};
+        return parseComments(range, handler, pictureHandler);
+    }
+}
+
+bool VorbisComment::isPictureEntry(const char* entry, size_t length)
+{
+    return length >= PICTURE_PREFIX_SIZE && entry[PICTURE_PREFIX_SIZE - 1] == '=' &&
+        strncasecmp(entry, PICTURE_KEY, PICTURE_PREFIX_SIZE - 1) == 0;
+}
+
+bool VorbisComment::parse(const uint8_t* data, size_t length, const EntryHandler& handler)
+{
+    MemoryRange range = {data, length};
+    return parseComments(range, handler, PictureHandler());
+}
+
+bool VorbisComment::readFlac(FileReader& reader, const EntryHandler& handler)
+{
+    Location location;
+    return VorbisComment::readFlac(reader, handler, location);
+}
+
+bool VorbisComment::readFlac(FileReader& reader, const EntryHandler& handler, Location& location,
+                             const PictureHandler& pictureHandler)
+{
+    if (reader.size() < 4 || memcmp(reader.data(), "fLaC", 4) != 0)
+    {
+        return false;
+    }
+
+    // Walk the metadata block headers until the comment block turns up. When pictures are
+    // recorded, the walk continues to the last block, since PICTURE blocks usually come later.
+    bool found = false;
+    uint64_t offset = 4;
+    while (true)
+    {
+        uint8_t header[4];
+        if (reader.readAt(offset, header, 4) != 4)
+        {
+            return found;
+        }
+
+        const bool isLast = (header[0] & 0x80) != 0;
+        const uint8_t type = header[0] & 0x7F;
+        const uint32_t length = (header[1] << 16) | (header[2] << 8) | header[3];
+        const uint64_t blockStart = offset + 4;
+
+        if (type == FLAC_BLOCK_VORBIS_COMMENT && !found)
+        {
+            location.offset = blockStart;
+            location.length = length;
+            if (!readFlacComments(reader, location, handler, pictureHandler))
+            {
+                return false;
+            }
+
+            found = true;
+            if (!pictureHandler)
+            {
+                return true;
+            }
+        }
+        else if (type == FLAC_BLOCK_PICTURE && pictureHandler)
+        {
+            readFlacPicture(reader, blockStart, length, pictureHandler);
+        }
+
+        if (isLast)
+        {
+            return found;
+        }
+        offset = blockStart + length;
+    }
+}
+
+bool VorbisComment::readFlacAt(FileReader& reader, const Location& location, const EntryHandler& handler)
+{
+    return readFlacComments(reader, location, handler, PictureHandler());
+}
+
+bool VorbisComment::readOpus(FileReader& reader, const EntryHandler& handler)
+{
+    Location location;
+    return VorbisComment::readOpus(reader, handler, location);
+}
+
+bool VorbisComment::readOpus(FileReader& reader, const EntryHandler& handler, Location& location,
+                             const PictureHandler& pictureHandler)
+{
+    return readOggComments(reader, OPUS_HEADERS, handler, location, pictureHandler);
+}
+
+bool VorbisComment::readOpusAt(FileReader& reader, const Location& location, const EntryHandler& handler)
+{
+    return readOggCommentsAt(reader, OPUS_HEADERS, location, handler);
+}
+
+bool VorbisComment::readVorbis(FileReader& reader, const EntryHandler& handler)
+{
+    Location location;
+    return VorbisComment::readVorbis(reader, handler, location);
+}
+
+bool VorbisComment::readVorbis(FileReader& reader, const EntryHandler& handler, Location& location,
+                               const PictureHandler& pictureHandler)
+{
+    return readOggComments(reader, VORBIS_HEADERS, handler, location, pictureHandler);
+}
+
+bool VorbisComment::readVorbisAt(FileReader& reader, const Location& location, const EntryHandler& handler)
+{
+    return readOggCommentsAt(reader, VORBIS_HEADERS, location, handler);
+}
@@ -0,0 +1,247 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_VORBISCOMMENT_HPP
+#define MUSICLIST_VORBISCOMMENT_HPP
+
+#include <functional>
+#include <string>
+#include <cinttypes>
+#include <cstddef>
+
+#include "FileReader.hpp"
+
+namespace MusicList
+{
+    /**
+     * @brief Dependency-free reader for Vorbis comment blocks.
+     *
+     * Comments are read straight from the file's bytes, from a FLAC METADATA_BLOCK_VORBIS_COMMENT,
+     * an Ogg OpusTags packet or an Ogg Vorbis comment header. Reading stops as soon as the
+     * comment block has been parsed.
+     *
+     * Embedded pictures are recognized by their key and skipped without being read, so they
+     * never reach the entry handler. Their position can be recorded instead.
+     */
+    class VorbisComment
+    {
+    public:
+        /**
+         * Receives each raw "KEY=value" comment entry. The entry isn't NUL-terminated.
+         */
+        using EntryHandler = std::function<void(const char* entry, size_t length)>;
+
+        /**
+         * Entries larger than this are treated as corruption.
+         */
+        static constexpr uint32_t MAX_ENTRY_SIZE = 64 * 1024 * 1024;
+
+        /**
+         * FLAC comment blocks up to this size are fetched in a single read. Larger ones hold
+         * pictures, which are skipped in place.
+         */
+        static constexpr uint32_t MAX_BUFFERED_BLOCK = 256 * 1024;
+
+        /**
+         * Key of the comment holding a base64-encoded FLAC picture block.
+         */
+        static constexpr const char* PICTURE_KEY = "METADATA_BLOCK_PICTURE";
+
+        /**
+         * Position of an embedded picture, so the image can be read later without parsing the
+         * tags again.
+         */
+        struct Picture
+        {
+            // FLAC: offset of the PICTURE block's data, or of the picture comment's value.
+            // Ogg: offset of the page the comment header starts on. 0 if it couldn't be located.
+            uint64_t offset = 0;
+            // Ogg only: position of the picture comment's value in the comment header packet.
+            uint32_t packetOffset = 0;
+            // Size of the block or the comment value.
+            uint32_t length = 0;
+            // True for picture comments, which hold the picture block in base64.
+            bool base64 = false;
+            // Picture type from the block, e.g. 3 for the front cover.
+            uint32_t type = 0;
+            // Empty if it couldn't be read from the start of the block.
+            std::string mimeType;
+        };
+
+        /**
+         * Receives the position of each embedded picture.
+         */
+        using PictureHandler = std::function<void(const Picture& picture)>;
+
+        /**
+         * @brief Checks whether a comment entry holds a picture.
+         *
+         * @param entry start of the "KEY=value" entry
+         * @param length size of the entry in bytes
+         *
+         * @returns true if the entry's key is PICTURE_KEY, in any case.
+         */
+        static bool isPictureEntry(const char* entry, size_t length);
+
+        /**
+         * Position of a comment block in its file, so it can be read again without searching
+         * for it. For FLAC it's the block's data, for Ogg the page the comment header starts on.
+         */
+        struct Location
+        {
+            // 0 if the block hasn't been located. No comment block can start at the beginning of a file.
+            uint64_t offset = 0;
+            // Size of the FLAC block. Ogg packets are read until they end.
+            uint32_t length = 0;
+        };
+
+        /**
+         * @brief Parses a bare comment block (vendor string, count and entries).
+         *
+         * @param data start of the comment block
+         * @param length size of the comment block in bytes
+         * @param handler called for every comment entry
+         *
+         * @returns false if the block is malformed.
+         */
+        static bool parse(const uint8_t* data, size_t length, const EntryHandler& handler);
+
+        /**
+         * @brief Reads the comments of a native FLAC file.
+         *
+         * @param reader open reader for the file
+         * @param handler called for every comment entry
+         *
+         * @returns false if the file isn't FLAC, has no comment block or the block is malformed.
+         */
+        static bool readFlac(FileReader& reader, const EntryHandler& handler);
+
+        /**
+         * @brief Reads the comments like readFlac(FileReader&, const EntryHandler&), and records where they are.
+         *
+         * @param reader open reader for the file
+         * @param handler called for every comment entry
+         * @param location set to the position of the comment block once it's found
+         * @param pictureHandler called with the position of every embedded picture. May be empty.
+         *
+         * @returns false if the file isn't FLAC, has no comment block or the block is malformed.
+         */
+        static bool readFlac(FileReader& reader, const EntryHandler& handler, Location& location,
+                             const PictureHandler& pictureHandler = PictureHandler());
+
+        /**
+         * @brief Reads the comments of a native FLAC file from a previously located block.
+         *
+         * @param reader open reader for the file
+         * @param location position returned by readFlac()
+         * @param handler called for every comment entry
+         *
+         * @returns false if the block is malformed.
+         */
+        static bool readFlacAt(FileReader& reader, const Location& location, const EntryHandler& handler);
+
+        /**
+         * @brief Reads the comments of an Ogg Opus file.
+         *
+         * Only the identification and comment header packets are read.
+         *
+         * @param reader open reader for the file
+         * @param handler called for every comment entry
+         *
+         * @returns false if the file isn't Ogg Opus or its comment header is malformed.
+         */
+        static bool readOpus(FileReader& reader, const EntryHandler& handler);
+
+        /**
+         * @brief Reads the comments like readOpus(FileReader&, const EntryHandler&), and records where they are.
+         *
+         * @param reader open reader for the file
+         * @param handler called for every comment entry
+         * @param location set to the position of the comment header once it's found
+         * @param pictureHandler called with the position of every embedded picture. May be empty.
+         *
+         * @returns false if the file isn't Ogg Opus or its comment header is malformed.
+         */
+        static bool readOpus(FileReader& reader, const EntryHandler& handler, Location& location,
+                             const PictureHandler& pictureHandler = PictureHandler());
+
+        /**
+         * @brief Reads the comments of an Ogg Opus file from a previously located comment header.
+         *
+         * @param reader open reader for the file
+         * @param location position returned by readOpus()
+         * @param handler called for every comment entry
+         *
+         * @returns false if the comment header is malformed.
+         */
+        static bool readOpusAt(FileReader& reader, const Location& location, const EntryHandler& handler);
+
+        /**
+         * @brief Reads the comments of an Ogg Vorbis file.
+         *
+         * Only the identification and comment header packets are read. The comment header is
+         * reassembled from as many pages as it spans, without touching the setup header.
+         *
+         * @param reader open reader for the file
+         * @param handler called for every comment entry
+         *
+         * @returns false if the file isn't Ogg Vorbis or its comment header is malformed.
+         */
+        static bool readVorbis(FileReader& reader, const EntryHandler& handler);
+
+        /**
+         * @brief Reads the comments like readVorbis(FileReader&, const EntryHandler&), and records where they are.
+         *
+         * @param reader open reader for the file
+         * @param handler called for every comment entry
+         * @param location set to the position of the comment header once it's found
+         * @param pictureHandler called with the position of every embedded picture. May be empty.
+         *
+         * @returns false if the file isn't Ogg Vorbis or its comment header is malformed.
+         */
+        static bool readVorbis(FileReader& reader, const EntryHandler& handler, Location& location,
+                               const PictureHandler& pictureHandler = PictureHandler());
+
+        /**
+         * @brief Reads the comments of an Ogg Vorbis file from a previously located comment header.
+         *
+         * @param reader open reader for the file
+         * @param location position returned by readVorbis()
+         * @param handler called for every comment entry
+         *
+         * @returns false if the comment header is malformed.
+         */
+        static bool readVorbisAt(FileReader& reader, const Location& location, const EntryHandler& handler);
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_VORBISCOMMENT_HPP
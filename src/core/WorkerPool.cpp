@@ -0,0 +1,200 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+
+#include <algorithm>
+
+#include "WorkerPool.hpp"
+
+using namespace MusicList;
+
+namespace
+{
+    // Index of the pool queue owned by the current thread, or -1 for non-worker threads.
+    thread_local int32_t currentWorker = -1;
+    thread_local const WorkerPool* currentPool = nullptr;
+}
+
+WorkerPool::WorkerPool(uint32_t threadCount) : WorkerPool(threadCount, 0) {}
+
+WorkerPool::WorkerPool(uint32_t threadCount, uint32_t maxQueued) : maxQueued(maxQueued)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    this->queues.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        this->queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    this->workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        this->workers.emplace_back(&WorkerPool::workerLoop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    this->wait();
+
+    {
+        std::lock_guard<std::mutex> guard(this->stateLock);
+        this->stopping = true;
+    }
+    this->workAvailable.notify_all();
+
+    for (auto& worker : this->workers)
+    {
+        worker.join();
+    }
+}
+
+void WorkerPool::submit(std::function<void()> task)
+{
+    uint32_t index;
+    if (currentPool == this)
+    {
+        index = static_cast<uint32_t>(currentWorker);
+    }
+    else
+    {
+        index = this->nextQueue.fetch_add(1, std::memory_order_relaxed) % this->queues.size();
+
+        if (this->maxQueued > 0 && this->queued >= this->maxQueued)
+        {
+            std::unique_lock<std::mutex> lock(this->stateLock);
+            this->spaceAvailable.wait(lock, [this] { return this->queued < this->maxQueued; });
+        }
+    }
+
+    this->unfinished++;
+    {
+        WorkQueue& queue = *this->queues[index];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.tasks.push_back(std::move(task));
+        this->queued++;
+    }
+
+    {
+        // Taking the lock orders this notification after any worker that is about to sleep.
+        std::lock_guard<std::mutex> guard(this->stateLock);
+    }
+    this->workAvailable.notify_one();
+}
+
+bool WorkerPool::popTask(uint32_t index, std::function<void()>& task)
+{
+    {
+        WorkQueue& own = *this->queues[index];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            this->queued--;
+            return true;
+        }
+    }
+
+    const auto queueCount = static_cast<uint32_t>(this->queues.size());
+    for (uint32_t offset = 1; offset < queueCount; offset++)
+    {
+        WorkQueue& victim = *this->queues[(index + offset) % queueCount];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            this->queued--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkerPool::workerLoop(uint32_t index)
+{
+    currentWorker = static_cast<int32_t>(index);
+    currentPool = this;
+
+    std::function<void()> task;
+    while (true)
+    {
+        if (!this->popTask(index, task))
+        {
+            std::unique_lock<std::mutex> lock(this->stateLock);
+            this->workAvailable.wait(lock, [this] { return this->stopping || this->queued > 0; });
+            if (this->stopping && this->queued == 0)
+            {
+                return;
+            }
+            continue;
+        }
+
+        if (this->maxQueued > 0)
+        {
+            std::lock_guard<std::mutex> guard(this->stateLock);
+            this->spaceAvailable.notify_one();
+        }
+
+        task();
+        task = nullptr;
+
+        if (--this->unfinished == 0)
+        {
+            std::lock_guard<std::mutex> guard(this->stateLock);
+            this->workDone.notify_all();
+        }
+    }
+}
+
+void WorkerPool::wait()
+{
+    std::unique_lock<std::mutex> lock(this->stateLock);
+    this->workDone.wait(lock, [this] { return this->unfinished == 0; });
+}
+
+bool WorkerPool::waitFor(const std::chrono::milliseconds& timeout)
+{
+    std::unique_lock<std::mutex> lock(this->stateLock);
+    return this->workDone.wait_for(lock, timeout, [this] { return this->unfinished == 0; });
+}
+
+uint32_t WorkerPool::size() const
+{
+    return static_cast<uint32_t>(this->workers.size());
+}
@@ -0,0 +1,156 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_WORKERPOOL_HPP
+#define MUSICLIST_WORKERPOOL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cinttypes>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::vector;
+using std::unique_ptr;
+
+namespace MusicList
+{
+    /**
+     * @brief Fixed-size pool of worker threads with per-worker task queues.
+     *
+     * Each worker pops from the back of its own queue and steals from the front of the other
+     * workers' queues once its own runs dry. Tasks must handle their own exceptions.
+     *
+     * The pool can optionally be bounded, in which case submit() blocks producer threads
+     * until the workers have drained the backlog below the limit.
+     */
+    class WorkerPool
+    {
+    private:
+        struct WorkQueue
+        {
+            std::mutex lock;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        vector<std::thread> workers;
+        vector<unique_ptr<WorkQueue>> queues;
+
+        std::mutex stateLock;
+        std::condition_variable workAvailable;
+        std::condition_variable workDone;
+        std::condition_variable spaceAvailable;
+
+        std::atomic<uint32_t> queued = 0;
+        std::atomic<uint32_t> unfinished = 0;
+        std::atomic<uint32_t> nextQueue = 0;
+        uint32_t maxQueued = 0;
+        bool stopping = false;
+
+        /**
+         * @brief Main loop run by each worker thread.
+         *
+         * @param index index of the worker's own queue
+         */
+        void workerLoop(uint32_t index);
+
+        /**
+         * @brief Takes the next task for a worker, stealing from other queues if needed.
+         *
+         * @param index index of the worker's own queue
+         * @param task destination for the popped task
+         *
+         * @returns true if a task was found.
+         */
+        bool popTask(uint32_t index, std::function<void()>& task);
+    public:
+        /**
+         * @brief Starts the requested number of worker threads.
+         *
+         * @param threadCount number of workers. 0 uses the hardware concurrency.
+         */
+        explicit WorkerPool(uint32_t threadCount);
+
+        /**
+         * @brief Starts the requested number of worker threads with a bounded backlog.
+         *
+         * @param threadCount number of workers. 0 uses the hardware concurrency.
+         * @param maxQueued maximum number of tasks waiting to run before submit() blocks.
+         * 0 leaves the backlog unbounded.
+         */
+        WorkerPool(uint32_t threadCount, uint32_t maxQueued);
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        /**
+         * @brief Waits for all queued tasks to finish, then stops the workers.
+         */
+        ~WorkerPool();
+
+        /**
+         * @brief Queues a task for execution.
+         *
+         * Tasks submitted from a worker thread go to that worker's own queue and never block.
+         * Other threads block while the pool is bounded and its backlog is full.
+         *
+         * @param task callable to run on a worker thread
+         */
+        void submit(std::function<void()> task);
+
+        /**
+         * @brief Blocks until every submitted task has finished.
+         */
+        void wait();
+
+        /**
+         * @brief Blocks until every submitted task has finished or the timeout passes.
+         *
+         * @param timeout maximum amount of time to wait
+         *
+         * @returns true if all tasks have finished.
+         */
+        bool waitFor(const std::chrono::milliseconds& timeout);
+
+        /**
+         * @returns number of worker threads in the pool.
+         */
+        uint32_t size() const;
+    };
+} // namespace MusicList
+
+#endif // MUSICLIST_WORKERPOOL_HPP
@@ -0,0 +1,167 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <sys/resource.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <BatchReader.hpp>
+#include <Importer.hpp>
+
+#include <gtest/gtest.h>
+
+#include "FlacWriter.hpp"
+
+namespace fs = std::filesystem;
+
+using namespace MusicList;
+
+class BatchReaderTest : public ::testing::Test
+{
+protected:
+    const fs::path TEST_DIR = fs::path("./batchreader-test");
+    // Enough files to need more than one batch.
+    const size_t FILE_COUNT = BatchReader::BATCH_SIZE + 17;
+
+    std::vector<fs::path> paths;
+
+    void SetUp() override
+    {
+        fs::create_directories(TEST_DIR);
+        for (size_t i = 0; i < FILE_COUNT; i++)
+        {
+            const fs::path path = TEST_DIR / (std::to_string(i) + ".bin");
+            std::ofstream outFile = std::ofstream(path, std::ios::binary | std::ios::trunc);
+
+            // Every other file is larger than the prefix.
+            const size_t size = i % 2 == 0 ? i + 1 : FileReader::PREFIX_SIZE + i;
+            for (size_t j = 0; j < size; j++)
+            {
+                outFile.put(static_cast<char>((i + j) % 251));
+            }
+            this->paths.push_back(path);
+        }
+        this->paths.push_back(TEST_DIR / "missing.bin");
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(TEST_DIR);
+    }
+
+    static size_t openDescriptors()
+    {
+        return static_cast<size_t>(std::distance(fs::directory_iterator("/proc/self/fd"), fs::directory_iterator()));
+    }
+
+    void checkReaders(const std::vector<std::shared_ptr<FileReader>>& readers)
+    {
+        ASSERT_EQ(this->paths.size(), readers.size());
+        ASSERT_EQ(nullptr, readers.back());
+
+        for (size_t i = 0; i < FILE_COUNT; i++)
+        {
+            const auto& reader = readers[i];
+            ASSERT_NE(nullptr, reader);
+
+            const size_t size = i % 2 == 0 ? i + 1 : FileReader::PREFIX_SIZE + i;
+            ASSERT_EQ(size, reader->getFileSize());
+            ASSERT_EQ(std::min(size, FileReader::PREFIX_SIZE), reader->size());
+            ASSERT_EQ(i % 251, reader->data()[0]);
+
+            // Reads past the prefix go through the descriptor handed over by the batch.
+            uint8_t last = 0;
+            ASSERT_EQ(1U, reader->readAt(size - 1, &last, 1));
+            ASSERT_EQ((i + size - 1) % 251, last);
+        }
+    }
+};
+
+TEST_F(BatchReaderTest, ReadsBatches)
+{
+    BatchReader batch = BatchReader();
+    const size_t openBefore = openDescriptors();
+    const auto readers = batch.read(this->paths);
+
+    // Readers give their descriptors back once the prefix is loaded.
+    ASSERT_EQ(openBefore, openDescriptors());
+    checkReaders(readers);
+}
+
+TEST_F(BatchReaderTest, ThreadFallback)
+{
+    BatchReader batch = BatchReader(false);
+    ASSERT_FALSE(batch.usesRing());
+    checkReaders(batch.read(this->paths));
+}
+
+TEST_F(BatchReaderTest, LowDescriptorLimit)
+{
+    const fs::path libraryDir = TEST_DIR / "library";
+    const uint32_t albumCount = 200;
+    const uint32_t tracksPerAlbum = 10;
+    for (uint32_t album = 0; album < albumCount; album++)
+    {
+        const fs::path albumDir = libraryDir / ("album-" + std::to_string(album));
+        fs::create_directories(albumDir);
+        for (uint32_t track = 0; track < tracksPerAlbum; track++)
+        {
+            FlacWriter::write(albumDir / (std::to_string(track) + ".flac"), {"ALBUM=Album", "ALBUMARTIST=Artist"});
+        }
+    }
+
+    // Far fewer descriptors than there are files queued across 16 import threads.
+    rlimit original = {};
+    ASSERT_EQ(0, getrlimit(RLIMIT_NOFILE, &original));
+    rlimit lowered = original;
+    lowered.rlim_cur = std::min<rlim_t>(original.rlim_cur, 48);
+    ASSERT_EQ(0, setrlimit(RLIMIT_NOFILE, &lowered));
+
+    Importer importer = Importer(16);
+    importer.setBatchReads(true);
+    importer.setQuiet(true);
+    importer.setProgressCallback(ProgressCallback());
+    importer.runTrackSearch(libraryDir, 0);
+
+    setrlimit(RLIMIT_NOFILE, &original);
+
+    ASSERT_EQ(albumCount * tracksPerAlbum, importer.getTracks().size());
+    ASSERT_EQ(0U, importer.getMetrics().get(ImportMetrics::Counter::parseFailures));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -30,18 +30,109 @@
   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
   
 */
+#include <filesystem>
+#include <fstream>
+#include <random>
 #include <vector>
 #include <string>
 
 #include <BlockPicture.hpp>
+#include <FileReader.hpp>
+#include <VorbisComment.hpp>
 
 #include <gtest/gtest.h>
 
+#include "FlacWriter.hpp"
+
+namespace fs = std::filesystem;
+
 using namespace MusicList;
 
 class BlockPictureTest : public ::testing::Test
 {
 protected:
+    const fs::path FLAC_PATH = fs::path("./blockpicture-test.flac");
+    const std::vector<BlockPicture::Decoder> DECODERS = {
+        BlockPicture::Decoder::scalar, BlockPicture::Decoder::ssse3, BlockPicture::Decoder::avx2
+    };
+
+    void TearDown() override
+    {
+        fs::remove(FLAC_PATH);
+    }
+
+    static void appendUInt32BE(std::string& out, uint32_t value)
+    {
+        for (int i = 3; i >= 0; i--)
+        {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    static std::string pictureBlock(uint32_t type, const std::string& mimeType, const std::string& data)
+    {
+        std::string block;
+        appendUInt32BE(block, type);
+        appendUInt32BE(block, static_cast<uint32_t>(mimeType.size()));
+        block.append(mimeType);
+        appendUInt32BE(block, 5);
+        block.append("Front");
+        appendUInt32BE(block, 500);
+        appendUInt32BE(block, 400);
+        appendUInt32BE(block, 24);
+        appendUInt32BE(block, 0);
+        appendUInt32BE(block, static_cast<uint32_t>(data.size()));
+        return block + data;
+    }
+
+    static std::string base64Encode(const std::string& data, bool padded = true)
+    {
+        static const char* ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        std::string out;
+        for (size_t i = 0; i < data.size(); i += 3)
+        {
+            uint32_t group = static_cast<uint8_t>(data[i]) << 16;
+            group |= i + 1 < data.size() ? static_cast<uint8_t>(data[i + 1]) << 8 : 0;
+            group |= i + 2 < data.size() ? static_cast<uint8_t>(data[i + 2]) : 0;
+
+            out.push_back(ALPHABET[(group >> 18) & 0x3F]);
+            out.push_back(ALPHABET[(group >> 12) & 0x3F]);
+            if (i + 1 < data.size() || padded)
+            {
+                out.push_back(i + 1 < data.size() ? ALPHABET[(group >> 6) & 0x3F] : '=');
+            }
+            if (i + 2 < data.size() || padded)
+            {
+                out.push_back(i + 2 < data.size() ? ALPHABET[group & 0x3F] : '=');
+            }
+        }
+        return out;
+    }
+
+    static std::string randomBytes(size_t size)
+    {
+        std::mt19937 generator(static_cast<uint32_t>(size));
+        std::string data;
+        for (size_t i = 0; i < size; i++)
+        {
+            data.push_back(static_cast<char>(generator() & 0xFF));
+        }
+        return data;
+    }
+
+    static bool decode(BlockPicture::Decoder decoder, const std::string& encoded, std::string& decoded)
+    {
+        std::vector<uint8_t> out(BlockPicture::maxDecodedSize(encoded.size()));
+        size_t written = 0;
+        if (!BlockPicture::base64Decode(decoder, encoded.data(), encoded.size(), out.data(), written))
+        {
+            return false;
+        }
+        decoded.assign(reinterpret_cast<const char*>(out.data()), written);
+        return true;
+    }
+
     std::string SHORT_TEST_DATA = {'Q','U','J','D'};
     std::string SHORT_EXPECTED = "ABC";
     std::string LONG_TEST_DATA = "SGVsbG8uIERvIHlvdSBrbm93IG15IG5hbWU/IQ==";
@@ -73,6 +164,122 @@ TEST_F(BlockPictureTest, DISABLED_FullPictureBlock)
     blkPic.readPictureBlock(RADIOACTIVE_PIC_BLOCK);
 }
 
+TEST_F(BlockPictureTest, DecodersAgree)
+{
+    ASSERT_TRUE(BlockPicture::isSupported(BlockPicture::Decoder::scalar));
+
+    // Sizes around every vector width, so each decoder hands over to the next at every offset.
+    std::vector<size_t> sizes;
+    for (size_t size = 0; size < 200; size++)
+    {
+        sizes.push_back(size);
+    }
+    sizes.push_back(100001);
+
+    for (const auto decoder : DECODERS)
+    {
+        for (const size_t size : sizes)
+        {
+            const std::string data = randomBytes(size);
+            std::string decoded;
+
+            ASSERT_TRUE(decode(decoder, base64Encode(data), decoded)) << size;
+            ASSERT_EQ(data, decoded) << size;
+
+            ASSERT_TRUE(decode(decoder, base64Encode(data, false), decoded)) << size;
+            ASSERT_EQ(data, decoded) << size;
+        }
+    }
+}
+
+TEST_F(BlockPictureTest, InvalidInput)
+{
+    const std::string encoded = base64Encode(randomBytes(300));
+
+    for (const auto decoder : DECODERS)
+    {
+        std::string decoded;
+        for (size_t pos = 0; pos < encoded.size(); pos++)
+        {
+            std::string corrupt = encoded;
+            corrupt[pos] = pos % 2 == 0 ? '*' : '\xC3';
+            ASSERT_FALSE(decode(decoder, corrupt, decoded)) << pos;
+        }
+
+        ASSERT_FALSE(decode(decoder, "QU=D", decoded));
+        ASSERT_FALSE(decode(decoder, "QUJDQ", decoded));
+        ASSERT_FALSE(decode(decoder, "QQ===", decoded));
+    }
+
+    ASSERT_THROW(BlockPicture::base64Decode(std::string("QU*D")), std::runtime_error);
+}
+
+TEST_F(BlockPictureTest, ParseBlock)
+{
+    const std::string image = randomBytes(1000);
+    const std::string block = pictureBlock(3, "image/jpeg", image);
+
+    BlockPicture picture = BlockPicture();
+    ASSERT_TRUE(picture.parse(reinterpret_cast<const uint8_t*>(block.data()), block.size()));
+    ASSERT_EQ(3U, picture.getType());
+    ASSERT_EQ("image/jpeg", picture.getMimeType());
+    ASSERT_EQ("Front", picture.getDescription());
+    ASSERT_EQ(500U, picture.getWidth());
+    ASSERT_EQ(400U, picture.getHeight());
+    ASSERT_EQ(24U, picture.getColorDepth());
+    ASSERT_EQ(0U, picture.getColorCount());
+    // The image is left in the caller's buffer.
+    ASSERT_EQ(reinterpret_cast<const uint8_t*>(block.data()) + block.size() - image.size(), picture.getData());
+    ASSERT_EQ(image.size(), picture.getDataLength());
+
+    ASSERT_TRUE(picture.readPictureBlock(base64Encode(block)));
+    ASSERT_EQ("image/jpeg", picture.getMimeType());
+    ASSERT_EQ(image, std::string(reinterpret_cast<const char*>(picture.getData()), picture.getDataLength()));
+
+    ASSERT_FALSE(picture.parse(reinterpret_cast<const uint8_t*>(block.data()), block.size() - 1));
+    ASSERT_EQ(nullptr, picture.getData());
+    ASSERT_FALSE(picture.readPictureBlock("not base64"));
+}
+
+TEST_F(BlockPictureTest, ReadRecordedPictures)
+{
+    const std::string cover = pictureBlock(3, "image/png", randomBytes(FileReader::PREFIX_SIZE));
+    const std::string back = pictureBlock(4, "image/jpeg", randomBytes(5000));
+
+    const std::string comments = FlacWriter::commentBlock({"METADATA_BLOCK_PICTURE=" + base64Encode(back)});
+
+    std::string file = "fLaC";
+    const auto appendBlock = [&file](uint8_t type, bool isLast, const std::string& body)
+    {
+        FlacWriter::appendBlockHeader(file, type, isLast, static_cast<uint32_t>(body.size()));
+        file.append(body);
+    };
+    appendBlock(0, false, std::string(34, '\0'));
+    appendBlock(4, false, comments);
+    appendBlock(6, true, cover);
+    {
+        std::ofstream outFile = std::ofstream(FLAC_PATH, std::ios::binary | std::ios::trunc);
+        outFile.write(file.data(), static_cast<std::streamsize>(file.size()));
+    }
+
+    std::vector<VorbisComment::Picture> pictures;
+    FileReader reader = FileReader(FLAC_PATH);
+    VorbisComment::Location location;
+    ASSERT_TRUE(VorbisComment::readFlac(reader, [](const char*, size_t) {}, location,
+        [&pictures](const VorbisComment::Picture& picture) { pictures.push_back(picture); }));
+    ASSERT_EQ(2U, pictures.size());
+
+    BlockPicture picture = BlockPicture();
+    ASSERT_TRUE(picture.read(reader, pictures[0]));
+    ASSERT_EQ(4U, picture.getType());
+    ASSERT_EQ(back.substr(back.size() - 5000), std::string(reinterpret_cast<const char*>(picture.getData()), 5000));
+
+    ASSERT_TRUE(picture.read(reader, pictures[1]));
+    ASSERT_EQ("image/png", picture.getMimeType());
+    ASSERT_EQ(cover.substr(cover.size() - FileReader::PREFIX_SIZE),
+              std::string(reinterpret_cast<const char*>(picture.getData()), picture.getDataLength()));
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,189 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <Catalog.hpp>
+#include <Importer.hpp>
+
+#include <gtest/gtest.h>
+
+#include "FlacWriter.hpp"
+
+namespace fs = std::filesystem;
+
+using namespace MusicList;
+
+class CatalogTest : public ::testing::Test
+{
+protected:
+    const fs::path LIBRARY_DIR = fs::path("./catalog-test-library");
+    const fs::path CATALOG_PATH = fs::path("./catalog-test.catalog");
+
+    static std::string makeMbid(uint32_t prefix, uint32_t value)
+    {
+        char mbid[37];
+        snprintf(mbid, sizeof(mbid), "%08x-0000-4000-8000-%012x", prefix, value);
+        return mbid;
+    }
+
+    void SetUp() override
+    {
+        for (uint32_t album = 0; album < 3; album++)
+        {
+            for (uint32_t track = 1; track <= 4; track++)
+            {
+                std::vector<std::string> comments = {
+                    "TITLE=Song " + std::to_string(track),
+                    "ALBUM=Album " + std::to_string(album),
+                    "ALBUMARTIST=Artist",
+                    "TRACKNUMBER=" + std::to_string(track),
+                    "TOTALTRACKS=4",
+                    "DISCNUMBER=1",
+                    "MUSICBRAINZ_TRACKID=" + makeMbid(0, album * 4 + track % 4)
+                };
+                // The last album has no release MBID.
+                if (album < 2)
+                {
+                    comments.push_back("MUSICBRAINZ_ALBUMID=" + makeMbid(1, album));
+                }
+
+                FlacWriter::write(LIBRARY_DIR / ("a" + std::to_string(album)) / ("t" + std::to_string(track) + ".flac"), comments);
+            }
+        }
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(LIBRARY_DIR);
+        fs::remove(CATALOG_PATH);
+    }
+};
+
+TEST_F(CatalogTest, MatchesImport)
+{
+    Importer importer = Importer();
+    importer.runTrackSearch(LIBRARY_DIR, 0);
+    const size_t trackCount = importer.getTracks().size();
+    importer.generateAlbumsFromTracks();
+    importer.writeCatalog(CATALOG_PATH);
+
+    const Catalog catalog = Catalog(CATALOG_PATH);
+    const auto& albums = importer.getAlbums();
+    ASSERT_EQ(albums.size(), catalog.getAlbumCount());
+    ASSERT_EQ(12U, trackCount);
+    ASSERT_EQ(trackCount, catalog.getTrackCount());
+    ASSERT_EQ("", catalog.getString(Catalog::EMPTY));
+
+    const auto albumTable = catalog.getAlbums();
+    const auto trackAlbums = catalog.getTrackAlbums();
+    const auto titles = catalog.getTitles();
+    const auto paths = catalog.getPaths();
+    const auto mbids = catalog.getTrackMBIDs();
+
+    uint32_t albumIndex = 0;
+    for (const auto& albumPair : albums)
+    {
+        const Album& album = *albumPair.second;
+        const CatalogAlbum& record = albumTable[albumIndex];
+        ASSERT_EQ(album.getName(), catalog.getString(record.name));
+        ASSERT_EQ(album.getArtist(), catalog.getString(record.artist));
+        ASSERT_EQ(album.getTrackSet().size(), record.trackCount);
+        ASSERT_EQ(album.getTotalTracks(), record.totalTracks);
+
+        Mbid albumMbid;
+        if (!Mbid::parse(album.getMBID(), albumMbid))
+        {
+            albumMbid = Mbid();
+        }
+        ASSERT_EQ(albumMbid, record.mbid);
+
+        uint32_t trackIndex = record.firstTrack;
+        for (const auto& trackPair : album.getTrackSet())
+        {
+            const Track& track = *trackPair.second;
+            ASSERT_EQ(albumIndex, trackAlbums[trackIndex]);
+            ASSERT_EQ(track.getTitle(), catalog.getString(titles[trackIndex]));
+            ASSERT_EQ(track.getPath().string(), catalog.getString(paths[trackIndex]));
+            ASSERT_EQ(track.getTrackNum(), catalog.getTrackNums()[trackIndex]);
+            ASSERT_EQ(track.getTotalTracks(), catalog.getTotalTracks()[trackIndex]);
+            ASSERT_EQ(track.getDiscNum(), catalog.getDiscNums()[trackIndex]);
+            ASSERT_EQ(static_cast<uint8_t>(AudioFormat::flac), catalog.getFormats()[trackIndex]);
+            ASSERT_EQ(1, catalog.getLossless()[trackIndex]);
+
+            Mbid trackMbid;
+            ASSERT_TRUE(Mbid::parse(track.getMBID(), trackMbid));
+            ASSERT_EQ(trackMbid, mbids[trackIndex]);
+            trackIndex++;
+        }
+        albumIndex++;
+    }
+
+    // Strings shared between tracks are only stored once.
+    ASSERT_EQ(catalog.getArtists()[0], catalog.getArtists()[catalog.getTrackCount() - 1]);
+    ASSERT_THROW(catalog.getString(catalog.getStringCount()), std::out_of_range);
+}
+
+TEST_F(CatalogTest, EmptyCatalog)
+{
+    Catalog::write(CATALOG_PATH, map<string,shared_ptr<Album>>());
+
+    const Catalog catalog = Catalog(CATALOG_PATH);
+    ASSERT_EQ(0U, catalog.getTrackCount());
+    ASSERT_EQ(0U, catalog.getAlbumCount());
+    ASSERT_EQ(1U, catalog.getStringCount());
+    ASSERT_EQ(catalog.getTitles().begin(), catalog.getTitles().end());
+}
+
+TEST_F(CatalogTest, RejectsCorruptFile)
+{
+    ASSERT_THROW(Catalog(fs::path("./does-not-exist.catalog")), std::runtime_error);
+
+    {
+        std::ofstream outFile = std::ofstream(CATALOG_PATH, std::ios::binary);
+        outFile << "not a catalog";
+    }
+    ASSERT_THROW(Catalog{CATALOG_PATH}, std::runtime_error);
+
+    Catalog::write(CATALOG_PATH, map<string,shared_ptr<Album>>());
+    fs::resize_file(CATALOG_PATH, fs::file_size(CATALOG_PATH) - 1);
+    ASSERT_THROW(Catalog{CATALOG_PATH}, std::runtime_error);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
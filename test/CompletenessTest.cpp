@@ -0,0 +1,200 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <Completeness.hpp>
+#include <Importer.hpp>
+
+#include <gtest/gtest.h>
+
+#include "FlacWriter.hpp"
+#include <json/reader.h>
+#include <json/value.h>
+
+namespace fs = std::filesystem;
+
+using namespace MusicList;
+
+class CompletenessTest : public ::testing::Test
+{
+protected:
+    const fs::path LIBRARY_DIR = fs::path("./completeness-test-library");
+    const fs::path REPORT_PATH = fs::path("./completeness-test.json");
+
+    uint32_t nextTrackId = 0;
+
+    /**
+     * Writes a FLAC file for a track of the album, with the extra comments appended.
+     */
+    void writeTrack(const std::string& album, uint32_t disc, uint32_t track, const std::vector<std::string>& extra)
+    {
+        char mbid[37];
+        snprintf(mbid, sizeof(mbid), "00000000-0000-4000-8000-%012x", nextTrackId++);
+
+        std::vector<std::string> comments = {
+            "ALBUM=" + album,
+            "ALBUMARTIST=Artist",
+            "MUSICBRAINZ_ALBUMID=" + album,
+            "MUSICBRAINZ_TRACKID=" + std::string(mbid),
+            "DISCNUMBER=" + std::to_string(disc),
+            "TRACKNUMBER=" + std::to_string(track)
+        };
+        comments.insert(comments.end(), extra.begin(), extra.end());
+
+        FlacWriter::write(LIBRARY_DIR / album / (std::to_string(nextTrackId) + ".flac"), comments);
+    }
+
+    void SetUp() override
+    {
+        // Complete single disc album.
+        for (uint32_t track = 1; track <= 3; track++)
+        {
+            writeTrack("complete", 1, track, {"TOTALTRACKS=3"});
+        }
+
+        // Two discs: track 3 is missing from the first, track 2 is duplicated on the second.
+        for (uint32_t track : {1, 2, 4})
+        {
+            writeTrack("gaps", 1, track, {"TOTALTRACKS=4", "TOTALDISCS=2"});
+        }
+        for (uint32_t track : {1, 2, 2, 3})
+        {
+            writeTrack("gaps", 2, track, {"TOTALTRACKS=3", "TOTALDISCS=2"});
+        }
+
+        // Three discs, of which only the first is present.
+        for (uint32_t track = 1; track <= 2; track++)
+        {
+            writeTrack("discs", 1, track, {"TOTALTRACKS=2", "TOTALDISCS=3"});
+        }
+
+        // No totals, so only the gap below the highest track number is known.
+        writeTrack("untotalled", 0, 1, {});
+        writeTrack("untotalled", 0, 3, {});
+        writeTrack("untotalled", 0, 0, {});
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(LIBRARY_DIR);
+        fs::remove(REPORT_PATH);
+    }
+
+    static const AlbumCompleteness* findAlbum(const CompletenessReport& report, const std::string& name)
+    {
+        for (const auto& album : report.getIncompleteAlbums())
+        {
+            if (album.album->getName() == name)
+            {
+                return &album;
+            }
+        }
+        return nullptr;
+    }
+};
+
+TEST_F(CompletenessTest, FindsMissingAndDuplicateTracks)
+{
+    Importer importer = Importer();
+    importer.runTrackSearch(LIBRARY_DIR, 0);
+    importer.generateAlbumsFromTracks();
+
+    const CompletenessReport report = CompletenessReport(importer.getAlbums());
+    ASSERT_EQ(4U, report.getAlbumCount());
+    ASSERT_EQ(3U, report.getIncompleteAlbums().size());
+    ASSERT_EQ(nullptr, findAlbum(report, "complete"));
+
+    const AlbumCompleteness* gaps = findAlbum(report, "gaps");
+    ASSERT_NE(nullptr, gaps);
+    ASSERT_TRUE(gaps->missingDiscs.empty());
+    ASSERT_EQ(2U, gaps->discs.size());
+    ASSERT_EQ(1, gaps->discs[0].discNum);
+    ASSERT_EQ(4, gaps->discs[0].totalTracks);
+    ASSERT_EQ(std::vector<uint_fast8_t>{3}, gaps->discs[0].missing);
+    ASSERT_TRUE(gaps->discs[0].duplicates.empty());
+    ASSERT_EQ(2, gaps->discs[1].discNum);
+    ASSERT_TRUE(gaps->discs[1].missing.empty());
+    ASSERT_EQ(std::vector<uint_fast8_t>{2}, gaps->discs[1].duplicates);
+
+    const AlbumCompleteness* discs = findAlbum(report, "discs");
+    ASSERT_NE(nullptr, discs);
+    ASSERT_EQ(3, discs->totalDiscs);
+    ASSERT_EQ((std::vector<uint_fast8_t>{2, 3}), discs->missingDiscs);
+    ASSERT_TRUE(discs->discs.empty());
+
+    const AlbumCompleteness* untotalled = findAlbum(report, "untotalled");
+    ASSERT_NE(nullptr, untotalled);
+    ASSERT_EQ(1U, untotalled->discs.size());
+    ASSERT_EQ(std::vector<uint_fast8_t>{2}, untotalled->discs[0].missing);
+    ASSERT_EQ(1U, untotalled->unnumberedTracks);
+
+    ASSERT_EQ(2U, report.getMissingTrackCount());
+    ASSERT_EQ(1U, report.getDuplicateTrackCount());
+    ASSERT_EQ(2U, report.getMissingDiscCount());
+}
+
+TEST_F(CompletenessTest, WritesReport)
+{
+    Importer importer = Importer();
+    importer.runTrackSearch(LIBRARY_DIR, 0);
+    importer.generateAlbumsFromTracks();
+
+    const CompletenessReport report = CompletenessReport(importer.getAlbums());
+    report.writeJSON(REPORT_PATH);
+
+    Json::Value root;
+    std::ifstream reportFile = std::ifstream(REPORT_PATH);
+    Json::CharReaderBuilder builder;
+    std::string errors;
+    ASSERT_TRUE(Json::parseFromStream(builder, reportFile, &root, &errors)) << errors;
+
+    ASSERT_EQ(4U, root["summary"]["albums"].asUInt());
+    ASSERT_EQ(1U, root["summary"]["complete_albums"].asUInt());
+    ASSERT_EQ(3U, root["summary"]["incomplete_albums"].asUInt());
+    ASSERT_EQ(2U, root["summary"]["missing_tracks"].asUInt());
+    ASSERT_EQ(3U, root["albums"].size());
+    for (const auto& album : root["albums"])
+    {
+        ASSERT_TRUE(album["discs"].isArray());
+        ASSERT_TRUE(album["missing_discs"].isArray());
+    }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,246 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <DirectorySnapshot.hpp>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+using namespace MusicList;
+
+class DirectorySnapshotTest : public ::testing::Test
+{
+protected:
+    const fs::path ROOT_DIR = fs::path("./snapshot-test");
+    const fs::path SNAPSHOT_PATH = fs::path("./snapshot-test.dirs");
+
+    void SetUp() override
+    {
+        fs::remove_all(ROOT_DIR);
+        for (const char* album : {"a", "b", "c"})
+        {
+            fs::create_directories(ROOT_DIR / album / "disc1");
+            writeFile(ROOT_DIR / album / "disc1" / "01.flac");
+            writeFile(ROOT_DIR / album / "cover.jpg");
+        }
+        ageTree();
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(ROOT_DIR);
+        fs::remove(SNAPSHOT_PATH);
+    }
+
+    static void writeFile(const fs::path& path)
+    {
+        std::ofstream outFile = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        outFile << "data";
+    }
+
+    /**
+     * Moves every directory's modification time out of the racy window so its listing is kept.
+     */
+    void ageTree() const
+    {
+        const auto past = fs::file_time_type::clock::now() - std::chrono::hours(1);
+        fs::last_write_time(ROOT_DIR, past);
+        for (const auto& entry : fs::recursive_directory_iterator(ROOT_DIR))
+        {
+            if (entry.is_directory())
+            {
+                fs::last_write_time(entry.path(), past);
+            }
+        }
+    }
+
+    static std::vector<fs::path> walkFlac(DirectorySnapshot& snapshot, const fs::path& root, uint32_t threadCount = 1)
+    {
+        std::vector<fs::path> files;
+        snapshot.walk(root, [](std::string_view name) { return fs::path(name).extension() == ".flac"; },
+                      [&files](const fs::path& path) { files.push_back(path); return true; }, threadCount);
+        return files;
+    }
+
+    static std::vector<fs::path> iterateFlac(const fs::path& root)
+    {
+        std::vector<fs::path> files;
+        for (const auto& entry : fs::recursive_directory_iterator(root))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".flac")
+            {
+                files.push_back(entry.path());
+            }
+        }
+        return files;
+    }
+};
+
+TEST_F(DirectorySnapshotTest, MatchesRecursiveIterator)
+{
+    DirectorySnapshot snapshot;
+    ASSERT_EQ(iterateFlac(ROOT_DIR), walkFlac(snapshot, ROOT_DIR));
+    ASSERT_EQ(0U, snapshot.getReusedCount());
+    ASSERT_EQ(7U, snapshot.getReadCount());
+    ASSERT_EQ(7U, snapshot.size());
+}
+
+TEST_F(DirectorySnapshotTest, ParallelWalkKeepsOrder)
+{
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        const fs::path albumDir = ROOT_DIR / "many" / std::to_string(i);
+        fs::create_directories(albumDir / "disc1");
+        writeFile(albumDir / "01.flac");
+        writeFile(albumDir / "disc1" / "02.flac");
+    }
+
+    const std::vector<fs::path> expected = iterateFlac(ROOT_DIR);
+    ASSERT_EQ(83U, expected.size());
+
+    DirectorySnapshot snapshot;
+    ASSERT_EQ(expected, walkFlac(snapshot, ROOT_DIR, 4));
+    ASSERT_EQ(88U, snapshot.getReadCount());
+
+    ageTree();
+    walkFlac(snapshot, ROOT_DIR, 4);
+    ASSERT_EQ(expected, walkFlac(snapshot, ROOT_DIR, 4));
+    ASSERT_EQ(88U, snapshot.getReusedCount());
+
+    // Stopping early leaves no threads behind.
+    uint32_t visited = 0;
+    ASSERT_FALSE(snapshot.walk(ROOT_DIR, [](std::string_view) { return true; },
+                               [&visited](const fs::path&) { return ++visited < 5; }, 4));
+    ASSERT_EQ(88U, snapshot.size());
+}
+
+TEST_F(DirectorySnapshotTest, ReusesUnchangedDirectories)
+{
+    {
+        DirectorySnapshot snapshot;
+        walkFlac(snapshot, ROOT_DIR);
+        snapshot.save(SNAPSHOT_PATH);
+    }
+
+    DirectorySnapshot loaded = DirectorySnapshot(SNAPSHOT_PATH);
+    ASSERT_EQ(7U, loaded.size());
+    ASSERT_EQ(iterateFlac(ROOT_DIR), walkFlac(loaded, ROOT_DIR));
+    ASSERT_EQ(7U, loaded.getReusedCount());
+    ASSERT_EQ(0U, loaded.getReadCount());
+
+    // Adding a file only changes its own directory.
+    writeFile(ROOT_DIR / "b" / "disc1" / "02.flac");
+    ASSERT_EQ(iterateFlac(ROOT_DIR), walkFlac(loaded, ROOT_DIR));
+    ASSERT_EQ(6U, loaded.getReusedCount());
+    ASSERT_EQ(1U, loaded.getReadCount());
+
+    // Removed directories are dropped from the snapshot.
+    fs::remove_all(ROOT_DIR / "c");
+    ageTree();
+    ASSERT_EQ(iterateFlac(ROOT_DIR), walkFlac(loaded, ROOT_DIR));
+    ASSERT_EQ(5U, loaded.size());
+}
+
+TEST_F(DirectorySnapshotTest, RacyDirectoriesAreNotKept)
+{
+    writeFile(ROOT_DIR / "a" / "disc1" / "02.flac");
+
+    DirectorySnapshot snapshot;
+    walkFlac(snapshot, ROOT_DIR);
+    ASSERT_EQ(6U, snapshot.size());
+
+    walkFlac(snapshot, ROOT_DIR);
+    ASSERT_EQ(1U, snapshot.getReadCount());
+}
+
+TEST_F(DirectorySnapshotTest, StoppedWalk)
+{
+    DirectorySnapshot snapshot;
+    uint32_t visited = 0;
+    ASSERT_FALSE(snapshot.walk(ROOT_DIR, [](std::string_view) { return true; },
+                               [&visited](const fs::path&) { return ++visited < 2; }));
+    ASSERT_EQ(2U, visited);
+
+    // A partial walk keeps what it read, and the rest is read next time.
+    ASSERT_TRUE(snapshot.walk(ROOT_DIR, [](std::string_view) { return true; },
+                              [](const fs::path&) { return true; }));
+    ASSERT_GT(snapshot.getReusedCount(), 0U);
+    ASSERT_EQ(7U, snapshot.getReusedCount() + snapshot.getReadCount());
+    ASSERT_EQ(7U, snapshot.size());
+}
+
+TEST_F(DirectorySnapshotTest, UnreadableDirectoriesAreNotKept)
+{
+    const fs::path removedDir = ROOT_DIR / "removed";
+    fs::create_directory(removedDir);
+    fs::last_write_time(removedDir, fs::file_time_type::clock::now() - std::chrono::hours(1));
+
+    // A removed directory can still be opened through a descriptor held on it, but reading
+    // its entries fails.
+    const int fd = open(removedDir.c_str(), O_RDONLY | O_DIRECTORY);
+    ASSERT_GE(fd, 0);
+    fs::remove(removedDir);
+
+    DirectorySnapshot snapshot;
+    ASSERT_TRUE(walkFlac(snapshot, fs::path("/proc/self/fd") / std::to_string(fd)).empty());
+    ASSERT_EQ(0U, snapshot.getReadCount());
+    ASSERT_EQ(0U, snapshot.size());
+
+    close(fd);
+}
+
+TEST_F(DirectorySnapshotTest, CorruptFile)
+{
+    {
+        std::ofstream snapshotFile = std::ofstream(SNAPSHOT_PATH, std::ios::binary);
+        snapshotFile << "not a snapshot";
+    }
+
+    DirectorySnapshot loaded = DirectorySnapshot(SNAPSHOT_PATH);
+    ASSERT_EQ(0U, loaded.size());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,152 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <DirectoryWatcher.hpp>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+using namespace MusicList;
+
+class DirectoryWatcherTest : public ::testing::Test
+{
+protected:
+    const fs::path WATCH_DIR = fs::path("./watcher-test");
+    const std::chrono::milliseconds TIMEOUT = std::chrono::milliseconds(2000);
+
+    void SetUp() override
+    {
+        fs::remove_all(WATCH_DIR);
+        fs::create_directories(WATCH_DIR / "album");
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(WATCH_DIR);
+    }
+
+    static void writeFile(const fs::path& path)
+    {
+        std::ofstream outFile = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        outFile << "data";
+    }
+
+    static bool contains(const std::vector<fs::path>& paths, const fs::path& path)
+    {
+        return std::find(paths.begin(), paths.end(), path) != paths.end();
+    }
+};
+
+TEST_F(DirectoryWatcherTest, WrittenAndRemovedFiles)
+{
+    DirectoryWatcher watcher = DirectoryWatcher(WATCH_DIR);
+    ASSERT_EQ(2U, watcher.size());
+
+    const fs::path trackPath = WATCH_DIR / "album" / "track.flac";
+    writeFile(trackPath);
+
+    DirectoryWatcher::Changes changes;
+    ASSERT_TRUE(watcher.wait(changes, TIMEOUT));
+    ASSERT_EQ(std::vector<fs::path>{trackPath}, changes.modified);
+    ASSERT_TRUE(changes.removed.empty());
+
+    fs::remove(trackPath);
+    ASSERT_TRUE(watcher.wait(changes, TIMEOUT));
+    ASSERT_TRUE(changes.modified.empty());
+    ASSERT_EQ(std::vector<fs::path>{trackPath}, changes.removed);
+
+    ASSERT_FALSE(watcher.wait(changes, std::chrono::milliseconds(0)));
+}
+
+TEST_F(DirectoryWatcherTest, MergesEvents)
+{
+    DirectoryWatcher watcher = DirectoryWatcher(WATCH_DIR);
+
+    const fs::path trackPath = WATCH_DIR / "album" / "track.flac";
+    writeFile(trackPath);
+    writeFile(trackPath);
+    fs::remove(trackPath);
+
+    DirectoryWatcher::Changes changes;
+    ASSERT_TRUE(watcher.wait(changes, TIMEOUT));
+    ASSERT_TRUE(changes.modified.empty());
+    ASSERT_EQ(std::vector<fs::path>{trackPath}, changes.removed);
+}
+
+TEST_F(DirectoryWatcherTest, NewAndMovedDirectories)
+{
+    DirectoryWatcher watcher = DirectoryWatcher(WATCH_DIR);
+
+    // Files written into a directory before its watch exists are still reported.
+    const fs::path newDir = WATCH_DIR / "new";
+    fs::create_directories(newDir / "disc1");
+    writeFile(newDir / "disc1" / "track.flac");
+
+    DirectoryWatcher::Changes changes;
+    ASSERT_TRUE(watcher.wait(changes, TIMEOUT));
+    ASSERT_TRUE(contains(changes.modified, newDir / "disc1" / "track.flac"));
+    ASSERT_EQ(4U, watcher.size());
+
+    // Moving a directory removes the old path and reports every file under the new one.
+    const fs::path movedDir = WATCH_DIR / "album" / "moved";
+    fs::rename(newDir, movedDir);
+    ASSERT_TRUE(watcher.wait(changes, TIMEOUT));
+    ASSERT_EQ(std::vector<fs::path>{newDir}, changes.removed);
+    ASSERT_EQ(std::vector<fs::path>{movedDir / "disc1" / "track.flac"}, changes.modified);
+    ASSERT_EQ(4U, watcher.size());
+
+    // Later changes are reported under the new path.
+    writeFile(movedDir / "disc1" / "other.flac");
+    ASSERT_TRUE(watcher.wait(changes, TIMEOUT));
+    ASSERT_EQ(std::vector<fs::path>{movedDir / "disc1" / "other.flac"}, changes.modified);
+}
+
+TEST_F(DirectoryWatcherTest, IsWithin)
+{
+    ASSERT_TRUE(DirectoryWatcher::isWithin(fs::path("./lib/a/b.flac"), fs::path("./lib/a")));
+    ASSERT_TRUE(DirectoryWatcher::isWithin(fs::path("./lib/a/b.flac"), fs::path("./lib/")));
+    ASSERT_TRUE(DirectoryWatcher::isWithin(fs::path("./lib/a"), fs::path("./lib/a")));
+    ASSERT_FALSE(DirectoryWatcher::isWithin(fs::path("./lib/ab/c.flac"), fs::path("./lib/a")));
+    ASSERT_FALSE(DirectoryWatcher::isWithin(fs::path("./lib"), fs::path("./lib/a")));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,167 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <FileReader.hpp>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+using namespace MusicList;
+
+class FileReaderTest : public ::testing::Test
+{
+protected:
+    const fs::path TEST_FILE = fs::path("./filereader-test.bin");
+    const size_t TEST_FILE_SIZE = FileReader::PREFIX_SIZE * 2 + 123;
+
+    void SetUp() override
+    {
+        std::ofstream outFile = std::ofstream(TEST_FILE, std::ios::binary | std::ios::trunc);
+        for (size_t i = 0; i < TEST_FILE_SIZE; i++)
+        {
+            outFile.put(static_cast<char>(i % 251));
+        }
+    }
+
+    void TearDown() override
+    {
+        fs::remove(TEST_FILE);
+    }
+};
+
+TEST_F(FileReaderTest, MissingFile)
+{
+    ASSERT_THROW(FileReader(fs::path("./does-not-exist.flac")), std::runtime_error);
+}
+
+TEST_F(FileReaderTest, PrefixBuffer)
+{
+    FileReader reader = FileReader(TEST_FILE);
+
+    ASSERT_EQ(TEST_FILE_SIZE, reader.getFileSize());
+    ASSERT_EQ(FileReader::PREFIX_SIZE, reader.size());
+    ASSERT_EQ(250, reader.data()[250]);
+
+    ASSERT_TRUE(reader.ensure(FileReader::PREFIX_SIZE + 10));
+    ASSERT_EQ((FileReader::PREFIX_SIZE + 10) % 251, reader.data()[FileReader::PREFIX_SIZE + 10 - 1] + 1U);
+
+    ASSERT_FALSE(reader.ensure(TEST_FILE_SIZE + 1));
+    ASSERT_EQ(TEST_FILE_SIZE, reader.size());
+}
+
+TEST_F(FileReaderTest, ReadAcrossPrefix)
+{
+    FileReader reader = FileReader(TEST_FILE);
+
+    std::vector<uint8_t> chunk(100);
+    const uint64_t offset = FileReader::PREFIX_SIZE - 50;
+    ASSERT_EQ(100U, reader.readAt(offset, chunk.data(), chunk.size()));
+    for (size_t i = 0; i < chunk.size(); i++)
+    {
+        ASSERT_EQ((offset + i) % 251, chunk[i]);
+    }
+
+    ASSERT_EQ(23U, reader.readAt(TEST_FILE_SIZE - 23, chunk.data(), chunk.size()));
+}
+
+TEST_F(FileReaderTest, SequentialAccess)
+{
+    FileReader reader = FileReader(TEST_FILE);
+
+    uint8_t value = 0;
+    ASSERT_TRUE(reader.seek(-1, SEEK_END));
+    ASSERT_EQ(1U, reader.read(&value, 1));
+    ASSERT_EQ((TEST_FILE_SIZE - 1) % 251, value);
+    ASSERT_EQ(TEST_FILE_SIZE, reader.tell());
+
+    ASSERT_FALSE(reader.seek(-1, SEEK_SET));
+    ASSERT_TRUE(reader.seek(10, SEEK_SET));
+    ASSERT_TRUE(reader.seek(5, SEEK_CUR));
+    ASSERT_EQ(15U, reader.tell());
+}
+
+TEST_F(FileReaderTest, MappedPrefix)
+{
+    FileReader reader = FileReader(TEST_FILE, ReadMode::mapped);
+
+    // Files smaller than the map size are mapped whole.
+    ASSERT_TRUE(reader.isMapped());
+    ASSERT_EQ(TEST_FILE_SIZE, reader.size());
+    ASSERT_EQ(250, reader.data()[250]);
+    ASSERT_EQ((TEST_FILE_SIZE - 1) % 251, reader.data()[TEST_FILE_SIZE - 1]);
+    ASSERT_FALSE(reader.ensure(TEST_FILE_SIZE + 1));
+
+    std::vector<uint8_t> chunk(64);
+    ASSERT_EQ(23U, reader.readAt(TEST_FILE_SIZE - 23, chunk.data(), chunk.size()));
+    ASSERT_EQ((TEST_FILE_SIZE - 23) % 251, chunk[0]);
+}
+
+TEST_F(FileReaderTest, MappedGrowth)
+{
+    const fs::path largeFile = fs::path("./filereader-large.bin");
+    const size_t largeSize = FileReader::MAP_SIZE * 2 + 7;
+    {
+        std::ofstream outFile = std::ofstream(largeFile, std::ios::binary | std::ios::trunc);
+        for (size_t i = 0; i < largeSize; i++)
+        {
+            outFile.put(static_cast<char>(i % 251));
+        }
+    }
+
+    {
+        FileReader reader = FileReader(largeFile, ReadMode::mapped);
+        ASSERT_EQ(FileReader::MAP_SIZE, reader.size());
+
+        std::vector<uint8_t> chunk(16);
+        ASSERT_EQ(16U, reader.readAt(FileReader::MAP_SIZE - 8, chunk.data(), chunk.size()));
+        ASSERT_EQ((FileReader::MAP_SIZE + 7) % 251, chunk[15]);
+
+        ASSERT_TRUE(reader.ensure(FileReader::MAP_SIZE + 1));
+        ASSERT_GT(reader.size(), FileReader::MAP_SIZE);
+        ASSERT_EQ(FileReader::MAP_SIZE % 251, reader.data()[FileReader::MAP_SIZE]);
+
+        ASSERT_TRUE(reader.ensure(largeSize));
+        ASSERT_EQ(largeSize, reader.size());
+    }
+
+    fs::remove(largeFile);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,109 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#ifndef MUSICLIST_TEST_FLACWRITER_HPP
+#define MUSICLIST_TEST_FLACWRITER_HPP
+
+#include <cinttypes>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * Writes minimal FLAC files for tests. They hold an empty STREAMINFO block and a VORBIS_COMMENT
+ * block, optionally followed by padding, and no audio.
+ */
+class FlacWriter
+{
+public:
+    static void appendUInt32LE(std::string& out, uint32_t value)
+    {
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            out.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    static void appendBlockHeader(std::string& out, uint8_t type, bool last, uint32_t length)
+    {
+        out.push_back(static_cast<char>(type | (last ? 0x80 : 0x00)));
+        out.push_back(static_cast<char>(length >> 16));
+        out.push_back(static_cast<char>(length >> 8));
+        out.push_back(static_cast<char>(length));
+    }
+
+    /**
+     * Builds the body of a VORBIS_COMMENT block, as also stored in Ogg comment headers.
+     */
+    static std::string commentBlock(const std::vector<std::string>& comments)
+    {
+        std::string block;
+        appendUInt32LE(block, 9);
+        block.append("musiclist");
+        appendUInt32LE(block, static_cast<uint32_t>(comments.size()));
+        for (const auto& comment : comments)
+        {
+            appendUInt32LE(block, static_cast<uint32_t>(comment.size()));
+            block.append(comment);
+        }
+        return block;
+    }
+
+    /**
+     * Writes a FLAC file with the provided comments, creating its directory if needed.
+     *
+     * @param paddingSize size of a PADDING block written after the comments. 0 writes none.
+     */
+    static void write(const std::filesystem::path& path, const std::vector<std::string>& comments,
+                      uint32_t paddingSize = 0)
+    {
+        const std::string block = commentBlock(comments);
+
+        std::string file = "fLaC";
+        appendBlockHeader(file, 0, false, 34);
+        file.append(34, '\0');
+        appendBlockHeader(file, 4, paddingSize == 0, static_cast<uint32_t>(block.size()));
+        file.append(block);
+        if (paddingSize > 0)
+        {
+            appendBlockHeader(file, 1, true, paddingSize);
+            file.append(paddingSize, '\0');
+        }
+
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream outFile = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        outFile.write(file.data(), static_cast<std::streamsize>(file.size()));
+    }
+};
+
+#endif // MUSICLIST_TEST_FLACWRITER_HPP
@@ -0,0 +1,327 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <FileReader.hpp>
+#include <Id3Tags.hpp>
+#include <Track.hpp>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+using namespace MusicList;
+
+using std::string;
+using std::vector;
+
+class Id3TagsTest : public ::testing::Test
+{
+protected:
+    const fs::path MP3_PATH = fs::path("./id3tags-test.mp3");
+    // Start of an MPEG-1 Layer III frame.
+    const string AUDIO = string("\xFF\xFB\x90\x00", 4) + string(2000, '\0');
+
+    using TagMap = std::map<string,vector<string>>;
+
+    void TearDown() override
+    {
+        fs::remove(MP3_PATH);
+    }
+
+    static string syncsafe(uint32_t value)
+    {
+        string out;
+        for (int i = 3; i >= 0; i--)
+        {
+            out.push_back(static_cast<char>((value >> (7 * i)) & 0x7F));
+        }
+        return out;
+    }
+
+    static string uint32BE(uint32_t value)
+    {
+        string out;
+        for (int i = 3; i >= 0; i--)
+        {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+        return out;
+    }
+
+    static string frame(uint8_t version, const string& id, const string& body, uint8_t flags = 0)
+    {
+        const string size = version == 4 ? syncsafe(static_cast<uint32_t>(body.size())) :
+            uint32BE(static_cast<uint32_t>(body.size()));
+        return id + size + '\0' + static_cast<char>(flags) + body;
+    }
+
+    static string tag(uint8_t version, const string& frames, uint8_t flags = 0)
+    {
+        const string body = frames + string(64, '\0');
+        return "ID3" + string(1, static_cast<char>(version)) + '\0' + static_cast<char>(flags) +
+            syncsafe(static_cast<uint32_t>(body.size())) + body;
+    }
+
+    /**
+     * Builds a text frame body from NUL-separated values.
+     */
+    static string text(const vector<string>& values, char encoding = '\0')
+    {
+        string out = string(1, encoding);
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            out += (i > 0 ? string(1, '\0') : "") + values[i];
+        }
+        return out;
+    }
+
+    static string unsynchronise(const string& data)
+    {
+        string out;
+        for (const char c : data)
+        {
+            out.push_back(c);
+            if (c == '\xFF')
+            {
+                out.push_back('\0');
+            }
+        }
+        return out;
+    }
+
+    static string utf16(const string& ascii)
+    {
+        string out = "\xFF\xFE";
+        for (const char c : ascii)
+        {
+            out.push_back(c);
+            out.push_back('\0');
+        }
+        return out;
+    }
+
+    static string v1Tag()
+    {
+        string tag = "TAG";
+        auto field = [&tag](const string& value, size_t width)
+        {
+            tag += value + string(width - value.size(), '\0');
+        };
+        field("Paranoid Android", 30);
+        field("Radiohead", 30);
+        field("OK Computer", 30);
+        field("1997", 4);
+        field("", 28);
+        tag += '\0';
+        tag += '\2';
+        tag += '\x11';
+        return tag;
+    }
+
+    static void writeFile(const fs::path& path, const string& data)
+    {
+        std::ofstream outFile = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        outFile.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    static bool readTags(const fs::path& path, TagMap& tags)
+    {
+        FileReader reader = FileReader(path);
+        return Id3Tags::read(reader, [&tags](const string& key, const string& value)
+        {
+            tags[key].push_back(value);
+        });
+    }
+};
+
+TEST_F(Id3TagsTest, Version3Unsynchronised)
+{
+    // Every 0xFF, including the ones in the UTF-16 BOM and the picture, is followed by a 0x00.
+    const string frames =
+        frame(3, "TIT2", "\x01" + utf16("Karma Police")) +
+        frame(3, "APIC", text({"image/jpeg", "\3", "\xFF\xD8\xFF\xE0"})) +
+        frame(3, "TALB", text({"OK Computer", ""})) +
+        frame(3, "TPE2", text({"Radiohead"})) +
+        frame(3, "TRCK", text({"6/12"})) +
+        frame(3, "TPOS", text({"1"})) +
+        frame(3, "TXXX", text({"MusicBrainz Album Id", "b1392450-e666-3926-a536-22c65f834433"}));
+    writeFile(MP3_PATH, tag(3, unsynchronise(frames), 0x80) + AUDIO);
+
+    TagMap tags;
+    ASSERT_TRUE(readTags(MP3_PATH, tags));
+
+    const TagMap expected = {
+        {"TITLE", {"Karma Police"}},
+        {"ALBUM", {"OK Computer"}},
+        {"ALBUMARTIST", {"Radiohead"}},
+        {"TRACKNUMBER", {"6"}},
+        {"TOTALTRACKS", {"12"}},
+        {"DISCNUMBER", {"1"}},
+        {"MUSICBRAINZ_ALBUMID", {"b1392450-e666-3926-a536-22c65f834433"}}
+    };
+    ASSERT_EQ(expected, tags);
+}
+
+TEST_F(Id3TagsTest, Version4)
+{
+    // UTF-8 with multiple NUL-separated values, and a frame with a data length indicator.
+    const string frames =
+        frame(4, "TIT2", text({"Caf\xC3\xA9"}, '\3')) +
+        frame(4, "TPE1", text({"Daft Punk", "Pharrell Williams"}, '\3')) +
+        frame(4, "TALB", syncsafe(14) + text({"Random Access"}, '\3'), 0x01) +
+        frame(4, "TXXX", text({"MusicBrainz Album Artist Id", "056a8e8d-fd9e-4c1c-a5cf-3d5ddbf1ccb9"}, '\3')) +
+        frame(4, "UFID", "http://musicbrainz.org" + string(1, '\0') + "a1b2c3d4-0000-4000-8000-000000000000") +
+        frame(4, "UFID", "http://example.com" + string(1, '\0') + "other") +
+        frame(4, "COMM", text({"eng", "comment"}, '\3'));
+    writeFile(MP3_PATH, tag(4, frames) + AUDIO);
+
+    TagMap tags;
+    ASSERT_TRUE(readTags(MP3_PATH, tags));
+
+    const TagMap expected = {
+        {"TITLE", {"Caf\xC3\xA9"}},
+        {"ARTIST", {"Daft Punk", "Pharrell Williams"}},
+        {"ALBUM", {"Random Access"}},
+        {"MUSICBRAINZ_ALBUMARTISTID", {"056a8e8d-fd9e-4c1c-a5cf-3d5ddbf1ccb9"}},
+        {"MUSICBRAINZ_TRACKID", {"a1b2c3d4-0000-4000-8000-000000000000"}}
+    };
+    ASSERT_EQ(expected, tags);
+}
+
+TEST_F(Id3TagsTest, LargeTag)
+{
+    // Cover art pushes the tag past MAX_BUFFERED_TAG, so frames are read one at a time.
+    const string frames =
+        frame(4, "TIT2", text({"Let Down"})) +
+        frame(4, "APIC", text({"image/png", string(Id3Tags::MAX_BUFFERED_TAG + 100, 'p')})) +
+        frame(4, "TALB", text({"OK Computer"}));
+    writeFile(MP3_PATH, tag(4, frames) + AUDIO);
+
+    TagMap tags;
+    ASSERT_TRUE(readTags(MP3_PATH, tags));
+    ASSERT_EQ(vector<string>{"Let Down"}, tags["TITLE"]);
+    ASSERT_EQ(vector<string>{"OK Computer"}, tags["ALBUM"]);
+    ASSERT_EQ(2U, tags.size());
+}
+
+TEST_F(Id3TagsTest, Version1Fallback)
+{
+    writeFile(MP3_PATH, AUDIO + v1Tag());
+
+    TagMap tags;
+    ASSERT_TRUE(readTags(MP3_PATH, tags));
+
+    const TagMap expected = {
+        {"TITLE", {"Paranoid Android"}},
+        {"ARTIST", {"Radiohead"}},
+        {"ALBUM", {"OK Computer"}},
+        {"DATE", {"1997"}},
+        {"TRACKNUMBER", {"2"}}
+    };
+    ASSERT_EQ(expected, tags);
+}
+
+TEST_F(Id3TagsTest, NoTags)
+{
+    writeFile(MP3_PATH, AUDIO);
+    ASSERT_EQ(AudioFormat::mp3, Track::determineFormat(MP3_PATH));
+
+    TagMap tags;
+    ASSERT_TRUE(readTags(MP3_PATH, tags));
+    ASSERT_TRUE(tags.empty());
+
+    // Untagged files are imported like untagged FLAC or M4A files.
+    Track track = Track(MP3_PATH);
+    ASSERT_EQ(AudioFormat::mp3, track.getAudioFormat());
+    ASSERT_EQ("", track.getTitle());
+
+    // ID3v2.2 isn't supported, so its tag is skipped.
+    writeFile(MP3_PATH, tag(2, frame(3, "TIT2", text({"Airbag"}))) + AUDIO);
+    ASSERT_TRUE(readTags(MP3_PATH, tags));
+    ASSERT_TRUE(tags.empty());
+
+    writeFile(MP3_PATH, string(100, 'x'));
+    ASSERT_EQ(AudioFormat::unknown, Track::determineFormat(MP3_PATH));
+}
+
+TEST_F(Id3TagsTest, MalformedTag)
+{
+    // The tag claims more bytes than the file holds.
+    writeFile(MP3_PATH, "ID3" + string(1, '\x03') + string(2, '\0') + syncsafe(100000) + AUDIO);
+
+    TagMap tags;
+    ASSERT_FALSE(readTags(MP3_PATH, tags));
+    ASSERT_THROW(Track track = Track(MP3_PATH), std::runtime_error);
+
+    // The ID3v1 tag is still used when there is one.
+    writeFile(MP3_PATH, "ID3" + string(1, '\x03') + string(2, '\0') + syncsafe(100000) + AUDIO + v1Tag());
+    ASSERT_TRUE(readTags(MP3_PATH, tags));
+    ASSERT_EQ(vector<string>{"Radiohead"}, tags["ARTIST"]);
+}
+
+TEST_F(Id3TagsTest, ImportTrack)
+{
+    const string frames =
+        frame(3, "TIT2", text({"Airbag"})) +
+        frame(3, "TALB", text({"OK Computer"})) +
+        frame(3, "TPE1", text({"Radiohead"})) +
+        frame(3, "TPE2", text({"Radiohead"})) +
+        frame(3, "TRCK", text({"1/12"})) +
+        frame(3, "TPOS", text({"1/1"})) +
+        frame(3, "UFID", "http://musicbrainz.org" + string(1, '\0') + "a1b2c3d4-0000-4000-8000-000000000000");
+    writeFile(MP3_PATH, tag(3, frames) + AUDIO);
+    ASSERT_EQ(AudioFormat::mp3, Track::determineFormat(MP3_PATH));
+
+    Track track = Track(MP3_PATH);
+    ASSERT_EQ(AudioFormat::mp3, track.getAudioFormat());
+    ASSERT_FALSE(track.getIsLossless());
+    ASSERT_EQ("Airbag", track.getTitle());
+    ASSERT_EQ("OK Computer", track.getAlbum());
+    ASSERT_EQ("Radiohead", track.getArtist());
+    ASSERT_EQ(1, track.getTrackNum());
+    ASSERT_EQ(12, track.getTotalTracks());
+    ASSERT_EQ(1, track.getDiscNum());
+    ASSERT_EQ(1, track.getTotalDiscs());
+    ASSERT_EQ("a1b2c3d4-0000-4000-8000-000000000000", track.getMBID());
+    ASSERT_EQ("MP3", track.toJSON()["format"].asString());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,133 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+#include <ImportArena.hpp>
+#include <Track.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace MusicList;
+
+TEST(ImportArenaTest, AlignedAllocations)
+{
+    ImportArena arena;
+
+    for (size_t alignment = 1; alignment <= 64; alignment *= 2)
+    {
+        void* ptr = arena.allocate(3 * alignment + 1, alignment);
+        ASSERT_NE(nullptr, ptr);
+        ASSERT_EQ(0U, reinterpret_cast<uintptr_t>(ptr) % alignment);
+        memset(ptr, 0xAB, 3 * alignment + 1);
+        arena.deallocate(ptr, 3 * alignment + 1, alignment);
+    }
+
+    // Larger than the initial block.
+    void* large = arena.allocate(ImportArena::INITIAL_BLOCK_SIZE * 4);
+    memset(large, 0, ImportArena::INITIAL_BLOCK_SIZE * 4);
+}
+
+TEST(ImportArenaTest, ConcurrentThreads)
+{
+    ImportArena arena;
+    std::vector<std::vector<uint32_t*>> values(4);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < values.size(); t++)
+    {
+        threads.emplace_back([&arena, &values, t]
+        {
+            for (uint32_t i = 0; i < 10000; i++)
+            {
+                auto* value = static_cast<uint32_t*>(arena.allocate(sizeof(uint32_t), alignof(uint32_t)));
+                *value = static_cast<uint32_t>(t * 10000 + i);
+                values[t].push_back(value);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (size_t t = 0; t < values.size(); t++)
+    {
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            ASSERT_EQ(t * 10000 + i, *values[t][i]);
+        }
+    }
+}
+
+TEST(ImportArenaTest, SharedTracks)
+{
+    ImportArena arena;
+    std::pmr::polymorphic_allocator<Track> allocator(&arena);
+
+    std::shared_ptr<Track> track = std::allocate_shared<Track>(allocator, &arena);
+    ASSERT_EQ("./", track->getPath());
+    ASSERT_TRUE(track->getTags().empty());
+    ASSERT_EQ("", track->getTag("TITLE"));
+}
+
+TEST(ImportArenaTest, TracksKeepArenaAlive)
+{
+    std::weak_ptr<ImportArena> weakArena;
+    std::shared_ptr<Track> track;
+    {
+        auto arena = std::make_shared<ImportArena>();
+        weakArena = arena;
+        track = std::allocate_shared<Track>(ArenaAllocator<Track>(arena), arena.get());
+    }
+
+    // The arena outlives its owner while a Track allocated from it is still held.
+    ASSERT_FALSE(weakArena.expired());
+    ASSERT_EQ("./", track->getPath());
+    ASSERT_EQ("", track->getTag("TITLE"));
+
+    std::shared_ptr<Track> copy = track;
+    track.reset();
+    ASSERT_FALSE(weakArena.expired());
+
+    copy.reset();
+    ASSERT_TRUE(weakArena.expired());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,164 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ImportMetrics.hpp>
+#include <Importer.hpp>
+
+#include <gtest/gtest.h>
+
+#include "FlacWriter.hpp"
+
+namespace fs = std::filesystem;
+
+using namespace MusicList;
+
+class ImportMetricsTest : public ::testing::Test
+{
+protected:
+    const fs::path LIBRARY_DIR = fs::path("./importmetrics-test-library");
+    const fs::path EXPORT_PATH = fs::path("./importmetrics-test.json");
+    const uint32_t TRACK_COUNT = 6;
+
+    void SetUp() override
+    {
+        fs::create_directories(LIBRARY_DIR);
+        for (uint32_t i = 0; i < TRACK_COUNT; i++)
+        {
+            FlacWriter::write(LIBRARY_DIR / (std::to_string(i) + ".flac"), {"ALBUM=Album", "ALBUMARTIST=Artist"});
+        }
+
+        // Has a supported extension, but isn't a FLAC file.
+        std::ofstream(LIBRARY_DIR / "broken.flac") << "not a flac file";
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(LIBRARY_DIR);
+        fs::remove(EXPORT_PATH);
+    }
+};
+
+TEST_F(ImportMetricsTest, Histogram)
+{
+    ImportMetrics metrics;
+    ASSERT_EQ(0U, metrics.getParsePercentile(50));
+
+    for (uint32_t i = 0; i < 90; i++)
+    {
+        metrics.addParseTime(std::chrono::microseconds(5));
+    }
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        metrics.addParseTime(std::chrono::microseconds(300));
+    }
+
+    const std::vector<uint64_t> histogram = metrics.getParseHistogram();
+    ASSERT_EQ(ImportMetrics::HISTOGRAM_BUCKETS, histogram.size());
+    ASSERT_EQ(90U, histogram[2]);
+    ASSERT_EQ(10U, histogram[8]);
+
+    ASSERT_EQ(8000U, metrics.getParsePercentile(50));
+    ASSERT_EQ(8000U, metrics.getParsePercentile(90));
+    // The slowest bucket is capped at the slowest time seen.
+    ASSERT_EQ(300000U, metrics.getParsePercentile(99));
+    ASSERT_EQ(300000U, metrics.getParseMax());
+
+    metrics.addParseTime(std::chrono::hours(1));
+    ASSERT_EQ(1U, metrics.getParseHistogram().back());
+
+    metrics.reset();
+    ASSERT_EQ(0U, metrics.getParseMax());
+    ASSERT_EQ(0U, metrics.getParseHistogram()[2]);
+}
+
+TEST_F(ImportMetricsTest, StageTimer)
+{
+    ImportMetrics metrics;
+    {
+        ImportMetrics::StageTimer timer = ImportMetrics::StageTimer(metrics, ImportMetrics::Stage::grouping);
+        timer.setItems(3);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    const ImportMetrics::StageTotals totals = metrics.getStage(ImportMetrics::Stage::grouping);
+    ASSERT_GE(totals.wallNs, 5000000U);
+    ASSERT_EQ(3U, totals.items);
+    // Sleeping doesn't use any CPU time or read anything.
+    ASSERT_LT(totals.cpuNs, totals.wallNs);
+    ASSERT_EQ(0U, totals.readSyscalls);
+
+    const Json::Value root = metrics.toJSON();
+    ASSERT_TRUE(root["stages"].isMember("grouping"));
+    ASSERT_FALSE(root["stages"].isMember("search"));
+    ASSERT_EQ(3U, root["stages"]["grouping"]["items"].asUInt64());
+}
+
+TEST_F(ImportMetricsTest, Import)
+{
+    Importer importer = Importer(2);
+    importer.runTrackSearch(LIBRARY_DIR, 0);
+    importer.generateAlbumsFromTracks();
+    importer.writeJSON(EXPORT_PATH);
+
+    const ImportMetrics& metrics = importer.getMetrics();
+    ASSERT_EQ(TRACK_COUNT + 1, metrics.get(ImportMetrics::Counter::discovered));
+    ASSERT_EQ(TRACK_COUNT, metrics.get(ImportMetrics::Counter::imported));
+    ASSERT_EQ(1U, metrics.get(ImportMetrics::Counter::unsupportedFiles));
+    ASSERT_EQ(0U, metrics.get(ImportMetrics::Counter::parseFailures));
+    ASSERT_EQ(0U, metrics.get(ImportMetrics::Counter::cacheHits));
+
+    ASSERT_EQ(TRACK_COUNT, metrics.getStage(ImportMetrics::Stage::search).items);
+    ASSERT_EQ(TRACK_COUNT + 1, metrics.getStage(ImportMetrics::Stage::discovery).items);
+    ASSERT_EQ(TRACK_COUNT, metrics.getStage(ImportMetrics::Stage::parsing).items);
+    ASSERT_EQ(TRACK_COUNT, metrics.getStage(ImportMetrics::Stage::grouping).items);
+    ASSERT_EQ(1U, metrics.getStage(ImportMetrics::Stage::jsonExport).items);
+    ASSERT_GT(metrics.getStage(ImportMetrics::Stage::search).wallNs, 0U);
+
+    uint64_t histogramCount = 0;
+    for (const auto count : metrics.getParseHistogram())
+    {
+        histogramCount += count;
+    }
+    ASSERT_EQ(TRACK_COUNT, histogramCount);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
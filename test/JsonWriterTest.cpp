@@ -0,0 +1,184 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <JsonWriter.hpp>
+
+#include <json/value.h>
+#include <json/writer.h>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+using namespace MusicList;
+
+class JsonWriterTest : public ::testing::Test
+{
+protected:
+    const fs::path OUT_PATH = fs::path("./jsonwriter-test.json");
+
+    void TearDown() override
+    {
+        fs::remove(OUT_PATH);
+    }
+
+    /**
+     * Writes a value the way the CLI used to, through jsoncpp.
+     */
+    static std::string jsoncppOutput(const Json::Value& value)
+    {
+        Json::StreamWriterBuilder builder;
+        builder["commentStyle"] = "None";
+        builder["indentation"] = "  ";
+        std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+
+        std::ostringstream outStr;
+        writer->write(value, &outStr);
+        outStr << std::endl;
+        return outStr.str();
+    }
+
+    std::string readOutput() const
+    {
+        std::ifstream inFile = std::ifstream(OUT_PATH, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(inFile), std::istreambuf_iterator<char>());
+    }
+};
+
+TEST_F(JsonWriterTest, MatchesJsoncppLayout)
+{
+    const std::string names[] = {"Morning Phase", "Quote \" and \\ slash /", "Tab\tNew\nline\x01",
+                                 "Caf\xC3\xA9 \xE6\x97\xA5\xE6\x9C\xAC \xF0\x9F\x8E\xB5",
+                                 "Bad \xC3 \xE6\x97 \xED\xA0\x80 \xC0\xAF \xFF end"};
+
+    Json::Value root;
+    JsonWriter writer = JsonWriter(OUT_PATH);
+    writer.beginArray();
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        Json::Value album;
+        album["artist"] = names[i];
+        album["empty"] = Json::Value(Json::objectValue);
+        album["name"] = names[(i + 1) % 5];
+        album["none"] = Json::Value(Json::arrayValue);
+        album["total_tracks"] = i * 3;
+        album["tracks"] = Json::Value();
+        for (uint32_t j = 0; j < i; j++)
+        {
+            Json::Value track;
+            track["is_lossless"] = j % 2 == 0;
+            track["title"] = names[j];
+            album["tracks"].append(track);
+        }
+        root[i] = album;
+
+        writer.beginObject();
+        writer.writeKey("artist");
+        writer.writeString(names[i]);
+        writer.writeKey("empty");
+        writer.beginObject();
+        writer.endObject();
+        writer.writeKey("name");
+        writer.writeString(names[(i + 1) % 5]);
+        writer.writeKey("none");
+        writer.beginArray();
+        writer.endArray();
+        writer.writeKey("total_tracks");
+        writer.writeInt(i * 3);
+        writer.writeKey("tracks");
+        if (i == 0)
+        {
+            writer.writeNull();
+        }
+        else
+        {
+            writer.beginArray();
+            for (uint32_t j = 0; j < i; j++)
+            {
+                writer.beginObject();
+                writer.writeKey("is_lossless");
+                writer.writeBool(j % 2 == 0);
+                writer.writeKey("title");
+                writer.writeString(names[j]);
+                writer.endObject();
+            }
+            writer.endArray();
+        }
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.close();
+
+    ASSERT_EQ(jsoncppOutput(root), readOutput());
+}
+
+TEST_F(JsonWriterTest, NullDocument)
+{
+    JsonWriter writer = JsonWriter(OUT_PATH);
+    writer.writeNull();
+    writer.close();
+
+    ASSERT_EQ(jsoncppOutput(Json::Value()), readOutput());
+}
+
+TEST_F(JsonWriterTest, EscapesLikeJsoncpp)
+{
+    std::mt19937 random(1234);
+    for (uint32_t i = 0; i < 2000; i++)
+    {
+        std::string value(random() % 12, '\0');
+        for (auto& c : value)
+        {
+            c = static_cast<char>(random());
+        }
+
+        std::string quoted;
+        JsonWriter::appendQuoted(quoted, value);
+
+        std::string expected = jsoncppOutput(Json::Value(value.data(), value.data() + value.size()));
+        expected.pop_back();
+        ASSERT_EQ(expected, quoted);
+    }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
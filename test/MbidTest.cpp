@@ -0,0 +1,81 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <unordered_set>
+
+#include <Mbid.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace MusicList;
+
+TEST(MbidTest, ParsesCanonicalForm)
+{
+    Mbid mbid;
+    ASSERT_TRUE(Mbid::parse("6d6f7a4e-0123-4567-89ab-cdef01234567", mbid));
+    ASSERT_EQ(0x6d6f7a4e01234567ULL, mbid.high);
+    ASSERT_EQ(0x89abcdef01234567ULL, mbid.low);
+
+    Mbid upper;
+    ASSERT_TRUE(Mbid::parse("6D6F7A4E-0123-4567-89AB-CDEF01234567", upper));
+    ASSERT_EQ(mbid, upper);
+}
+
+TEST(MbidTest, RejectsMalformed)
+{
+    Mbid mbid;
+    ASSERT_FALSE(Mbid::parse("", mbid));
+    ASSERT_FALSE(Mbid::parse("6d6f7a4e-0123-4567-89ab-cdef0123456", mbid));
+    ASSERT_FALSE(Mbid::parse("6d6f7a4e-0123-4567-89ab-cdef012345678", mbid));
+    ASSERT_FALSE(Mbid::parse("6d6f7a4e00123-4567-89ab-cdef01234567", mbid));
+    ASSERT_FALSE(Mbid::parse("6d6f7a4e-0123-4567-89ab-cdef0123456g", mbid));
+}
+
+TEST(MbidTest, Hashable)
+{
+    std::unordered_set<Mbid, MbidHash> ids;
+    Mbid mbid;
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        char text[37];
+        snprintf(text, sizeof(text), "00000000-0000-4000-8000-%012u", i);
+        ASSERT_TRUE(Mbid::parse(text, mbid));
+        ids.insert(mbid);
+        ids.insert(mbid);
+    }
+    ASSERT_EQ(100U, ids.size());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,249 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <Importer.hpp>
+#include <MetadataCache.hpp>
+
+#include <gtest/gtest.h>
+
+#include "FlacWriter.hpp"
+
+namespace fs = std::filesystem;
+
+using namespace MusicList;
+
+class MetadataCacheTest : public ::testing::Test
+{
+protected:
+    const fs::path CACHE_PATH = fs::path("./metadata-test.cache");
+    const fs::path TRACK_PATH = fs::path("./res/turn_away.flac");
+
+    void TearDown() override
+    {
+        fs::remove(CACHE_PATH);
+    }
+};
+
+TEST_F(MetadataCacheTest, StampMatching)
+{
+    MetadataCache cache = MetadataCache();
+    FileStamp stamp = {12, 34, 56};
+
+    cache.store(Track(), stamp);
+
+    Track restored;
+    ASSERT_TRUE(cache.restore(restored, fs::path("./"), stamp));
+
+    FileStamp modified = stamp;
+    modified.mtime++;
+    ASSERT_FALSE(cache.restore(restored, fs::path("./"), modified));
+    ASSERT_FALSE(cache.restore(restored, TRACK_PATH, stamp));
+}
+
+TEST_F(MetadataCacheTest, SaveAndLoad)
+{
+    FileStamp stamp = {1, 2, 3};
+    {
+        MetadataCache cache = MetadataCache();
+        cache.store(Track(), stamp);
+        cache.save(CACHE_PATH);
+    }
+
+    MetadataCache loaded = MetadataCache(CACHE_PATH);
+    ASSERT_EQ(1U, loaded.size());
+
+    Track restored;
+    ASSERT_TRUE(loaded.restore(restored, fs::path("./"), stamp));
+    ASSERT_EQ(AudioFormat::unknown, restored.getAudioFormat());
+    ASSERT_EQ(0, restored.getTrackNum());
+}
+
+TEST_F(MetadataCacheTest, Prune)
+{
+    FileStamp stamp = {1, 2, 3};
+    {
+        MetadataCache cache = MetadataCache();
+        cache.store(Track(), stamp);
+        cache.save(CACHE_PATH);
+    }
+
+    MetadataCache loaded = MetadataCache(CACHE_PATH);
+    loaded.prune();
+    ASSERT_EQ(0U, loaded.size());
+}
+
+TEST_F(MetadataCacheTest, PictureRecording)
+{
+    ReadOptions options;
+    options.recordPictures = true;
+
+    FileStamp stamp = {1, 2, 3};
+    MetadataCache cache = MetadataCache();
+    cache.store(Track(), stamp);
+
+    // Entries stored without pictures can't serve Tracks that record them.
+    Track recording;
+    recording.setReadOptions(options);
+    ASSERT_FALSE(cache.restore(recording, fs::path("./"), stamp));
+
+    Track recorded;
+    recorded.setReadOptions(options);
+    cache.store(recorded, stamp);
+    cache.save(CACHE_PATH);
+
+    MetadataCache loaded = MetadataCache(CACHE_PATH);
+    ASSERT_TRUE(loaded.restore(recording, fs::path("./"), stamp));
+    ASSERT_TRUE(recording.getPictures().empty());
+
+    Track plain;
+    ASSERT_TRUE(loaded.restore(plain, fs::path("./"), stamp));
+}
+
+TEST_F(MetadataCacheTest, CorruptFile)
+{
+    {
+        std::ofstream cacheFile = std::ofstream(CACHE_PATH, std::ios::binary);
+        cacheFile << "not a cache";
+    }
+
+    MetadataCache loaded = MetadataCache(CACHE_PATH);
+    ASSERT_EQ(0U, loaded.size());
+}
+
+TEST_F(MetadataCacheTest, InvalidFormat)
+{
+    FileStamp stamp = {1, 2, 3};
+    {
+        MetadataCache cache = MetadataCache();
+        cache.store(Track(), stamp);
+        cache.save(CACHE_PATH);
+    }
+
+    // Magic, version, entry count, the "./" path and the stamp come before the format byte.
+    const std::streamoff formatOffset = 8 + 4 + 4 + 4 + 2 + 24;
+    {
+        std::fstream cacheFile = std::fstream(CACHE_PATH, std::ios::binary | std::ios::in | std::ios::out);
+        cacheFile.seekp(formatOffset);
+        cacheFile.put(static_cast<char>(0xFE));
+    }
+
+    MetadataCache loaded = MetadataCache(CACHE_PATH);
+    ASSERT_EQ(0U, loaded.size());
+}
+
+TEST_F(MetadataCacheTest, SavedAfterUpdates)
+{
+    const fs::path libraryDir = fs::path("./metadata-test-library");
+    const fs::path first = libraryDir / "1.flac";
+    const fs::path second = libraryDir / "2.flac";
+    fs::create_directories(libraryDir);
+    FlacWriter::write(first, {"TITLE=One", "MUSICBRAINZ_TRACKID=one", "MUSICBRAINZ_ALBUMID=album"});
+    FlacWriter::write(second, {"TITLE=Two", "MUSICBRAINZ_TRACKID=two", "MUSICBRAINZ_ALBUMID=album"});
+
+    Importer importer = Importer();
+    importer.setQuiet(true);
+    importer.setProgressCallback(ProgressCallback());
+    importer.setCachePath(CACHE_PATH);
+    importer.runTrackSearch(libraryDir, 0);
+    importer.generateAlbumsFromTracks();
+    ASSERT_EQ(2U, importer.getAlbums().at("album")->getTrackSet().size());
+
+    // Re-read tracks replace the old ones in their album.
+    FlacWriter::write(first, {"TITLE=One again", "MUSICBRAINZ_TRACKID=one", "MUSICBRAINZ_ALBUMID=album"});
+    ASSERT_TRUE(importer.updateTracks({first}, {}));
+    ASSERT_EQ(2U, importer.getAlbums().at("album")->getTrackSet().size());
+    ASSERT_EQ("One again", importer.getAlbums().at("album")->getTrackSet().at("one")->getTitle());
+
+    // Removing a file alone still writes the cache back.
+    fs::remove(CACHE_PATH);
+    fs::remove(second);
+    ASSERT_TRUE(importer.updateTracks({}, {second}));
+    ASSERT_TRUE(fs::exists(CACHE_PATH));
+    ASSERT_EQ(1U, importer.getAlbums().at("album")->getTrackSet().size());
+    ASSERT_EQ(1U, MetadataCache(CACHE_PATH).size());
+
+    fs::remove_all(libraryDir);
+    fs::remove(fs::path(CACHE_PATH.string() + ".dirs"));
+}
+
+TEST_F(MetadataCacheTest, UpdatesRefreshAlbumDetails)
+{
+    const fs::path libraryDir = fs::path("./metadata-test-retag");
+    const fs::path first = libraryDir / "1.flac";
+    const fs::path second = libraryDir / "disc2" / "2.flac";
+    fs::create_directories(libraryDir / "disc2");
+    FlacWriter::write(first, {"ALBUM=Old", "TOTALTRACKS=3", "MUSICBRAINZ_TRACKID=one", "MUSICBRAINZ_ALBUMID=album"});
+    FlacWriter::write(second, {"ALBUM=Old", "TOTALTRACKS=3", "MUSICBRAINZ_TRACKID=two", "MUSICBRAINZ_ALBUMID=album"});
+
+    Importer importer = Importer();
+    importer.setQuiet(true);
+    importer.setProgressCallback(ProgressCallback());
+    importer.setCachePath(CACHE_PATH);
+    importer.runTrackSearch(libraryDir, 0);
+    importer.generateAlbumsFromTracks();
+    ASSERT_EQ("Old", importer.getAlbums().at("album")->getName());
+
+    // Files retagged one at a time end up with the details a fresh import would give them.
+    FlacWriter::write(first, {"ALBUM=New", "TOTALTRACKS=2", "MUSICBRAINZ_TRACKID=one", "MUSICBRAINZ_ALBUMID=album"});
+    ASSERT_TRUE(importer.updateTracks({first}, {}));
+    FlacWriter::write(second, {"ALBUM=New", "TOTALTRACKS=2", "MUSICBRAINZ_TRACKID=two", "MUSICBRAINZ_ALBUMID=album"});
+    ASSERT_TRUE(importer.updateTracks({second}, {}));
+    ASSERT_EQ("New", importer.getAlbums().at("album")->getName());
+    ASSERT_EQ(2, importer.getAlbums().at("album")->getTotalTracks());
+    ASSERT_EQ(2U, importer.getAlbums().at("album")->getTrackSet().size());
+
+    // Moving a track to another album leaves the rest in place.
+    FlacWriter::write(first, {"ALBUM=Other", "MUSICBRAINZ_TRACKID=one", "MUSICBRAINZ_ALBUMID=other"});
+    ASSERT_TRUE(importer.updateTracks({first}, {}));
+    ASSERT_EQ("Other", importer.getAlbums().at("other")->getName());
+    ASSERT_EQ(1U, importer.getAlbums().at("album")->getTrackSet().size());
+
+    // Removing a directory drops its tracks and their cache entries.
+    fs::remove_all(libraryDir / "disc2");
+    ASSERT_TRUE(importer.updateTracks({}, {libraryDir / "disc2"}));
+    ASSERT_EQ(0U, importer.getAlbums().count("album"));
+    ASSERT_EQ(1U, importer.getAlbums().size());
+    ASSERT_EQ(1U, MetadataCache(CACHE_PATH).size());
+
+    fs::remove_all(libraryDir);
+    fs::remove(fs::path(CACHE_PATH.string() + ".dirs"));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
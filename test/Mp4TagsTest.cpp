@@ -0,0 +1,257 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <FileReader.hpp>
+#include <Mp4Tags.hpp>
+#include <Track.hpp>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+using namespace MusicList;
+
+using std::string;
+using std::vector;
+
+class Mp4TagsTest : public ::testing::Test
+{
+protected:
+    const fs::path M4A_PATH = fs::path("./mp4tags-test.m4a");
+
+    using TagMap = std::map<string,vector<string>>;
+
+    void TearDown() override
+    {
+        fs::remove(M4A_PATH);
+    }
+
+    static string uint32BE(uint32_t value)
+    {
+        string out;
+        for (int i = 3; i >= 0; i--)
+        {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+        return out;
+    }
+
+    static string box(const string& type, const string& body)
+    {
+        return uint32BE(static_cast<uint32_t>(body.size() + 8)) + type + body;
+    }
+
+    static string fullBox(const string& type, const string& body)
+    {
+        return box(type, string(4, '\0') + body);
+    }
+
+    static string dataBox(const string& value, uint32_t typeIndicator = 1)
+    {
+        return box("data", uint32BE(typeIndicator) + uint32BE(0) + value);
+    }
+
+    static string indexItem(const string& type, uint16_t index, uint16_t total)
+    {
+        string value = string(2, '\0');
+        value.push_back(static_cast<char>(index >> 8));
+        value.push_back(static_cast<char>(index));
+        value.push_back(static_cast<char>(total >> 8));
+        value.push_back(static_cast<char>(total));
+        value.append(2, '\0');
+        return box(type, dataBox(value, 0));
+    }
+
+    static string freeformItem(const string& name, const string& value)
+    {
+        return box("----", fullBox("mean", "com.apple.iTunes") + fullBox("name", name) + dataBox(value));
+    }
+
+    /**
+     * Builds a moov box with a single audio track using the provided sample entry type.
+     */
+    static string moov(const string& codec, const string& ilst, bool fullMeta)
+    {
+        const string sampleEntry = box(codec, string(28, '\0'));
+        const string stbl = box("stbl", fullBox("stsd", uint32BE(1) + sampleEntry) + fullBox("stts", uint32BE(0)));
+        const string minf = box("minf", fullBox("smhd", string(4, '\0')) + stbl);
+        const string mdia = box("mdia", fullBox("mdhd", string(20, '\0')) +
+            fullBox("hdlr", string(4, '\0') + "soun" + string(13, '\0')) + minf);
+        const string trak = box("trak", fullBox("tkhd", string(80, '\0')) + mdia);
+
+        const string metaBody = fullBox("hdlr", string(4, '\0') + "mdirappl" + string(9, '\0')) + ilst;
+        const string meta = fullMeta ? fullBox("meta", metaBody) : box("meta", metaBody);
+
+        return box("moov", fullBox("mvhd", string(96, '\0')) + trak + box("udta", meta));
+    }
+
+    static string ftyp()
+    {
+        return box("ftyp", "M4A " + uint32BE(0x200) + "isomiso2");
+    }
+
+    static void writeFile(const fs::path& path, const string& data)
+    {
+        std::ofstream outFile = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        outFile.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    static bool readTags(const fs::path& path, TagMap& tags, Mp4Tags::Codec& codec)
+    {
+        FileReader reader = FileReader(path);
+        return Mp4Tags::read(reader, [&tags](const string& key, const string& value)
+        {
+            tags[key].push_back(value);
+        }, codec);
+    }
+
+    static string standardIlst(const string& extra)
+    {
+        return box("ilst",
+            box("\xA9nam", dataBox("Turn Away")) +
+            box("\xA9" "alb", dataBox("Morning Phase")) +
+            box("aART", dataBox("Beck")) +
+            box("\xA9" "ART", dataBox("Beck") + dataBox("Guest")) +
+            indexItem("trkn", 11, 13) +
+            indexItem("disk", 1, 2) +
+            extra +
+            freeformItem("MusicBrainz Track Id", "4e8ff10b-1da4-4d4c-9b6a-4f8e0cf1a8f1") +
+            freeformItem("MusicBrainz Album Id", "5a5e0d4b-3c5e-4bf9-8f5b-0a0d2c4ae5f2") +
+            freeformItem("Unknown Field", "ignored") +
+            box("\xA9too", dataBox("Lavf58.29.100")));
+    }
+};
+
+TEST_F(Mp4TagsTest, MdatBeforeMoov)
+{
+    // Cover art pushes the ilst past MAX_BUFFERED_ILST, so it's walked item by item.
+    const string cover = box("covr", dataBox(string(Mp4Tags::MAX_BUFFERED_ILST + 100, 'c'), 13));
+    writeFile(M4A_PATH, ftyp() + box("free", "") + box("mdat", string(FileReader::PREFIX_SIZE * 4, 'a')) +
+        moov("alac", standardIlst(cover), true));
+
+    TagMap tags;
+    Mp4Tags::Codec codec;
+    ASSERT_TRUE(readTags(M4A_PATH, tags, codec));
+    ASSERT_EQ(Mp4Tags::Codec::alac, codec);
+
+    const TagMap expected = {
+        {"TITLE", {"Turn Away"}},
+        {"ALBUM", {"Morning Phase"}},
+        {"ALBUMARTIST", {"Beck"}},
+        {"ARTIST", {"Beck", "Guest"}},
+        {"TRACKNUMBER", {"11"}},
+        {"TOTALTRACKS", {"13"}},
+        {"DISCNUMBER", {"1"}},
+        {"TOTALDISCS", {"2"}},
+        {"MUSICBRAINZ_TRACKID", {"4e8ff10b-1da4-4d4c-9b6a-4f8e0cf1a8f1"}},
+        {"MUSICBRAINZ_ALBUMID", {"5a5e0d4b-3c5e-4bf9-8f5b-0a0d2c4ae5f2"}}
+    };
+    ASSERT_EQ(expected, tags);
+}
+
+TEST_F(Mp4TagsTest, QuickTimeMeta)
+{
+    writeFile(M4A_PATH, ftyp() + moov("mp4a", standardIlst(""), false) + box("mdat", string(1000, 'a')));
+
+    TagMap tags;
+    Mp4Tags::Codec codec;
+    ASSERT_TRUE(readTags(M4A_PATH, tags, codec));
+    ASSERT_EQ(Mp4Tags::Codec::aac, codec);
+    ASSERT_EQ(vector<string>{"Turn Away"}, tags["TITLE"]);
+    ASSERT_EQ(vector<string>{"2"}, tags["TOTALDISCS"]);
+}
+
+TEST_F(Mp4TagsTest, LargeMdat)
+{
+    // A 64-bit box size pointing past the end of the file is rejected rather than followed.
+    string mdat = uint32BE(1) + "mdat";
+    mdat += uint32BE(1) + uint32BE(16);
+    writeFile(M4A_PATH, ftyp() + mdat + moov("mp4a", standardIlst(""), true));
+
+    TagMap tags;
+    Mp4Tags::Codec codec;
+    ASSERT_FALSE(readTags(M4A_PATH, tags, codec));
+    ASSERT_TRUE(tags.empty());
+}
+
+TEST_F(Mp4TagsTest, NoTags)
+{
+    writeFile(M4A_PATH, ftyp() + box("moov", fullBox("mvhd", string(96, '\0'))));
+
+    TagMap tags;
+    Mp4Tags::Codec codec;
+    ASSERT_TRUE(readTags(M4A_PATH, tags, codec));
+    ASSERT_EQ(Mp4Tags::Codec::unknown, codec);
+    ASSERT_TRUE(tags.empty());
+}
+
+TEST_F(Mp4TagsTest, NotMp4)
+{
+    writeFile(M4A_PATH, "ID3" + string(100, '\0'));
+
+    TagMap tags;
+    Mp4Tags::Codec codec;
+    ASSERT_FALSE(readTags(M4A_PATH, tags, codec));
+    ASSERT_EQ(AudioFormat::unknown, Track::determineFormat(M4A_PATH));
+}
+
+TEST_F(Mp4TagsTest, ImportTrack)
+{
+    writeFile(M4A_PATH, ftyp() + box("mdat", string(5000, 'a')) + moov("alac", standardIlst(""), true));
+    ASSERT_EQ(AudioFormat::aac, Track::determineFormat(M4A_PATH));
+
+    Track track = Track(M4A_PATH);
+    ASSERT_EQ(AudioFormat::alac, track.getAudioFormat());
+    ASSERT_TRUE(track.getIsLossless());
+    ASSERT_EQ("Turn Away", track.getTitle());
+    ASSERT_EQ("Morning Phase", track.getAlbum());
+    ASSERT_EQ("Beck", track.getArtist());
+    ASSERT_EQ("Guest", track.getTag("ARTIST1"));
+    ASSERT_EQ(11, track.getTrackNum());
+    ASSERT_EQ(13, track.getTotalTracks());
+    ASSERT_EQ(1, track.getDiscNum());
+    ASSERT_EQ(2, track.getTotalDiscs());
+    ASSERT_EQ("4e8ff10b-1da4-4d4c-9b6a-4f8e0cf1a8f1", track.getMBID());
+    ASSERT_EQ("5a5e0d4b-3c5e-4bf9-8f5b-0a0d2c4ae5f2", track.getAlbumMBID());
+    ASSERT_EQ("ALAC", track.toJSON()["format"].asString());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,165 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Importer.hpp>
+#include <ProgressReporter.hpp>
+
+#include <gtest/gtest.h>
+
+#include "FlacWriter.hpp"
+
+namespace fs = std::filesystem;
+
+using namespace MusicList;
+
+class ProgressReporterTest : public ::testing::Test
+{
+protected:
+    const fs::path LIBRARY_DIR = fs::path("./progressreporter-test-library");
+    const uint32_t TRACK_COUNT = 5;
+
+    void TearDown() override
+    {
+        fs::remove_all(LIBRARY_DIR);
+    }
+};
+
+TEST_F(ProgressReporterTest, FinalSnapshot)
+{
+    std::vector<ImportProgress> snapshots;
+    {
+        ProgressReporter reporter = ProgressReporter([&snapshots](const ImportProgress& progress)
+        {
+            snapshots.push_back(progress);
+        });
+
+        for (uint32_t i = 0; i < 10; i++)
+        {
+            reporter.addDiscovered();
+        }
+        for (uint32_t i = 0; i < 7; i++)
+        {
+            reporter.addImported();
+        }
+        reporter.addFailed();
+    }
+
+    // Nothing runs on the reporter thread anymore, so the vector is safe to read.
+    ASSERT_FALSE(snapshots.empty());
+    const ImportProgress& last = snapshots.back();
+    ASSERT_TRUE(last.finished);
+    ASSERT_EQ(10U, last.discovered);
+    ASSERT_EQ(7U, last.imported);
+    ASSERT_EQ(1U, last.failed);
+
+    for (size_t i = 0; i + 1 < snapshots.size(); i++)
+    {
+        ASSERT_FALSE(snapshots[i].finished);
+    }
+}
+
+TEST_F(ProgressReporterTest, RateLimited)
+{
+    std::mutex lock;
+    uint32_t calls = 0;
+    {
+        ProgressReporter reporter = ProgressReporter([&lock, &calls](const ImportProgress&)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            calls++;
+        }, std::chrono::milliseconds(50));
+
+        const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(275);
+        while (std::chrono::steady_clock::now() < end)
+        {
+            reporter.addImported();
+        }
+    }
+
+    // 5 periodic snapshots plus the final one, with some slack for a slow scheduler.
+    std::lock_guard<std::mutex> guard(lock);
+    ASSERT_GE(calls, 2U);
+    ASSERT_LE(calls, 7U);
+}
+
+TEST_F(ProgressReporterTest, JsonCallback)
+{
+    std::ostringstream out;
+    ImportProgress progress;
+    progress.discovered = 3;
+    progress.imported = 2;
+    progress.failed = 1;
+    progress.elapsed = std::chrono::milliseconds(42);
+    progress.finished = true;
+
+    ProgressReporter::jsonCallback(out)(progress);
+
+    ASSERT_EQ("{\"discovered\":3,\"elapsed_ms\":42,\"failed\":1,\"finished\":true,\"imported\":2}\n", out.str());
+}
+
+TEST_F(ProgressReporterTest, ImporterCallback)
+{
+    fs::create_directories(LIBRARY_DIR);
+    for (uint32_t i = 0; i < TRACK_COUNT; i++)
+    {
+        FlacWriter::write(LIBRARY_DIR / (std::to_string(i) + ".flac"), {"ALBUM=Album"});
+    }
+    std::ofstream(LIBRARY_DIR / "broken.flac") << "not a flac file";
+
+    ImportProgress last;
+    Importer importer = Importer(2);
+    importer.setQuiet(true);
+    importer.setProgressCallback([&last](const ImportProgress& progress)
+    {
+        last = progress;
+    });
+    importer.runTrackSearch(LIBRARY_DIR, 0);
+
+    ASSERT_TRUE(last.finished);
+    ASSERT_EQ(TRACK_COUNT + 1, last.discovered);
+    ASSERT_EQ(TRACK_COUNT, last.imported);
+    ASSERT_EQ(1U, last.failed);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
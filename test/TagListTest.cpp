@@ -0,0 +1,149 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <TagList.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace MusicList;
+
+TEST(StringPoolTest, InternsOnce)
+{
+    StringPool pool;
+    ASSERT_EQ(StringPool::EMPTY, pool.intern(""));
+
+    const StringPool::Id album = pool.intern("Morning Phase");
+    ASSERT_EQ(album, pool.intern(std::string("Morning ") + "Phase"));
+    ASSERT_NE(album, pool.intern("Sea Change"));
+    ASSERT_EQ("Morning Phase", pool.get(album));
+    ASSERT_EQ(3U, pool.size());
+
+    StringPool::Id found;
+    ASSERT_TRUE(pool.find("Sea Change", found));
+    ASSERT_FALSE(pool.find("Odelay", found));
+}
+
+TEST(StringPoolTest, StableAcrossGrowth)
+{
+    StringPool pool;
+    const StringPool::Id first = pool.intern("first");
+    const std::string* stored = &pool.get(first);
+
+    for (uint32_t i = 0; i < 10000; i++)
+    {
+        pool.intern(std::to_string(i));
+    }
+
+    ASSERT_EQ(stored, &pool.get(first));
+    ASSERT_EQ("9999", pool.get(pool.intern("9999")));
+}
+
+TEST(StringPoolTest, ConcurrentIntern)
+{
+    StringPool pool;
+    std::vector<std::vector<StringPool::Id>> ids(4);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < ids.size(); t++)
+    {
+        threads.emplace_back([&pool, &ids, t]
+        {
+            for (uint32_t i = 0; i < 5000; i++)
+            {
+                ids[t].push_back(pool.intern("value" + std::to_string(i)));
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (size_t t = 1; t < ids.size(); t++)
+    {
+        ASSERT_EQ(ids[0], ids[t]);
+    }
+    ASSERT_EQ(5001U, pool.size());
+}
+
+TEST(TagListTest, SetAndLookup)
+{
+    TagList tags;
+    ASSERT_TRUE(tags.empty());
+
+    tags.set("TITLE", "Turn Away");
+    tags.set("ALBUM", "Morning Phase");
+    tags.set("TITLE", "Wave");
+
+    ASSERT_EQ(2U, tags.size());
+    ASSERT_EQ("Wave", tags["TITLE"]);
+    ASSERT_EQ("Morning Phase", tags["ALBUM"]);
+    ASSERT_EQ("", tags["GENRE"]);
+    ASSERT_EQ(1U, tags.count("ALBUM"));
+    ASSERT_EQ(0U, tags.count("TAGLIST_TEST_UNPOOLED_KEY"));
+    ASSERT_EQ(StringPool::EMPTY, tags.valueId("TAGLIST_TEST_UNPOOLED_KEY"));
+
+    size_t visited = 0;
+    for (const auto tag : tags)
+    {
+        ASSERT_EQ(tags[tag.first], tag.second);
+        visited++;
+    }
+    ASSERT_EQ(tags.size(), visited);
+}
+
+TEST(TagListTest, Equality)
+{
+    TagList lhs;
+    lhs.set("ARTIST0", "Beck");
+    lhs.set("DATE", "2014");
+
+    TagList rhs;
+    rhs.set("DATE", "2014");
+    rhs.set("ARTIST0", "Beck");
+    ASSERT_EQ(lhs, rhs);
+
+    rhs.set("DATE", "2015");
+    ASSERT_NE(lhs, rhs);
+
+    rhs.clear();
+    ASSERT_TRUE(rhs.empty());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
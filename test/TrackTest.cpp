@@ -35,12 +35,18 @@
 #include <fstream>
 #include <sstream>
 #include <memory>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <Track.hpp>
 
 #include <gtest/gtest.h>
 #include <json/json.h>
 
+#include "FlacWriter.hpp"
+
 using namespace MusicList;
 
 namespace fs = std::filesystem;
@@ -120,6 +126,186 @@ TEST_F(TrackTest, ImportOpusMetadata)
     ASSERT_EQ(trackTags.size(), 27);
 }
 
+TEST_F(TrackTest, ImportVorbisMetadata)
+{
+    Track vorbisTrack = Track(this->VORBIS_PATH);
+
+    ASSERT_EQ("Beck", vorbisTrack.getArtist());
+    ASSERT_EQ("Morning Phase", vorbisTrack.getAlbum());
+    ASSERT_EQ("Turn Away", vorbisTrack.getTitle());
+    ASSERT_EQ(11, vorbisTrack.getTrackNum());
+    ASSERT_EQ(13, vorbisTrack.getTotalTracks());
+    ASSERT_EQ(1, vorbisTrack.getDiscNum());
+    ASSERT_EQ(1, vorbisTrack.getTotalDiscs());
+    ASSERT_FALSE(vorbisTrack.getIsLossless());
+}
+
+TEST_F(TrackTest, LazyTags)
+{
+    const fs::path lazyPath = fs::path("./track-test-lazy.flac");
+    FlacWriter::write(lazyPath, {"TITLE=Turn Away", "ALBUM=Morning Phase", "ALBUMARTIST=Beck", "ARTIST=Beck",
+                                 "TRACKNUMBER=11", "TOTALTRACKS=13", "MUSICBRAINZ_ALBUMID=album-id",
+                                 "GENRE=Folk", "DATE=2014"}, 256);
+
+    ReadOptions options;
+    options.lazyTags = true;
+
+    Track eagerTrack;
+    eagerTrack.setPath(lazyPath);
+    eagerTrack.readMetadata();
+    ASSERT_TRUE(eagerTrack.hasAllTags());
+
+    Track lazyTrack;
+    lazyTrack.setReadOptions(options);
+    lazyTrack.setPath(lazyPath);
+    lazyTrack.readMetadata();
+
+    // The summary covers everything needed to group and export the track.
+    ASSERT_FALSE(lazyTrack.hasAllTags());
+    ASSERT_EQ("Turn Away", lazyTrack.getTitle());
+    ASSERT_EQ("Morning Phase", lazyTrack.getAlbum());
+    ASSERT_EQ("Beck", lazyTrack.getArtist());
+    ASSERT_EQ("album-id", lazyTrack.getAlbumMBID());
+    ASSERT_EQ(11, lazyTrack.getTrackNum());
+    ASSERT_EQ(13, lazyTrack.getTotalTracks());
+    ASSERT_EQ(eagerTrack.toJSON(), lazyTrack.toJSON());
+    ASSERT_FALSE(lazyTrack.hasAllTags());
+
+    ASSERT_EQ("Folk", lazyTrack.getTag("GENRE"));
+    ASSERT_TRUE(lazyTrack.hasAllTags());
+    ASSERT_EQ(eagerTrack.getTags(), lazyTrack.getTags());
+    ASSERT_EQ("Beck", lazyTrack.getTag("ARTIST0"));
+
+    fs::remove(lazyPath);
+}
+
+TEST_F(TrackTest, LazyTagsMissingFile)
+{
+    const fs::path lazyPath = fs::path("./track-test-lazy-missing.flac");
+    FlacWriter::write(lazyPath, {"TITLE=Turn Away", "GENRE=Folk"}, 256);
+
+    ReadOptions options;
+    options.lazyTags = true;
+
+    Track lazyTrack;
+    lazyTrack.setReadOptions(options);
+    lazyTrack.setPath(lazyPath);
+    lazyTrack.readMetadata();
+    fs::remove(lazyPath);
+
+    // The summary tags are kept when the file is gone.
+    ASSERT_EQ("", lazyTrack.getTag("GENRE"));
+    ASSERT_EQ("Turn Away", lazyTrack.getTag("TITLE"));
+    ASSERT_TRUE(lazyTrack.hasAllTags());
+}
+
+TEST_F(TrackTest, LazyTagsConcurrent)
+{
+    const fs::path lazyPath = fs::path("./track-test-lazy-concurrent.flac");
+    FlacWriter::write(lazyPath, {"TITLE=Turn Away", "ARTIST=Beck", "GENRE=Folk", "DATE=2014"}, 256);
+
+    ReadOptions options;
+    options.lazyTags = true;
+
+    std::vector<Track> lazyTracks(8);
+    for (auto &lazyTrack : lazyTracks)
+    {
+        lazyTrack.setReadOptions(options);
+        lazyTrack.setPath(lazyPath);
+        lazyTrack.readMetadata();
+    }
+
+    // Every thread loads every track, so loads of the same and different tracks overlap.
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&lazyTracks]()
+        {
+            for (const auto &lazyTrack : lazyTracks)
+            {
+                EXPECT_EQ("Folk", lazyTrack.getTag("GENRE"));
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    for (const auto &lazyTrack : lazyTracks)
+    {
+        ASSERT_TRUE(lazyTrack.hasAllTags());
+        ASSERT_EQ("2014", lazyTrack.getTag("DATE"));
+        ASSERT_EQ("Beck", lazyTrack.getTag("ARTIST0"));
+    }
+
+    fs::remove(lazyPath);
+}
+
+TEST_F(TrackTest, OrderByMbid)
+{
+    const fs::path laterPath = fs::path("./track-test-order-later.flac");
+    const fs::path earlierPath = fs::path("./track-test-order-earlier.flac");
+    FlacWriter::write(laterPath, {"MUSICBRAINZ_TRACKID=f0000000-order-test"});
+    FlacWriter::write(earlierPath, {"MUSICBRAINZ_TRACKID=a0000000-order-test"});
+
+    // The later ID is pooled first, so its pooled id is the smaller one.
+    Track later;
+    later.setPath(laterPath);
+    later.readMetadata();
+    Track earlier;
+    earlier.setPath(earlierPath);
+    earlier.readMetadata();
+
+    ASSERT_TRUE(earlier < later);
+    ASSERT_FALSE(later < earlier);
+    ASSERT_TRUE(later > earlier);
+
+    fs::remove(laterPath);
+    fs::remove(earlierPath);
+}
+
+TEST_F(TrackTest, TagsAllocatedOnce)
+{
+    // Counts the allocations made for a Track's tag list.
+    class CountingResource : public std::pmr::memory_resource
+    {
+    public:
+        size_t allocations = 0;
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            this->allocations++;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    const fs::path tagPath = fs::path("./track-test-tags.flac");
+    FlacWriter::write(tagPath, {"TITLE=Turn Away", "ALBUM=Morning Phase", "ALBUMARTIST=Beck", "ARTIST=Beck",
+                                "GENRE=Folk", "DATE=2014", "LABEL=Capitol", "COMMENT=None", "LANGUAGE=eng"});
+
+    CountingResource resource;
+    {
+        Track track = Track(&resource);
+        track.setPath(tagPath);
+        track.readMetadata();
+        ASSERT_EQ(9U, track.getTags().size());
+    }
+    ASSERT_EQ(1U, resource.allocations);
+
+    fs::remove(tagPath);
+}
+
 TEST_F(TrackTest, GenerateJSON)
 {
     Track opusTrack = Track(this->OPUS_PATH);
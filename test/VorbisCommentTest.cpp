@@ -0,0 +1,419 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <FileReader.hpp>
+#include <OggPacketStream.hpp>
+#include <VorbisComment.hpp>
+
+#include <gtest/gtest.h>
+
+#include "FlacWriter.hpp"
+
+namespace fs = std::filesystem;
+
+using namespace MusicList;
+
+using std::string;
+using std::vector;
+
+class VorbisCommentTest : public ::testing::Test
+{
+protected:
+    const fs::path FLAC_PATH = fs::path("./vorbiscomment-test.flac");
+    const fs::path OPUS_PATH = fs::path("./vorbiscomment-test.opus");
+
+    const vector<string> COMMENTS = {
+        "TITLE=Turn Away", "ALBUM=Morning Phase", "ALBUMARTIST=Beck", "TRACKNUMBER=11",
+        "MUSICBRAINZ_TRACKID=4e8ff10b-1da4-4d4c-9b6a-4f8e0cf1a8f1", "EMPTY="
+    };
+
+    void TearDown() override
+    {
+        fs::remove(FLAC_PATH);
+        fs::remove(OPUS_PATH);
+    }
+
+    static void appendUInt32BE(string& out, uint32_t value)
+    {
+        for (int i = 3; i >= 0; i--)
+        {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    /**
+     * Builds the body of a FLAC PICTURE block holding `size` bytes of image data.
+     */
+    static string pictureBlock(uint32_t type, const string& mimeType, size_t size)
+    {
+        string block;
+        appendUInt32BE(block, type);
+        appendUInt32BE(block, static_cast<uint32_t>(mimeType.size()));
+        block.append(mimeType);
+        appendUInt32BE(block, 0);
+        for (int i = 0; i < 5; i++)
+        {
+            appendUInt32BE(block, 0);
+        }
+        appendUInt32BE(block, static_cast<uint32_t>(size));
+        return block + string(size, 'i');
+    }
+
+    static string base64Encode(const string& data)
+    {
+        static const char* ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        string out;
+        for (size_t i = 0; i < data.size(); i += 3)
+        {
+            uint32_t group = static_cast<uint8_t>(data[i]) << 16;
+            group |= i + 1 < data.size() ? static_cast<uint8_t>(data[i + 1]) << 8 : 0;
+            group |= i + 2 < data.size() ? static_cast<uint8_t>(data[i + 2]) : 0;
+
+            out.push_back(ALPHABET[(group >> 18) & 0x3F]);
+            out.push_back(ALPHABET[(group >> 12) & 0x3F]);
+            out.push_back(i + 1 < data.size() ? ALPHABET[(group >> 6) & 0x3F] : '=');
+            out.push_back(i + 2 < data.size() ? ALPHABET[group & 0x3F] : '=');
+        }
+        return out;
+    }
+
+    static string flacBlock(uint8_t type, bool isLast, const string& body)
+    {
+        string block;
+        FlacWriter::appendBlockHeader(block, type, isLast, static_cast<uint32_t>(body.size()));
+        return block + body;
+    }
+
+    /**
+     * Lays packets out over Ogg pages holding at most `maxSegments` lacing values each.
+     */
+    static string oggPages(const vector<string>& packets, uint8_t maxSegments)
+    {
+        vector<std::pair<uint8_t, string>> segments;
+        for (const auto& packet : packets)
+        {
+            size_t pos = 0;
+            while (true)
+            {
+                const size_t length = std::min<size_t>(255, packet.size() - pos);
+                segments.emplace_back(static_cast<uint8_t>(length), packet.substr(pos, length));
+                pos += length;
+                if (length < 255)
+                {
+                    break;
+                }
+            }
+        }
+
+        string out;
+        uint32_t sequence = 0;
+        for (size_t first = 0; first < segments.size(); first += maxSegments)
+        {
+            const size_t count = std::min<size_t>(maxSegments, segments.size() - first);
+            string header = "OggS";
+            header.push_back(0);
+            header.push_back(first == 0 ? 0x02 : 0x00);
+            header.append(8, '\0');
+            FlacWriter::appendUInt32LE(header, 0x1234);
+            FlacWriter::appendUInt32LE(header, sequence++);
+            FlacWriter::appendUInt32LE(header, 0);
+            header.push_back(static_cast<char>(count));
+
+            string payload;
+            for (size_t i = first; i < first + count; i++)
+            {
+                header.push_back(static_cast<char>(segments[i].first));
+                payload.append(segments[i].second);
+            }
+            out.append(header).append(payload);
+        }
+        return out;
+    }
+
+    static void writeFile(const fs::path& path, const string& data)
+    {
+        std::ofstream outFile = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        outFile.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    static vector<string> collect(bool (*reader)(FileReader&, const VorbisComment::EntryHandler&), const fs::path& path)
+    {
+        vector<string> entries;
+        FileReader fileReader = FileReader(path);
+        const bool success = reader(fileReader, [&entries](const char* entry, size_t length)
+        {
+            entries.emplace_back(entry, length);
+        });
+        if (!success)
+        {
+            entries.emplace_back("<failed>");
+        }
+        return entries;
+    }
+};
+
+TEST_F(VorbisCommentTest, ParseBlock)
+{
+    const string block = FlacWriter::commentBlock(COMMENTS);
+
+    vector<string> entries;
+    ASSERT_TRUE(VorbisComment::parse(reinterpret_cast<const uint8_t*>(block.data()), block.size(),
+        [&entries](const char* entry, size_t length) { entries.emplace_back(entry, length); }));
+    ASSERT_EQ(COMMENTS, entries);
+
+    ASSERT_FALSE(VorbisComment::parse(reinterpret_cast<const uint8_t*>(block.data()), block.size() - 1,
+        [](const char*, size_t) {}));
+}
+
+TEST_F(VorbisCommentTest, FlacFile)
+{
+    const string streamInfo = string(34, '\0');
+    const string padding = string(100, '\0');
+    writeFile(FLAC_PATH, "fLaC" + flacBlock(0, false, streamInfo) + flacBlock(1, false, padding) +
+        flacBlock(4, true, FlacWriter::commentBlock(COMMENTS)) + string(1000, '\xFF'));
+
+    ASSERT_EQ(COMMENTS, collect(VorbisComment::readFlac, FLAC_PATH));
+}
+
+TEST_F(VorbisCommentTest, FlacCommentPastPrefix)
+{
+    // A large block ahead of the comments pushes them out of the initial read.
+    const string picture = string(FileReader::PREFIX_SIZE + 5000, 'p');
+    writeFile(FLAC_PATH, "fLaC" + flacBlock(0, false, string(34, '\0')) + flacBlock(6, false, picture) +
+        flacBlock(4, true, FlacWriter::commentBlock(COMMENTS)));
+
+    ASSERT_EQ(COMMENTS, collect(VorbisComment::readFlac, FLAC_PATH));
+}
+
+TEST_F(VorbisCommentTest, FlacWithoutComments)
+{
+    writeFile(FLAC_PATH, "fLaC" + flacBlock(0, true, string(34, '\0')));
+
+    ASSERT_EQ(vector<string>{"<failed>"}, collect(VorbisComment::readFlac, FLAC_PATH));
+}
+
+TEST_F(VorbisCommentTest, OpusFile)
+{
+    const string head = "OpusHead" + string(11, '\1');
+    const string tags = "OpusTags" + FlacWriter::commentBlock(COMMENTS);
+    writeFile(OPUS_PATH, oggPages({head, tags, string(500, 'a')}, 255));
+
+    ASSERT_EQ(COMMENTS, collect(VorbisComment::readOpus, OPUS_PATH));
+}
+
+TEST_F(VorbisCommentTest, OpusCommentAcrossPages)
+{
+    vector<string> comments = COMMENTS;
+    comments.push_back("LYRICS=" + string(3000, 'l'));
+
+    const string head = "OpusHead" + string(11, '\1');
+    const string tags = "OpusTags" + FlacWriter::commentBlock(comments);
+    // Two lacing values per page splits the comment packet over many pages.
+    writeFile(OPUS_PATH, oggPages({head, tags, string(500, 'a')}, 2));
+
+    ASSERT_EQ(comments, collect(VorbisComment::readOpus, OPUS_PATH));
+}
+
+TEST_F(VorbisCommentTest, FlacLocation)
+{
+    writeFile(FLAC_PATH, "fLaC" + flacBlock(0, false, string(34, '\0')) + flacBlock(1, false, string(100, '\0')) +
+        flacBlock(4, true, FlacWriter::commentBlock(COMMENTS)));
+
+    FileReader fileReader = FileReader(FLAC_PATH);
+    VorbisComment::Location location;
+    ASSERT_TRUE(VorbisComment::readFlac(fileReader, [](const char*, size_t) {}, location));
+    ASSERT_EQ(4U + 38U + 104U + 4U, location.offset);
+    ASSERT_EQ(FlacWriter::commentBlock(COMMENTS).size(), location.length);
+
+    vector<string> entries;
+    FileReader secondReader = FileReader(FLAC_PATH);
+    ASSERT_TRUE(VorbisComment::readFlacAt(secondReader, location,
+        [&entries](const char* entry, size_t length) { entries.emplace_back(entry, length); }));
+    ASSERT_EQ(COMMENTS, entries);
+}
+
+TEST_F(VorbisCommentTest, OpusLocation)
+{
+    vector<string> comments = COMMENTS;
+    comments.push_back("LYRICS=" + string(3000, 'l'));
+
+    const string head = "OpusHead" + string(11, '\1');
+    // One lacing value per page puts the identification header on a page of its own and spreads
+    // the comment packet over many pages.
+    writeFile(OPUS_PATH, oggPages({head, "OpusTags" + FlacWriter::commentBlock(comments), string(500, 'a')}, 1));
+
+    FileReader fileReader = FileReader(OPUS_PATH);
+    VorbisComment::Location location;
+    ASSERT_TRUE(VorbisComment::readOpus(fileReader, [](const char*, size_t) {}, location));
+    ASSERT_EQ(27U + 1U + head.size(), location.offset);
+
+    vector<string> entries;
+    FileReader secondReader = FileReader(OPUS_PATH);
+    ASSERT_TRUE(VorbisComment::readOpusAt(secondReader, location,
+        [&entries](const char* entry, size_t length) { entries.emplace_back(entry, length); }));
+    ASSERT_EQ(comments, entries);
+}
+
+TEST_F(VorbisCommentTest, FlacPictures)
+{
+    const string cover = pictureBlock(3, "image/jpeg", FileReader::PREFIX_SIZE + 5000);
+    const string back = pictureBlock(4, "image/png", 100);
+    const string encodedBack = base64Encode(back);
+
+    vector<string> comments = COMMENTS;
+    comments.insert(comments.begin() + 2, "metadata_block_picture=" + encodedBack);
+    const string comment = FlacWriter::commentBlock(comments);
+    writeFile(FLAC_PATH, "fLaC" + flacBlock(0, false, string(34, '\0')) + flacBlock(6, false, cover) +
+        flacBlock(4, false, comment) + flacBlock(6, true, back));
+
+    FileReader fileReader = FileReader(FLAC_PATH);
+    VorbisComment::Location location;
+    vector<string> entries;
+    vector<VorbisComment::Picture> pictures;
+    ASSERT_TRUE(VorbisComment::readFlac(fileReader,
+        [&entries](const char* entry, size_t length) { entries.emplace_back(entry, length); }, location,
+        [&pictures](const VorbisComment::Picture& picture) { pictures.push_back(picture); }));
+
+    // The picture comment never reaches the entry handler, and the cover ahead of the comments
+    // isn't read to get to them.
+    ASSERT_EQ(COMMENTS, entries);
+    ASSERT_EQ(FileReader::PREFIX_SIZE, fileReader.size());
+
+    ASSERT_EQ(3U, pictures.size());
+    ASSERT_EQ(4U + 38U + 4U, pictures[0].offset);
+    ASSERT_EQ(cover.size(), pictures[0].length);
+    ASSERT_FALSE(pictures[0].base64);
+    ASSERT_EQ(3U, pictures[0].type);
+    ASSERT_EQ("image/jpeg", pictures[0].mimeType);
+
+    ASSERT_TRUE(pictures[1].base64);
+    ASSERT_EQ(encodedBack.size(), pictures[1].length);
+    ASSERT_EQ(4U, pictures[1].type);
+    ASSERT_EQ("image/png", pictures[1].mimeType);
+    string value = string(pictures[1].length, '\0');
+    ASSERT_EQ(value.size(), fileReader.readAt(pictures[1].offset, value.data(), value.size()));
+    ASSERT_EQ(encodedBack, value);
+
+    ASSERT_EQ(location.offset + comment.size() + 4U, pictures[2].offset);
+    ASSERT_EQ("image/png", pictures[2].mimeType);
+}
+
+TEST_F(VorbisCommentTest, FlacLargePictureComment)
+{
+    // A comment block too large to buffer is walked in place, skipping the picture.
+    vector<string> comments = COMMENTS;
+    comments.insert(comments.begin(), "METADATA_BLOCK_PICTURE=" +
+        base64Encode(pictureBlock(3, "image/jpeg", VorbisComment::MAX_BUFFERED_BLOCK)));
+    writeFile(FLAC_PATH, "fLaC" + flacBlock(0, false, string(34, '\0')) +
+        flacBlock(4, true, FlacWriter::commentBlock(comments)));
+
+    vector<string> entries;
+    FileReader fileReader = FileReader(FLAC_PATH);
+    ASSERT_TRUE(VorbisComment::readFlac(fileReader,
+        [&entries](const char* entry, size_t length) { entries.emplace_back(entry, length); }));
+    ASSERT_EQ(COMMENTS, entries);
+    ASSERT_EQ(FileReader::PREFIX_SIZE, fileReader.size());
+}
+
+TEST_F(VorbisCommentTest, OpusPictureComment)
+{
+    const string encoded = base64Encode(pictureBlock(3, "image/jpeg", 3000));
+    vector<string> comments = COMMENTS;
+    comments.push_back("METADATA_BLOCK_PICTURE=" + encoded);
+
+    const string head = "OpusHead" + string(11, '\1');
+    writeFile(OPUS_PATH, oggPages({head, "OpusTags" + FlacWriter::commentBlock(comments), string(500, 'a')}, 1));
+
+    FileReader fileReader = FileReader(OPUS_PATH);
+    VorbisComment::Location location;
+    vector<string> entries;
+    vector<VorbisComment::Picture> pictures;
+    ASSERT_TRUE(VorbisComment::readOpus(fileReader,
+        [&entries](const char* entry, size_t length) { entries.emplace_back(entry, length); }, location,
+        [&pictures](const VorbisComment::Picture& picture) { pictures.push_back(picture); }));
+    ASSERT_EQ(COMMENTS, entries);
+
+    ASSERT_EQ(1U, pictures.size());
+    ASSERT_EQ(location.offset, pictures[0].offset);
+    ASSERT_EQ(encoded.size(), pictures[0].length);
+    ASSERT_EQ("image/jpeg", pictures[0].mimeType);
+
+    // The value can be read straight from the comment header's page.
+    OggPacketStream stream = OggPacketStream(fileReader, pictures[0].offset);
+    ASSERT_TRUE(stream.nextPacket());
+    ASSERT_EQ(pictures[0].packetOffset, stream.skip(pictures[0].packetOffset));
+    string value = string(pictures[0].length, '\0');
+    ASSERT_EQ(value.size(), stream.read(value.data(), value.size()));
+    ASSERT_EQ(encoded, value);
+}
+
+TEST_F(VorbisCommentTest, VorbisFile)
+{
+    vector<string> comments = COMMENTS;
+    comments.push_back("LYRICS=" + string(3000, 'l'));
+
+    const string identification = "\x01vorbis" + string(23, '\0');
+    // The comment header ends with a framing bit and shares its last page with the setup header.
+    const string comment = "\x03vorbis" + FlacWriter::commentBlock(comments) + "\x01";
+    const string setup = "\x05vorbis" + string(300, 's');
+    writeFile(OPUS_PATH, oggPages({identification, comment, setup, string(500, 'a')}, 4));
+
+    ASSERT_EQ(comments, collect(VorbisComment::readVorbis, OPUS_PATH));
+    ASSERT_EQ(vector<string>{"<failed>"}, collect(VorbisComment::readOpus, OPUS_PATH));
+}
+
+TEST_F(VorbisCommentTest, NotVorbis)
+{
+    const string head = "OpusHead" + string(11, '\1');
+    writeFile(OPUS_PATH, oggPages({head, "OpusTags" + FlacWriter::commentBlock(COMMENTS)}, 255));
+
+    ASSERT_EQ(vector<string>{"<failed>"}, collect(VorbisComment::readVorbis, OPUS_PATH));
+}
+
+TEST_F(VorbisCommentTest, NotOpus)
+{
+    writeFile(OPUS_PATH, oggPages({"\x01vorbis" + string(23, '\0'), "\x03vorbis"}, 255));
+
+    ASSERT_EQ(vector<string>{"<failed>"}, collect(VorbisComment::readOpus, OPUS_PATH));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
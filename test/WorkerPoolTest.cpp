@@ -0,0 +1,130 @@
+/*
+  BSD 3-Clause License
+  
+  Copyright (c) 2020, Brenden Davidson
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+  
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+  
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  
+*/
+#include <atomic>
+#include <vector>
+
+#include <WorkerPool.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace MusicList;
+
+class WorkerPoolTest : public ::testing::Test
+{
+protected:
+    const uint32_t TASK_COUNT = 10000U;
+};
+
+TEST_F(WorkerPoolTest, RunsEveryTask)
+{
+    std::vector<uint32_t> results(TASK_COUNT, 0);
+
+    WorkerPool pool(4);
+    for (uint32_t i = 0; i < TASK_COUNT; i++)
+    {
+        pool.submit([&results, i] { results[i] = i * 2; });
+    }
+    pool.wait();
+
+    for (uint32_t i = 0; i < TASK_COUNT; i++)
+    {
+        ASSERT_EQ(i * 2, results[i]);
+    }
+}
+
+TEST_F(WorkerPoolTest, NestedSubmit)
+{
+    std::atomic<uint32_t> count = 0;
+
+    WorkerPool pool(3);
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        pool.submit([&pool, &count]
+        {
+            for (uint32_t j = 0; j < 10; j++)
+            {
+                pool.submit([&count] { count++; });
+            }
+        });
+    }
+    pool.wait();
+
+    ASSERT_EQ(1000U, count.load());
+}
+
+TEST_F(WorkerPoolTest, ReusableAfterWait)
+{
+    std::atomic<uint32_t> count = 0;
+
+    WorkerPool pool(0);
+    ASSERT_GE(pool.size(), 1U);
+
+    pool.submit([&count] { count++; });
+    pool.wait();
+    pool.submit([&count] { count++; });
+    ASSERT_TRUE(pool.waitFor(std::chrono::milliseconds(5000)));
+
+    ASSERT_EQ(2U, count.load());
+}
+
+TEST_F(WorkerPoolTest, BoundedBacklog)
+{
+    std::atomic<uint32_t> count = 0;
+    std::atomic<uint32_t> maxSeen = 0;
+    std::atomic<uint32_t> submitted = 0;
+
+    WorkerPool pool(2, 8);
+    for (uint32_t i = 0; i < TASK_COUNT; i++)
+    {
+        submitted++;
+        pool.submit([&count, &maxSeen, &submitted]
+        {
+            // Read in this order so a task finishing in between can't make the backlog negative.
+            const uint32_t done = count;
+            const uint32_t backlog = submitted - done;
+            uint32_t seen = maxSeen;
+            while (backlog > seen && !maxSeen.compare_exchange_weak(seen, backlog)) {}
+            count++;
+        });
+    }
+    pool.wait();
+
+    ASSERT_EQ(TASK_COUNT, count.load());
+    // Queued tasks plus the ones currently running on each worker.
+    ASSERT_LE(maxSeen.load(), 8U + 2U + 1U);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}